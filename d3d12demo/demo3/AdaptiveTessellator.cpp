@@ -0,0 +1,808 @@
+#include "AdaptiveTessellator.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include "BezierPatch.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ADAPTIVE_TESSELLATOR_SSE2 1
+#endif
+
+using namespace std;
+
+namespace
+{
+	const uint32_t maxSupportedDepth{ 12 };
+	// eye plane distance below which a control point counts as behind the eye
+	const float minClipW{ 1e-4f };
+	// cosine of the angle below which two open edges from a vertex run along each other
+	const float alongCosine{ 0.99f };
+
+	// Domain coordinates are in steps of 2^-(maxDepth + 1), so leaf corners are even and leaf centers integers.
+	struct SubPatch
+	{
+		// four rows along v of four control points along u, one array per coordinate
+		float coordinates[3][16];
+		uint32_t u0;
+		uint32_t v0;
+		uint32_t u1;
+		uint32_t v1;
+		uint32_t depthU;
+		uint32_t depthV;
+	};
+
+	struct Leaf
+	{
+		uint32_t u0;
+		uint32_t v0;
+		uint32_t u1;
+		uint32_t v1;
+	};
+
+	// a patch border in the orientation whose control points compare lower, and the points every patch on it needs
+	struct BorderCurve
+	{
+		Float3 points[4];
+		vector<uint32_t> params;
+	};
+
+	struct PatchBorder
+	{
+		uint32_t curve;
+		bool reversed;
+	};
+
+	struct Flatness
+	{
+		// bound on the distance of the surface from the two triangles between its corners
+		float error;
+		// how far the control points bend away from straight lines along u and along v
+		float alongU;
+		float alongV;
+	};
+
+	// control points of the borders v = 0, u = 1, v = 1 and u = 0, each by increasing parameter
+	const uint32_t borderPoints[4][4]{ { 0, 1, 2, 3 }, { 3, 7, 11, 15 }, { 12, 13, 14, 15 }, { 0, 4, 8, 12 } };
+
+#if defined(ADAPTIVE_TESSELLATOR_SSE2)
+	// de Casteljau at 1/2 of four cubics at once, one per lane
+	void splitCurves(__m128 p0, __m128 p1, __m128 p2, __m128 p3, __m128* low, __m128* high)
+	{
+		const __m128 half{ _mm_set1_ps(0.5f) };
+		__m128 p01{ _mm_mul_ps(_mm_add_ps(p0, p1), half) };
+		__m128 p12{ _mm_mul_ps(_mm_add_ps(p1, p2), half) };
+		__m128 p23{ _mm_mul_ps(_mm_add_ps(p2, p3), half) };
+		__m128 p012{ _mm_mul_ps(_mm_add_ps(p01, p12), half) };
+		__m128 p123{ _mm_mul_ps(_mm_add_ps(p12, p23), half) };
+		__m128 middle{ _mm_mul_ps(_mm_add_ps(p012, p123), half) };
+		low[0] = p0;
+		low[1] = p01;
+		low[2] = p012;
+		low[3] = middle;
+		high[0] = middle;
+		high[1] = p123;
+		high[2] = p23;
+		high[3] = p3;
+	}
+
+	// the straight line from lane 0 to lane 3 at the parameters in ramp
+	__m128 getLine(__m128 points, __m128 ramp)
+	{
+		__m128 first{ _mm_shuffle_ps(points, points, _MM_SHUFFLE(0, 0, 0, 0)) };
+		__m128 last{ _mm_shuffle_ps(points, points, _MM_SHUFFLE(3, 3, 3, 3)) };
+		return _mm_add_ps(first, _mm_mul_ps(_mm_sub_ps(last, first), ramp));
+	}
+
+	float getHorizontalMax(__m128 v)
+	{
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(v);
+	}
+#else
+	void splitCurve(const float* p, size_t stride, float* low, float* high)
+	{
+		float p01{ (p[0] + p[stride]) * 0.5f };
+		float p12{ (p[stride] + p[2 * stride]) * 0.5f };
+		float p23{ (p[2 * stride] + p[3 * stride]) * 0.5f };
+		float p012{ (p01 + p12) * 0.5f };
+		float p123{ (p12 + p23) * 0.5f };
+		float middle{ (p012 + p123) * 0.5f };
+		low[0] = p[0];
+		low[stride] = p01;
+		low[2 * stride] = p012;
+		low[3 * stride] = middle;
+		high[0] = middle;
+		high[stride] = p123;
+		high[2 * stride] = p23;
+		high[3 * stride] = p[3 * stride];
+	}
+#endif
+
+	void splitU(const SubPatch& patch, SubPatch& low, SubPatch& high)
+	{
+		for (size_t c = 0; c < 3; ++c)
+		{
+			const float* p{ patch.coordinates[c] };
+#if defined(ADAPTIVE_TESSELLATOR_SSE2)
+			// transposed, each register holds one column and the lanes are the rows
+			__m128 r0{ _mm_loadu_ps(p) };
+			__m128 r1{ _mm_loadu_ps(p + 4) };
+			__m128 r2{ _mm_loadu_ps(p + 8) };
+			__m128 r3{ _mm_loadu_ps(p + 12) };
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			__m128 l[4];
+			__m128 h[4];
+			splitCurves(r0, r1, r2, r3, l, h);
+			_MM_TRANSPOSE4_PS(l[0], l[1], l[2], l[3]);
+			_MM_TRANSPOSE4_PS(h[0], h[1], h[2], h[3]);
+			for (size_t row = 0; row < 4; ++row)
+			{
+				_mm_storeu_ps(low.coordinates[c] + row * 4, l[row]);
+				_mm_storeu_ps(high.coordinates[c] + row * 4, h[row]);
+			}
+#else
+			for (size_t row = 0; row < 4; ++row)
+			{
+				splitCurve(p + row * 4, 1, low.coordinates[c] + row * 4, high.coordinates[c] + row * 4);
+			}
+#endif
+		}
+	}
+
+	void splitV(const SubPatch& patch, SubPatch& low, SubPatch& high)
+	{
+		for (size_t c = 0; c < 3; ++c)
+		{
+			const float* p{ patch.coordinates[c] };
+#if defined(ADAPTIVE_TESSELLATOR_SSE2)
+			__m128 l[4];
+			__m128 h[4];
+			splitCurves(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), _mm_loadu_ps(p + 8), _mm_loadu_ps(p + 12), l, h);
+			for (size_t row = 0; row < 4; ++row)
+			{
+				_mm_storeu_ps(low.coordinates[c] + row * 4, l[row]);
+				_mm_storeu_ps(high.coordinates[c] + row * 4, h[row]);
+			}
+#else
+			for (size_t column = 0; column < 4; ++column)
+			{
+				splitCurve(p + column, 4, low.coordinates[c] + column, high.coordinates[c] + column);
+			}
+#endif
+		}
+	}
+
+	// The bicubic patch through the corners with its inner control points at thirds is the bilinear patch, so the
+	// control points' distance from that bounds the surface's, and the triangles are off the bilinear patch by at
+	// most a quarter of its twist.
+	Flatness measureFlatness(const float(&coordinates)[3][16])
+	{
+		float bilinearSquared;
+		float alongUSquared;
+		float alongVSquared;
+#if defined(ADAPTIVE_TESSELLATOR_SSE2)
+		const __m128 ramp{ _mm_setr_ps(0.0f, 1.0f / 3.0f, 2.0f / 3.0f, 1.0f) };
+		__m128 bilinear{ _mm_setzero_ps() };
+		__m128 alongU{ _mm_setzero_ps() };
+		__m128 alongV{ _mm_setzero_ps() };
+		for (size_t row = 0; row < 4; ++row)
+		{
+			const __m128 t{ _mm_set1_ps(row / 3.0f) };
+			__m128 bilinearRow{ _mm_setzero_ps() };
+			__m128 alongURow{ _mm_setzero_ps() };
+			__m128 alongVRow{ _mm_setzero_ps() };
+			for (size_t c = 0; c < 3; ++c)
+			{
+				const float* p{ coordinates[c] };
+				__m128 first{ _mm_loadu_ps(p) };
+				__m128 points{ _mm_loadu_ps(p + row * 4) };
+				// the straight lines along v from the first row to the last, at this row
+				__m128 columns{ _mm_add_ps(first, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(p + 12), first), t)) };
+				__m128 d{ _mm_sub_ps(points, getLine(columns, ramp)) };
+				bilinearRow = _mm_add_ps(bilinearRow, _mm_mul_ps(d, d));
+				d = _mm_sub_ps(points, getLine(points, ramp));
+				alongURow = _mm_add_ps(alongURow, _mm_mul_ps(d, d));
+				d = _mm_sub_ps(points, columns);
+				alongVRow = _mm_add_ps(alongVRow, _mm_mul_ps(d, d));
+			}
+			bilinear = _mm_max_ps(bilinear, bilinearRow);
+			alongU = _mm_max_ps(alongU, alongURow);
+			alongV = _mm_max_ps(alongV, alongVRow);
+		}
+		bilinearSquared = getHorizontalMax(bilinear);
+		alongUSquared = getHorizontalMax(alongU);
+		alongVSquared = getHorizontalMax(alongV);
+#else
+		bilinearSquared = 0.0f;
+		alongUSquared = 0.0f;
+		alongVSquared = 0.0f;
+		for (size_t row = 0; row < 4; ++row)
+		{
+			float t{ row / 3.0f };
+			for (size_t i = 0; i < 4; ++i)
+			{
+				float s{ i / 3.0f };
+				float bilinearPoint{ 0.0f };
+				float alongUPoint{ 0.0f };
+				float alongVPoint{ 0.0f };
+				for (size_t c = 0; c < 3; ++c)
+				{
+					const float* p{ coordinates[c] };
+					float point{ p[row * 4 + i] };
+					float columnFirst{ p[0] + (p[12] - p[0]) * t };
+					float columnLast{ p[3] + (p[15] - p[3]) * t };
+					float column{ p[i] + (p[12 + i] - p[i]) * t };
+					float d{ point - (columnFirst + (columnLast - columnFirst) * s) };
+					bilinearPoint += d * d;
+					d = point - (p[row * 4] + (p[row * 4 + 3] - p[row * 4]) * s);
+					alongUPoint += d * d;
+					d = point - column;
+					alongVPoint += d * d;
+				}
+				bilinearSquared = max(bilinearSquared, bilinearPoint);
+				alongUSquared = max(alongUSquared, alongUPoint);
+				alongVSquared = max(alongVSquared, alongVPoint);
+			}
+		}
+#endif
+		float twistSquared{ 0.0f };
+		for (size_t c = 0; c < 3; ++c)
+		{
+			const float* p{ coordinates[c] };
+			float twist{ p[0] - p[3] - p[12] + p[15] };
+			twistSquared += twist * twist;
+		}
+		return{ sqrt(bilinearSquared) + 0.25f * sqrt(twistSquared), sqrt(alongUSquared), sqrt(alongVSquared) };
+	}
+
+	Flatness measureFlatness(const SubPatch& patch, const AdaptiveTessellationSettings& settings)
+	{
+		if (!settings.worldViewProj)
+		{
+			return measureFlatness(patch.coordinates);
+		}
+
+		float projected[3][16];
+		for (size_t i = 0; i < 16; ++i)
+		{
+			Float4 clip{ math::transformPoint({ patch.coordinates[0][i], patch.coordinates[1][i], patch.coordinates[2][i] }, *settings.worldViewProj) };
+			if (clip.w <= minClipW)
+			{
+				return{ 0.0f, 0.0f, 0.0f };
+			}
+			projected[0][i] = clip.x / clip.w * 0.5f * settings.viewportWidth;
+			projected[1][i] = clip.y / clip.w * 0.5f * settings.viewportHeight;
+			projected[2][i] = 0.0f;
+		}
+		return measureFlatness(projected);
+	}
+
+	void subdividePatch(const SubPatch& root, const AdaptiveTessellationSettings& settings, vector<SubPatch>& stack, vector<Leaf>& leaves, uint32_t& deepest)
+	{
+		stack.clear();
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			SubPatch patch{ stack.back() };
+			stack.pop_back();
+
+			Flatness flatness{ measureFlatness(patch, settings) };
+			bool canSplitU{ patch.depthU < settings.maxDepth };
+			bool canSplitV{ patch.depthV < settings.maxDepth };
+			if (flatness.error <= settings.tolerance || (!canSplitU && !canSplitV))
+			{
+				leaves.push_back({ patch.u0, patch.v0, patch.u1, patch.v1 });
+				deepest = max(deepest, max(patch.depthU, patch.depthV));
+				continue;
+			}
+
+			stack.resize(stack.size() + 2);
+			SubPatch& low{ stack[stack.size() - 2] };
+			SubPatch& high{ stack[stack.size() - 1] };
+			low = patch;
+			high = patch;
+			if (canSplitU && (flatness.alongU >= flatness.alongV || !canSplitV))
+			{
+				splitU(patch, low, high);
+				low.u1 = high.u0 = (patch.u0 + patch.u1) / 2;
+				low.depthU = high.depthU = patch.depthU + 1;
+			}
+			else
+			{
+				splitV(patch, low, high);
+				low.v1 = high.v0 = (patch.v0 + patch.v1) / 2;
+				low.depthV = high.depthV = patch.depthV + 1;
+			}
+		}
+	}
+
+	bool samePosition(const Float3& a, const Float3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	array<float, 12> getCurveKey(const Float3* points)
+	{
+		return{ points[0].x, points[0].y, points[0].z, points[1].x, points[1].y, points[1].z,
+			points[2].x, points[2].y, points[2].z, points[3].x, points[3].y, points[3].z };
+	}
+
+	uint32_t packCoordinates(uint32_t major, uint32_t minor)
+	{
+		return (major << 16) | minor;
+	}
+
+	// params strictly between first and last of the points packed with major in sorted
+	void gatherBetween(const vector<uint32_t>& sorted, uint32_t major, uint32_t first, uint32_t last, vector<uint32_t>& params)
+	{
+		auto it = upper_bound(sorted.begin(), sorted.end(), packCoordinates(major, first));
+		for (; it != sorted.end() && *it < packCoordinates(major, last); ++it)
+		{
+			params.push_back(*it & 0xffff);
+		}
+	}
+
+	void gatherBetween(const vector<uint32_t>& params, uint32_t first, uint32_t last, vector<uint32_t>& between)
+	{
+		for (auto it = upper_bound(params.begin(), params.end(), first); it != params.end() && *it < last; ++it)
+		{
+			between.push_back(*it);
+		}
+	}
+}
+
+namespace teapot_tutorial
+{
+	AdaptiveTessellationResult tessellateAdaptive(const PatchModel& model, const AdaptiveTessellationSettings& settings, TessellatedMesh& mesh)
+	{
+		if (!(settings.tolerance > 0.0f) || settings.maxDepth > maxSupportedDepth)
+		{
+			throw(runtime_error{ "Invalid adaptive tessellation settings." });
+		}
+
+		AdaptiveTessellationResult result{ 0, 0, 0, 0 };
+		size_t patchCount{ model.getPatchCount() };
+		const uint32_t size{ 2u << settings.maxDepth };
+		vector<Float3> controlPoints(patchCount * PatchModel::controlPointsPerPatch);
+		vector<Leaf> leaves;
+		vector<size_t> leafOffsets{ 0 };
+		vector<SubPatch> stack;
+		for (size_t patch = 0; patch < patchCount; ++patch)
+		{
+			Float3* points{ &controlPoints[patch * PatchModel::controlPointsPerPatch] };
+			gatherControlPoints(model, patch, points);
+			// the transforms are affine, so transforming the control points transforms the surface
+			const Float4x4& transform{ patch < model.patchesTransforms.size() ? model.patchesTransforms[patch] : math::identity() };
+			SubPatch root;
+			for (size_t i = 0; i < PatchModel::controlPointsPerPatch; ++i)
+			{
+				points[i] = bezier::transformPosition(points[i], transform);
+				root.coordinates[0][i] = points[i].x;
+				root.coordinates[1][i] = points[i].y;
+				root.coordinates[2][i] = points[i].z;
+			}
+			root.u0 = root.v0 = 0;
+			root.u1 = root.v1 = size;
+			root.depthU = root.depthV = 0;
+			subdividePatch(root, settings, stack, leaves, result.maxDepth);
+			leafOffsets.push_back(leaves.size());
+		}
+		result.leaves = leaves.size();
+
+		// every patch puts the leaf corners on its borders into the border's curve
+		vector<BorderCurve> curves;
+		vector<PatchBorder> borders(patchCount * 4);
+		map<array<float, 12>, uint32_t> curveIndices;
+		for (size_t patch = 0; patch < patchCount; ++patch)
+		{
+			for (uint32_t border = 0; border < 4; ++border)
+			{
+				Float3 points[4];
+				Float3 reversedPoints[4];
+				for (size_t i = 0; i < 4; ++i)
+				{
+					points[i] = controlPoints[patch * PatchModel::controlPointsPerPatch + borderPoints[border][i]];
+					reversedPoints[3 - i] = points[i];
+				}
+				array<float, 12> key{ getCurveKey(points) };
+				array<float, 12> reversedKey{ getCurveKey(reversedPoints) };
+				bool reversed{ reversedKey < key };
+				auto inserted = curveIndices.insert({ reversed ? reversedKey : key, static_cast<uint32_t>(curves.size()) });
+				if (inserted.second)
+				{
+					curves.emplace_back();
+					copy(reversed ? reversedPoints : points, (reversed ? reversedPoints : points) + 4, curves.back().points);
+				}
+				PatchBorder& patchBorder{ borders[patch * 4 + border] };
+				patchBorder.curve = inserted.first->second;
+				patchBorder.reversed = reversed;
+
+				vector<uint32_t>& params{ curves[patchBorder.curve].params };
+				for (size_t leaf = leafOffsets[patch]; leaf < leafOffsets[patch + 1]; ++leaf)
+				{
+					const Leaf& l{ leaves[leaf] };
+					bool onBorder{ border == 0 ? l.v0 == 0 : border == 1 ? l.u1 == size : border == 2 ? l.v1 == size : l.u0 == 0 };
+					if (onBorder)
+					{
+						bool alongU{ border == 0 || border == 2 };
+						for (uint32_t param : { alongU ? l.u0 : l.v0, alongU ? l.u1 : l.v1 })
+						{
+							params.push_back(reversed ? size - param : param);
+						}
+					}
+				}
+			}
+		}
+		for (BorderCurve& curve : curves)
+		{
+			sort(curve.params.begin(), curve.params.end());
+			curve.params.erase(unique(curve.params.begin(), curve.params.end()), curve.params.end());
+		}
+
+		mesh.positions.clear();
+		mesh.colors.clear();
+		mesh.indices.clear();
+		vector<uint32_t> cornersByU;
+		vector<uint32_t> cornersByV;
+		vector<uint32_t> borderParams[4];
+		unordered_map<uint32_t, uint32_t> vertices;
+		vector<uint32_t> loop;
+		vector<uint32_t> between;
+		for (size_t patch = 0; patch < patchCount; ++patch)
+		{
+			const Float3* points{ &controlPoints[patch * PatchModel::controlPointsPerPatch] };
+			Float3 color{ patch < model.patchesColors.size() ? model.patchesColors[patch] : Float3{ 1.0f, 1.0f, 1.0f } };
+			size_t firstLeaf{ leafOffsets[patch] };
+			size_t lastLeaf{ leafOffsets[patch + 1] };
+
+			cornersByU.clear();
+			cornersByV.clear();
+			for (size_t leaf = firstLeaf; leaf < lastLeaf; ++leaf)
+			{
+				const Leaf& l{ leaves[leaf] };
+				for (uint32_t u : { l.u0, l.u1 })
+				{
+					for (uint32_t v : { l.v0, l.v1 })
+					{
+						cornersByU.push_back(packCoordinates(u, v));
+						cornersByV.push_back(packCoordinates(v, u));
+					}
+				}
+			}
+			for (vector<uint32_t>* corners : { &cornersByU, &cornersByV })
+			{
+				sort(corners->begin(), corners->end());
+				corners->erase(unique(corners->begin(), corners->end()), corners->end());
+			}
+			for (uint32_t border = 0; border < 4; ++border)
+			{
+				const PatchBorder& patchBorder{ borders[patch * 4 + border] };
+				borderParams[border] = curves[patchBorder.curve].params;
+				if (patchBorder.reversed)
+				{
+					reverse(borderParams[border].begin(), borderParams[border].end());
+					for (uint32_t& param : borderParams[border])
+					{
+						param = size - param;
+					}
+				}
+			}
+
+			vertices.clear();
+			auto getVertex = [&](uint32_t u, uint32_t v) -> uint32_t
+			{
+				auto inserted = vertices.insert({ packCoordinates(u, v), static_cast<uint32_t>(mesh.positions.size()) });
+				if (!inserted.second)
+				{
+					return inserted.first->second;
+				}
+
+				int32_t border{ v == 0 ? 0 : u == size ? 1 : v == size ? 2 : u == 0 ? 3 : -1 };
+				if (border < 0)
+				{
+					mesh.positions.push_back(bezier::evaluate(points, static_cast<float>(u) / size, static_cast<float>(v) / size));
+				}
+				else
+				{
+					// from the curve in its own orientation, for every patch on it to compute the same position
+					const PatchBorder& patchBorder{ borders[patch * 4 + border] };
+					const Float3* p{ curves[patchBorder.curve].points };
+					uint32_t param{ border == 0 || border == 2 ? u : v };
+					Float4 basis{ bezier::bernsteinBasis(static_cast<float>(patchBorder.reversed ? size - param : param) / size) };
+					mesh.positions.push_back(p[0] * basis.x + p[1] * basis.y + p[2] * basis.z + p[3] * basis.w);
+				}
+				mesh.colors.push_back(color);
+				return inserted.first->second;
+			};
+			auto addTriangle = [&](uint32_t a, uint32_t b, uint32_t c)
+			{
+				const vector<Float3>& p{ mesh.positions };
+				if (samePosition(p[a], p[b]) || samePosition(p[b], p[c]) || samePosition(p[c], p[a]))
+				{
+					return;
+				}
+				mesh.indices.push_back(a);
+				mesh.indices.push_back(b);
+				mesh.indices.push_back(c);
+			};
+
+			for (size_t leaf = firstLeaf; leaf < lastLeaf; ++leaf)
+			{
+				const Leaf& l{ leaves[leaf] };
+				// clockwise in the domain, like the triangles of writeGridIndices: up the u0 edge, along v1, down
+				// the u1 edge and back along v0, with the corners of finer neighbors on the way
+				loop.clear();
+				for (uint32_t edge = 0; edge < 4; ++edge)
+				{
+					between.clear();
+					switch (edge)
+					{
+					case 0:
+						loop.push_back(getVertex(l.u0, l.v0));
+						l.u0 == 0 ? gatherBetween(borderParams[3], l.v0, l.v1, between) : gatherBetween(cornersByU, l.u0, l.v0, l.v1, between);
+						for (uint32_t v : between)
+						{
+							loop.push_back(getVertex(l.u0, v));
+						}
+						break;
+					case 1:
+						loop.push_back(getVertex(l.u0, l.v1));
+						l.v1 == size ? gatherBetween(borderParams[2], l.u0, l.u1, between) : gatherBetween(cornersByV, l.v1, l.u0, l.u1, between);
+						for (uint32_t u : between)
+						{
+							loop.push_back(getVertex(u, l.v1));
+						}
+						break;
+					case 2:
+						loop.push_back(getVertex(l.u1, l.v1));
+						l.u1 == size ? gatherBetween(borderParams[1], l.v0, l.v1, between) : gatherBetween(cornersByU, l.u1, l.v0, l.v1, between);
+						for (auto it = between.rbegin(); it != between.rend(); ++it)
+						{
+							loop.push_back(getVertex(l.u1, *it));
+						}
+						break;
+					default:
+						loop.push_back(getVertex(l.u1, l.v0));
+						l.v0 == 0 ? gatherBetween(borderParams[0], l.u0, l.u1, between) : gatherBetween(cornersByV, l.v0, l.u0, l.u1, between);
+						for (auto it = between.rbegin(); it != between.rend(); ++it)
+						{
+							loop.push_back(getVertex(*it, l.v0));
+						}
+						break;
+					}
+				}
+
+				if (loop.size() == 4)
+				{
+					addTriangle(loop[0], loop[1], loop[3]);
+					addTriangle(loop[3], loop[1], loop[2]);
+				}
+				else
+				{
+					uint32_t center{ getVertex((l.u0 + l.u1) / 2, (l.v0 + l.v1) / 2) };
+					for (size_t i = 0; i < loop.size(); ++i)
+					{
+						addTriangle(center, loop[i], loop[(i + 1) % loop.size()]);
+					}
+					++result.stitchedLeaves;
+				}
+			}
+		}
+		result.triangles = mesh.getTriangleCount();
+		return result;
+	}
+
+	size_t countTJunctions(const TessellatedMesh& mesh)
+	{
+		vector<uint32_t> order(mesh.positions.size());
+		for (uint32_t i = 0; i < order.size(); ++i)
+		{
+			order[i] = i;
+		}
+		auto less = [&](uint32_t a, uint32_t b)
+		{
+			const Float3& p{ mesh.positions[a] };
+			const Float3& q{ mesh.positions[b] };
+			return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+		};
+		sort(order.begin(), order.end(), less);
+		vector<uint32_t> welded(mesh.positions.size());
+		uint32_t weldedCount{ 0 };
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			weldedCount += i > 0 && less(order[i - 1], order[i]) ? 1 : 0;
+			welded[order[i]] = weldedCount;
+		}
+
+		vector<uint64_t> edges;
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				uint64_t a{ welded[mesh.indices[i + corner]] };
+				uint64_t b{ welded[mesh.indices[i + (corner + 1) % 3]] };
+				if (a != b)
+				{
+					edges.push_back((a << 32) | b);
+				}
+			}
+		}
+		sort(edges.begin(), edges.end());
+
+		// open edges by vertex, with the vertex at their other end
+		vector<pair<uint32_t, uint32_t>> open;
+		for (uint64_t edge : edges)
+		{
+			uint32_t a{ static_cast<uint32_t>(edge >> 32) };
+			uint32_t b{ static_cast<uint32_t>(edge) };
+			if (!binary_search(edges.begin(), edges.end(), (static_cast<uint64_t>(b) << 32) | a))
+			{
+				open.push_back({ a, b });
+				open.push_back({ b, a });
+			}
+		}
+		sort(open.begin(), open.end());
+
+		vector<Float3> positions(static_cast<size_t>(weldedCount) + 1);
+		for (size_t i = 0; i < welded.size(); ++i)
+		{
+			positions[welded[i]] = mesh.positions[i];
+		}
+		size_t count{ 0 };
+		for (size_t first = 0; first < open.size();)
+		{
+			size_t last{ first };
+			while (last < open.size() && open[last].first == open[first].first)
+			{
+				++last;
+			}
+			const Float3& a{ positions[open[first].first] };
+			for (size_t i = first; i < last; ++i)
+			{
+				Float3 toFar{ positions[open[i].second] - a };
+				for (size_t j = first; j < last; ++j)
+				{
+					Float3 toNear{ positions[open[j].second] - a };
+					float nearLength{ math::length(toNear) };
+					float farLength{ math::length(toFar) };
+					if (open[i].second != open[j].second && nearLength < farLength &&
+						math::dot(toNear, toFar) > alongCosine * nearLength * farLength)
+					{
+						++count;
+						break;
+					}
+				}
+			}
+			first = last;
+		}
+		return count;
+	}
+
+	vector<AdaptiveBenchmarkResult> runAdaptiveTessellationBenchmark(const PatchModel& model, uint32_t width, uint32_t height)
+	{
+		TessellatedMesh reference;
+		tessellate(model, maxTessFactor, reference);
+		Float3 low{ numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::max() };
+		Float3 high{ -low.x, -low.y, -low.z };
+		for (const Float3& p : reference.positions)
+		{
+			low = { min(low.x, p.x), min(low.y, p.y), min(low.z, p.z) };
+			high = { max(high.x, p.x), max(high.y, p.y), max(high.z, p.z) };
+		}
+		Float3 center{ (low + high) * 0.5f };
+		float radius{ 0.0f };
+		for (const Float3& p : reference.positions)
+		{
+			radius = max(radius, math::length(p - center));
+		}
+
+		TessellatedMesh mesh;
+		tessellate(model, 8, mesh);
+		if (countTJunctions(mesh) != 0)
+		{
+			throw(runtime_error{ "The T-junction check fails a uniform tessellation." });
+		}
+
+		vector<MeshDistance> uniformDistances(maxTessFactor + 1, MeshDistance{ -1.0f, -1.0f });
+		auto getUniformDistance = [&](int factor) -> const MeshDistance&
+		{
+			if (uniformDistances[factor].maxDistance < 0.0f)
+			{
+				TessellatedMesh uniform;
+				tessellate(model, factor, uniform);
+				uniformDistances[factor] = measureMeshDistance(reference, uniform);
+			}
+			return uniformDistances[factor];
+		};
+
+		vector<AdaptiveBenchmarkResult> results;
+		auto runCase = [&](const string& name, float tolerance, const AdaptiveTessellationSettings& settings)
+		{
+			auto start = chrono::steady_clock::now();
+			tessellateAdaptive(model, settings, mesh);
+			double ms{ chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() };
+			if (countTJunctions(mesh) != 0)
+			{
+				throw(runtime_error{ "Adaptive tessellation " + name + " has T-junctions." });
+			}
+
+			AdaptiveBenchmarkResult result;
+			result.name = name;
+			result.tolerance = tolerance;
+			result.triangles = mesh.getTriangleCount();
+			result.ms = ms;
+			result.distance = measureMeshDistance(reference, mesh);
+			// the error of the uniform tessellation falls with the factor
+			int lowFactor{ minTessFactor };
+			int highFactor{ maxTessFactor };
+			while (lowFactor < highFactor)
+			{
+				int factor{ (lowFactor + highFactor) / 2 };
+				if (getUniformDistance(factor).maxDistance <= result.distance.maxDistance)
+				{
+					highFactor = factor;
+				}
+				else
+				{
+					lowFactor = factor + 1;
+				}
+			}
+			result.uniformFactor = lowFactor;
+			result.uniformTriangles = getGridIndexCount(lowFactor) / 3 * model.getPatchCount();
+			result.uniformDistance = getUniformDistance(lowFactor);
+			results.push_back(result);
+		};
+
+		AdaptiveTessellationSettings settings;
+		const pair<const char*, float> objectCases[]{ { "object 1e-2", 1e-2f }, { "object 3e-3", 3e-3f }, { "object 1e-3", 1e-3f }, { "object 3e-4", 3e-4f } };
+		for (const auto& objectCase : objectCases)
+		{
+			settings.tolerance = objectCase.second * radius;
+			runCase(objectCase.first, objectCase.second, settings);
+		}
+
+		// the LodChain sweep's camera, far and near
+		settings.viewportWidth = static_cast<float>(width);
+		settings.viewportHeight = static_cast<float>(height);
+		struct ScreenCase
+		{
+			const char* name;
+			float distance;
+			float pixels;
+		};
+		const ScreenCase screenCases[]{ { "screen d10 1px", 10.0f, 1.0f }, { "screen d4 0.5px", 4.0f, 0.5f } };
+		for (const ScreenCase& screenCase : screenCases)
+		{
+			Float4x4 projMatrix{ math::perspectiveFovLH(math::toRadians(45), settings.viewportWidth / settings.viewportHeight, 1.0f, 100.0f) };
+			Float4x4 viewMatrix{ math::lookAtLH(Float3{ 0.0f, 0.0f, -screenCase.distance }, Float3{ 0.0f, 0.0f, 0.0f }, Float3{ 0.0f, 1.0f, 0.0f }) };
+			Float4x4 worldViewProj{ math::multiply(math::translation(0.0f, -1.0f, 0.0f), math::multiply(viewMatrix, projMatrix)) };
+			settings.worldViewProj = &worldViewProj;
+			settings.tolerance = screenCase.pixels;
+			runCase(screenCase.name, screenCase.pixels, settings);
+		}
+		return results;
+	}
+
+	string formatAdaptiveBenchmarkResults(const vector<AdaptiveBenchmarkResult>& results)
+	{
+		string text;
+		for (const AdaptiveBenchmarkResult& result : results)
+		{
+			char line[256];
+			snprintf(line, sizeof(line), "adaptive %-15s %zu triangles in %.2f ms, distance max %.5f mean %.6f; uniform f%d %zu triangles, distance max %.5f, %.2fx the triangles\n",
+				result.name.c_str(), result.triangles, result.ms, result.distance.maxDistance, result.distance.meanDistance,
+				result.uniformFactor, result.uniformTriangles, result.uniformDistance.maxDistance,
+				result.triangles > 0 ? static_cast<double>(result.uniformTriangles) / result.triangles : 0.0);
+			text += line;
+		}
+		return text;
+	}
+}
\ No newline at end of file
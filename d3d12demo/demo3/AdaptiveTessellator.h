@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MathTypes.h"
+#include "MeshSimplifier.h"
+#include "PatchModel.h"
+#include "PatchTessellator.h"
+
+struct AdaptiveTessellationSettings
+{
+	// largest distance a leaf's surface may have from its triangles, in model units, or in pixels with worldViewProj
+	float tolerance{ 0.01f };
+	// null measures flatness in object space; sub-patches reaching behind the eye are not refined
+	const Float4x4* worldViewProj{ nullptr };
+	float viewportWidth{ 1280.0f };
+	float viewportHeight{ 720.0f };
+	// splits of a patch along each of u and v, at most 12
+	uint32_t maxDepth{ 8 };
+};
+
+struct AdaptiveTessellationResult
+{
+	size_t leaves;
+	// leaves fanned around their center to take in the corners of finer neighbors
+	size_t stitchedLeaves;
+	size_t triangles;
+	uint32_t maxDepth;
+};
+
+struct AdaptiveBenchmarkResult
+{
+	std::string name;
+	// relative to the bounding radius, or in pixels for screen space cases
+	float tolerance;
+	size_t triangles;
+	double ms;
+	// from a factor 64 tessellation, relative to the bounding radius
+	MeshDistance distance;
+	// the lowest uniform factor at least as close
+	int uniformFactor;
+	size_t uniformTriangles;
+	MeshDistance uniformDistance;
+};
+
+// CPU tessellation that splits each patch in half along u or v by de Casteljau's algorithm until a sub-patch is
+// within the tolerance of the two triangles between its corners, measured by how far its control points lie from
+// the bilinear patch through the corners plus the twist of that patch. Leaves whose edges hold corners of finer
+// neighbors are fanned around their center so the mesh has no T-junctions, and the points along a patch border
+// are the union of what every patch sharing that curve wants there, each computed from the curve alone, so
+// neighboring patches meet at bitwise equal positions. Like tessellate, patches don't share vertices, for colors.
+namespace teapot_tutorial
+{
+	AdaptiveTessellationResult tessellateAdaptive(const PatchModel& model, const AdaptiveTessellationSettings& settings, TessellatedMesh& mesh);
+
+	// edges of the mesh without a neighbor that run along another such edge from the same vertex
+	size_t countTJunctions(const TessellatedMesh& mesh);
+
+	// Tessellates at object space tolerances and two screen space ones, each against the lowest uniform factor
+	// that is as close to the surface. Throws when an output has T-junctions.
+	std::vector<AdaptiveBenchmarkResult> runAdaptiveTessellationBenchmark(const PatchModel& model, uint32_t width, uint32_t height);
+
+	// one line per result
+	std::string formatAdaptiveBenchmarkResults(const std::vector<AdaptiveBenchmarkResult>& results);
+}
\ No newline at end of file
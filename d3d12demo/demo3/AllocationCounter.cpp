@@ -0,0 +1,156 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace
+{
+	atomic<uint64_t> allocationCount{ 0 };
+	atomic<uint64_t> deallocationCount{ 0 };
+	atomic<uint64_t> allocatedBytes{ 0 };
+
+	// hook and context change together under a tiny spin lock; allocations only take it while a hook is set
+	atomic<AllocationHook> allocationHook{ nullptr };
+	void* allocationHookContext{ nullptr };
+	atomic_flag hookLock = ATOMIC_FLAG_INIT;
+
+	void lockHook()
+	{
+		while (hookLock.test_and_set(memory_order_acquire))
+		{
+		}
+	}
+
+	void unlockHook()
+	{
+		hookLock.clear(memory_order_release);
+	}
+
+	void callHook(size_t size)
+	{
+		lockHook();
+		AllocationHook hook{ allocationHook.load(memory_order_relaxed) };
+		void* context{ allocationHookContext };
+		unlockHook();
+
+		if (hook != nullptr)
+		{
+			hook(size, context);
+		}
+	}
+
+	void* countedAllocate(size_t size)
+	{
+		allocationCount.fetch_add(1, memory_order_relaxed);
+		allocatedBytes.fetch_add(size, memory_order_relaxed);
+		if (allocationHook.load(memory_order_relaxed) != nullptr)
+		{
+			callHook(size);
+		}
+		return malloc(size == 0 ? 1 : size);
+	}
+
+	void countedFree(void* p)
+	{
+		if (p != nullptr)
+		{
+			deallocationCount.fetch_add(1, memory_order_relaxed);
+			free(p);
+		}
+	}
+}
+
+uint64_t AllocationCounter::getAllocationCount()
+{
+	return allocationCount.load(memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::getDeallocationCount()
+{
+	return deallocationCount.load(memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::getAllocatedBytes()
+{
+	return allocatedBytes.load(memory_order_relaxed);
+}
+
+void AllocationCounter::exchangeHook(AllocationHook& hook, void*& context)
+{
+	lockHook();
+	AllocationHook previousHook{ allocationHook.load(memory_order_relaxed) };
+	void* previousContext{ allocationHookContext };
+	allocationHookContext = context;
+	allocationHook.store(hook, memory_order_relaxed);
+	unlockHook();
+
+	hook = previousHook;
+	context = previousContext;
+}
+
+ScopedAllocationHook::ScopedAllocationHook(AllocationHook hook, void* context) : previousHook{ hook }, previousContext{ context }
+{
+	AllocationCounter::exchangeHook(previousHook, previousContext);
+}
+
+ScopedAllocationHook::~ScopedAllocationHook()
+{
+	AllocationCounter::exchangeHook(previousHook, previousContext);
+}
+
+void* operator new(size_t size)
+{
+	void* p{ countedAllocate(size) };
+	if (p == nullptr)
+	{
+		throw bad_alloc{};
+	}
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+	return countedAllocate(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+	return countedAllocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	countedFree(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	countedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	countedFree(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	countedFree(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept
+{
+	countedFree(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept
+{
+	countedFree(p);
+}
\ No newline at end of file
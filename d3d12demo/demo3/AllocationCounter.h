@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// called on the allocating thread for every operator new while installed; must not allocate itself
+typedef void(*AllocationHook)(size_t size, void* context);
+
+// Counts every allocation made through the global operator new/delete, which AllocationCounter.cpp replaces
+// for the whole program, and forwards them to an optional hook.
+class AllocationCounter
+{
+public:
+	static uint64_t getAllocationCount();
+	static uint64_t getDeallocationCount();
+	static uint64_t getAllocatedBytes();
+
+	// installs hook and context, a null hook removes it, and hands back the previous pair
+	static void exchangeHook(AllocationHook& hook, void*& context);
+};
+
+// Installs a hook for the lifetime of the scope and restores the previous one.
+class ScopedAllocationHook
+{
+public:
+	ScopedAllocationHook(AllocationHook hook, void* context);
+	~ScopedAllocationHook();
+
+	ScopedAllocationHook(const ScopedAllocationHook&) = delete;
+	ScopedAllocationHook& operator=(const ScopedAllocationHook&) = delete;
+
+private:
+	AllocationHook previousHook;
+	void* previousContext;
+};
\ No newline at end of file
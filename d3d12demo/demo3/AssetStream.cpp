@@ -0,0 +1,536 @@
+#include "AssetStream.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include "Lz4.h"
+
+using namespace std;
+using namespace details;
+
+namespace
+{
+	const char assetMagic[4]{ 'A', 'S', 'T', 'M' };
+	const uint32_t assetVersion{ 1 };
+
+	// the synthetic data is generated and checked this many words at a time
+	const size_t syntheticBlockWords{ 1 << 18 };
+
+	uint32_t hashIndex(uint64_t x)
+	{
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdull;
+		x ^= x >> 33;
+		return static_cast<uint32_t>(x);
+	}
+
+	// Word first + i of a synthetic section. Points are Float3s on a 1/16 lattice, repeating like the shared
+	// corners of neighbouring patches do, and patches are 16 indices into a grid of points per patch.
+	void fillSyntheticWords(AssetSectionId id, uint64_t first, uint32_t* words, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint64_t word{ first + i };
+			if (id == AssetSectionId::Points)
+			{
+				uint32_t hash{ hashIndex(word / 3 / 4) };
+				float value{ static_cast<float>((hash >> (word % 3 * 8)) & 0xff) / 16.0f - 8.0f };
+				memcpy(&words[i], &value, sizeof(value));
+			}
+			else
+			{
+				uint64_t patch{ word / 16 };
+				uint32_t corner{ static_cast<uint32_t>(word % 16) };
+				words[i] = static_cast<uint32_t>(patch * 12 + corner / 4 * 4 + corner % 4);
+			}
+		}
+	}
+
+	// the points and patches sections get half the bytes each, in whole points and patches
+	uint64_t getSyntheticSectionSize(AssetSectionId id, uint64_t megabytes)
+	{
+		uint64_t half{ megabytes * (1 << 20) / 2 };
+		uint64_t stride{ id == AssetSectionId::Points ? sizeof(float) * 3 : sizeof(uint32_t) * 16 };
+		return half / stride * stride;
+	}
+}
+
+AssetStreamWriter::AssetStreamWriter(string path, uint32_t chunkSize) : file{ path, ios::binary | ios::trunc }, chunkSize{ chunkSize }
+{
+	if (!file)
+	{
+		throw(runtime_error{ "Error creating asset stream." });
+	}
+
+	if (chunkSize == 0)
+	{
+		throw(runtime_error{ "Invalid asset stream chunk size." });
+	}
+
+	pending.reserve(chunkSize);
+	compressed.resize(lz4::compressBound(chunkSize));
+
+	AssetFileHeader header;
+	memset(&header, 0, sizeof(header));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	offset = sizeof(header);
+}
+
+AssetStreamWriter::~AssetStreamWriter()
+{
+	if (!finished)
+	{
+		try
+		{
+			finish();
+		}
+		catch (runtime_error&)
+		{
+		}
+	}
+}
+
+void AssetStreamWriter::beginSection(AssetSectionId id, uint32_t stride)
+{
+	if (inSection || finished)
+	{
+		throw(runtime_error{ "Asset stream section already open." });
+	}
+
+	AssetSectionEntry section;
+	section.id = static_cast<uint32_t>(id);
+	section.stride = stride;
+	section.size = 0;
+	section.firstChunk = static_cast<uint32_t>(chunks.size());
+	section.chunkCount = 0;
+	sections.push_back(section);
+
+	inSection = true;
+}
+
+void AssetStreamWriter::write(const void* data, size_t size)
+{
+	if (!inSection)
+	{
+		throw(runtime_error{ "No asset stream section open." });
+	}
+
+	const uint8_t* bytes{ static_cast<const uint8_t*>(data) };
+	sections.back().size += size;
+
+	while (size > 0)
+	{
+		size_t count{ min(size, static_cast<size_t>(chunkSize) - pending.size()) };
+		pending.insert(pending.end(), bytes, bytes + count);
+		bytes += count;
+		size -= count;
+
+		if (pending.size() == chunkSize)
+		{
+			flushChunk();
+		}
+	}
+}
+
+void AssetStreamWriter::endSection()
+{
+	if (!inSection)
+	{
+		throw(runtime_error{ "No asset stream section open." });
+	}
+
+	if (!pending.empty())
+	{
+		flushChunk();
+	}
+
+	AssetSectionEntry& section{ sections.back() };
+	section.chunkCount = static_cast<uint32_t>(chunks.size()) - section.firstChunk;
+	inSection = false;
+}
+
+void AssetStreamWriter::finish()
+{
+	if (inSection)
+	{
+		endSection();
+	}
+
+	finished = true;
+
+	AssetFileHeader header;
+	memcpy(header.magic, assetMagic, sizeof(header.magic));
+	header.version = assetVersion;
+	header.chunkSize = chunkSize;
+	header.sectionCount = static_cast<uint32_t>(sections.size());
+	header.chunkCount = static_cast<uint32_t>(chunks.size());
+	header.reserved = 0;
+	header.tableOffset = offset;
+
+	file.write(reinterpret_cast<const char*>(sections.data()), sections.size() * sizeof(AssetSectionEntry));
+	file.write(reinterpret_cast<const char*>(chunks.data()), chunks.size() * sizeof(AssetChunkEntry));
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.flush();
+
+	if (!file)
+	{
+		throw(runtime_error{ "Error writing asset stream." });
+	}
+}
+
+const AssetStreamMetrics& AssetStreamWriter::getMetrics() const
+{
+	return metrics;
+}
+
+void AssetStreamWriter::flushChunk()
+{
+	size_t compressedSize{ lz4::compress(pending.data(), pending.size(), compressed.data(), compressed.size()) };
+
+	AssetChunkEntry chunk;
+	chunk.offset = offset;
+	chunk.size = static_cast<uint32_t>(pending.size());
+
+	// incompressible chunks are stored raw, flagged by compressedSize == size
+	if (compressedSize == 0 || compressedSize >= pending.size())
+	{
+		chunk.compressedSize = chunk.size;
+		file.write(reinterpret_cast<const char*>(pending.data()), pending.size());
+	}
+	else
+	{
+		chunk.compressedSize = static_cast<uint32_t>(compressedSize);
+		file.write(reinterpret_cast<const char*>(compressed.data()), compressedSize);
+	}
+
+	if (!file)
+	{
+		throw(runtime_error{ "Error writing asset stream chunk." });
+	}
+
+	offset += chunk.compressedSize;
+	chunks.push_back(chunk);
+	metrics.compressedBytes += chunk.compressedSize;
+	metrics.uncompressedBytes += chunk.size;
+	++metrics.chunks;
+	pending.clear();
+}
+
+AssetStreamReader::AssetStreamReader(string path, unsigned threadCount) : path{ path }
+{
+	setThreadCount(threadCount);
+
+	ifstream file{ path, ios::binary };
+	if (!file)
+	{
+		throw(runtime_error{ "Error opening asset stream." });
+	}
+
+	AssetFileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.magic, assetMagic, sizeof(assetMagic)) != 0)
+	{
+		throw(runtime_error{ "Invalid asset stream." });
+	}
+
+	if (header.version != assetVersion)
+	{
+		throw(runtime_error{ "Unsupported asset stream version." });
+	}
+
+	file.seekg(0, ios::end);
+	uint64_t fileSize{ static_cast<uint64_t>(file.tellg()) };
+	uint64_t tableSize{ static_cast<uint64_t>(header.sectionCount) * sizeof(AssetSectionEntry) + static_cast<uint64_t>(header.chunkCount) * sizeof(AssetChunkEntry) };
+	if (header.chunkSize == 0 || header.tableOffset < sizeof(header) || header.tableOffset > fileSize || tableSize > fileSize - header.tableOffset)
+	{
+		throw(runtime_error{ "Invalid asset stream tables." });
+	}
+
+	chunkSize = header.chunkSize;
+	sections.resize(header.sectionCount);
+	chunks.resize(header.chunkCount);
+
+	file.seekg(static_cast<streamoff>(header.tableOffset));
+	file.read(reinterpret_cast<char*>(sections.data()), sections.size() * sizeof(AssetSectionEntry));
+	file.read(reinterpret_cast<char*>(chunks.data()), chunks.size() * sizeof(AssetChunkEntry));
+	if (!file)
+	{
+		throw(runtime_error{ "Error reading asset stream tables." });
+	}
+
+	for (const AssetChunkEntry& chunk : chunks)
+	{
+		if (chunk.size > chunkSize || chunk.compressedSize > lz4::compressBound(chunkSize) || chunk.offset < sizeof(header) ||
+			chunk.offset > header.tableOffset || chunk.compressedSize > header.tableOffset - chunk.offset)
+		{
+			throw(runtime_error{ "Invalid asset stream chunk." });
+		}
+	}
+
+	// readSection decodes chunk i at i * chunkSize, so all but the last chunk must be full and together hold the section
+	for (const AssetSectionEntry& section : sections)
+	{
+		if (static_cast<uint64_t>(section.firstChunk) + section.chunkCount > chunks.size() ||
+			section.chunkCount != (section.size + chunkSize - 1) / chunkSize)
+		{
+			throw(runtime_error{ "Invalid asset stream section." });
+		}
+		for (uint32_t i{ 0 }; i < section.chunkCount; ++i)
+		{
+			uint64_t expected{ i + 1 < section.chunkCount ? chunkSize : section.size - static_cast<uint64_t>(i) * chunkSize };
+			if (chunks[section.firstChunk + i].size != expected)
+			{
+				throw(runtime_error{ "Invalid asset stream section." });
+			}
+		}
+	}
+}
+
+bool AssetStreamReader::hasSection(AssetSectionId id) const
+{
+	return any_of(sections.begin(), sections.end(), [id](const AssetSectionEntry& s) { return s.id == static_cast<uint32_t>(id); });
+}
+
+uint64_t AssetStreamReader::getSectionSize(AssetSectionId id) const
+{
+	return getSection(id).size;
+}
+
+uint32_t AssetStreamReader::getSectionStride(AssetSectionId id) const
+{
+	return getSection(id).stride;
+}
+
+void AssetStreamReader::readSection(AssetSectionId id, void* dst, uint64_t dstSize)
+{
+	const AssetSectionEntry& section{ getSection(id) };
+	if (dstSize < section.size)
+	{
+		throw(runtime_error{ "Asset stream destination too small." });
+	}
+
+	auto start = chrono::steady_clock::now();
+
+	uint8_t* bytes{ static_cast<uint8_t*>(dst) };
+	atomic<uint32_t> nextChunk{ 0 };
+	atomic<uint64_t> compressedBytes{ 0 };
+
+	// workers claim chunks in order and each reads through its own file handle
+	auto worker = [&]()
+	{
+		ifstream file{ path, ios::binary };
+		if (!file)
+		{
+			throw(runtime_error{ "Error opening asset stream." });
+		}
+
+		vector<uint8_t> scratch(lz4::compressBound(chunkSize));
+		uint64_t localCompressed{ 0 };
+
+		for (uint32_t i{ nextChunk++ }; i < section.chunkCount; i = nextChunk++)
+		{
+			const AssetChunkEntry& chunk{ chunks[section.firstChunk + i] };
+			decodeChunk(file, scratch, chunk, bytes + static_cast<uint64_t>(i) * chunkSize);
+			localCompressed += chunk.compressedSize;
+		}
+
+		compressedBytes += localCompressed;
+	};
+
+	unsigned workerCount{ min(threadCount, max(section.chunkCount, 1u)) };
+	vector<exception_ptr> errors(workerCount);
+	vector<thread> workers;
+
+	for (unsigned i{ 1 }; i < workerCount; ++i)
+	{
+		workers.emplace_back([&, i]()
+		{
+			try
+			{
+				worker();
+			}
+			catch (...)
+			{
+				errors[i] = current_exception();
+				nextChunk = section.chunkCount;
+			}
+		});
+	}
+
+	try
+	{
+		worker();
+	}
+	catch (...)
+	{
+		errors[0] = current_exception();
+		nextChunk = section.chunkCount;
+	}
+
+	for (thread& t : workers)
+	{
+		t.join();
+	}
+
+	for (exception_ptr& error : errors)
+	{
+		if (error)
+		{
+			rethrow_exception(error);
+		}
+	}
+
+	chrono::duration<double> elapsed{ chrono::steady_clock::now() - start };
+	metrics.compressedBytes += compressedBytes;
+	metrics.uncompressedBytes += section.size;
+	metrics.chunks += section.chunkCount;
+	metrics.seconds += elapsed.count();
+	metrics.threadCount = workerCount;
+}
+
+void AssetStreamReader::setThreadCount(unsigned threadCount)
+{
+	this->threadCount = threadCount != 0 ? threadCount : max(thread::hardware_concurrency(), 1u);
+}
+
+const AssetStreamMetrics& AssetStreamReader::getMetrics() const
+{
+	return metrics;
+}
+
+void AssetStreamReader::resetMetrics()
+{
+	metrics = AssetStreamMetrics{};
+}
+
+const AssetSectionEntry& AssetStreamReader::getSection(AssetSectionId id) const
+{
+	for (const AssetSectionEntry& section : sections)
+	{
+		if (section.id == static_cast<uint32_t>(id))
+		{
+			return section;
+		}
+	}
+
+	throw(runtime_error{ "Asset stream section not found." });
+}
+
+void AssetStreamReader::decodeChunk(ifstream& file, vector<uint8_t>& scratch, const AssetChunkEntry& chunk, uint8_t* dst) const
+{
+	file.seekg(static_cast<streamoff>(chunk.offset));
+
+	if (chunk.compressedSize == chunk.size)
+	{
+		if (!file.read(reinterpret_cast<char*>(dst), chunk.size))
+		{
+			throw(runtime_error{ "Error reading asset stream chunk." });
+		}
+		return;
+	}
+
+	if (!file.read(reinterpret_cast<char*>(scratch.data()), chunk.compressedSize))
+	{
+		throw(runtime_error{ "Error reading asset stream chunk." });
+	}
+
+	if (lz4::decompress(scratch.data(), chunk.compressedSize, dst, chunk.size) != chunk.size)
+	{
+		throw(runtime_error{ "Corrupt asset stream chunk." });
+	}
+}
+
+namespace teapot_tutorial
+{
+	AssetStreamMetrics writeSyntheticAssetStream(const string& path, uint64_t megabytes)
+	{
+		AssetStreamWriter writer{ path };
+		vector<uint32_t> block(syntheticBlockWords);
+		double seconds{ 0.0 };
+
+		for (AssetSectionId id : { AssetSectionId::Points, AssetSectionId::Patches })
+		{
+			uint64_t words{ getSyntheticSectionSize(id, megabytes) / sizeof(uint32_t) };
+			writer.beginSection(id, id == AssetSectionId::Points ? sizeof(float) * 3 : sizeof(uint32_t));
+			for (uint64_t first = 0; first < words; first += block.size())
+			{
+				size_t count{ static_cast<size_t>(min<uint64_t>(block.size(), words - first)) };
+				fillSyntheticWords(id, first, block.data(), count);
+				auto begin = chrono::steady_clock::now();
+				writer.write(block.data(), count * sizeof(uint32_t));
+				seconds += chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+			}
+			writer.endSection();
+		}
+
+		auto begin = chrono::steady_clock::now();
+		writer.finish();
+		AssetStreamMetrics metrics{ writer.getMetrics() };
+		metrics.seconds = seconds + chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+		metrics.threadCount = 1;
+		return metrics;
+	}
+
+	AssetStreamBenchmarkResult runAssetStreamBenchmark(const string& path, uint64_t megabytes, uint32_t maxThreads)
+	{
+		AssetStreamBenchmarkResult result;
+		result.write = writeSyntheticAssetStream(path, megabytes);
+
+		try
+		{
+			AssetStreamReader reader{ path };
+			vector<uint8_t> section(static_cast<size_t>(max(getSyntheticSectionSize(AssetSectionId::Points, megabytes), getSyntheticSectionSize(AssetSectionId::Patches, megabytes))));
+			vector<uint32_t> expected(syntheticBlockWords);
+
+			uint32_t threadLimit{ min(max(maxThreads, 1u), max(thread::hardware_concurrency(), 4u)) };
+			for (uint32_t threads = 1; threads <= threadLimit; threads *= 2)
+			{
+				reader.setThreadCount(threads);
+				reader.resetMetrics();
+				for (AssetSectionId id : { AssetSectionId::Points, AssetSectionId::Patches })
+				{
+					uint64_t size{ reader.getSectionSize(id) };
+					reader.readSection(id, section.data(), size);
+
+					uint64_t words{ size / sizeof(uint32_t) };
+					for (uint64_t first = 0; first < words; first += expected.size())
+					{
+						size_t count{ static_cast<size_t>(min<uint64_t>(expected.size(), words - first)) };
+						fillSyntheticWords(id, first, expected.data(), count);
+						if (memcmp(expected.data(), section.data() + first * sizeof(uint32_t), count * sizeof(uint32_t)) != 0)
+						{
+							throw(runtime_error{ "Asset stream read on " + to_string(threads) + " threads differs from what was written." });
+						}
+					}
+				}
+				result.reads.push_back(reader.getMetrics());
+			}
+		}
+		catch (...)
+		{
+			remove(path.c_str());
+			throw;
+		}
+
+		remove(path.c_str());
+		return result;
+	}
+
+	string formatAssetStreamBenchmarkResult(const AssetStreamBenchmarkResult& result)
+	{
+		char line[160];
+		snprintf(line, sizeof(line), "asset write %.2f GB %.2f GB/s compression %.2fx\n",
+			result.write.uncompressedBytes / 1e9, result.write.getGigabytesPerSecond(), result.write.getCompressionRatio());
+		string text{ line };
+		for (const AssetStreamMetrics& read : result.reads)
+		{
+			snprintf(line, sizeof(line), "asset read %u threads %.2f GB/s\n", read.threadCount, read.getGigabytesPerSecond());
+			text += line;
+		}
+		return text;
+	}
+}
\ No newline at end of file
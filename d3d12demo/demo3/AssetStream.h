@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Chunked asset container. Every section is split into fixed-size chunks that are LZ4 compressed
+// independently, so a reader can decode them in parallel straight into their final location.
+//
+// Layout: FileHeader | chunk data ... | SectionEntry[sectionCount] | ChunkEntry[chunkCount]
+
+enum class AssetSectionId : uint32_t
+{
+	Points = 1,
+	Patches = 2,
+	PatchesTransforms = 3,
+	PatchesColors = 4
+};
+
+struct AssetStreamMetrics
+{
+	uint64_t compressedBytes{ 0 };
+	uint64_t uncompressedBytes{ 0 };
+	uint64_t chunks{ 0 };
+	double seconds{ 0.0 };
+	unsigned threadCount{ 0 };
+
+	double getGigabytesPerSecond() const
+	{
+		return seconds > 0.0 ? static_cast<double>(uncompressedBytes) / seconds / 1e9 : 0.0;
+	}
+
+	double getCompressionRatio() const
+	{
+		return compressedBytes > 0 ? static_cast<double>(uncompressedBytes) / static_cast<double>(compressedBytes) : 0.0;
+	}
+};
+
+struct AssetStreamBenchmarkResult
+{
+	// of writing the file, on one thread
+	AssetStreamMetrics write;
+	// of reading every section back, one per thread count
+	std::vector<AssetStreamMetrics> reads;
+};
+
+namespace details
+{
+#pragma pack(push, 1)
+	struct AssetFileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t chunkSize;
+		uint32_t sectionCount;
+		uint32_t chunkCount;
+		uint32_t reserved;
+		uint64_t tableOffset;
+	};
+
+	struct AssetSectionEntry
+	{
+		uint32_t id;
+		uint32_t stride;
+		uint64_t size;
+		uint32_t firstChunk;
+		uint32_t chunkCount;
+	};
+
+	struct AssetChunkEntry
+	{
+		uint64_t offset;
+		uint32_t compressedSize;
+		uint32_t size;
+	};
+#pragma pack(pop)
+}
+
+class AssetStreamWriter
+{
+public:
+	AssetStreamWriter(std::string path, uint32_t chunkSize = 1 << 20);
+	~AssetStreamWriter();
+
+	void beginSection(AssetSectionId id, uint32_t stride);
+	void write(const void* data, size_t size);
+	void endSection();
+	void finish();
+
+	template<typename T>
+	void addSection(AssetSectionId id, const std::vector<T>& data)
+	{
+		beginSection(id, static_cast<uint32_t>(sizeof(T)));
+		write(data.data(), data.size() * sizeof(T));
+		endSection();
+	}
+
+	const AssetStreamMetrics& getMetrics() const;
+
+private:
+	void flushChunk();
+
+private:
+	std::ofstream file;
+	uint32_t chunkSize;
+	std::vector<uint8_t> pending;
+	std::vector<uint8_t> compressed;
+	std::vector<details::AssetSectionEntry> sections;
+	std::vector<details::AssetChunkEntry> chunks;
+	uint64_t offset{ 0 };
+	bool inSection{ false };
+	bool finished{ false };
+	AssetStreamMetrics metrics;
+};
+
+class AssetStreamReader
+{
+public:
+	// threadCount 0 uses std::thread::hardware_concurrency()
+	AssetStreamReader(std::string path, unsigned threadCount = 0);
+
+	bool hasSection(AssetSectionId id) const;
+	uint64_t getSectionSize(AssetSectionId id) const;
+	uint32_t getSectionStride(AssetSectionId id) const;
+
+	// Decompresses the section into dst, e.g. the mapped upload heap of a stream createVertexBuffer in Utils.h.
+	void readSection(AssetSectionId id, void* dst, uint64_t dstSize);
+
+	template<typename T>
+	std::vector<T> readSection(AssetSectionId id)
+	{
+		std::vector<T> data(static_cast<size_t>(getSectionSize(id) / sizeof(T)));
+		readSection(id, data.data(), data.size() * sizeof(T));
+		return data;
+	}
+
+	void setThreadCount(unsigned threadCount);
+	const AssetStreamMetrics& getMetrics() const;
+	void resetMetrics();
+
+private:
+	const details::AssetSectionEntry& getSection(AssetSectionId id) const;
+	void decodeChunk(std::ifstream& file, std::vector<uint8_t>& scratch, const details::AssetChunkEntry& chunk, uint8_t* dst) const;
+
+private:
+	std::string path;
+	unsigned threadCount;
+	uint32_t chunkSize;
+	std::vector<details::AssetSectionEntry> sections;
+	std::vector<details::AssetChunkEntry> chunks;
+	AssetStreamMetrics metrics;
+};
+
+namespace teapot_tutorial
+{
+	// Writes megabytes of synthetic model data, a points and a patches section about as compressible as real
+	// control points and indices, and returns the writer's metrics.
+	AssetStreamMetrics writeSyntheticAssetStream(const std::string& path, uint64_t megabytes);
+
+	// Writes a synthetic asset stream of megabytes to path, reads it back on powers of two threads up to maxThreads
+	// or the hardware's threads, but at least 4, and removes it. Throws when a read differs from what was written.
+	AssetStreamBenchmarkResult runAssetStreamBenchmark(const std::string& path, uint64_t megabytes, uint32_t maxThreads);
+
+	// one line for the write and one per read
+	std::string formatAssetStreamBenchmarkResult(const AssetStreamBenchmarkResult& result);
+}
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "BernsteinTableCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include "BezierPatch.h"
+#include "PatchEvaluator.h"
+#include "PatchKernels.h"
+
+using namespace std;
+
+struct BernsteinTableCache::Table
+{
+	BernsteinWeights weights;
+	// factor + 1 basis values, then as many derivatives
+	vector<Float4> values;
+};
+
+namespace
+{
+	// grid points each evaluator produces per measurement
+	const size_t benchmarkPoints{ 1 << 21 };
+	const uint32_t benchmarkLookups{ 1 << 24 };
+
+	// evaluateGridBernstein before the cache, the basis per point
+	void evaluateGridComputed(const Float3* controlPoints, int factor, Float3* positions)
+	{
+		int n{ teapot_tutorial::clampTessFactor(factor) };
+		for (int j{ 0 }; j <= n; ++j)
+		{
+			Float4 basisV{ bezier::bernsteinBasis(static_cast<float>(j) / static_cast<float>(n)) };
+			for (int i{ 0 }; i <= n; ++i)
+			{
+				*positions++ = bezier::evaluate(controlPoints, bezier::bernsteinBasis(static_cast<float>(i) / static_cast<float>(n)), basisV);
+			}
+		}
+	}
+
+	// evaluateGridKernelGeneric before the cache, the table per call
+	void evaluateKernelComputed(const Float3* controlPoints, int factor, Float3* positions)
+	{
+		int n{ teapot_tutorial::clampTessFactor(factor) };
+		float weights[(teapot_tutorial::maxTessFactor + 1) * 4];
+		for (int i{ 0 }; i <= n; ++i)
+		{
+			for (size_t k = 0; k < 4; ++k)
+			{
+				weights[i * 4 + k] = teapot_tutorial::getBernsteinWeight(k, static_cast<float>(i) / static_cast<float>(n));
+			}
+		}
+		teapot_tutorial::evaluateGridWeights<0>(controlPoints, n, weights, positions);
+	}
+
+	void checkTable(const BernsteinWeights& weights, int factor)
+	{
+		for (int i{ 0 }; i <= factor; ++i)
+		{
+			float t{ static_cast<float>(i) / static_cast<float>(factor) };
+			Float4 basis{ bezier::bernsteinBasis(t) };
+			Float4 derivative{ bezier::bernsteinDerivative(t) };
+			if (memcmp(&weights.basis[i], &basis, sizeof(Float4)) != 0 || memcmp(&weights.derivatives[i], &derivative, sizeof(Float4)) != 0)
+			{
+				throw(runtime_error{ "The cached factor " + to_string(factor) + " Bernstein weights are wrong." });
+			}
+		}
+	}
+}
+
+BernsteinTableCache::BernsteinTableCache()
+{
+	for (atomic<const Table*>& table : tables)
+	{
+		table.store(nullptr, memory_order_relaxed);
+	}
+}
+
+BernsteinTableCache::~BernsteinTableCache()
+{
+	for (atomic<const Table*>& table : tables)
+	{
+		delete table.load(memory_order_acquire);
+	}
+}
+
+BernsteinTableCache& BernsteinTableCache::getShared()
+{
+	static BernsteinTableCache cache;
+	return cache;
+}
+
+const BernsteinWeights& BernsteinTableCache::get(int factor)
+{
+	int n{ teapot_tutorial::clampTessFactor(factor) };
+	const Table* table{ tables[n].load(memory_order_acquire) };
+	if (table != nullptr)
+	{
+		return table->weights;
+	}
+
+	unique_ptr<Table> built{ new Table };
+	size_t count{ static_cast<size_t>(n) + 1 };
+	built->values.resize(count * 2);
+	for (size_t i = 0; i < count; ++i)
+	{
+		float t{ static_cast<float>(i) / static_cast<float>(n) };
+		built->values[i] = bezier::bernsteinBasis(t);
+		built->values[count + i] = bezier::bernsteinDerivative(t);
+	}
+	built->weights = { n, built->values.data(), built->values.data() + count };
+
+	// a thread that lost the race uses the winner's table and drops its own
+	if (tables[n].compare_exchange_strong(table, built.get(), memory_order_acq_rel, memory_order_acquire))
+	{
+		table = built.release();
+	}
+	return table->weights;
+}
+
+vector<Float4> BernsteinTableCache::getPackedWeights()
+{
+	vector<Float4> packed(getPackedOffset(teapot_tutorial::maxTessFactor + 1));
+	for (int factor{ teapot_tutorial::minTessFactor }; factor <= teapot_tutorial::maxTessFactor; ++factor)
+	{
+		const BernsteinWeights& weights{ get(factor) };
+		auto offset = packed.begin() + getPackedOffset(factor);
+		copy(weights.basis, weights.basis + factor + 1, offset);
+		copy(weights.derivatives, weights.derivatives + factor + 1, offset + factor + 1);
+	}
+	return packed;
+}
+
+uint32_t BernsteinTableCache::getPackedOffset(int factor)
+{
+	// 2 (n + 1) values for each factor n from 1, summed below factor
+	uint32_t n{ static_cast<uint32_t>(factor) };
+	return n * (n + 1) - 2;
+}
+
+namespace teapot_tutorial
+{
+	vector<WeightCacheBenchmarkResult> runWeightCacheBenchmark(const PatchModel& model)
+	{
+		BernsteinTableCache& shared{ BernsteinTableCache::getShared() };
+		vector<Float4> packed{ shared.getPackedWeights() };
+		for (int factor{ minTessFactor }; factor <= maxTessFactor; ++factor)
+		{
+			const BernsteinWeights& weights{ shared.get(factor) };
+			checkTable(weights, factor);
+			const Float4* offset{ packed.data() + BernsteinTableCache::getPackedOffset(factor) };
+			if (memcmp(offset, weights.basis, (factor + 1) * sizeof(Float4)) != 0 || memcmp(offset + factor + 1, weights.derivatives, (factor + 1) * sizeof(Float4)) != 0)
+			{
+				throw(runtime_error{ "The packed factor " + to_string(factor) + " Bernstein weights are wrong." });
+			}
+		}
+
+		uint32_t hardwareThreads{ max(thread::hardware_concurrency(), 1u) };
+		uint32_t raceThreads{ max(hardwareThreads, 4u) };
+		for (uint32_t round = 0; round < 16; ++round)
+		{
+			// every thread asks a fresh cache for every factor at once, in its own order
+			BernsteinTableCache cache;
+			vector<vector<const BernsteinWeights*>> seen(raceThreads, vector<const BernsteinWeights*>(maxTessFactor + 1));
+			atomic<uint32_t> ready{ 0 };
+			vector<thread> threads;
+			for (uint32_t t = 0; t < raceThreads; ++t)
+			{
+				threads.emplace_back([&cache, &seen, &ready, raceThreads, t]()
+				{
+					ready.fetch_add(1);
+					while (ready.load() < raceThreads)
+					{
+					}
+					for (int i{ 0 }; i < maxTessFactor; ++i)
+					{
+						int factor{ (i * 37 + static_cast<int>(t) * 11) % maxTessFactor + 1 };
+						seen[t][factor] = &cache.get(factor);
+					}
+				});
+			}
+			for (thread& t : threads)
+			{
+				t.join();
+			}
+			for (int factor{ minTessFactor }; factor <= maxTessFactor; ++factor)
+			{
+				checkTable(*seen[0][factor], factor);
+				for (uint32_t t = 1; t < raceThreads; ++t)
+				{
+					if (seen[t][factor] != seen[0][factor])
+					{
+						throw(runtime_error{ "Threads building the factor " + to_string(factor) + " Bernstein weights got different tables." });
+					}
+				}
+			}
+		}
+
+		vector<WeightCacheBenchmarkResult> results;
+		for (uint32_t threadCount : { 1u, 2u, 4u, 8u })
+		{
+			vector<double> seconds(threadCount);
+			vector<float> sums(threadCount * 16);
+			vector<thread> threads;
+			for (uint32_t t = 0; t < threadCount; ++t)
+			{
+				threads.emplace_back([&shared, &seconds, &sums, t]()
+				{
+					float sum{ 0.0f };
+					auto begin = chrono::steady_clock::now();
+					for (uint32_t i = 0; i < benchmarkLookups; ++i)
+					{
+						sum += shared.get(static_cast<int>((i * 7 + t) % maxTessFactor) + 1).basis[1].y;
+					}
+					seconds[t] = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+					// a cache line apart, so the threads don't share one
+					sums[t * 16] = sum;
+				});
+			}
+			double slowest{ 0.0 };
+			for (uint32_t t = 0; t < threadCount; ++t)
+			{
+				threads[t].join();
+				slowest = max(slowest, seconds[t]);
+			}
+			if (sums[0] <= 0.0f)
+			{
+				throw(runtime_error{ "Bernstein weight lookups returned nothing." });
+			}
+			results.push_back({ "lookups", threadCount, slowest > 0.0 ? static_cast<double>(benchmarkLookups) * threadCount / slowest : 0.0, 0.0 });
+		}
+
+		size_t patchCount{ model.getPatchCount() };
+		vector<Float3> controlPoints(patchCount * PatchModel::controlPointsPerPatch);
+		for (size_t patch = 0; patch < patchCount; ++patch)
+		{
+			gatherControlPoints(model, patch, &controlPoints[patch * PatchModel::controlPointsPerPatch]);
+		}
+		vector<Float3> positions;
+		vector<Float3> computedPositions;
+		for (int factor : { 6, 12, 48 })
+		{
+			size_t gridVertices{ getGridVertexCount(factor) };
+			positions.resize(patchCount * gridVertices);
+			computedPositions.resize(positions.size());
+			size_t repeats{ max<size_t>(benchmarkPoints / max<size_t>(positions.size(), 1), 1) };
+			auto measure = [&](void(*evaluate)(const Float3*, int, Float3*), vector<Float3>& output)
+			{
+				auto begin = chrono::steady_clock::now();
+				for (size_t repeat = 0; repeat < repeats; ++repeat)
+				{
+					for (size_t patch = 0; patch < patchCount; ++patch)
+					{
+						evaluate(&controlPoints[patch * PatchModel::controlPointsPerPatch], factor, &output[patch * gridVertices]);
+					}
+				}
+				double seconds{ chrono::duration<double>(chrono::steady_clock::now() - begin).count() };
+				return seconds > 0.0 ? repeats * output.size() / seconds : 0.0;
+			};
+			auto compare = [&](const char* name)
+			{
+				if (memcmp(positions.data(), computedPositions.data(), positions.size() * sizeof(Float3)) != 0)
+				{
+					throw(runtime_error{ string{ name } + " differs with cached Bernstein weights at factor " + to_string(factor) + "." });
+				}
+			};
+
+			WeightCacheBenchmarkResult bernstein{ "bernstein f" + to_string(factor), 1, measure(evaluateGridBernstein, positions), measure(evaluateGridComputed, computedPositions) };
+			compare("evaluateGridBernstein");
+			results.push_back(bernstein);
+			WeightCacheBenchmarkResult kernel{ "generic f" + to_string(factor), 1, measure(evaluateGridKernelGeneric, positions), measure(evaluateKernelComputed, computedPositions) };
+			compare("evaluateGridKernelGeneric");
+			results.push_back(kernel);
+		}
+		return results;
+	}
+
+	string formatWeightCacheBenchmarkResults(const vector<WeightCacheBenchmarkResult>& results)
+	{
+		string text;
+		for (const WeightCacheBenchmarkResult& result : results)
+		{
+			char line[256];
+			if (result.uncachedPerSecond > 0.0)
+			{
+				snprintf(line, sizeof(line), "weights %-13s %.1f Mpoints/s cached, %.1f computed, %.2fx\n",
+					result.name.c_str(), result.perSecond / 1e6, result.uncachedPerSecond / 1e6, result.perSecond / result.uncachedPerSecond);
+			}
+			else
+			{
+				snprintf(line, sizeof(line), "weights %-13s %u threads %.1f Mlookups/s\n", result.name.c_str(), result.threads, result.perSecond / 1e6);
+			}
+			text += line;
+		}
+		return text;
+	}
+}
\ No newline at end of file
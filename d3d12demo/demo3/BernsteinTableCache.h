@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MathTypes.h"
+#include "PatchModel.h"
+#include "PatchTessellator.h"
+
+// Bernstein basis and its derivative at the factor + 1 parameters i / factor. Integer partitioning puts u and v
+// at the same parameters, so one table serves both.
+struct BernsteinWeights
+{
+	int factor;
+	const Float4* basis;
+	const Float4* derivatives;
+};
+
+struct WeightCacheBenchmarkResult
+{
+	std::string name;
+	uint32_t threads;
+	// lookups or grid points
+	double perSecond;
+	// the same work computing the weights instead, 0 for lookups
+	double uncachedPerSecond;
+};
+
+// Weight tables by tessellation factor, built on first use. Lookups are an acquire load once a factor is built;
+// threads that miss together each build it and the first to publish wins, so nothing ever locks.
+class BernsteinTableCache
+{
+public:
+	BernsteinTableCache();
+	~BernsteinTableCache();
+
+	BernsteinTableCache(const BernsteinTableCache&) = delete;
+	BernsteinTableCache& operator=(const BernsteinTableCache&) = delete;
+
+	static BernsteinTableCache& getShared();
+
+	// clamps the factor like clampTessFactor
+	const BernsteinWeights& get(int factor);
+
+	// Every factor's tables back to back, what DomainShader.hlsl reads as bernsteinWeights: the factor + 1 basis
+	// values of a factor from getPackedOffset, followed by its factor + 1 derivatives.
+	std::vector<Float4> getPackedWeights();
+	static uint32_t getPackedOffset(int factor);
+
+private:
+	struct Table;
+
+	std::atomic<const Table*> tables[teapot_tutorial::maxTessFactor + 1];
+};
+
+namespace teapot_tutorial
+{
+	// Lookup rate from one to eight threads, then the Bernstein evaluator and the generic kernel with cached weights
+	// against computing them. Throws when a cached table differs from bezier::bernsteinBasis and bernsteinDerivative,
+	// or when threads racing to build a factor see different tables.
+	std::vector<WeightCacheBenchmarkResult> runWeightCacheBenchmark(const PatchModel& model);
+
+	// one line per result
+	std::string formatWeightCacheBenchmarkResults(const std::vector<WeightCacheBenchmarkResult>& results);
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "MathTypes.h"
+
+// CPU counterparts of evaluateBezier/getNormal in DomainShader.hlsl. The basis functions fill BernsteinTableCache,
+// whose tables the shader reads.
+namespace bezier
+{
+	// below this squared length ratio to the other partial derivative, one counts as vanished
+	const float collapsedTangentRatio{ 1e-8f };
+
+	inline Float4 bernsteinBasis(float t)
+	{
+		float invT{ 1.0f - t };
+		return{ invT * invT * invT,
+			3.0f * t * invT * invT,
+			3.0f * t * t * invT,
+			t * t * t };
+	}
+
+	inline Float4 bernsteinDerivative(float t)
+	{
+		float invT{ 1.0f - t };
+		return{ -3.0f * invT * invT,
+			3.0f * invT * invT - 6.0f * t * invT,
+			6.0f * t * invT - 3.0f * t * t,
+			3.0f * t * t };
+	}
+
+	// controlPoints holds 16 points, four rows along v of four points along u
+	inline Float3 evaluate(const Float3* controlPoints, const Float4& basisU, const Float4& basisV)
+	{
+		const float bu[4]{ basisU.x, basisU.y, basisU.z, basisU.w };
+		const float bv[4]{ basisV.x, basisV.y, basisV.z, basisV.w };
+
+		Float3 value{ 0.0f, 0.0f, 0.0f };
+		for (int row{ 0 }; row < 4; ++row)
+		{
+			const Float3* p{ controlPoints + row * 4 };
+			Float3 rowValue{ p[0] * bu[0] + p[1] * bu[1] + p[2] * bu[2] + p[3] * bu[3] };
+			value = value + rowValue * bv[row];
+		}
+		return value;
+	}
+
+	inline Float3 evaluate(const Float3* controlPoints, float u, float v)
+	{
+		return evaluate(controlPoints, bernsteinBasis(u), bernsteinBasis(v));
+	}
+
+	// Unit normal from the partial derivatives. Where a border collapses to a point, like the teapot lid's pole,
+	// the derivative along it vanishes; near the border it is the mixed derivative times the parameter distance to
+	// it, so the mixed derivative with that sign takes its place.
+	inline Float3 getNormal(const Float3& dPdu, const Float3& dPdv, const Float3& d2Pdudv, float u, float v)
+	{
+		float duSquared{ math::dot(dPdu, dPdu) };
+		float dvSquared{ math::dot(dPdv, dPdv) };
+		Float3 a{ duSquared < collapsedTangentRatio * dvSquared ? d2Pdudv * (v < 0.5f ? 1.0f : -1.0f) : dPdu };
+		Float3 b{ dvSquared < collapsedTangentRatio * duSquared ? d2Pdudv * (u < 0.5f ? 1.0f : -1.0f) : dPdv };
+		return math::normalize(math::cross(a, b));
+	}
+
+	inline Float3 transformDirection(const Float3& d, const Float4x4& m)
+	{
+		Float4 r{ math::transform(Float4{ d.x, d.y, d.z, 0.0f }, m) };
+		return{ r.x, r.y, r.z };
+	}
+
+	inline Float3 transformPosition(const Float3& p, const Float4x4& m)
+	{
+		Float4 r{ math::transformPoint(p, m) };
+		return{ r.x, r.y, r.z };
+	}
+}
\ No newline at end of file
@@ -0,0 +1,468 @@
+#include "CommandStream.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace details;
+
+namespace
+{
+	const char commandStreamMagic[4]{ 'C', 'M', 'D', 'S' };
+	const uint32_t commandStreamVersion{ 1 };
+
+	class CommandReader
+	{
+	public:
+		CommandReader(const uint8_t* begin, const uint8_t* end) : current{ begin }, end{ end }
+		{
+		}
+
+		bool atEnd() const
+		{
+			return current == end;
+		}
+
+		template <typename T> T read()
+		{
+			T value;
+			memcpy(&value, readBytes(sizeof(T)), sizeof(T));
+			return value;
+		}
+
+		const uint8_t* readBytes(size_t size)
+		{
+			if (static_cast<size_t>(end - current) < size)
+			{
+				throw(runtime_error{ "Truncated command stream." });
+			}
+			const uint8_t* p{ current };
+			current += size;
+			return p;
+		}
+
+	private:
+		const uint8_t* current;
+		const uint8_t* end;
+	};
+
+	template <typename T> T readEnum(CommandReader& reader, uint8_t count)
+	{
+		uint8_t value{ reader.read<uint8_t>() };
+		if (value >= count)
+		{
+			throw(runtime_error{ "Invalid command stream argument." });
+		}
+		return static_cast<T>(value);
+	}
+}
+
+template <typename T> void CommandStream::write(T value)
+{
+	writeBytes(&value, sizeof(T));
+}
+
+void CommandStream::reset(uint32_t frameIndex)
+{
+	writeOpcode(CommandOpcode::Reset);
+	write(frameIndex);
+}
+
+void CommandStream::setPipelineState(PipelineId pipeline)
+{
+	writeOpcode(CommandOpcode::SetPipelineState);
+	write(static_cast<uint8_t>(pipeline));
+}
+
+void CommandStream::setGraphicsRootSignature()
+{
+	writeOpcode(CommandOpcode::SetGraphicsRootSignature);
+}
+
+void CommandStream::setViewport(const Viewport& viewport)
+{
+	writeOpcode(CommandOpcode::SetViewport);
+	write(viewport);
+}
+
+void CommandStream::setScissorRect(const ScissorRect& rect)
+{
+	writeOpcode(CommandOpcode::SetScissorRect);
+	write(rect);
+}
+
+void CommandStream::transitionBackBuffer(uint32_t frameIndex, ResourceState before, ResourceState after)
+{
+	writeOpcode(CommandOpcode::TransitionBackBuffer);
+	write(frameIndex);
+	write(static_cast<uint8_t>(before));
+	write(static_cast<uint8_t>(after));
+}
+
+void CommandStream::setRenderTarget(uint32_t frameIndex)
+{
+	writeOpcode(CommandOpcode::SetRenderTarget);
+	write(frameIndex);
+}
+
+void CommandStream::clearRenderTarget(uint32_t frameIndex, const float color[4])
+{
+	writeOpcode(CommandOpcode::ClearRenderTarget);
+	write(frameIndex);
+	writeBytes(color, 4 * sizeof(float));
+}
+
+void CommandStream::clearDepth(float depth)
+{
+	writeOpcode(CommandOpcode::ClearDepth);
+	write(depth);
+}
+
+void CommandStream::setPrimitiveTopology(PrimitiveTopology topology)
+{
+	writeOpcode(CommandOpcode::SetPrimitiveTopology);
+	write(static_cast<uint8_t>(topology));
+}
+
+void CommandStream::setVertexBuffer(BufferId buffer)
+{
+	writeOpcode(CommandOpcode::SetVertexBuffer);
+	write(static_cast<uint8_t>(buffer));
+}
+
+void CommandStream::setIndexBuffer(BufferId buffer)
+{
+	writeOpcode(CommandOpcode::SetIndexBuffer);
+	write(static_cast<uint8_t>(buffer));
+}
+
+void CommandStream::setGraphicsRoot32BitConstants(uint32_t rootIndex, uint32_t count, const void* values)
+{
+	writeOpcode(CommandOpcode::SetGraphicsRoot32BitConstants);
+	write(rootIndex);
+	write(count);
+	writeBytes(values, count * sizeof(uint32_t));
+}
+
+void CommandStream::setGraphicsRootDescriptorTable(uint32_t rootIndex)
+{
+	writeOpcode(CommandOpcode::SetGraphicsRootDescriptorTable);
+	write(rootIndex);
+}
+
+void CommandStream::setGraphicsRootConstantBufferView(uint32_t rootIndex, uint32_t frameIndex)
+{
+	writeOpcode(CommandOpcode::SetGraphicsRootConstantBufferView);
+	write(rootIndex);
+	write(frameIndex);
+}
+
+void CommandStream::drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
+{
+	writeOpcode(CommandOpcode::DrawInstanced);
+	write(vertexCount);
+	write(instanceCount);
+	write(startVertex);
+	write(startInstance);
+}
+
+void CommandStream::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+	writeOpcode(CommandOpcode::DrawIndexedInstanced);
+	write(indexCount);
+	write(instanceCount);
+	write(startIndex);
+	write(baseVertex);
+	write(startInstance);
+}
+
+void CommandStream::writeTimestamp(uint32_t frameIndex, uint32_t queryIndex)
+{
+	writeOpcode(CommandOpcode::WriteTimestamp);
+	write(frameIndex);
+	write(queryIndex);
+}
+
+void CommandStream::resolveTimestamps(uint32_t frameIndex, uint32_t queryCount)
+{
+	writeOpcode(CommandOpcode::ResolveTimestamps);
+	write(frameIndex);
+	write(queryCount);
+}
+
+void CommandStream::close()
+{
+	writeOpcode(CommandOpcode::Close);
+}
+
+void CommandStream::transitionSceneTarget(ResourceState before, ResourceState after)
+{
+	writeOpcode(CommandOpcode::TransitionSceneTarget);
+	write(static_cast<uint8_t>(before));
+	write(static_cast<uint8_t>(after));
+}
+
+void CommandStream::setSceneRenderTarget()
+{
+	writeOpcode(CommandOpcode::SetSceneRenderTarget);
+}
+
+void CommandStream::clearSceneRenderTarget(const float color[4])
+{
+	writeOpcode(CommandOpcode::ClearSceneRenderTarget);
+	writeBytes(color, 4 * sizeof(float));
+}
+
+void CommandStream::upscaleScene(const ScissorRect& source)
+{
+	writeOpcode(CommandOpcode::UpscaleScene);
+	write(source);
+}
+
+void CommandStream::updateConstantBuffer(uint32_t frameIndex, const void* values, size_t size)
+{
+	writeOpcode(CommandOpcode::UpdateConstantBuffer);
+	write(frameIndex);
+	write(static_cast<uint32_t>(size));
+	writeBytes(values, size);
+}
+
+void CommandStream::clear()
+{
+	data.clear();
+	commandCount = 0;
+}
+
+void CommandStream::append(const CommandStream& other)
+{
+	data.insert(data.end(), other.data.begin(), other.data.end());
+	commandCount += other.commandCount;
+}
+
+const uint8_t* CommandStream::getData() const
+{
+	return data.data();
+}
+
+size_t CommandStream::getSize() const
+{
+	return data.size();
+}
+
+uint32_t CommandStream::getCommandCount() const
+{
+	return commandCount;
+}
+
+void CommandStream::replay(RenderDevice& device) const
+{
+	replay(device, device.getCommandList());
+}
+
+void CommandStream::replay(RenderDevice& device, CommandList& commandList) const
+{
+	CommandReader reader{ data.data(), data.data() + data.size() };
+
+	while (!reader.atEnd())
+	{
+		CommandOpcode opcode{ reader.read<CommandOpcode>() };
+		switch (opcode)
+		{
+		case CommandOpcode::Reset:
+			commandList.reset(reader.read<uint32_t>());
+			break;
+		case CommandOpcode::SetPipelineState:
+			commandList.setPipelineState(readEnum<PipelineId>(reader, 4));
+			break;
+		case CommandOpcode::SetGraphicsRootSignature:
+			commandList.setGraphicsRootSignature();
+			break;
+		case CommandOpcode::SetViewport:
+			commandList.setViewport(reader.read<Viewport>());
+			break;
+		case CommandOpcode::SetScissorRect:
+			commandList.setScissorRect(reader.read<ScissorRect>());
+			break;
+		case CommandOpcode::TransitionBackBuffer:
+		{
+			uint32_t frameIndex{ reader.read<uint32_t>() };
+			ResourceState before{ readEnum<ResourceState>(reader, 3) };
+			ResourceState after{ readEnum<ResourceState>(reader, 3) };
+			commandList.transitionBackBuffer(frameIndex, before, after);
+			break;
+		}
+		case CommandOpcode::SetRenderTarget:
+			commandList.setRenderTarget(reader.read<uint32_t>());
+			break;
+		case CommandOpcode::ClearRenderTarget:
+		{
+			uint32_t frameIndex{ reader.read<uint32_t>() };
+			float color[4];
+			memcpy(color, reader.readBytes(sizeof(color)), sizeof(color));
+			commandList.clearRenderTarget(frameIndex, color);
+			break;
+		}
+		case CommandOpcode::ClearDepth:
+			commandList.clearDepth(reader.read<float>());
+			break;
+		case CommandOpcode::SetPrimitiveTopology:
+			commandList.setPrimitiveTopology(readEnum<PrimitiveTopology>(reader, 2));
+			break;
+		case CommandOpcode::SetVertexBuffer:
+			commandList.setVertexBuffer(readEnum<BufferId>(reader, 4));
+			break;
+		case CommandOpcode::SetIndexBuffer:
+			commandList.setIndexBuffer(readEnum<BufferId>(reader, 4));
+			break;
+		case CommandOpcode::SetGraphicsRoot32BitConstants:
+		{
+			uint32_t rootIndex{ reader.read<uint32_t>() };
+			uint32_t count{ reader.read<uint32_t>() };
+			if (count > 64)
+			{
+				throw(runtime_error{ "Invalid command stream argument." });
+			}
+			uint32_t values[64];
+			memcpy(values, reader.readBytes(count * sizeof(uint32_t)), count * sizeof(uint32_t));
+			commandList.setGraphicsRoot32BitConstants(rootIndex, count, values);
+			break;
+		}
+		case CommandOpcode::SetGraphicsRootDescriptorTable:
+			commandList.setGraphicsRootDescriptorTable(reader.read<uint32_t>());
+			break;
+		case CommandOpcode::SetGraphicsRootConstantBufferView:
+		{
+			uint32_t rootIndex{ reader.read<uint32_t>() };
+			uint32_t frameIndex{ reader.read<uint32_t>() };
+			commandList.setGraphicsRootConstantBufferView(rootIndex, frameIndex);
+			break;
+		}
+		case CommandOpcode::DrawInstanced:
+		{
+			uint32_t vertexCount{ reader.read<uint32_t>() };
+			uint32_t instanceCount{ reader.read<uint32_t>() };
+			uint32_t startVertex{ reader.read<uint32_t>() };
+			uint32_t startInstance{ reader.read<uint32_t>() };
+			commandList.drawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+			break;
+		}
+		case CommandOpcode::DrawIndexedInstanced:
+		{
+			uint32_t indexCount{ reader.read<uint32_t>() };
+			uint32_t instanceCount{ reader.read<uint32_t>() };
+			uint32_t startIndex{ reader.read<uint32_t>() };
+			int32_t baseVertex{ reader.read<int32_t>() };
+			uint32_t startInstance{ reader.read<uint32_t>() };
+			commandList.drawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+			break;
+		}
+		case CommandOpcode::Close:
+			commandList.close();
+			break;
+		case CommandOpcode::UpdateConstantBuffer:
+		{
+			uint32_t frameIndex{ reader.read<uint32_t>() };
+			uint32_t size{ reader.read<uint32_t>() };
+			device.updateConstantBuffer(frameIndex, reader.readBytes(size), size);
+			break;
+		}
+		case CommandOpcode::WriteTimestamp:
+		{
+			uint32_t frameIndex{ reader.read<uint32_t>() };
+			uint32_t queryIndex{ reader.read<uint32_t>() };
+			commandList.writeTimestamp(frameIndex, queryIndex);
+			break;
+		}
+		case CommandOpcode::ResolveTimestamps:
+		{
+			uint32_t frameIndex{ reader.read<uint32_t>() };
+			uint32_t queryCount{ reader.read<uint32_t>() };
+			commandList.resolveTimestamps(frameIndex, queryCount);
+			break;
+		}
+		case CommandOpcode::TransitionSceneTarget:
+		{
+			ResourceState before{ readEnum<ResourceState>(reader, 3) };
+			ResourceState after{ readEnum<ResourceState>(reader, 3) };
+			commandList.transitionSceneTarget(before, after);
+			break;
+		}
+		case CommandOpcode::SetSceneRenderTarget:
+			commandList.setSceneRenderTarget();
+			break;
+		case CommandOpcode::ClearSceneRenderTarget:
+		{
+			float color[4];
+			memcpy(color, reader.readBytes(sizeof(color)), sizeof(color));
+			commandList.clearSceneRenderTarget(color);
+			break;
+		}
+		case CommandOpcode::UpscaleScene:
+			commandList.upscaleScene(reader.read<ScissorRect>());
+			break;
+		default:
+			throw(runtime_error{ "Invalid command stream opcode." });
+		}
+	}
+}
+
+void CommandStream::save(string path) const
+{
+	ofstream file{ path, ios::binary | ios::trunc };
+	if (!file)
+	{
+		throw(runtime_error{ "Error creating command stream file." });
+	}
+
+	CommandStreamHeader header;
+	memcpy(header.magic, commandStreamMagic, sizeof(header.magic));
+	header.version = commandStreamVersion;
+	header.commandCount = commandCount;
+	header.size = static_cast<uint32_t>(data.size());
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	if (!file)
+	{
+		throw(runtime_error{ "Error writing command stream file." });
+	}
+}
+
+void CommandStream::load(string path)
+{
+	ifstream file{ path, ios::binary };
+	if (!file)
+	{
+		throw(runtime_error{ "Error opening command stream file." });
+	}
+
+	CommandStreamHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.magic, commandStreamMagic, sizeof(commandStreamMagic)) != 0)
+	{
+		throw(runtime_error{ "Invalid command stream file." });
+	}
+
+	if (header.version != commandStreamVersion)
+	{
+		throw(runtime_error{ "Unsupported command stream version." });
+	}
+
+	data.resize(header.size);
+	if (!file.read(reinterpret_cast<char*>(data.data()), data.size()))
+	{
+		throw(runtime_error{ "Error reading command stream file." });
+	}
+	commandCount = header.commandCount;
+}
+
+void CommandStream::writeOpcode(CommandOpcode opcode)
+{
+	write(opcode);
+	++commandCount;
+}
+
+void CommandStream::writeBytes(const void* values, size_t size)
+{
+	const uint8_t* bytes{ static_cast<const uint8_t*>(values) };
+	data.insert(data.end(), bytes, bytes + size);
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "RenderDevice.h"
+
+enum class CommandOpcode : uint8_t
+{
+	Reset = 1,
+	SetPipelineState,
+	SetGraphicsRootSignature,
+	SetViewport,
+	SetScissorRect,
+	TransitionBackBuffer,
+	SetRenderTarget,
+	ClearRenderTarget,
+	ClearDepth,
+	SetPrimitiveTopology,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	SetGraphicsRoot32BitConstants,
+	SetGraphicsRootDescriptorTable,
+	SetGraphicsRootConstantBufferView,
+	DrawInstanced,
+	DrawIndexedInstanced,
+	Close,
+	UpdateConstantBuffer,
+	WriteTimestamp,
+	ResolveTimestamps,
+	TransitionSceneTarget,
+	SetSceneRenderTarget,
+	ClearSceneRenderTarget,
+	UpscaleScene
+};
+
+namespace details
+{
+#pragma pack(push, 1)
+	struct CommandStreamHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t commandCount;
+		uint32_t size;
+	};
+#pragma pack(pop)
+}
+
+// Linear encoding of one or more frames of CommandList calls: a one byte opcode followed by its packed
+// little endian arguments. Constant buffer updates are recorded in order with the commands so a stream is
+// self contained and can be replayed against any RenderDevice (D3D12, null or the software rasterizer).
+class CommandStream : public CommandList
+{
+public:
+	void reset(uint32_t frameIndex) override;
+	void setPipelineState(PipelineId pipeline) override;
+	void setGraphicsRootSignature() override;
+	void setViewport(const Viewport& viewport) override;
+	void setScissorRect(const ScissorRect& rect) override;
+	void transitionBackBuffer(uint32_t frameIndex, ResourceState before, ResourceState after) override;
+	void setRenderTarget(uint32_t frameIndex) override;
+	void clearRenderTarget(uint32_t frameIndex, const float color[4]) override;
+	void clearDepth(float depth) override;
+	void setPrimitiveTopology(PrimitiveTopology topology) override;
+	void setVertexBuffer(BufferId buffer) override;
+	void setIndexBuffer(BufferId buffer) override;
+	void setGraphicsRoot32BitConstants(uint32_t rootIndex, uint32_t count, const void* data) override;
+	void setGraphicsRootDescriptorTable(uint32_t rootIndex) override;
+	void setGraphicsRootConstantBufferView(uint32_t rootIndex, uint32_t frameIndex) override;
+	void drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance) override;
+	void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+	void writeTimestamp(uint32_t frameIndex, uint32_t queryIndex) override;
+	void resolveTimestamps(uint32_t frameIndex, uint32_t queryCount) override;
+	void close() override;
+	void transitionSceneTarget(ResourceState before, ResourceState after) override;
+	void setSceneRenderTarget() override;
+	void clearSceneRenderTarget(const float color[4]) override;
+	void upscaleScene(const ScissorRect& source) override;
+
+	void updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size);
+
+	// drops the recorded commands but keeps the capacity
+	void clear();
+	void append(const CommandStream& other);
+
+	const uint8_t* getData() const;
+	size_t getSize() const;
+	uint32_t getCommandCount() const;
+
+	// Decodes the stream, issuing commands on device.getCommandList() and constant buffer updates on the
+	// device. Throws on malformed data.
+	void replay(RenderDevice& device) const;
+	// the same, issuing the commands on commandList instead
+	void replay(RenderDevice& device, CommandList& commandList) const;
+
+	void save(std::string path) const;
+	void load(std::string path);
+
+private:
+	void writeOpcode(CommandOpcode opcode);
+	template <typename T> void write(T value);
+	void writeBytes(const void* data, size_t size);
+
+private:
+	std::vector<uint8_t> data;
+	uint32_t commandCount{ 0 };
+};
\ No newline at end of file
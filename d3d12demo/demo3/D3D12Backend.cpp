@@ -0,0 +1,436 @@
+#include <stdexcept>
+#include <cstring>
+#include "D3D12Backend.h"
+#include "Demo.h"
+#include "FenceWaiter.h"
+
+using namespace std;
+using namespace Microsoft::WRL;
+
+namespace
+{
+	D3D12_RESOURCE_STATES toD3D12(ResourceState state)
+	{
+		switch (state)
+		{
+		case ResourceState::Present:
+			return D3D12_RESOURCE_STATE_PRESENT;
+		case ResourceState::ShaderResource:
+			return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		default:
+			return D3D12_RESOURCE_STATE_RENDER_TARGET;
+		}
+	}
+
+	void transition(ID3D12GraphicsCommandList* commandList, ID3D12Resource* resource, ResourceState before, ResourceState after)
+	{
+		D3D12_RESOURCE_BARRIER barrierDesc;
+		ZeroMemory(&barrierDesc, sizeof(barrierDesc));
+		barrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrierDesc.Transition.pResource = resource;
+		barrierDesc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrierDesc.Transition.StateBefore = toD3D12(before);
+		barrierDesc.Transition.StateAfter = toD3D12(after);
+		barrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		commandList->ResourceBarrier(1, &barrierDesc);
+	}
+}
+
+D3D12Fence::D3D12Fence(ID3D12Fence* fence) : fence{ fence }
+{
+}
+
+uint64_t D3D12Fence::getCompletedValue()
+{
+	return fence->GetCompletedValue();
+}
+
+void D3D12Fence::notifyOnCompletion(uint64_t value, FenceWaiter& waiter)
+{
+	if (FAILED(fence->SetEventOnCompletion(value, waiter.getNativeWakeEvent())))
+	{
+		throw(runtime_error{ "Failed set event on completion." });
+	}
+}
+
+void D3D12Fence::cancelNotification(uint64_t, FenceWaiter&)
+{
+	// the runtime holds only the event handle, which FenceWaiter closes last; nothing refers to the waiter itself
+}
+
+D3D12Backend::D3D12Backend(Demo& demo) : demo(demo)
+{
+	descriptorSizeRtv = demo.device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+	descriptorSizeCbvSrv = demo.device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	createTimestampQueries();
+
+	for (const ComPtr<ID3D12Fence>& fence : demo.fences)
+	{
+		frameFences.push_back(make_unique<D3D12Fence>(fence.Get()));
+	}
+}
+
+uint32_t D3D12Backend::getBufferCount()
+{
+	return demo.bufferCount;
+}
+
+uint32_t D3D12Backend::getCurrentBackBufferIndex()
+{
+	return demo.swapChain->GetCurrentBackBufferIndex();
+}
+
+CommandList& D3D12Backend::getCommandList()
+{
+	return *this;
+}
+
+void D3D12Backend::resetCommandAllocator(uint32_t frameIndex)
+{
+	if (FAILED(demo.commandAllocators[frameIndex]->Reset()))
+	{
+		throw(runtime_error{ "Error resetting command allocator." });
+	}
+}
+
+void D3D12Backend::updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size)
+{
+	D3D12_RANGE readRange = { 0, 0 };
+	uint8_t* cbvDataBegin;
+	if (FAILED(demo.constBuffer->Map(0, &readRange, reinterpret_cast<void**>(&cbvDataBegin))))
+	{
+		throw(runtime_error{ "Error mapping constant buffer." });
+	}
+	memcpy(&cbvDataBegin[frameIndex * constantBufferSliceSize], data, size);
+	demo.constBuffer->Unmap(0, nullptr);
+}
+
+void D3D12Backend::executeCommandList()
+{
+	ID3D12CommandList* cmdList{ demo.commandList.Get() };
+	demo.commandQueue->ExecuteCommandLists(1, &cmdList);
+}
+
+void D3D12Backend::present(uint32_t syncInterval)
+{
+	HRESULT hr{ demo.swapChain->Present(syncInterval, 0) };
+	if (FAILED(hr))
+	{
+		throw(runtime_error{ "Failed present." });
+	}
+	occluded = hr == DXGI_STATUS_OCCLUDED;
+}
+
+bool D3D12Backend::isOccluded()
+{
+	return occluded;
+}
+
+bool D3D12Backend::testOcclusion()
+{
+	HRESULT hr{ demo.swapChain->Present(0, DXGI_PRESENT_TEST) };
+	if (FAILED(hr))
+	{
+		throw(runtime_error{ "Failed present test." });
+	}
+	occluded = hr == DXGI_STATUS_OCCLUDED;
+	return occluded;
+}
+
+void D3D12Backend::signal(uint32_t frameIndex)
+{
+	UINT64& fenceValue{ demo.fenceValues[frameIndex] };
+	++fenceValue;
+	if (FAILED(demo.commandQueue->Signal(demo.fences[frameIndex].Get(), fenceValue)))
+	{
+		throw(runtime_error{ "Failed signal." });
+	}
+}
+
+void D3D12Backend::waitFrameComplete(uint32_t frameIndex)
+{
+	demo.waitFrameComplete(frameIndex);
+}
+
+uint64_t D3D12Backend::getFenceValue(uint32_t frameIndex)
+{
+	return demo.fenceValues[frameIndex];
+}
+
+Fence& D3D12Backend::getFence(uint32_t frameIndex)
+{
+	return *frameFences[frameIndex];
+}
+
+uint64_t D3D12Backend::getTimestampFrequency()
+{
+	UINT64 frequency;
+	if (FAILED(demo.commandQueue->GetTimestampFrequency(&frequency)))
+	{
+		throw(runtime_error{ "Error getting timestamp frequency." });
+	}
+	return frequency;
+}
+
+void D3D12Backend::getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuNs)
+{
+	UINT64 gpu;
+	UINT64 cpu;
+	if (FAILED(demo.commandQueue->GetClockCalibration(&gpu, &cpu)))
+	{
+		throw(runtime_error{ "Error getting clock calibration." });
+	}
+
+	// the CPU side is a QueryPerformanceCounter value, the same clock steady_clock reads
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	gpuTimestamp = gpu;
+	cpuNs = static_cast<uint64_t>(static_cast<double>(cpu) * 1e9 / static_cast<double>(frequency.QuadPart));
+}
+
+void D3D12Backend::readTimestamps(uint32_t frameIndex, uint64_t* timestamps, uint32_t count)
+{
+	SIZE_T offset{ frameIndex * maxTimestampQueries * sizeof(uint64_t) };
+	D3D12_RANGE readRange{ offset, offset + count * sizeof(uint64_t) };
+	uint8_t* data;
+	if (FAILED(timestampReadbackBuffer->Map(0, &readRange, reinterpret_cast<void**>(&data))))
+	{
+		throw(runtime_error{ "Error mapping timestamp readback buffer." });
+	}
+	memcpy(timestamps, data + offset, count * sizeof(uint64_t));
+
+	D3D12_RANGE writeRange{ 0, 0 };
+	timestampReadbackBuffer->Unmap(0, &writeRange);
+}
+
+void D3D12Backend::reset(uint32_t frameIndex)
+{
+	if (FAILED(demo.commandList->Reset(demo.commandAllocators[frameIndex].Get(), nullptr)))
+	{
+		throw(runtime_error{ "Error resetting command list." });
+	}
+}
+
+void D3D12Backend::setPipelineState(PipelineId pipeline)
+{
+	ID3D12PipelineState* pipelineState{ nullptr };
+	switch (pipeline)
+	{
+	case PipelineId::Wireframe:
+		pipelineState = demo.pipelineStateWireframe.Get();
+		break;
+	case PipelineId::Solid:
+		pipelineState = demo.pipelineStateSolid.Get();
+		break;
+	case PipelineId::WireframeMesh:
+		pipelineState = demo.pipelineStateWireframeMesh.Get();
+		break;
+	case PipelineId::SolidMesh:
+		pipelineState = demo.pipelineStateSolidMesh.Get();
+		break;
+	}
+	demo.commandList->SetPipelineState(pipelineState);
+}
+
+void D3D12Backend::setGraphicsRootSignature()
+{
+	demo.commandList->SetGraphicsRootSignature(demo.rootSignature.Get());
+}
+
+void D3D12Backend::setViewport(const Viewport& viewport)
+{
+	D3D12_VIEWPORT d3d12Viewport{ viewport.topLeftX, viewport.topLeftY, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth };
+	demo.commandList->RSSetViewports(1, &d3d12Viewport);
+}
+
+void D3D12Backend::setScissorRect(const ScissorRect& rect)
+{
+	D3D12_RECT d3d12Rect{ rect.left, rect.top, rect.right, rect.bottom };
+	demo.commandList->RSSetScissorRects(1, &d3d12Rect);
+}
+
+void D3D12Backend::transitionBackBuffer(uint32_t frameIndex, ResourceState before, ResourceState after)
+{
+	transition(demo.commandList.Get(), demo.swapChainBuffers[frameIndex].Get(), before, after);
+}
+
+void D3D12Backend::setRenderTarget(uint32_t frameIndex)
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE descHandleRtv(demo.descHeapRtv->GetCPUDescriptorHandleForHeapStart());
+	descHandleRtv.ptr += frameIndex * descriptorSizeRtv;
+
+	D3D12_CPU_DESCRIPTOR_HANDLE descHandleDepthStencil(demo.descHeapDepthStencil->GetCPUDescriptorHandleForHeapStart());
+
+	demo.commandList->OMSetRenderTargets(1, &descHandleRtv, FALSE, &descHandleDepthStencil);
+}
+
+void D3D12Backend::clearRenderTarget(uint32_t frameIndex, const float color[4])
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE descHandleRtv(demo.descHeapRtv->GetCPUDescriptorHandleForHeapStart());
+	descHandleRtv.ptr += frameIndex * descriptorSizeRtv;
+	demo.commandList->ClearRenderTargetView(descHandleRtv, color, 0, nullptr);
+}
+
+void D3D12Backend::clearDepth(float depth)
+{
+	demo.commandList->ClearDepthStencilView(demo.descHeapDepthStencil->GetCPUDescriptorHandleForHeapStart(), D3D12_CLEAR_FLAG_DEPTH, depth, 0, 0, nullptr);
+}
+
+void D3D12Backend::setPrimitiveTopology(PrimitiveTopology topology)
+{
+	demo.commandList->IASetPrimitiveTopology(topology == PrimitiveTopology::PatchList16 ? D3D_PRIMITIVE_TOPOLOGY_16_CONTROL_POINT_PATCHLIST : D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void D3D12Backend::setVertexBuffer(BufferId buffer)
+{
+	if (buffer != BufferId::ControlPoints && buffer != BufferId::LodVertices)
+	{
+		throw(runtime_error{ "Buffer is not a vertex buffer." });
+	}
+	demo.commandList->IASetVertexBuffers(0, 1, buffer == BufferId::LodVertices ? &demo.lodVertexBufferView : &demo.controlPointsBufferView);
+}
+
+void D3D12Backend::setIndexBuffer(BufferId buffer)
+{
+	if (buffer != BufferId::PatchIndices && buffer != BufferId::LodIndices)
+	{
+		throw(runtime_error{ "Buffer is not an index buffer." });
+	}
+	demo.commandList->IASetIndexBuffer(buffer == BufferId::LodIndices ? &demo.lodIndexBufferView : &demo.controlPointsIndexBufferView);
+}
+
+void D3D12Backend::setGraphicsRoot32BitConstants(uint32_t rootIndex, uint32_t count, const void* data)
+{
+	demo.commandList->SetGraphicsRoot32BitConstants(rootIndex, count, data, 0);
+}
+
+void D3D12Backend::setGraphicsRootDescriptorTable(uint32_t rootIndex)
+{
+	ID3D12DescriptorHeap* ppHeaps[] = { demo.transformsAndColorsDescHeap.Get() };
+	demo.commandList->SetDescriptorHeaps(1, ppHeaps);
+	demo.commandList->SetGraphicsRootDescriptorTable(rootIndex, demo.transformsAndColorsDescHeap->GetGPUDescriptorHandleForHeapStart());
+}
+
+void D3D12Backend::setGraphicsRootConstantBufferView(uint32_t rootIndex, uint32_t frameIndex)
+{
+	demo.commandList->SetGraphicsRootConstantBufferView(rootIndex, demo.constBuffer->GetGPUVirtualAddress() + frameIndex * constantBufferSliceSize);
+}
+
+void D3D12Backend::drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
+{
+	demo.commandList->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+}
+
+void D3D12Backend::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+	demo.commandList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void D3D12Backend::writeTimestamp(uint32_t frameIndex, uint32_t queryIndex)
+{
+	demo.commandList->EndQuery(timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * maxTimestampQueries + queryIndex);
+}
+
+void D3D12Backend::resolveTimestamps(uint32_t frameIndex, uint32_t queryCount)
+{
+	UINT firstQuery{ frameIndex * maxTimestampQueries };
+	demo.commandList->ResolveQueryData(timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, queryCount, timestampReadbackBuffer.Get(), firstQuery * sizeof(uint64_t));
+}
+
+void D3D12Backend::close()
+{
+	if (FAILED(demo.commandList->Close()))
+	{
+		throw(runtime_error{ "Failed closing command list." });
+	}
+}
+
+void D3D12Backend::transitionSceneTarget(ResourceState before, ResourceState after)
+{
+	transition(demo.commandList.Get(), demo.sceneTarget.Get(), before, after);
+}
+
+void D3D12Backend::setSceneRenderTarget()
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE descHandleRtv(demo.sceneRtvHeap->GetCPUDescriptorHandleForHeapStart());
+	D3D12_CPU_DESCRIPTOR_HANDLE descHandleDepthStencil(demo.descHeapDepthStencil->GetCPUDescriptorHandleForHeapStart());
+	demo.commandList->OMSetRenderTargets(1, &descHandleRtv, FALSE, &descHandleDepthStencil);
+}
+
+void D3D12Backend::clearSceneRenderTarget(const float color[4])
+{
+	demo.commandList->ClearRenderTargetView(demo.sceneRtvHeap->GetCPUDescriptorHandleForHeapStart(), color, 0, nullptr);
+}
+
+void D3D12Backend::upscaleScene(const ScissorRect& source)
+{
+	D3D12_RESOURCE_DESC sceneDesc{ demo.sceneTarget->GetDesc() };
+	float width{ static_cast<float>(sceneDesc.Width) };
+	float height{ static_cast<float>(sceneDesc.Height) };
+	float sourceRect[4]{ source.left / width, source.top / height, source.right / width, source.bottom / height };
+
+	demo.commandList->SetPipelineState(demo.pipelineStateUpscale.Get());
+	demo.commandList->SetGraphicsRootSignature(demo.upscaleRootSignature.Get());
+	ID3D12DescriptorHeap* ppHeaps[] = { demo.transformsAndColorsDescHeap.Get() };
+	demo.commandList->SetDescriptorHeaps(1, ppHeaps);
+	D3D12_GPU_DESCRIPTOR_HANDLE sceneSrv(demo.transformsAndColorsDescHeap->GetGPUDescriptorHandleForHeapStart());
+	sceneSrv.ptr += 2 * descriptorSizeCbvSrv;
+	demo.commandList->SetGraphicsRootDescriptorTable(1, sceneSrv);
+	demo.commandList->SetGraphicsRoot32BitConstants(0, 4, sourceRect, 0);
+	demo.commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	demo.commandList->DrawInstanced(3, 1, 0, 0);
+}
+
+void D3D12Backend::createTimestampQueries()
+{
+	UINT queryCount{ demo.bufferCount * maxTimestampQueries };
+
+	D3D12_QUERY_HEAP_DESC queryHeapDesc;
+	ZeroMemory(&queryHeapDesc, sizeof(queryHeapDesc));
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = queryCount;
+	queryHeapDesc.NodeMask = 0;
+
+	if (FAILED(demo.device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(timestampQueryHeap.ReleaseAndGetAddressOf()))))
+	{
+		throw(runtime_error{ "Error creating timestamp query heap." });
+	}
+
+	D3D12_HEAP_PROPERTIES heapProps;
+	ZeroMemory(&heapProps, sizeof(heapProps));
+	heapProps.Type = D3D12_HEAP_TYPE_READBACK;
+	heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapProps.CreationNodeMask = 1;
+	heapProps.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC resourceDesc;
+	ZeroMemory(&resourceDesc, sizeof(resourceDesc));
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Alignment = 0;
+	resourceDesc.Width = queryCount * sizeof(uint64_t);
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.SampleDesc.Quality = 0;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	resourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	HRESULT hr{ demo.device->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&resourceDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(timestampReadbackBuffer.ReleaseAndGetAddressOf())
+	) };
+
+	if (FAILED(hr))
+	{
+		throw(runtime_error{ "Error creating timestamp readback buffer." });
+	}
+
+	timestampReadbackBuffer->SetName(L"timestamps");
+}
\ No newline at end of file
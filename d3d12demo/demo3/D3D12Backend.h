@@ -0,0 +1,89 @@
+#pragma once
+
+#include <d3d12.h>
+#include <memory>
+#include <vector>
+#include <wrl/client.h>
+#include "RenderDevice.h"
+
+class Demo;
+
+// Fence over an ID3D12Fence; completion sets the FenceWaiter's event through SetEventOnCompletion.
+class D3D12Fence : public Fence
+{
+public:
+	D3D12Fence(ID3D12Fence* fence);
+
+	uint64_t getCompletedValue() override;
+	void notifyOnCompletion(uint64_t value, FenceWaiter& waiter) override;
+	void cancelNotification(uint64_t value, FenceWaiter& waiter) override;
+
+private:
+	ID3D12Fence* fence;
+};
+
+// RenderDevice over the objects Demo and Graphics create: forwards each call to the D3D12 command list,
+// command queue and swap chain.
+class D3D12Backend : public RenderDevice, public CommandList
+{
+public:
+	D3D12Backend(Demo& demo);
+
+	uint32_t getBufferCount() override;
+	uint32_t getCurrentBackBufferIndex() override;
+	CommandList& getCommandList() override;
+	void resetCommandAllocator(uint32_t frameIndex) override;
+	void updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size) override;
+	void executeCommandList() override;
+	void present(uint32_t syncInterval) override;
+	bool isOccluded() override;
+	bool testOcclusion() override;
+	void signal(uint32_t frameIndex) override;
+	void waitFrameComplete(uint32_t frameIndex) override;
+	uint64_t getFenceValue(uint32_t frameIndex) override;
+	Fence& getFence(uint32_t frameIndex) override;
+	uint64_t getTimestampFrequency() override;
+	void getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuNs) override;
+	void readTimestamps(uint32_t frameIndex, uint64_t* timestamps, uint32_t count) override;
+
+	void reset(uint32_t frameIndex) override;
+	void setPipelineState(PipelineId pipeline) override;
+	void setGraphicsRootSignature() override;
+	void setViewport(const Viewport& viewport) override;
+	void setScissorRect(const ScissorRect& rect) override;
+	void transitionBackBuffer(uint32_t frameIndex, ResourceState before, ResourceState after) override;
+	void setRenderTarget(uint32_t frameIndex) override;
+	void clearRenderTarget(uint32_t frameIndex, const float color[4]) override;
+	void clearDepth(float depth) override;
+	void setPrimitiveTopology(PrimitiveTopology topology) override;
+	void setVertexBuffer(BufferId buffer) override;
+	void setIndexBuffer(BufferId buffer) override;
+	void setGraphicsRoot32BitConstants(uint32_t rootIndex, uint32_t count, const void* data) override;
+	void setGraphicsRootDescriptorTable(uint32_t rootIndex) override;
+	void setGraphicsRootConstantBufferView(uint32_t rootIndex, uint32_t frameIndex) override;
+	void drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance) override;
+	void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+	void writeTimestamp(uint32_t frameIndex, uint32_t queryIndex) override;
+	void resolveTimestamps(uint32_t frameIndex, uint32_t queryCount) override;
+	void close() override;
+	void transitionSceneTarget(ResourceState before, ResourceState after) override;
+	void setSceneRenderTarget() override;
+	void clearSceneRenderTarget(const float color[4]) override;
+	void upscaleScene(const ScissorRect& source) override;
+
+	// the constant buffer holds one 256 byte aligned slice per back buffer
+	static const uint32_t constantBufferSliceSize{ 256 };
+
+private:
+	void createTimestampQueries();
+
+private:
+	Demo& demo;
+	uint32_t descriptorSizeRtv;
+	uint32_t descriptorSizeCbvSrv;
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> timestampQueryHeap;
+	Microsoft::WRL::ComPtr<ID3D12Resource> timestampReadbackBuffer;
+	std::vector<std::unique_ptr<D3D12Fence>> frameFences;
+	// DXGI_STATUS_OCCLUDED from the last Present
+	bool occluded{ false };
+};
\ No newline at end of file
@@ -1,202 +1,248 @@
+#include <cstddef>
 #include <stdexcept>
 #include <d3dcompiler.h>
 #include "Demo.h"
-#include "TeapotData.h"
+#include "BernsteinTableCache.h"
 #include "Window.h"
 #include "Utils.h"
+#include "Trace.h"
 
 using namespace std;
 using namespace Microsoft::WRL;
 using namespace DirectX;
 
-Demo::Demo(UINT bufferCount, string name, LONG width, LONG height) : Graphics{ bufferCount, name, width, height }
+Demo::Demo(UINT bufferCount, string name, LONG width, LONG height, const PatchModel& model, bool lodEnabled) : Demo{ bufferCount, name, width, height, static_cast<uint32_t>(model.patches.size()) }
 {
-	using PointType = decltype(TeapotData::points)::value_type;
-	using TransformType = decltype(TeapotData::patchesTransforms)::value_type;
-	using ColorType = decltype(TeapotData::patchesColors)::value_type;
+	controlPointsBuffer = teapot_tutorial::createVertexBuffer(device.Get(), model.points, L"control points");
+	controlPointsIndexBuffer = teapot_tutorial::createIndexBuffer(device.Get(), model.patches, L"patches");
+	transformsBuffer = teapot_tutorial::createStructuredBuffer(device.Get(), model.patchesTransforms, L"transforms");
+	colorsBuffer = teapot_tutorial::createStructuredBuffer(device.Get(), model.patchesColors, L"colors");
+	createModelViews(model.points.size(), model.patches.size(), model.patchesTransforms.size(), model.patchesColors.size());
 
-	controlPointsBuffer = teapot_tutorial::createVertexBuffer(device.Get(), TeapotData::points, L"control points");
-	controlPointsIndexBuffer = teapot_tutorial::createIndexBuffer(device.Get(), TeapotData::patches, L"patches");
+	if (lodEnabled)
+	{
+		lodChain = make_unique<LodChain>(model);
+		lodVertexBuffer = teapot_tutorial::createVertexBuffer(device.Get(), lodChain->getVertices(), L"lod vertices");
+		lodIndexBuffer = teapot_tutorial::createIndexBuffer(device.Get(), lodChain->getIndices(), L"lod indices");
 
-	controlPointsBufferView.BufferLocation = controlPointsBuffer->GetGPUVirtualAddress();
-	controlPointsBufferView.StrideInBytes = static_cast<UINT>(sizeof(PointType));
-	controlPointsBufferView.SizeInBytes = static_cast<UINT>(controlPointsBufferView.StrideInBytes * TeapotData::points.size());
+		lodVertexBufferView.BufferLocation = lodVertexBuffer->GetGPUVirtualAddress();
+		lodVertexBufferView.StrideInBytes = static_cast<UINT>(sizeof(LodVertex));
+		lodVertexBufferView.SizeInBytes = static_cast<UINT>(lodVertexBufferView.StrideInBytes * lodChain->getVertices().size());
 
-	controlPointsIndexBufferView.BufferLocation = controlPointsIndexBuffer->GetGPUVirtualAddress();
-	controlPointsIndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-	controlPointsIndexBufferView.SizeInBytes = static_cast<UINT>(TeapotData::patches.size() * sizeof(uint32_t));
+		lodIndexBufferView.BufferLocation = lodIndexBuffer->GetGPUVirtualAddress();
+		lodIndexBufferView.Format = DXGI_FORMAT_R32_UINT;
+		lodIndexBufferView.SizeInBytes = static_cast<UINT>(lodChain->getIndices().size() * sizeof(uint32_t));
+
+		renderer.setLodChain(lodChain.get());
+	}
+}
+
+Demo::Demo(UINT bufferCount, string name, LONG width, LONG height, AssetStreamReader& stream)
+	: Demo{ bufferCount, name, width, height, static_cast<uint32_t>(stream.getSectionSize(AssetSectionId::Patches) / sizeof(uint32_t)) }
+{
+	using PointType = decltype(PatchModel::points)::value_type;
+	using TransformType = decltype(PatchModel::patchesTransforms)::value_type;
+	using ColorType = decltype(PatchModel::patchesColors)::value_type;
+
+	controlPointsBuffer = teapot_tutorial::createVertexBuffer<PointType>(device.Get(), stream, AssetSectionId::Points, L"control points");
+	controlPointsIndexBuffer = teapot_tutorial::createIndexBuffer<uint32_t>(device.Get(), stream, AssetSectionId::Patches, L"patches");
+	transformsBuffer = teapot_tutorial::createStructuredBuffer<TransformType>(device.Get(), stream, AssetSectionId::PatchesTransforms, L"transforms");
+	colorsBuffer = teapot_tutorial::createStructuredBuffer<ColorType>(device.Get(), stream, AssetSectionId::PatchesColors, L"colors");
+	createModelViews(static_cast<size_t>(stream.getSectionSize(AssetSectionId::Points) / sizeof(PointType)),
+		static_cast<size_t>(stream.getSectionSize(AssetSectionId::Patches) / sizeof(uint32_t)),
+		static_cast<size_t>(stream.getSectionSize(AssetSectionId::PatchesTransforms) / sizeof(TransformType)),
+		static_cast<size_t>(stream.getSectionSize(AssetSectionId::PatchesColors) / sizeof(ColorType)));
+}
 
-	transformsBuffer = teapot_tutorial::createStructuredBuffer(device.Get(), TeapotData::patchesTransforms, L"transforms");
-	colorsBuffer = teapot_tutorial::createStructuredBuffer(device.Get(), TeapotData::patchesColors, L"colors");
+Demo::Demo(UINT bufferCount, string name, LONG width, LONG height, uint32_t indexCount) : Graphics{ bufferCount, name, width, height },
+	framePacer{ PacingMode::Throughput, teapot_tutorial::getDefaultMaxQueuedFrames(PacingMode::Throughput, bufferCount) },
+	renderer{ indexCount, window->getSize().x, window->getSize().y },
+	inputSystem{ window->getSize().x, window->getSize().y }, simulation{ window->getSize().x, window->getSize().y }, snapshots{ simulation.getSnapshot() }, pumpThreadId{ GetCurrentThreadId() }
+{
+	TRACE_SCOPE("Demo::Demo");
 
 	createTransformsAndColorsDescHeap();
-	
-	teapot_tutorial::createSrv<TransformType>(device.Get(), transformsAndColorsDescHeap.Get(), 0, transformsBuffer.Get(), TeapotData::patchesTransforms.size());
-	teapot_tutorial::createSrv<ColorType>(device.Get(), transformsAndColorsDescHeap.Get(), 1, colorsBuffer.Get(), TeapotData::patchesColors.size());
+
+	vector<Float4> bernsteinWeights{ BernsteinTableCache::getShared().getPackedWeights() };
+	bernsteinWeightsBuffer = teapot_tutorial::createStructuredBuffer(device.Get(), bernsteinWeights, L"bernstein weights");
+	teapot_tutorial::createSrv<Float4>(device.Get(), transformsAndColorsDescHeap.Get(), 3, bernsteinWeightsBuffer.Get(), bernsteinWeights.size());
 
 	createConstantBuffer();
+	createSceneTarget();
 	createShaders();
 	createRootSignature();
+	createUpscaleRootSignature();
 	createPipelineStateWireframe();
 	createPipelineStateSolid();
-	createViewport();
-	createScissorRect();
+	createPipelineStateMesh();
+	createPipelineStateUpscale();
 
-	auto lambda = [this](WPARAM wParam)
-	{
-		switch (wParam)
-		{
-		case 49:
-			--tessFactor;
-			if (tessFactor < 1) tessFactor = 1;
-			break;
-		case 50:
-			++tessFactor;
-			if (tessFactor > 64) tessFactor = 64;
-			break;
-		case 51:
-			currPipelineState = pipelineStateWireframe;
-			break;
-		case 52:
-			currPipelineState = pipelineStateSolid;
-			break;
-		}
-	};
-	shared_ptr<function<void(WPARAM)>> onKeyPress = make_shared<function<void(WPARAM)>>(lambda);
-	window->addKeyPressCallback(onKeyPress);
+	backend = make_unique<D3D12Backend>(*this);
+	recorder = make_unique<RecordingDevice>(*backend);
+
+	renderer.setInputSystem(&inputSystem);
+	renderer.setFramePacer(&framePacer);
+	window->setInputQueue(&inputQueue);
+	window->setInputSystem(&inputSystem);
 }
 
-void Demo::render()
+Demo::~Demo()
 {
-	UINT frameIndex{ swapChain->GetCurrentBackBufferIndex() };
+	window->setInputQueue(nullptr);
+	window->setInputSystem(nullptr);
+	try
+	{
+		stop();
+	}
+	catch (runtime_error&)
+	{
+	}
+}
 
-	ComPtr<ID3D12CommandAllocator> commandAllocator{ commandAllocators[frameIndex] };
+void Demo::start()
+{
+	renderThread = thread{ &Demo::renderLoop, this };
+}
 
-	if (FAILED(commandAllocator->Reset()))
+void Demo::update()
+{
+	if (simulation.update(inputQueue) > 0)
 	{
-		throw(runtime_error{ "Error resetting command allocator." });
+		const FrameSnapshot& snapshot{ simulation.getSnapshot() };
+		snapshots.getWriteBuffer() = snapshot;
+		snapshots.publish();
+		// WM_SIZE reports a zero client area when the window is minimized
+		loopScheduler.setMinimized(snapshot.input.width == 0 || snapshot.input.height == 0);
+		loopScheduler.requestRender();
 	}
+}
 
-	if (FAILED(commandList->Reset(commandAllocator.Get(), nullptr)))
+void Demo::stop()
+{
+	if (!renderThread.joinable())
 	{
-		throw(runtime_error{ "Error resetting command list." });
+		return;
 	}
-
-	commandList->SetPipelineState(currPipelineState.Get());
-	commandList->SetGraphicsRootSignature(rootSignature.Get());
-	commandList->RSSetViewports(1, &viewport);
-	commandList->RSSetScissorRects(1, &scissorRect);
-
-	ID3D12Resource* currBuffer{ swapChainBuffers[frameIndex].Get() };
-
-	D3D12_RESOURCE_BARRIER barrierDesc;
-	ZeroMemory(&barrierDesc, sizeof(barrierDesc)); 
-	barrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	barrierDesc.Transition.pResource = currBuffer;
-	barrierDesc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-	barrierDesc.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-	barrierDesc.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-	barrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-	commandList->ResourceBarrier(1, &barrierDesc);
-
-	static UINT descriptorSize{ device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV) };
-	D3D12_CPU_DESCRIPTOR_HANDLE descHandleRtv(descHeapRtv->GetCPUDescriptorHandleForHeapStart());
-	descHandleRtv.ptr += frameIndex * descriptorSize;
-
-	D3D12_CPU_DESCRIPTOR_HANDLE descHandleDepthStencil(descHeapDepthStencil->GetCPUDescriptorHandleForHeapStart());
-
-	commandList->OMSetRenderTargets(1, &descHandleRtv, FALSE, &descHandleDepthStencil);
-
-	static float clearColor[]{ 0.1f, 0.1f, 0.1f, 1.0f };
-	commandList->ClearRenderTargetView(descHandleRtv, clearColor, 0, nullptr);
-	commandList->ClearDepthStencilView(descHeapDepthStencil->GetCPUDescriptorHandleForHeapStart(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_16_CONTROL_POINT_PATCHLIST);
-
-	vector<D3D12_VERTEX_BUFFER_VIEW> myArray{ controlPointsBufferView  };
-	commandList->IASetVertexBuffers(0, static_cast<UINT>(myArray.size()), myArray.data());
-
-	vector<int> rootConstants{ tessFactor, tessFactor };
-	commandList->SetGraphicsRoot32BitConstants(1, static_cast<UINT>(rootConstants.size()), rootConstants.data(), 0);
-
-	ID3D12DescriptorHeap* ppHeaps[] = { transformsAndColorsDescHeap.Get() };
-	commandList->SetDescriptorHeaps(1, ppHeaps);
-	D3D12_GPU_DESCRIPTOR_HANDLE d = transformsAndColorsDescHeap->GetGPUDescriptorHandleForHeapStart();
-	d.ptr += 0;
-	commandList->SetGraphicsRootDescriptorTable(2, d);
-
-	POINT windowSize(window->getSize());
-	float ratio{ static_cast<float>(windowSize.x) / static_cast<float>(windowSize.y) };
-	XMMATRIX projMatrixDX{ XMMatrixPerspectiveFovLH(XMConvertToRadians(45), ratio, 1.0f, 100.0f) };
-
-	XMVECTOR camPositionDX(XMVectorSet(0.0f, 0.0f, -10.0f, 0.0f));
-	XMVECTOR camLookAtDX(XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f));
-	XMVECTOR camUpDX(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
-	XMMATRIX viewMatrixDX{ XMMatrixLookAtLH(camPositionDX, camLookAtDX, camUpDX) };
-
-	XMMATRIX viewProjMatrixDX{ viewMatrixDX * projMatrixDX };
-	UINT constDataSizeAligned{ (sizeof(XMFLOAT4X4) + 255) & ~255 };
-
-	POINT mousePoint(window->getMousePosition());
-	float pitch{ -XMConvertToRadians((mousePoint.x - (static_cast<float>(windowSize.x) / 2.0f)) / (static_cast<float>(windowSize.x) / 2.0f) * 180.0f) };
-	float roll{ XMConvertToRadians((mousePoint.y - (static_cast<float>(windowSize.y) / 2.0f)) / (static_cast<float>(windowSize.y) / 2.0f) * 180.0f) };
-
-	XMMATRIX modelMatrixRotationDX{ XMMatrixRotationRollPitchYaw(roll, pitch, 0.0f) };
-	XMMATRIX modelMatrixTranslationDX{ XMMatrixTranslation(0.0f, -1.0f, 0.0f) };
-	XMMATRIX modelMatrixDX{ modelMatrixRotationDX * modelMatrixTranslationDX };
-	XMFLOAT4X4 mvpMatrix;
-	XMStoreFloat4x4(&mvpMatrix, modelMatrixDX * viewProjMatrixDX);
-
-	D3D12_RANGE readRange = {0, 0};
-	uint8_t* cbvDataBegin;
-	constBuffer->Map(0, &readRange, reinterpret_cast<void**>(&cbvDataBegin));
-	memcpy(&cbvDataBegin[frameIndex * constDataSizeAligned], &mvpMatrix, sizeof(mvpMatrix));
-	constBuffer->Unmap(0, nullptr);
-
-	commandList->SetGraphicsRootConstantBufferView(0, constBuffer->GetGPUVirtualAddress() + frameIndex * constDataSizeAligned);
-
-	commandList->IASetIndexBuffer(&controlPointsIndexBufferView);
-
-	uint32_t numIndices{ controlPointsIndexBufferView.SizeInBytes / sizeof(uint32_t) };
-	commandList->DrawIndexedInstanced(numIndices, 1, 0, 0, 0);
-
-	ZeroMemory(&barrierDesc, sizeof(barrierDesc));
-	barrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	barrierDesc.Transition.pResource = currBuffer;
-	barrierDesc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-	barrierDesc.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-	barrierDesc.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-	barrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-	commandList->ResourceBarrier(1, &barrierDesc);
-
-	if (FAILED(commandList->Close()))
+	stopping.store(true, memory_order_release);
+	loopScheduler.wake();
+	renderThread.join();
+	if (!renderError.empty())
 	{
-		throw(runtime_error{ "Failed closing command list." });
+		throw(runtime_error{ renderError });
 	}
+}
 
-	ID3D12CommandList* cmdList{ commandList.Get() };
-	commandQueue->ExecuteCommandLists(1, &cmdList);
+void Demo::renderLoop()
+{
+	if (Tracer::isEnabled())
+	{
+		Tracer::setThreadName("render");
+	}
 
-	if (FAILED(swapChain->Present(1, 0)))
+	uint32_t captureCount{ 0 };
+	try
 	{
-		throw(runtime_error{ "Failed present." });
+		while (true)
+		{
+			// stopping is read after next(), which forgets earlier wake ups, so the one from stop() is never lost
+			LoopDecision decision{ loopScheduler.next(Tracer::now()) };
+			if (stopping.load(memory_order_acquire))
+			{
+				break;
+			}
+			if (decision.action == LoopAction::Wait)
+			{
+				loopScheduler.wait(decision);
+				continue;
+			}
+			if (decision.action == LoopAction::TestOcclusion)
+			{
+				loopScheduler.onOcclusionTested(Tracer::now(), recorder->testOcclusion());
+				continue;
+			}
+
+			snapshots.update();
+			const FrameSnapshot& snapshot{ snapshots.getReadBuffer() };
+			if (snapshot.captureCount != captureCount)
+			{
+				captureCount = snapshot.captureCount;
+				recorder->captureNextFrame("capture.cmds");
+			}
+			renderer.setTessFactor(snapshot.tessFactor);
+			renderer.setPipeline(snapshot.pipeline);
+			renderer.render(*recorder, snapshot.input);
+			loopScheduler.onFrameRendered(Tracer::now(), recorder->isOccluded());
+		}
 	}
+	catch (runtime_error& err)
+	{
+		renderError = err.what();
+		PostThreadMessage(pumpThreadId, WM_QUIT, 0, 0);
+	}
+}
+
+void Demo::setFlightRecorder(FlightRecorder* flightRecorder)
+{
+	recorder->setFlightRecorder(flightRecorder);
+}
+
+void Demo::setPacingMode(PacingMode mode)
+{
+	framePacer.setMode(mode);
+	framePacer.setMaxQueuedFrames(teapot_tutorial::getDefaultMaxQueuedFrames(mode, bufferCount));
+}
+
+void Demo::setRenderOnDemand(bool renderOnDemand)
+{
+	loopScheduler.setRenderOnDemand(renderOnDemand);
+}
+
+void Demo::setIdleTick(uint64_t idleTickNs)
+{
+	loopScheduler.setIdleTick(idleTickNs);
+}
 
-	UINT64& fenceValue{ fenceValues[frameIndex] };
-	++fenceValue;
-	ComPtr<ID3D12Fence> fence{ fences[frameIndex] };
-	if (FAILED(commandQueue->Signal(fence.Get(), fenceValue)))
+void Demo::setDynamicResolution(uint64_t budgetNs)
+{
+	if (budgetNs == 0)
 	{
-		throw(runtime_error{ "Failed signal." });
+		renderer.setDynamicResolution(nullptr);
+		return;
 	}
+	DynamicResolutionSettings settings;
+	settings.budgetNs = budgetNs;
+	dynamicResolution.setSettings(settings);
+	renderer.setDynamicResolution(&dynamicResolution);
+}
+
+void Demo::setTriangleBudget(uint64_t triangleBudget)
+{
+	renderer.setTriangleBudget(triangleBudget);
+}
+
+void Demo::createModelViews(size_t pointCount, size_t indexCount, size_t transformCount, size_t colorCount)
+{
+	using PointType = decltype(PatchModel::points)::value_type;
+	using TransformType = decltype(PatchModel::patchesTransforms)::value_type;
+	using ColorType = decltype(PatchModel::patchesColors)::value_type;
+
+	controlPointsBufferView.BufferLocation = controlPointsBuffer->GetGPUVirtualAddress();
+	controlPointsBufferView.StrideInBytes = static_cast<UINT>(sizeof(PointType));
+	controlPointsBufferView.SizeInBytes = static_cast<UINT>(controlPointsBufferView.StrideInBytes * pointCount);
+
+	controlPointsIndexBufferView.BufferLocation = controlPointsIndexBuffer->GetGPUVirtualAddress();
+	controlPointsIndexBufferView.Format = DXGI_FORMAT_R32_UINT;
+	controlPointsIndexBufferView.SizeInBytes = static_cast<UINT>(indexCount * sizeof(uint32_t));
 
-	waitFrameComplete(swapChain->GetCurrentBackBufferIndex());
+	teapot_tutorial::createSrv<TransformType>(device.Get(), transformsAndColorsDescHeap.Get(), 0, transformsBuffer.Get(), transformCount);
+	teapot_tutorial::createSrv<ColorType>(device.Get(), transformsAndColorsDescHeap.Get(), 1, colorsBuffer.Get(), colorCount);
 }
 
 void Demo::createTransformsAndColorsDescHeap()
 {
 	D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
 	ZeroMemory(&heapDesc, sizeof(heapDesc));
-	heapDesc.NumDescriptors = 2;
+	heapDesc.NumDescriptors = 4;
 	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	heapDesc.NodeMask = 0;
@@ -251,6 +297,81 @@ void Demo::createConstantBuffer()
 	constBuffer->SetName(L"constants");
 }
 
+void Demo::createSceneTarget()
+{
+	POINT wSize(window->getSize());
+
+	D3D12_CLEAR_VALUE clearValue;
+	ZeroMemory(&clearValue, sizeof(clearValue));
+	clearValue.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	clearValue.Color[0] = 0.1f;
+	clearValue.Color[1] = 0.1f;
+	clearValue.Color[2] = 0.1f;
+	clearValue.Color[3] = 1.0f;
+
+	D3D12_HEAP_PROPERTIES heapProps;
+	ZeroMemory(&heapProps, sizeof(heapProps));
+	heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
+	heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapProps.CreationNodeMask = 1;
+	heapProps.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC resourceDesc;
+	ZeroMemory(&resourceDesc, sizeof(resourceDesc));
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	resourceDesc.Alignment = 0;
+	resourceDesc.Width = wSize.x;
+	resourceDesc.Height = wSize.y;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.SampleDesc.Quality = 0;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+	HRESULT hr{ device->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&resourceDesc,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		&clearValue,
+		IID_PPV_ARGS(sceneTarget.ReleaseAndGetAddressOf())
+	) };
+
+	if (FAILED(hr))
+	{
+		throw(runtime_error{ "Error creating scene render target." });
+	}
+
+	sceneTarget->SetName(L"scene");
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
+	ZeroMemory(&heapDesc, sizeof(heapDesc));
+	heapDesc.NumDescriptors = 1;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+
+	if (FAILED(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(sceneRtvHeap.ReleaseAndGetAddressOf()))))
+	{
+		throw(runtime_error{ "Error creating scene descriptor heap." });
+	}
+
+	device->CreateRenderTargetView(sceneTarget.Get(), nullptr, sceneRtvHeap->GetCPUDescriptorHandleForHeapStart());
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	ZeroMemory(&srvDesc, sizeof(srvDesc));
+	srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Texture2D.MipLevels = 1;
+
+	D3D12_CPU_DESCRIPTOR_HANDLE d{ transformsAndColorsDescHeap->GetCPUDescriptorHandleForHeapStart() };
+	d.ptr += 2 * device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	device->CreateShaderResourceView(sceneTarget.Get(), &srvDesc, d);
+}
+
 void Demo::createShaders()
 {
 	if (FAILED(D3DReadFileToBlob(L"VertexShader.cso", vertexShaderBlob.ReleaseAndGetAddressOf())))
@@ -272,29 +393,51 @@ void Demo::createShaders()
 	{
 		throw(runtime_error{ "Error reading pixel shader." });
 	}
+
+	if (FAILED(D3DReadFileToBlob(L"MeshVertexShader.cso", meshVertexShaderBlob.ReleaseAndGetAddressOf())))
+	{
+		throw(runtime_error{ "Error reading mesh vertex shader." });
+	}
+
+	if (FAILED(D3DReadFileToBlob(L"UpscaleVertexShader.cso", upscaleVertexShaderBlob.ReleaseAndGetAddressOf())))
+	{
+		throw(runtime_error{ "Error reading upscale vertex shader." });
+	}
+
+	if (FAILED(D3DReadFileToBlob(L"UpscalePixelShader.cso", upscalePixelShaderBlob.ReleaseAndGetAddressOf())))
+	{
+		throw(runtime_error{ "Error reading upscale pixel shader." });
+	}
 }
 
 void Demo::createRootSignature()
 {
-	D3D12_DESCRIPTOR_RANGE dsTransformAndColorSrvRange;
-	ZeroMemory(&dsTransformAndColorSrvRange, sizeof(dsTransformAndColorSrvRange));
-	dsTransformAndColorSrvRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-	dsTransformAndColorSrvRange.NumDescriptors = 2;
-	dsTransformAndColorSrvRange.BaseShaderRegister = 0;
-	dsTransformAndColorSrvRange.RegisterSpace = 0;
-	dsTransformAndColorSrvRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	// transforms and colors at t0 and t1, then the Bernstein weights at t2 past the scene target's SRV
+	D3D12_DESCRIPTOR_RANGE dsTransformAndColorSrvRanges[2];
+	ZeroMemory(dsTransformAndColorSrvRanges, sizeof(dsTransformAndColorSrvRanges));
+	dsTransformAndColorSrvRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	dsTransformAndColorSrvRanges[0].NumDescriptors = 2;
+	dsTransformAndColorSrvRanges[0].BaseShaderRegister = 0;
+	dsTransformAndColorSrvRanges[0].RegisterSpace = 0;
+	dsTransformAndColorSrvRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	dsTransformAndColorSrvRanges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	dsTransformAndColorSrvRanges[1].NumDescriptors = 1;
+	dsTransformAndColorSrvRanges[1].BaseShaderRegister = 2;
+	dsTransformAndColorSrvRanges[1].RegisterSpace = 0;
+	dsTransformAndColorSrvRanges[1].OffsetInDescriptorsFromTableStart = 3;
 
 	D3D12_ROOT_PARAMETER dsTransformAndColorSrv;
 	ZeroMemory(&dsTransformAndColorSrv, sizeof(dsTransformAndColorSrv));
 	dsTransformAndColorSrv.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-	dsTransformAndColorSrv.DescriptorTable = { 1, &dsTransformAndColorSrvRange };
+	dsTransformAndColorSrv.DescriptorTable = { 2, dsTransformAndColorSrvRanges };
 	dsTransformAndColorSrv.ShaderVisibility = D3D12_SHADER_VISIBILITY_DOMAIN;
 
 	D3D12_ROOT_PARAMETER dsObjCb;
 	ZeroMemory(&dsObjCb, sizeof(dsObjCb));
 	dsObjCb.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
 	dsObjCb.Descriptor = { 0, 0 };
-	dsObjCb.ShaderVisibility = D3D12_SHADER_VISIBILITY_DOMAIN;
+	// the mesh pipelines transform in the vertex shader
+	dsObjCb.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
 
 	D3D12_ROOT_PARAMETER hsTessFactorsCb;
 	ZeroMemory(&hsTessFactorsCb, sizeof(hsTessFactorsCb));
@@ -306,7 +449,6 @@ void Demo::createRootSignature()
 	
 	D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags{
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
-		D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS |
 		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
 		D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS
 	};
@@ -332,10 +474,70 @@ void Demo::createRootSignature()
 	}
 }
 
+void Demo::createUpscaleRootSignature()
+{
+	D3D12_DESCRIPTOR_RANGE sceneSrvRange;
+	ZeroMemory(&sceneSrvRange, sizeof(sceneSrvRange));
+	sceneSrvRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	sceneSrvRange.NumDescriptors = 1;
+	sceneSrvRange.BaseShaderRegister = 0;
+	sceneSrvRange.RegisterSpace = 0;
+	sceneSrvRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+	// the source region in texture coordinates: left, top, right, bottom
+	D3D12_ROOT_PARAMETER sourceRectConstants;
+	ZeroMemory(&sourceRectConstants, sizeof(sourceRectConstants));
+	sourceRectConstants.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	sourceRectConstants.Constants = { 0, 0, 4 };
+	sourceRectConstants.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	D3D12_ROOT_PARAMETER sceneSrv;
+	ZeroMemory(&sceneSrv, sizeof(sceneSrv));
+	sceneSrv.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	sceneSrv.DescriptorTable = { 1, &sceneSrvRange };
+	sceneSrv.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	vector<D3D12_ROOT_PARAMETER> rootParameters{ sourceRectConstants, sceneSrv };
+
+	D3D12_STATIC_SAMPLER_DESC linearClamp;
+	ZeroMemory(&linearClamp, sizeof(linearClamp));
+	linearClamp.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+	linearClamp.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+	linearClamp.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+	linearClamp.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+	linearClamp.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+	linearClamp.MaxLOD = D3D12_FLOAT32_MAX;
+	linearClamp.ShaderRegister = 0;
+	linearClamp.RegisterSpace = 0;
+	linearClamp.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	ZeroMemory(&rootSignatureDesc, sizeof(rootSignatureDesc));
+	rootSignatureDesc.NumParameters = static_cast<UINT>(rootParameters.size());
+	rootSignatureDesc.pParameters = rootParameters.data();
+	rootSignatureDesc.NumStaticSamplers = 1;
+	rootSignatureDesc.pStaticSamplers = &linearClamp;
+	rootSignatureDesc.Flags =
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+	if (FAILED(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, signature.ReleaseAndGetAddressOf(), error.ReleaseAndGetAddressOf())))
+	{
+		throw(runtime_error{ "Error serializing upscale root signature" });
+	}
+
+	if (FAILED(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(upscaleRootSignature.ReleaseAndGetAddressOf()))))
+	{
+		throw(runtime_error{ "Error creating upscale root signature" });
+	}
+}
+
 void Demo::createPipelineStateWireframe()
 {
 	pipelineStateWireframe = createPipelineState(D3D12_FILL_MODE_WIREFRAME, D3D12_CULL_MODE_NONE);
-	currPipelineState = pipelineStateWireframe;
 }
 
 void Demo::createPipelineStateSolid()
@@ -343,17 +545,75 @@ void Demo::createPipelineStateSolid()
 	pipelineStateSolid = createPipelineState(D3D12_FILL_MODE_SOLID, D3D12_CULL_MODE_NONE);
 }
 
+void Demo::createPipelineStateMesh()
+{
+	pipelineStateWireframeMesh = createPipelineState(D3D12_FILL_MODE_WIREFRAME, D3D12_CULL_MODE_NONE, false);
+	pipelineStateSolidMesh = createPipelineState(D3D12_FILL_MODE_SOLID, D3D12_CULL_MODE_NONE, false);
+}
+
+void Demo::createPipelineStateUpscale()
+{
+	D3D12_RASTERIZER_DESC rasterizerDesc;
+	ZeroMemory(&rasterizerDesc, sizeof(rasterizerDesc));
+	rasterizerDesc.FillMode = D3D12_FILL_MODE_SOLID;
+	rasterizerDesc.CullMode = D3D12_CULL_MODE_NONE;
+	rasterizerDesc.DepthClipEnable = TRUE;
+
+	D3D12_BLEND_DESC blendDesc;
+	ZeroMemory(&blendDesc, sizeof(blendDesc));
+	blendDesc.RenderTarget[0] = {
+		FALSE,FALSE,
+		D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
+		D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
+		D3D12_LOGIC_OP_NOOP,
+		D3D12_COLOR_WRITE_ENABLE_ALL
+	};
+
+	// the back buffer is bound with the depth buffer, which the upscale neither tests nor writes
+	D3D12_DEPTH_STENCIL_DESC depthStencilDesc;
+	ZeroMemory(&depthStencilDesc, sizeof(depthStencilDesc));
+	depthStencilDesc.DepthEnable = FALSE;
+	depthStencilDesc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	depthStencilDesc.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+	depthStencilDesc.StencilEnable = FALSE;
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineStateDesc;
+	ZeroMemory(&pipelineStateDesc, sizeof(pipelineStateDesc));
+	pipelineStateDesc.InputLayout = { nullptr, 0 };
+	pipelineStateDesc.pRootSignature = upscaleRootSignature.Get();
+	pipelineStateDesc.VS = { upscaleVertexShaderBlob->GetBufferPointer(), upscaleVertexShaderBlob->GetBufferSize() };
+	pipelineStateDesc.PS = { upscalePixelShaderBlob->GetBufferPointer(), upscalePixelShaderBlob->GetBufferSize() };
+	pipelineStateDesc.RasterizerState = rasterizerDesc;
+	pipelineStateDesc.BlendState = blendDesc;
+	pipelineStateDesc.DepthStencilState = depthStencilDesc;
+	pipelineStateDesc.SampleMask = UINT_MAX;
+	pipelineStateDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	pipelineStateDesc.NumRenderTargets = 1;
+	pipelineStateDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	pipelineStateDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+	pipelineStateDesc.SampleDesc.Count = 1;
+
+	if (FAILED(device->CreateGraphicsPipelineState(&pipelineStateDesc, IID_PPV_ARGS(pipelineStateUpscale.ReleaseAndGetAddressOf()))))
+	{
+		throw(runtime_error{ "Error creating upscale pipeline state." });
+	}
+}
+
 
 
 
 
 
-ComPtr<ID3D12PipelineState> Demo::createPipelineState(D3D12_FILL_MODE fillMode, D3D12_CULL_MODE cullMode)
+ComPtr<ID3D12PipelineState> Demo::createPipelineState(D3D12_FILL_MODE fillMode, D3D12_CULL_MODE cullMode, bool tessellated)
 {
 	vector<D3D12_INPUT_ELEMENT_DESC> inputElementDescs
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
 	};
+	if (!tessellated)
+	{
+		inputElementDescs.push_back({ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(LodVertex, color), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+	}
 
 	D3D12_RASTERIZER_DESC rasterizerDesc;
 	ZeroMemory(&rasterizerDesc, sizeof(rasterizerDesc));
@@ -397,15 +657,22 @@ ComPtr<ID3D12PipelineState> Demo::createPipelineState(D3D12_FILL_MODE fillMode,
 	ZeroMemory(&pipelineStateDesc, sizeof(pipelineStateDesc));
 	pipelineStateDesc.InputLayout = { inputElementDescs.data(), static_cast<UINT>(inputElementDescs.size()) };
 	pipelineStateDesc.pRootSignature = rootSignature.Get();
-	pipelineStateDesc.VS = { vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize() };
-	pipelineStateDesc.HS = { hullShaderBlob->GetBufferPointer(), hullShaderBlob->GetBufferSize() };
-	pipelineStateDesc.DS = { domainShaderBlob->GetBufferPointer(), domainShaderBlob->GetBufferSize() };
+	if (tessellated)
+	{
+		pipelineStateDesc.VS = { vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize() };
+		pipelineStateDesc.HS = { hullShaderBlob->GetBufferPointer(), hullShaderBlob->GetBufferSize() };
+		pipelineStateDesc.DS = { domainShaderBlob->GetBufferPointer(), domainShaderBlob->GetBufferSize() };
+	}
+	else
+	{
+		pipelineStateDesc.VS = { meshVertexShaderBlob->GetBufferPointer(), meshVertexShaderBlob->GetBufferSize() };
+	}
 	pipelineStateDesc.PS = { pixelShaderBlob->GetBufferPointer(), pixelShaderBlob->GetBufferSize() };
 	pipelineStateDesc.RasterizerState = rasterizerDesc;
 	pipelineStateDesc.BlendState = blendDesc;
 	pipelineStateDesc.DepthStencilState = depthStencilDesc;
 	pipelineStateDesc.SampleMask = UINT_MAX;
-	pipelineStateDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH;
+	pipelineStateDesc.PrimitiveTopologyType = tessellated ? D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH : D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
 	pipelineStateDesc.NumRenderTargets = 1;
 	pipelineStateDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 	pipelineStateDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
@@ -418,38 +685,4 @@ ComPtr<ID3D12PipelineState> Demo::createPipelineState(D3D12_FILL_MODE fillMode,
 	}
 
 	return pipelineState;
-}
-
-
-
-
-
-void Demo::createViewport()
-{
-	RECT rect;
-	if (!GetClientRect(window->getHandle(), &rect))
-	{
-		throw(runtime_error{ "Error getting window size." });
-	}
-
-	viewport.TopLeftX = 0.0f;
-	viewport.TopLeftY = 0.0f;
-	viewport.Width = static_cast<FLOAT>(rect.right - rect.left);
-	viewport.Height = static_cast<FLOAT>(rect.bottom - rect.top);
-	viewport.MinDepth = 0.0f;
-	viewport.MaxDepth = 1.0f;
-}
-
-void Demo::createScissorRect()
-{
-	RECT rect;
-	if (!GetClientRect(window->getHandle(), &rect))
-	{
-		throw(runtime_error{ "Error getting window size." });
-	}
-
-	scissorRect.left = 0;
-	scissorRect.top = 0;
-	scissorRect.right = rect.right - rect.left;
-	scissorRect.bottom = rect.bottom - rect.top;
 }
\ No newline at end of file
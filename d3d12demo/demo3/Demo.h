@@ -1,25 +1,74 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <atomic>
+#include <thread>
 #include "Graphics.h"
+#include "InputEvent.h"
+#include "InputSystem.h"
+#include "PatchModel.h"
+#include "TeapotRenderer.h"
+#include "TeapotSimulation.h"
+#include "TripleBuffer.h"
+#include "DynamicResolution.h"
+#include "LodChain.h"
+#include "FramePacer.h"
+#include "LoopScheduler.h"
+#include "D3D12Backend.h"
+#include "RecordingDevice.h"
+
+class AssetStreamReader;
 
 class Demo : public Graphics
 {
+	friend class D3D12Backend;
+
 public:
-	Demo(UINT bufferCount, std::string name, LONG width, LONG height);
+	// lodEnabled draws pre-tessellated LodChain levels where detailed enough instead of tessellating
+	Demo(UINT bufferCount, std::string name, LONG width, LONG height, const PatchModel& model, bool lodEnabled);
+	// decompresses the model's sections straight into the upload heaps, without LOD levels
+	Demo(UINT bufferCount, std::string name, LONG width, LONG height, AssetStreamReader& stream);
+	~Demo();
+
+	// Starts the render thread, which renders the newest snapshot until stop(). From then on the flight recorder
+	// belongs to the render thread.
+	void start();
+	// on the message pump thread: applies the input WndProc queued and publishes a snapshot if it changed anything
+	void update();
+	// joins the render thread and rethrows the error that ended it, if any
+	void stop();
 
-	void render();
+	void setFlightRecorder(FlightRecorder* flightRecorder);
+	// before start(); throughput pacing by default
+	void setPacingMode(PacingMode mode);
+	// by default frames are only drawn when input changed the snapshot, plus one a second
+	void setRenderOnDemand(bool renderOnDemand);
+	// 0 draws nothing while idle
+	void setIdleTick(uint64_t idleTickNs);
+	// before start(); renders at the resolution that keeps GPU frames within budgetNs and upscales, 0 turns it off
+	void setDynamicResolution(uint64_t budgetNs);
+	// before start(); lowers the tessellation factor so a frame stays within triangleBudget triangles, 0 for no limit
+	void setTriangleBudget(uint64_t triangleBudget);
 
 private:
+	// everything but the model buffers, for a model of indexCount patch indices
+	Demo(UINT bufferCount, std::string name, LONG width, LONG height, uint32_t indexCount);
+
+	// views and SRVs of the model buffers
+	void createModelViews(size_t pointCount, size_t indexCount, size_t transformCount, size_t colorCount);
 	void createTransformsAndColorsDescHeap();
 	void createConstantBuffer();
+	void createSceneTarget();
 	void createShaders();
 	void createRootSignature();
+	void createUpscaleRootSignature();
 	void createPipelineStateWireframe();
 	void createPipelineStateSolid();
-	Microsoft::WRL::ComPtr<ID3D12PipelineState> createPipelineState(D3D12_FILL_MODE fillMode, D3D12_CULL_MODE cullMode);
-	void createViewport();
-	void createScissorRect();
+	void createPipelineStateMesh();
+	void createPipelineStateUpscale();
+	// tessellated from patch lists, or from the LOD buffers' triangle lists
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> createPipelineState(D3D12_FILL_MODE fillMode, D3D12_CULL_MODE cullMode, bool tessellated = true);
+	void renderLoop();
 
 private:
 	const int numParts{ 28 };
@@ -28,20 +77,53 @@ private:
 	D3D12_VERTEX_BUFFER_VIEW controlPointsBufferView;
 	Microsoft::WRL::ComPtr<ID3D12Resource> controlPointsIndexBuffer;
 	D3D12_INDEX_BUFFER_VIEW controlPointsIndexBufferView;
+	// only built with LOD enabled, and the LOD buffers with it
+	std::unique_ptr<LodChain> lodChain;
+	Microsoft::WRL::ComPtr<ID3D12Resource> lodVertexBuffer;
+	D3D12_VERTEX_BUFFER_VIEW lodVertexBufferView;
+	Microsoft::WRL::ComPtr<ID3D12Resource> lodIndexBuffer;
+	D3D12_INDEX_BUFFER_VIEW lodIndexBufferView;
 	Microsoft::WRL::ComPtr<ID3D12Resource> transformsBuffer;
 	Microsoft::WRL::ComPtr<ID3D12Resource> colorsBuffer;
+	// BernsteinTableCache::getPackedWeights for DomainShader.hlsl, the fourth descriptor of transformsAndColorsDescHeap
+	Microsoft::WRL::ComPtr<ID3D12Resource> bernsteinWeightsBuffer;
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> transformsAndColorsDescHeap;
 	Microsoft::WRL::ComPtr<ID3D12Resource> constBuffer;
+	// dynamic resolution renders here, its SRV is the third descriptor of transformsAndColorsDescHeap
+	Microsoft::WRL::ComPtr<ID3D12Resource> sceneTarget;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> sceneRtvHeap;
 	Microsoft::WRL::ComPtr<ID3DBlob> vertexShaderBlob;
 	Microsoft::WRL::ComPtr<ID3DBlob> hullShaderBlob;
 	Microsoft::WRL::ComPtr<ID3DBlob> domainShaderBlob;
 	Microsoft::WRL::ComPtr<ID3DBlob> pixelShaderBlob;
+	Microsoft::WRL::ComPtr<ID3DBlob> meshVertexShaderBlob;
+	Microsoft::WRL::ComPtr<ID3DBlob> upscaleVertexShaderBlob;
+	Microsoft::WRL::ComPtr<ID3DBlob> upscalePixelShaderBlob;
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature;
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> upscaleRootSignature;
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineStateWireframe;
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineStateSolid;
-	Microsoft::WRL::ComPtr<ID3D12PipelineState> currPipelineState;
-	D3D12_VIEWPORT viewport;
-	D3D12_RECT scissorRect;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineStateWireframeMesh;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineStateSolidMesh;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineStateUpscale;
+
+	FramePacer framePacer;
+	DynamicResolution dynamicResolution;
+	TeapotRenderer renderer;
+	std::unique_ptr<D3D12Backend> backend;
+	std::unique_ptr<RecordingDevice> recorder;
 
-	int tessFactor{ 8 };
+	InputQueue inputQueue;
+	// mouse and size for the MVP, latched by the renderer just before submitting
+	InputSystem inputSystem;
+	TeapotSimulation simulation;
+	TripleBuffer<FrameSnapshot> snapshots;
+	// skips frames while minimized, occluded or idle
+	LoopScheduler loopScheduler;
+	std::thread renderThread;
+	std::atomic<bool> stopping{ false };
+	// posted WM_QUIT when rendering fails
+	DWORD pumpThreadId;
+	// written by the render thread before it exits, read after joining it
+	std::string renderError;
 };
\ No newline at end of file
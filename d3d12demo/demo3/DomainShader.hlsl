@@ -20,6 +20,10 @@ struct PatchColor
 };
 StructuredBuffer<PatchColor> patchColors : register(t1);
 
+// BernsteinTableCache::getPackedWeights: for each factor n from 1, the Bernstein basis at the n + 1 parameters i / n
+// from offset n (n + 1) - 2, followed by its derivative at the same parameters
+StructuredBuffer<float4> bernsteinWeights : register(t2);
+
 struct PatchConstantData
 {
 	float edgeTessFactor[4] : SV_TessFactor;
@@ -35,17 +39,10 @@ struct DomainToPixel
 {
 	float4 pos : SV_POSITION;
 	float3 color : COLOR;
+	// patch transform applied, for lighting; PixelShader.hlsl doesn't read it yet
+	float3 normal : NORMAL;
 };
 
-float4 bernsteinBasis(float t)
-{
-	float invT = 1.0f - t;
-	return float4(invT * invT * invT,	// (1-t)3
-		3.0f * t * invT * invT,			// 3t(1-t)2
-		3.0f * t * t * invT,			// 3t2(1-t)
-		t * t * t);						// t3
-}
-
 float3 evaluateBezier(const OutputPatch<HullToDomain, NUM_CONTROL_POINTS> bezpatch, float4 basisU, float4 basisV)
 {
 	float3 value = float3(0, 0, 0);
@@ -57,12 +54,31 @@ float3 evaluateBezier(const OutputPatch<HullToDomain, NUM_CONTROL_POINTS> bezpat
 	return value;
 }
 
+// Where a border collapses to a point, like the lid's pole, the derivative along it vanishes; near the border it
+// is the mixed derivative times the parameter distance to it, so that takes its place.
+float3 getNormal(float3 dPdu, float3 dPdv, float3 d2Pdudv, float2 domain)
+{
+	const float collapsedTangentRatio = 1e-8f;
+	float duSquared = dot(dPdu, dPdu);
+	float dvSquared = dot(dPdv, dPdv);
+	float3 a = duSquared < collapsedTangentRatio * dvSquared ? d2Pdudv * (domain.y < 0.5f ? 1.0f : -1.0f) : dPdu;
+	float3 b = dvSquared < collapsedTangentRatio * duSquared ? d2Pdudv * (domain.x < 0.5f ? 1.0f : -1.0f) : dPdv;
+	float3 n = cross(a, b);
+	float lengthSquared = dot(n, n);
+	return lengthSquared > 0.0f ? n * rsqrt(lengthSquared) : n;
+}
+
 [domain("quad")]
 DomainToPixel main(PatchConstantData input, float2 domain : SV_DomainLocation, const OutputPatch<HullToDomain, NUM_CONTROL_POINTS> patch, uint patchID : SV_PrimitiveID)
 {
-	// Evaluate the basis functions at (u, v)
-	float4 basisU = bernsteinBasis(domain.x);
-	float4 basisV = bernsteinBasis(domain.y);
+	// Integer partitioning with HullShader.hlsl's single factor puts u and v on multiples of 1 / n, so the basis
+	// functions at (u, v) are table rows
+	uint n = (uint)clamp(input.insideTessFactor[0], 1.0f, 64.0f);
+	uint offset = n * (n + 1) - 2;
+	uint i = (uint)round(domain.x * n);
+	uint j = (uint)round(domain.y * n);
+	float4 basisU = bernsteinWeights[offset + i];
+	float4 basisV = bernsteinWeights[offset + j];
 
 	// Evaluate the surface position for this vertex
 	float3 localPos = evaluateBezier(patch, basisU, basisV);
@@ -70,9 +86,17 @@ DomainToPixel main(PatchConstantData input, float2 domain : SV_DomainLocation, c
 	float4x4 transform = patchTransforms[patchID].transform;
 	float4 localPosTransformed = mul(float4(localPos, 1.0f), transform);
 
+	// Partial derivatives from the same control points, transformed like directions
+	float4 derivativeU = bernsteinWeights[offset + n + 1 + i];
+	float4 derivativeV = bernsteinWeights[offset + n + 1 + j];
+	float3 dPdu = mul(float4(evaluateBezier(patch, derivativeU, basisV), 0.0f), transform).xyz;
+	float3 dPdv = mul(float4(evaluateBezier(patch, basisU, derivativeV), 0.0f), transform).xyz;
+	float3 d2Pdudv = mul(float4(evaluateBezier(patch, derivativeU, derivativeV), 0.0f), transform).xyz;
+
 	DomainToPixel output;
 	output.pos = mul(localPosTransformed, constPerObject.wvpMat);
 	output.color = patchColors[patchID].color;
+	output.normal = getNormal(dPdu, dPdv, d2Pdudv, domain);
 
 	return output;
 }
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+DynamicResolution::DynamicResolution(const DynamicResolutionSettings& settings)
+{
+	setSettings(settings);
+}
+
+void DynamicResolution::setSettings(const DynamicResolutionSettings& settings)
+{
+	if (settings.budgetNs == 0 || settings.minScale <= 0.0f || settings.minScale > settings.maxScale ||
+		settings.smoothing <= 0.0f || settings.smoothing > 1.0f)
+	{
+		throw(runtime_error{ "Invalid dynamic resolution settings." });
+	}
+	this->settings = settings;
+	reset();
+}
+
+const DynamicResolutionSettings& DynamicResolution::getSettings() const
+{
+	return settings;
+}
+
+float DynamicResolution::update(uint64_t gpuNs)
+{
+	if (settling > 0)
+	{
+		--settling;
+		return scale;
+	}
+
+	filteredNs = filteredNs < 0.0f ? static_cast<float>(gpuNs) : filteredNs + settings.smoothing * (gpuNs - filteredNs);
+	float error{ 1.0f - filteredNs / static_cast<float>(settings.budgetNs) };
+	if (fabs(error) < settings.deadBand)
+	{
+		error = 0.0f;
+	}
+
+	float minArea{ settings.minScale * settings.minScale };
+	float maxArea{ settings.maxScale * settings.maxScale };
+	// clamping the integral is the anti wind up, it never runs past what the limits can deliver
+	integral = min(max(integral + settings.integralGain * error, minArea), maxArea);
+	area = integral + settings.proportionalGain * error + settings.derivativeGain * (error - previousError);
+	area = min(max(area, minArea), maxArea);
+	previousError = error;
+
+	float target{ sqrt(area) };
+	bool atLimit{ target <= settings.minScale || target >= settings.maxScale };
+	if (fabs(target - scale) >= settings.minStep || (atLimit && target != scale))
+	{
+		scale = target;
+		settling = settings.settleFrames;
+		++changes;
+	}
+	return scale;
+}
+
+float DynamicResolution::getScale() const
+{
+	return scale;
+}
+
+float DynamicResolution::getControllerScale() const
+{
+	return sqrt(area);
+}
+
+void DynamicResolution::getRenderSize(int32_t width, int32_t height, int32_t& renderWidth, int32_t& renderHeight) const
+{
+	renderWidth = max(static_cast<int32_t>(lround(width * scale)), 1);
+	renderHeight = max(static_cast<int32_t>(lround(height * scale)), 1);
+}
+
+uint32_t DynamicResolution::getChangeCount() const
+{
+	return changes;
+}
+
+void DynamicResolution::reset()
+{
+	scale = settings.maxScale;
+	area = scale * scale;
+	integral = area;
+	filteredNs = -1.0f;
+	previousError = 0.0f;
+	settling = 0;
+	changes = 0;
+}
+
+namespace teapot_tutorial
+{
+	DynamicResolutionResult simulateDynamicResolution(const DynamicResolutionSimulation& simulation)
+	{
+		DynamicResolution controller{ simulation.settings };
+		const vector<uint64_t>& trace{ simulation.fullResolutionNs };
+		uint64_t overBudgetNs{ static_cast<uint64_t>(simulation.settings.budgetNs * (1.0 + simulation.settings.deadBand)) };
+
+		DynamicResolutionResult result;
+		result.name = simulation.name;
+		result.frames = static_cast<uint32_t>(trace.size());
+		result.overBudgetFrames = 0;
+		result.minScale = controller.getScale();
+		result.maxScale = controller.getScale();
+		vector<uint64_t> gpuNs(trace.size(), 0);
+		double scaleSum{ 0.0 };
+		for (size_t frame = 0; frame < trace.size(); ++frame)
+		{
+			if (frame >= simulation.latencyFrames)
+			{
+				controller.update(gpuNs[frame - simulation.latencyFrames]);
+			}
+
+			float scale{ controller.getScale() };
+			double share{ simulation.pixelShare };
+			gpuNs[frame] = static_cast<uint64_t>(trace[frame] * (1.0 - share + share * scale * scale));
+			result.overBudgetFrames += gpuNs[frame] > overBudgetNs ? 1 : 0;
+			result.minScale = min(result.minScale, scale);
+			result.maxScale = max(result.maxScale, scale);
+			scaleSum += scale;
+		}
+
+		result.finalScale = controller.getScale();
+		result.changes = controller.getChangeCount();
+		result.meanScale = trace.empty() ? 0.0 : scaleSum / trace.size();
+		result.gpuP50Ns = 0;
+		result.gpuP99Ns = 0;
+		if (!gpuNs.empty())
+		{
+			sort(gpuNs.begin(), gpuNs.end());
+			result.gpuP50Ns = gpuNs[gpuNs.size() / 2];
+			result.gpuP99Ns = gpuNs[gpuNs.size() * 99 / 100];
+		}
+		return result;
+	}
+
+	vector<uint64_t> readFrameTimeTrace(const string& path)
+	{
+		ifstream file{ path };
+		if (!file)
+		{
+			throw(runtime_error{ "Error opening frame time trace: " + path });
+		}
+
+		vector<uint64_t> trace;
+		string line;
+		while (getline(file, line))
+		{
+			if (line.empty() || line[0] == '#' || line[0] == '\r')
+			{
+				continue;
+			}
+			char* end{ nullptr };
+			unsigned long long ns{ strtoull(line.c_str(), &end, 10) };
+			if (end == line.c_str() || (*end != '\0' && *end != '\r'))
+			{
+				throw(runtime_error{ "Invalid frame time in trace: " + line });
+			}
+			trace.push_back(ns);
+		}
+		return trace;
+	}
+
+	string formatDynamicResolutionResults(const vector<DynamicResolutionResult>& results)
+	{
+		string text;
+		for (const DynamicResolutionResult& result : results)
+		{
+			char line[256];
+			snprintf(line, sizeof(line), "dynres %-12s %u frames: over budget %u, gpu p50/p99 %.2f/%.2f ms, scale mean %.2f min %.2f max %.2f final %.2f, %u changes\n",
+				result.name.c_str(), result.frames, result.overBudgetFrames, result.gpuP50Ns / 1e6, result.gpuP99Ns / 1e6,
+				result.meanScale, result.minScale, result.maxScale, result.finalScale, result.changes);
+			text += line;
+		}
+		return text;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct DynamicResolutionSettings
+{
+	// GPU time per frame to aim for
+	uint64_t budgetNs{ 16666667 };
+	// render size over output size, per axis
+	float minScale{ 0.5f };
+	float maxScale{ 1.0f };
+	float proportionalGain{ 0.2f };
+	float integralGain{ 0.1f };
+	float derivativeGain{ 0.05f };
+	// weight of a new GPU time in the moving average the controller works on
+	float smoothing{ 0.15f };
+	// frame times within this fraction of the budget count as on budget, so noise alone never moves the scale
+	float deadBand{ 0.05f };
+	// the applied scale only follows the controller once it is this far off, or at the limits
+	float minStep{ 0.04f };
+	// measurements skipped after a change, of frames that were already in flight at the old scale
+	uint32_t settleFrames{ 3 };
+};
+
+// Picks the render resolution from measured GPU frame times. A PID controller works on the rendered area, which
+// the resolution dependent part of the GPU time is proportional to, with the error as the fraction of the budget
+// left over by the smoothed GPU time. The smoothing, the dead band, the minimum step and the settle frames keep
+// the size from chasing noise or its own measurement delay.
+class DynamicResolution
+{
+public:
+	DynamicResolution(const DynamicResolutionSettings& settings = DynamicResolutionSettings{});
+
+	void setSettings(const DynamicResolutionSettings& settings);
+	const DynamicResolutionSettings& getSettings() const;
+
+	// feeds the GPU time of a completed frame, returns the scale for the next one
+	float update(uint64_t gpuNs);
+	float getScale() const;
+	// the scale the controller wants, which getScale() only follows in minStep steps
+	float getControllerScale() const;
+	// render size for an output of width x height at the current scale, at least 1 x 1
+	void getRenderSize(int32_t width, int32_t height, int32_t& renderWidth, int32_t& renderHeight) const;
+	uint32_t getChangeCount() const;
+
+	void reset();
+
+private:
+	DynamicResolutionSettings settings;
+	// controller output, the rendered fraction of the output area
+	float area;
+	float scale;
+	float integral;
+	// moving average of the GPU time, negative until the first update
+	float filteredNs;
+	float previousError{ 0.0f };
+	uint32_t settling{ 0 };
+	uint32_t changes{ 0 };
+};
+
+// Replays a trace of GPU frame times at full resolution through a DynamicResolution: the pixelShare of each
+// frame's time scales with the rendered area and the controller sees it latencyFrames frames later, the way
+// timestamp queries come back once the back buffer comes around.
+struct DynamicResolutionSimulation
+{
+	std::string name;
+	std::vector<uint64_t> fullResolutionNs;
+	DynamicResolutionSettings settings;
+	double pixelShare;
+	uint32_t latencyFrames;
+};
+
+struct DynamicResolutionResult
+{
+	std::string name;
+	uint32_t frames;
+	// frames above the budget plus its dead band
+	uint32_t overBudgetFrames;
+	uint64_t gpuP50Ns;
+	uint64_t gpuP99Ns;
+	double meanScale;
+	float minScale;
+	float maxScale;
+	float finalScale;
+	uint32_t changes;
+};
+
+namespace teapot_tutorial
+{
+	DynamicResolutionResult simulateDynamicResolution(const DynamicResolutionSimulation& simulation);
+
+	// one GPU frame time in ns per line; empty lines and lines starting with # are skipped
+	std::vector<uint64_t> readFrameTimeTrace(const std::string& path);
+
+	// one line per result
+	std::string formatDynamicResolutionResults(const std::vector<DynamicResolutionResult>& results);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "Fence.h"
+#include "FenceWaiter.h"
+
+using namespace std;
+
+uint64_t SimulatedFence::getCompletedValue()
+{
+	return completedValue.load(memory_order_acquire);
+}
+
+void SimulatedFence::notifyOnCompletion(uint64_t value, FenceWaiter& waiter)
+{
+	{
+		lock_guard<std::mutex> lock{ mutex };
+		if (completedValue.load(memory_order_relaxed) < value)
+		{
+			notifications.push_back({ value, &waiter });
+			return;
+		}
+	}
+	waiter.wake();
+}
+
+void SimulatedFence::cancelNotification(uint64_t value, FenceWaiter& waiter)
+{
+	// signal wakes under the lock, so taking it also waits out a signal that is waking waiter right now
+	lock_guard<std::mutex> lock{ mutex };
+	for (size_t i = 0; i < notifications.size();)
+	{
+		if (notifications[i].value == value && notifications[i].waiter == &waiter)
+		{
+			notifications[i] = notifications.back();
+			notifications.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void SimulatedFence::signal(uint64_t value)
+{
+	{
+		lock_guard<std::mutex> lock{ mutex };
+		completedValue.store(value, memory_order_release);
+
+		wakeList.clear();
+		for (size_t i = 0; i < notifications.size();)
+		{
+			if (notifications[i].value <= value)
+			{
+				wakeList.push_back(notifications[i].waiter);
+				notifications[i] = notifications.back();
+				notifications.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		// waiters are woken under the lock, the list is reused by the next signal
+		for (FenceWaiter* waiter : wakeList)
+		{
+			waiter->wake();
+		}
+	}
+	completed.notify_all();
+}
+
+void SimulatedFence::waitBlocking(uint64_t value)
+{
+	unique_lock<std::mutex> lock{ mutex };
+	while (completedValue.load(memory_order_relaxed) < value)
+	{
+		completed.wait(lock);
+	}
+}
\ No newline at end of file
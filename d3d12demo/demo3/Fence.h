@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class FenceWaiter;
+
+// A GPU timeline: a value that only grows as the work signaling it completes.
+class Fence
+{
+public:
+	virtual ~Fence() = default;
+
+	virtual uint64_t getCompletedValue() = 0;
+	// makes waiter wake up once the fence reaches value, or right away if it already has; waking early is allowed
+	virtual void notifyOnCompletion(uint64_t value, FenceWaiter& waiter) = 0;
+	// once it returns, the fence no longer wakes waiter for value, not even from a signal already in progress
+	virtual void cancelNotification(uint64_t value, FenceWaiter& waiter) = 0;
+};
+
+// Fence advanced by the CPU, for the null device and for simulating a GPU queue on another thread.
+class SimulatedFence : public Fence
+{
+public:
+	uint64_t getCompletedValue() override;
+	void notifyOnCompletion(uint64_t value, FenceWaiter& waiter) override;
+	void cancelNotification(uint64_t value, FenceWaiter& waiter) override;
+
+	// any thread; wakes the waiters whose value has been reached
+	void signal(uint64_t value);
+	// sleeps the calling thread until value completes, what a worker would do without a FenceWaiter
+	void waitBlocking(uint64_t value);
+
+private:
+	struct Notification
+	{
+		uint64_t value;
+		FenceWaiter* waiter;
+	};
+
+	std::atomic<uint64_t> completedValue{ 0 };
+	std::mutex mutex;
+	std::condition_variable completed;
+	std::vector<Notification> notifications;
+	std::vector<FenceWaiter*> wakeList;
+};
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "FenceWaiter.h"
+#include <stdexcept>
+#include "Trace.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+using namespace std;
+
+FenceWaiter::FenceWaiter(JobSystem& jobs) : jobs(jobs)
+{
+#if defined(_WIN32)
+	wakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (wakeEvent == nullptr)
+	{
+		throw(runtime_error{ "Error creating fence waiter event." });
+	}
+#endif
+
+	thread = std::thread{ &FenceWaiter::waiterLoop, this };
+}
+
+FenceWaiter::~FenceWaiter()
+{
+	{
+		lock_guard<std::mutex> lock{ mutex };
+		stopping = true;
+	}
+	wake();
+	thread.join();
+
+	// nothing wakes the jobs waiting on these anymore, and no fence may call into the waiter once it is gone
+	for (const PendingWait& wait : waits)
+	{
+		wait.fence->cancelNotification(wait.value, *this);
+		jobs.completePending(*wait.counter);
+	}
+	for (const PendingWait& wait : addedWaits)
+	{
+		jobs.completePending(*wait.counter);
+	}
+
+#if defined(_WIN32)
+	CloseHandle(wakeEvent);
+#endif
+}
+
+void FenceWaiter::addDependency(Fence& fence, uint64_t value, JobCounter& counter)
+{
+	jobs.addPending(counter);
+	{
+		lock_guard<std::mutex> lock{ mutex };
+		addedWaits.push_back({ &fence, value, &counter });
+	}
+	wake();
+}
+
+void FenceWaiter::wake()
+{
+#if defined(_WIN32)
+	SetEvent(wakeEvent);
+#else
+	{
+		lock_guard<std::mutex> lock{ mutex };
+		woken = true;
+	}
+	wakeCondition.notify_one();
+#endif
+}
+
+void* FenceWaiter::getNativeWakeEvent() const
+{
+#if defined(_WIN32)
+	return wakeEvent;
+#else
+	return nullptr;
+#endif
+}
+
+uint64_t FenceWaiter::getWakeCount() const
+{
+	return wakeCount.load(memory_order_relaxed);
+}
+
+void FenceWaiter::waiterLoop()
+{
+	if (Tracer::isEnabled())
+	{
+		Tracer::setThreadName("fence waiter");
+	}
+
+	for (;;)
+	{
+		{
+			lock_guard<std::mutex> lock{ mutex };
+			if (stopping)
+			{
+				break;
+			}
+			swap(newWaits, addedWaits);
+		}
+
+		// register before checking, so a fence completing in between still wakes the next sleep
+		for (const PendingWait& wait : newWaits)
+		{
+			wait.fence->notifyOnCompletion(wait.value, *this);
+			waits.push_back(wait);
+		}
+		newWaits.clear();
+
+		for (size_t i = 0; i < waits.size();)
+		{
+			if (waits[i].fence->getCompletedValue() >= waits[i].value)
+			{
+				// waits out a signal still waking the waiter for this value; the fence may go once the counter is released
+				waits[i].fence->cancelNotification(waits[i].value, *this);
+				jobs.completePending(*waits[i].counter);
+				waits[i] = waits.back();
+				waits.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		sleep();
+		wakeCount.fetch_add(1, memory_order_relaxed);
+	}
+}
+
+void FenceWaiter::sleep()
+{
+#if defined(_WIN32)
+	WaitForSingleObject(wakeEvent, INFINITE);
+#else
+	unique_lock<std::mutex> lock{ mutex };
+	while (!woken)
+	{
+		wakeCondition.wait(lock);
+	}
+	woken = false;
+#endif
+}
\ No newline at end of file
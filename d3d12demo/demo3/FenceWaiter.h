@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Fence.h"
+#include "JobSystem.h"
+
+// Turns "fence F reached value V" into job dependencies. One thread sleeps until any watched fence advances
+// and completes the counters waiting on it, so jobs started with JobSystem::runAfter on such a counter run
+// once the GPU is done without a worker ever blocking on a fence. On Windows the thread waits on an event that
+// ID3D12Fence::SetEventOnCompletion sets; elsewhere fences call wake().
+class FenceWaiter
+{
+public:
+	FenceWaiter(JobSystem& jobs);
+	~FenceWaiter();
+
+	FenceWaiter(const FenceWaiter&) = delete;
+	FenceWaiter& operator=(const FenceWaiter&) = delete;
+
+	// Counter stays above zero until fence reaches value or the waiter is destroyed, which releases the
+	// dependencies left as if their fences had completed. Counter and fence must outlive the wait.
+	void addDependency(Fence& fence, uint64_t value, JobCounter& counter);
+
+	// any thread
+	void wake();
+	// the auto reset event HANDLE fences set on Windows, null elsewhere
+	void* getNativeWakeEvent() const;
+
+	uint64_t getWakeCount() const;
+
+private:
+	struct PendingWait
+	{
+		Fence* fence;
+		uint64_t value;
+		JobCounter* counter;
+	};
+
+	void waiterLoop();
+	void sleep();
+
+private:
+	JobSystem& jobs;
+
+	std::mutex mutex;
+	std::vector<PendingWait> addedWaits;
+	bool stopping{ false };
+
+	// owned by the waiter thread
+	std::vector<PendingWait> waits;
+	std::vector<PendingWait> newWaits;
+	std::atomic<uint64_t> wakeCount{ 0 };
+
+#if defined(_WIN32)
+	void* wakeEvent;
+#else
+	std::condition_variable wakeCondition;
+	bool woken{ false };
+#endif
+
+	std::thread thread;
+};
\ No newline at end of file
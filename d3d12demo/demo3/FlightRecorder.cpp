@@ -0,0 +1,262 @@
+#include "FlightRecorder.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include "Trace.h"
+
+using namespace std;
+
+namespace
+{
+	const char flightRecorderMagic[4]{ 'F', 'L', 'T', 'R' };
+	const uint32_t flightRecorderVersion{ 1 };
+
+	static_assert(sizeof(details::FlightRecorderHeader) == 64, "FlightRecorderHeader must stay 64 bytes.");
+	static_assert(sizeof(atomic<uint64_t>) == sizeof(uint64_t), "FlightRecord::sequence is accessed as an atomic.");
+
+	// the sequence is published last with release semantics, so a reader that sees it also sees the payload
+	atomic<uint64_t>& getSequence(FlightRecord& record)
+	{
+		return *reinterpret_cast<atomic<uint64_t>*>(&record.sequence);
+	}
+
+	const atomic<uint64_t>& getSequence(const FlightRecord& record)
+	{
+		return *reinterpret_cast<const atomic<uint64_t>*>(&record.sequence);
+	}
+
+	size_t getFileSize(uint32_t capacity)
+	{
+		return sizeof(details::FlightRecorderHeader) + static_cast<size_t>(capacity) * sizeof(FlightRecord);
+	}
+
+	bool isValidHeader(const details::FlightRecorderHeader& header, size_t fileSize)
+	{
+		return memcmp(header.magic, flightRecorderMagic, sizeof(flightRecorderMagic)) == 0 && header.version == flightRecorderVersion &&
+			header.recordSize == sizeof(FlightRecord) && header.capacity > 0 && getFileSize(header.capacity) <= fileSize;
+	}
+
+	// a torn slot, or one left over from a ring of another capacity, does not belong at its position
+	bool isCompleteRecord(uint64_t sequence, uint32_t slot, uint32_t capacity)
+	{
+		return sequence != 0 && (sequence - 1) % capacity == slot;
+	}
+
+	void copyText(char* destination, size_t size, const char* text)
+	{
+		size_t length{ 0 };
+		if (text != nullptr)
+		{
+			for (; length + 1 < size && text[length] != '\0'; ++length)
+			{
+				destination[length] = text[length];
+			}
+		}
+		destination[length] = '\0';
+	}
+}
+
+FlightRecorder::FlightRecorder(string path, uint32_t capacity) : file{ path, getFileSize(capacity) }, capacity{ capacity }
+{
+	if (capacity == 0)
+	{
+		throw(runtime_error{ "Invalid flight recorder capacity." });
+	}
+
+	uint8_t* data{ file.getWritableData() };
+	auto& header = *reinterpret_cast<details::FlightRecorderHeader*>(data);
+	records = reinterpret_cast<FlightRecord*>(data + sizeof(details::FlightRecorderHeader));
+
+	if (isValidHeader(header, file.getSize()) && header.capacity == capacity)
+	{
+		for (uint32_t i = 0; i < capacity; ++i)
+		{
+			uint64_t sequence{ getSequence(records[i]).load(memory_order_relaxed) };
+			if (isCompleteRecord(sequence, i, capacity) && sequence >= nextSequence)
+			{
+				nextSequence = sequence + 1;
+			}
+		}
+	}
+	else
+	{
+		memset(data, 0, file.getSize());
+		memcpy(header.magic, flightRecorderMagic, sizeof(flightRecorderMagic));
+		header.version = flightRecorderVersion;
+		header.recordSize = sizeof(FlightRecord);
+		header.capacity = capacity;
+	}
+
+	uint64_t wallClockNs{ static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count()) };
+	wallClockOffsetNs = wallClockNs - Tracer::now();
+
+	recordText(FlightEventType::Session, "session start");
+}
+
+void FlightRecorder::recordFrame(uint64_t frameNumber, uint32_t frameIndex, uint64_t fenceValue, uint64_t waitNs, uint32_t commandCount)
+{
+	FlightRecord& record{ beginRecord(FlightEventType::Frame) };
+	record.frameNumber = frameNumber;
+	record.frameIndex = frameIndex;
+	record.fenceValue = fenceValue;
+	record.waitNs = waitNs;
+	record.commandCount = commandCount;
+	commitRecord(record);
+
+	lastFrameNumber = frameNumber;
+	lastFrameIndex = frameIndex;
+	lastFenceValue = fenceValue;
+}
+
+void FlightRecorder::recordError(const char* message)
+{
+	recordText(FlightEventType::Error, message);
+	flush();
+}
+
+void FlightRecorder::recordMessage(const char* message)
+{
+	recordText(FlightEventType::Message, message);
+}
+
+void FlightRecorder::flush()
+{
+	file.flush();
+}
+
+uint32_t FlightRecorder::getCapacity() const
+{
+	return capacity;
+}
+
+uint64_t FlightRecorder::getNextSequence() const
+{
+	return nextSequence;
+}
+
+FlightRecord& FlightRecorder::beginRecord(FlightEventType type)
+{
+	FlightRecord& record{ records[(nextSequence - 1) % capacity] };
+	getSequence(record).store(0, memory_order_relaxed);
+	// keeps the payload stores below from being reordered ahead of the invalidation
+	atomic_thread_fence(memory_order_release);
+
+	record.timeNs = wallClockOffsetNs + Tracer::now();
+	record.frameNumber = 0;
+	record.fenceValue = 0;
+	record.waitNs = 0;
+	record.type = type;
+	record.frameIndex = 0;
+	record.commandCount = 0;
+	record.text[0] = '\0';
+	return record;
+}
+
+void FlightRecorder::commitRecord(FlightRecord& record)
+{
+	getSequence(record).store(nextSequence, memory_order_release);
+	++nextSequence;
+}
+
+void FlightRecorder::recordText(FlightEventType type, const char* message)
+{
+	FlightRecord& record{ beginRecord(type) };
+	record.frameNumber = lastFrameNumber;
+	record.frameIndex = lastFrameIndex;
+	record.fenceValue = lastFenceValue;
+	copyText(record.text, sizeof(record.text), message);
+	commitRecord(record);
+}
+
+namespace teapot_tutorial
+{
+	vector<FlightRecord> readFlightRecords(string path)
+	{
+		MappedFile file{ path };
+		if (file.getSize() < sizeof(details::FlightRecorderHeader))
+		{
+			throw(runtime_error{ "Invalid flight recorder file." });
+		}
+
+		const auto& header = *reinterpret_cast<const details::FlightRecorderHeader*>(file.getData());
+		if (!isValidHeader(header, file.getSize()))
+		{
+			throw(runtime_error{ "Invalid flight recorder file." });
+		}
+
+		const FlightRecord* slots{ reinterpret_cast<const FlightRecord*>(file.getData() + sizeof(details::FlightRecorderHeader)) };
+		vector<FlightRecord> records;
+		records.reserve(header.capacity);
+
+		for (uint32_t i = 0; i < header.capacity; ++i)
+		{
+			// the writer may still be running; a slot whose sequence changed during the copy is being rewritten
+			uint64_t sequence{ getSequence(slots[i]).load(memory_order_acquire) };
+			if (!isCompleteRecord(sequence, i, header.capacity))
+			{
+				continue;
+			}
+
+			FlightRecord record;
+			memcpy(&record, &slots[i], sizeof(record));
+			atomic_thread_fence(memory_order_acquire);
+			if (getSequence(slots[i]).load(memory_order_relaxed) != sequence)
+			{
+				continue;
+			}
+
+			record.sequence = sequence;
+			record.text[sizeof(record.text) - 1] = '\0';
+			records.push_back(record);
+		}
+
+		sort(records.begin(), records.end(), [](const FlightRecord& a, const FlightRecord& b) { return a.sequence < b.sequence; });
+		return records;
+	}
+
+	string formatFlightRecords(const vector<FlightRecord>& records)
+	{
+		if (records.empty())
+		{
+			return "no flight records\n";
+		}
+
+		const FlightRecord& newest{ records.back() };
+		string text;
+		char line[256];
+		snprintf(line, sizeof(line), "%zu records, sequence %llu..%llu, newest at %llu.%06llu s since epoch\n",
+			records.size(),
+			static_cast<unsigned long long>(records.front().sequence),
+			static_cast<unsigned long long>(newest.sequence),
+			static_cast<unsigned long long>(newest.timeNs / 1000000000),
+			static_cast<unsigned long long>(newest.timeNs % 1000000000 / 1000));
+		text += line;
+
+		for (const FlightRecord& record : records)
+		{
+			double ageMs{ (static_cast<double>(record.timeNs) - static_cast<double>(newest.timeNs)) / 1e6 };
+			switch (record.type)
+			{
+			case FlightEventType::Frame:
+				snprintf(line, sizeof(line), "%8llu %12.3f ms  frame %llu [%u] fence %llu, waited %.3f ms, %u commands\n",
+					static_cast<unsigned long long>(record.sequence), ageMs,
+					static_cast<unsigned long long>(record.frameNumber), record.frameIndex,
+					static_cast<unsigned long long>(record.fenceValue),
+					static_cast<double>(record.waitNs) / 1e6, record.commandCount);
+				break;
+			default:
+				snprintf(line, sizeof(line), "%8llu %12.3f ms  %s after frame %llu [%u] fence %llu: %s\n",
+					static_cast<unsigned long long>(record.sequence), ageMs,
+					record.type == FlightEventType::Error ? "ERROR" : record.type == FlightEventType::Session ? "session" : "message",
+					static_cast<unsigned long long>(record.frameNumber), record.frameIndex,
+					static_cast<unsigned long long>(record.fenceValue), record.text);
+				break;
+			}
+			text += line;
+		}
+		return text;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+enum class FlightEventType : uint32_t
+{
+	Session = 1,
+	Frame,
+	Error,
+	Message
+};
+
+// One slot of the ring. sequence is 1 based and zeroed while the slot is rewritten, so a record the process
+// died in the middle of is never mistaken for a complete one.
+struct FlightRecord
+{
+	uint64_t sequence;
+	// wall clock, ns since the Unix epoch
+	uint64_t timeNs;
+	uint64_t frameNumber;
+	uint64_t fenceValue;
+	// time blocked on a fence before the frame was recorded
+	uint64_t waitNs;
+	FlightEventType type;
+	uint32_t frameIndex;
+	uint32_t commandCount;
+	// null terminated
+	char text[76];
+};
+
+static_assert(sizeof(FlightRecord) == 128, "FlightRecord must stay 128 bytes.");
+
+namespace details
+{
+#pragma pack(push, 1)
+	struct FlightRecorderHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t recordSize;
+		uint32_t capacity;
+		uint8_t reserved[48];
+	};
+#pragma pack(pop)
+}
+
+// Fixed size ring of FlightRecords in a memory mapped file. Records are written straight into the shared
+// mapping, so they survive the process crashing or being killed; only the machine going down can lose them.
+// Appends take no lock and make no system call: a single thread owns the recorder. Reopening a file with the
+// same capacity continues after its newest record, keeping the history of the run that crashed.
+class FlightRecorder
+{
+public:
+	static const uint32_t defaultCapacity{ 4096 };
+
+	FlightRecorder(std::string path, uint32_t capacity = defaultCapacity);
+
+	FlightRecorder(const FlightRecorder&) = delete;
+	FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+	void recordFrame(uint64_t frameNumber, uint32_t frameIndex, uint64_t fenceValue, uint64_t waitNs, uint32_t commandCount);
+	// stamped with the last recorded frame; also flushes the file
+	void recordError(const char* message);
+	void recordMessage(const char* message);
+
+	void flush();
+
+	uint32_t getCapacity() const;
+	// sequence the next record will get
+	uint64_t getNextSequence() const;
+
+private:
+	FlightRecord& beginRecord(FlightEventType type);
+	void commitRecord(FlightRecord& record);
+	void recordText(FlightEventType type, const char* message);
+
+private:
+	MappedFile file;
+	FlightRecord* records;
+	uint32_t capacity;
+	uint64_t nextSequence{ 1 };
+	// added to Tracer::now() to get the wall clock without a second clock read per record
+	uint64_t wallClockOffsetNs;
+	uint64_t lastFrameNumber{ 0 };
+	uint32_t lastFrameIndex{ 0 };
+	uint64_t lastFenceValue{ 0 };
+};
+
+namespace teapot_tutorial
+{
+	// complete records of a flight recorder file, oldest first
+	std::vector<FlightRecord> readFlightRecords(std::string path);
+
+	// one line per record, times relative to the newest record
+	std::string formatFlightRecords(const std::vector<FlightRecord>& records);
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+FrameArena::FrameArena(size_t capacity) : memory{ new uint8_t[capacity] }, capacity{ capacity }
+{
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+	uintptr_t base{ reinterpret_cast<uintptr_t>(memory.get()) };
+	uintptr_t begin{ (base + used + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1) };
+	size_t offset{ static_cast<size_t>(begin - base) };
+	if (offset > capacity || size > capacity - offset)
+	{
+		throw(runtime_error{ "Frame arena exhausted." });
+	}
+
+	used = offset + size;
+	highWater = max(highWater, used);
+	return memory.get() + offset;
+}
+
+void FrameArena::reset()
+{
+	used = 0;
+}
+
+size_t FrameArena::getCapacity() const
+{
+	return capacity;
+}
+
+size_t FrameArena::getUsed() const
+{
+	return used;
+}
+
+size_t FrameArena::getHighWater() const
+{
+	return highWater;
+}
\ No newline at end of file
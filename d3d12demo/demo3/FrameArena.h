@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Linear allocator for memory that only lives until the end of a frame. The block is allocated once; allocate
+// bumps an offset and reset releases everything at once, so the frame loop never reaches the heap. Objects
+// placed in it are never destroyed and must be trivially destructible.
+class FrameArena
+{
+public:
+	FrameArena(size_t capacity);
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// alignment must be a power of two; throws when the arena is exhausted
+	void* allocate(size_t size, size_t alignment);
+
+	template <typename T>
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void reset();
+
+	size_t getCapacity() const;
+	size_t getUsed() const;
+	// most bytes used between two resets since construction
+	size_t getHighWater() const;
+
+private:
+	std::unique_ptr<uint8_t[]> memory;
+	size_t capacity;
+	size_t used{ 0 };
+	size_t highWater{ 0 };
+};
\ No newline at end of file
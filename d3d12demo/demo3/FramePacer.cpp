@@ -0,0 +1,234 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std;
+
+FramePacer::FramePacer(PacingMode mode, uint32_t maxQueuedFrames) : mode{ mode }, maxQueuedFrames{ max(maxQueuedFrames, 1u) }
+{
+}
+
+void FramePacer::setMode(PacingMode mode)
+{
+	this->mode = mode;
+}
+
+PacingMode FramePacer::getMode() const
+{
+	return mode;
+}
+
+void FramePacer::setMaxQueuedFrames(uint32_t maxQueuedFrames)
+{
+	this->maxQueuedFrames = max(maxQueuedFrames, 1u);
+}
+
+uint32_t FramePacer::getMaxQueuedFrames() const
+{
+	return maxQueuedFrames;
+}
+
+uint64_t FramePacer::getFrameToWait() const
+{
+	// after the next submit, frames waited + 1 to submittedFrames + 1 are in flight
+	return submittedFrames + 1 > maxQueuedFrames ? submittedFrames + 1 - maxQueuedFrames : 0;
+}
+
+void FramePacer::onWaitReturned(uint64_t frameNumber, uint64_t nowNs, bool blocked)
+{
+	if (blocked && frameNumber <= submittedFrames)
+	{
+		predictedGpuIdleNs = nowNs + getGpuEstimateNs() * (submittedFrames - frameNumber);
+	}
+}
+
+uint64_t FramePacer::getStartTime(uint64_t nowNs) const
+{
+	if (mode == PacingMode::Throughput)
+	{
+		return nowNs;
+	}
+	uint64_t cpuEstimateNs{ getCpuEstimateNs() };
+	if (predictedGpuIdleNs <= cpuEstimateNs)
+	{
+		return nowNs;
+	}
+	return max(nowNs, predictedGpuIdleNs - cpuEstimateNs);
+}
+
+void FramePacer::onFrameSubmitted(uint64_t cpuBeginNs, uint64_t submitNs)
+{
+	cpuHistory[cpuCount++ % historySize] = submitNs - cpuBeginNs;
+	++submittedFrames;
+	predictedGpuIdleNs = max(predictedGpuIdleNs, submitNs) + getGpuEstimateNs();
+}
+
+void FramePacer::onGpuFrameMeasured(uint64_t gpuNs)
+{
+	gpuHistory[gpuCount++ % historySize] = gpuNs;
+}
+
+uint64_t FramePacer::getSubmittedFrames() const
+{
+	return submittedFrames;
+}
+
+uint64_t FramePacer::getCpuEstimateNs() const
+{
+	return getLargest(cpuHistory);
+}
+
+uint64_t FramePacer::getGpuEstimateNs() const
+{
+	return getLargest(gpuHistory);
+}
+
+uint64_t FramePacer::getPredictedGpuIdleNs() const
+{
+	return predictedGpuIdleNs;
+}
+
+uint64_t FramePacer::getLargest(const uint64_t (&history)[historySize])
+{
+	return *max_element(begin(history), end(history));
+}
+
+CostJitter::CostJitter(uint32_t seed) : state{ seed }
+{
+}
+
+uint64_t CostJitter::apply(uint64_t ns, double jitter)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	double unit{ (state & 0xffffff) / static_cast<double>(0xffffff) };
+	return static_cast<uint64_t>(ns * (1.0 + jitter * (2.0 * unit - 1.0)));
+}
+
+namespace
+{
+	const char* getModeName(PacingMode mode)
+	{
+		return mode == PacingMode::LowLatency ? "low latency" : "throughput";
+	}
+}
+
+namespace teapot_tutorial
+{
+	PacingMode parsePacingMode(const string& name)
+	{
+		if (name == "latency")
+		{
+			return PacingMode::LowLatency;
+		}
+		if (name == "throughput")
+		{
+			return PacingMode::Throughput;
+		}
+		throw(runtime_error{ "Unknown pacing mode: " + name });
+	}
+
+	uint32_t getDefaultMaxQueuedFrames(PacingMode mode, uint32_t bufferCount)
+	{
+		return mode == PacingMode::LowLatency ? 2 : max(bufferCount, 1u);
+	}
+
+	FramePacingResult simulateFramePacing(const FramePacingSimulation& simulation)
+	{
+		FramePacer pacer{ simulation.mode, simulation.maxQueuedFrames };
+		CostJitter cpuJitter{ 0x9e3779b9u };
+		CostJitter gpuJitter{ 0x85ebca6bu };
+
+		vector<uint64_t> gpuEndNs(simulation.frames + 1, 0);
+		vector<uint64_t> gpuCostNs(simulation.frames + 1, 0);
+		vector<uint64_t> latencies;
+		latencies.reserve(simulation.frames);
+		uint64_t nowNs{ 0 };
+		uint64_t gpuFreeNs{ 0 };
+		uint64_t gpuBusyNs{ 0 };
+		uint64_t firstBeginNs{ 0 };
+		uint64_t measuredFrames{ 0 };
+		uint32_t maxInFlight{ 0 };
+
+		for (uint32_t frame = 1; frame <= simulation.frames; ++frame)
+		{
+			uint64_t waitFrame{ pacer.getFrameToWait() };
+			if (waitFrame != 0)
+			{
+				bool blocked{ gpuEndNs[waitFrame] > nowNs };
+				nowNs = max(nowNs, gpuEndNs[waitFrame]);
+				pacer.onWaitReturned(waitFrame, nowNs, blocked);
+			}
+			// timestamps of completed frames become readable once they are done
+			while (measuredFrames + 1 < frame && gpuEndNs[measuredFrames + 1] <= nowNs)
+			{
+				++measuredFrames;
+				pacer.onGpuFrameMeasured(gpuCostNs[measuredFrames]);
+			}
+
+			nowNs = pacer.getStartTime(nowNs);
+			uint64_t cpuBeginNs{ nowNs };
+			if (frame == 1)
+			{
+				firstBeginNs = cpuBeginNs;
+			}
+			nowNs += cpuJitter.apply(simulation.cpuNs, simulation.jitter);
+			pacer.onFrameSubmitted(cpuBeginNs, nowNs);
+
+			gpuCostNs[frame] = gpuJitter.apply(simulation.gpuNs, simulation.jitter);
+			gpuEndNs[frame] = max(nowNs, gpuFreeNs) + gpuCostNs[frame];
+			gpuFreeNs = gpuEndNs[frame];
+			gpuBusyNs += gpuCostNs[frame];
+			latencies.push_back(gpuEndNs[frame] - cpuBeginNs);
+
+			uint32_t inFlight{ 0 };
+			for (uint32_t f = frame; f > 0 && gpuEndNs[f] > nowNs; --f)
+			{
+				++inFlight;
+			}
+			maxInFlight = max(maxInFlight, inFlight);
+		}
+
+		FramePacingResult result;
+		result.mode = simulation.mode;
+		result.maxQueuedFrames = simulation.maxQueuedFrames;
+		result.cpuNs = simulation.cpuNs;
+		result.gpuNs = simulation.gpuNs;
+		result.maxInFlight = maxInFlight;
+		result.framesPerSecond = 0.0;
+		result.latencyMeanNs = 0;
+		result.latencyP99Ns = 0;
+		result.gpuUtilization = 0.0;
+		if (simulation.frames > 0)
+		{
+			uint64_t elapsedNs{ gpuFreeNs - firstBeginNs };
+			result.framesPerSecond = simulation.frames * 1e9 / elapsedNs;
+			result.gpuUtilization = static_cast<double>(gpuBusyNs) / elapsedNs;
+			uint64_t latencySum{ 0 };
+			for (uint64_t latency : latencies)
+			{
+				latencySum += latency;
+			}
+			result.latencyMeanNs = latencySum / latencies.size();
+			sort(latencies.begin(), latencies.end());
+			result.latencyP99Ns = latencies[latencies.size() * 99 / 100];
+		}
+		return result;
+	}
+
+	string formatFramePacingResults(const vector<FramePacingResult>& results)
+	{
+		string text;
+		for (const FramePacingResult& result : results)
+		{
+			char line[192];
+			snprintf(line, sizeof(line), "pacing %-11s queue %u cpu %.1f gpu %.1f ms: %.1f fps, latency mean/p99 %.2f/%.2f ms, gpu busy %.0f%%, in flight %u\n",
+				getModeName(result.mode), result.maxQueuedFrames, result.cpuNs / 1e6, result.gpuNs / 1e6, result.framesPerSecond,
+				result.latencyMeanNs / 1e6, result.latencyP99Ns / 1e6, result.gpuUtilization * 100.0, result.maxInFlight);
+			text += line;
+		}
+		return text;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class PacingMode : uint32_t
+{
+	// keeps up to maxQueuedFrames frames in flight, so the CPU only waits once the GPU falls that far behind
+	Throughput,
+	// also delays the start of CPU work until the predicted GPU timeline needs the frame, so it is submitted
+	// just as the GPU becomes free and samples its input as late as possible
+	LowLatency
+};
+
+// Decides when the next frame's CPU work starts, waitable swap chain style: first wait for the GPU to
+// complete the frame that keeps at most maxQueuedFrames frames in flight, then, in LowLatency mode, until
+// the predicted GPU idle time minus the CPU time the frame is expected to take. Estimates are the largest
+// CPU and GPU frame durations of the last historySize frames. Times are in ns of any monotonic clock, so a
+// simulated clock drives it just as well as Tracer::now().
+class FramePacer
+{
+public:
+	static const uint32_t historySize{ 16 };
+
+	FramePacer(PacingMode mode, uint32_t maxQueuedFrames);
+
+	void setMode(PacingMode mode);
+	PacingMode getMode() const;
+	// at least 1
+	void setMaxQueuedFrames(uint32_t maxQueuedFrames);
+	uint32_t getMaxQueuedFrames() const;
+
+	// 1 based number of the submitted frame that must have completed before the next frame starts, 0 for none
+	uint64_t getFrameToWait() const;
+	// Reports that the wait for getFrameToWait() returned at nowNs; blocked tells whether it had to wait, in
+	// which case the GPU finished the frame right then and the predicted timeline is corrected to it.
+	void onWaitReturned(uint64_t frameNumber, uint64_t nowNs, bool blocked);
+	// when the next frame's CPU work should start, nowNs or later
+	uint64_t getStartTime(uint64_t nowNs) const;
+
+	// the frame's CPU work started at cpuBeginNs and was submitted at submitNs
+	void onFrameSubmitted(uint64_t cpuBeginNs, uint64_t submitNs);
+	// measured GPU duration of a completed frame, in any order and with any delay
+	void onGpuFrameMeasured(uint64_t gpuNs);
+
+	uint64_t getSubmittedFrames() const;
+	uint64_t getCpuEstimateNs() const;
+	uint64_t getGpuEstimateNs() const;
+	// when the GPU is expected to finish everything submitted
+	uint64_t getPredictedGpuIdleNs() const;
+
+private:
+	static uint64_t getLargest(const uint64_t (&history)[historySize]);
+
+private:
+	PacingMode mode;
+	uint32_t maxQueuedFrames;
+	uint64_t submittedFrames{ 0 };
+	uint64_t predictedGpuIdleNs{ 0 };
+	uint64_t cpuHistory[historySize]{};
+	uint64_t gpuHistory[historySize]{};
+	uint32_t cpuCount{ 0 };
+	uint32_t gpuCount{ 0 };
+};
+
+// Deterministic cost variation for simulated frame times: xorshift32 from seed, each cost scaled by a factor in
+// [1 - jitter, 1 + jitter].
+class CostJitter
+{
+public:
+	CostJitter(uint32_t seed);
+
+	uint64_t apply(uint64_t ns, double jitter);
+
+private:
+	uint32_t state;
+};
+
+// A frame loop on a simulated clock: each frame costs cpuNs on the CPU and gpuNs on a GPU that runs submitted
+// frames in order, both varied by up to jitter (0..1) with a fixed seed, so runs are deterministic.
+struct FramePacingSimulation
+{
+	PacingMode mode;
+	uint32_t maxQueuedFrames;
+	uint32_t frames;
+	uint64_t cpuNs;
+	uint64_t gpuNs;
+	double jitter;
+};
+
+struct FramePacingResult
+{
+	PacingMode mode;
+	uint32_t maxQueuedFrames;
+	uint64_t cpuNs;
+	uint64_t gpuNs;
+	double framesPerSecond;
+	// from the start of a frame's CPU work, when it samples input, to its GPU work completing
+	uint64_t latencyMeanNs;
+	uint64_t latencyP99Ns;
+	double gpuUtilization;
+	// most frames in flight right after a submit
+	uint32_t maxInFlight;
+};
+
+namespace teapot_tutorial
+{
+	// "latency" or "throughput"
+	PacingMode parsePacingMode(const std::string& name);
+	// LowLatency overlaps one frame of CPU work with the GPU, Throughput queues a frame per back buffer
+	uint32_t getDefaultMaxQueuedFrames(PacingMode mode, uint32_t bufferCount);
+
+	FramePacingResult simulateFramePacing(const FramePacingSimulation& simulation);
+
+	// one line per result
+	std::string formatFramePacingResults(const std::vector<FramePacingResult>& results);
+}
\ No newline at end of file
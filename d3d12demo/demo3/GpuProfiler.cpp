@@ -0,0 +1,109 @@
+#include "GpuProfiler.h"
+#include "Trace.h"
+
+using namespace std;
+
+GpuProfiler::GpuProfiler() : trackId{ Tracer::createTrack("GPU") }
+{
+}
+
+void GpuProfiler::beginFrame(RenderDevice& device, uint32_t frameIndex)
+{
+	if (frames.size() < device.getBufferCount())
+	{
+		frames.resize(device.getBufferCount());
+	}
+
+	FrameQueries& frame{ frames[frameIndex] };
+	resolvedFrameNs = 0;
+	if (frame.queryCount > 0)
+	{
+		resolve(device, frame, frameIndex);
+	}
+
+	frame.scopeCount = 0;
+	frame.queryCount = 0;
+	depth = 0;
+	currentFrameIndex = frameIndex;
+	current = Tracer::isEnabled() || frameTiming ? &frame : nullptr;
+}
+
+uint32_t GpuProfiler::beginScope(CommandList& commandList, const char* name)
+{
+	if (current == nullptr || current->queryCount + 2 > maxTimestampQueries)
+	{
+		return invalidScope;
+	}
+
+	uint32_t scope{ current->scopeCount++ };
+	current->scopes[scope] = { name, current->queryCount++, 0, depth++ };
+	commandList.writeTimestamp(currentFrameIndex, current->scopes[scope].beginQuery);
+	return scope;
+}
+
+void GpuProfiler::endScope(CommandList& commandList, uint32_t scope)
+{
+	if (current == nullptr || scope == invalidScope)
+	{
+		return;
+	}
+
+	current->scopes[scope].endQuery = current->queryCount++;
+	commandList.writeTimestamp(currentFrameIndex, current->scopes[scope].endQuery);
+	--depth;
+}
+
+void GpuProfiler::endFrame(CommandList& commandList)
+{
+	if (current != nullptr && current->queryCount > 0)
+	{
+		commandList.resolveTimestamps(currentFrameIndex, current->queryCount);
+	}
+	current = nullptr;
+}
+
+void GpuProfiler::setFrameTimingEnabled(bool enabled)
+{
+	frameTiming = enabled;
+}
+
+uint64_t GpuProfiler::getResolvedFrameNs() const
+{
+	return resolvedFrameNs;
+}
+
+void GpuProfiler::resolve(RenderDevice& device, FrameQueries& frame, uint32_t frameIndex)
+{
+	if (frequency == 0)
+	{
+		frequency = device.getTimestampFrequency();
+	}
+
+	uint64_t gpuReference;
+	uint64_t cpuReference;
+	device.getClockCalibration(gpuReference, cpuReference);
+	device.readTimestamps(frameIndex, timestamps, frame.queryCount);
+
+	// GPU ticks to Tracer::now() nanoseconds through the calibration pair
+	auto toCpuNs = [&](uint64_t ticks)
+	{
+		double deltaNs{ (static_cast<double>(ticks) - static_cast<double>(gpuReference)) * 1e9 / static_cast<double>(frequency) };
+		return static_cast<uint64_t>(static_cast<double>(cpuReference) + deltaNs);
+	};
+
+	for (uint32_t i = 0; i < frame.scopeCount; ++i)
+	{
+		const Scope& scope{ frame.scopes[i] };
+		if (scope.endQuery <= scope.beginQuery)
+		{
+			continue;
+		}
+		uint64_t beginNs{ toCpuNs(timestamps[scope.beginQuery]) };
+		uint64_t endNs{ toCpuNs(timestamps[scope.endQuery]) };
+		if (scope.depth == 0 && resolvedFrameNs == 0 && endNs > beginNs)
+		{
+			resolvedFrameNs = endNs - beginNs;
+		}
+		Tracer::record(scope.name, beginNs, endNs, trackId, scope.depth);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include "RenderDevice.h"
+
+// Brackets command list regions with timestamp queries and turns the results into Tracer events on a "GPU"
+// track. Results are read when the frame's back buffer comes around again, after the fence wait the frame
+// loop already does, so resolving never stalls. Queries are only written while the Tracer is enabled, or
+// while frame timing is enabled for a FramePacer.
+class GpuProfiler
+{
+public:
+	static const uint32_t invalidScope{ UINT32_MAX };
+
+	GpuProfiler();
+
+	// resolves the results left by the last frame recorded on frameIndex, then starts a new one
+	void beginFrame(RenderDevice& device, uint32_t frameIndex);
+	uint32_t beginScope(CommandList& commandList, const char* name);
+	void endScope(CommandList& commandList, uint32_t scope);
+	// records the query resolve, call before closing the command list
+	void endFrame(CommandList& commandList);
+
+	// writes the queries even while the Tracer is disabled
+	void setFrameTimingEnabled(bool enabled);
+	// GPU duration of the outermost scope of the frame the last beginFrame resolved, 0 if it had none
+	uint64_t getResolvedFrameNs() const;
+
+private:
+	struct Scope
+	{
+		const char* name;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+		uint32_t depth;
+	};
+
+	struct FrameQueries
+	{
+		Scope scopes[maxTimestampQueries / 2];
+		uint32_t scopeCount{ 0 };
+		uint32_t queryCount{ 0 };
+	};
+
+	void resolve(RenderDevice& device, FrameQueries& frame, uint32_t frameIndex);
+
+private:
+	uint32_t trackId;
+	std::vector<FrameQueries> frames;
+	FrameQueries* current{ nullptr };
+	uint32_t currentFrameIndex{ 0 };
+	uint32_t depth{ 0 };
+	uint64_t frequency{ 0 };
+	bool frameTiming{ false };
+	uint64_t resolvedFrameNs{ 0 };
+	uint64_t timestamps[maxTimestampQueries];
+};
\ No newline at end of file
@@ -1,12 +1,15 @@
 #include "Graphics.h"
 #include <stdexcept>
 #include "Window.h"
+#include "Trace.h"
 
 using namespace std;
 using namespace Microsoft::WRL;
 
 Graphics::Graphics(UINT bufferCount, string name, LONG width, LONG height) : bufferCount{ bufferCount }, swapChainBuffers(bufferCount)
 {
+	TRACE_SCOPE("Graphics::Graphics");
+
 	createWindow(name, width, height);
 	createFactory();
 	getAdapter();
@@ -33,11 +36,15 @@ Graphics::~Graphics()
 
 void Graphics::createWindow(string name, LONG width, LONG height)
 {
+	TRACE_SCOPE("Graphics::createWindow");
+
 	window = make_shared<Window>(width, height, name.c_str());
 }
 
 void Graphics::createFactory()
 {
+	TRACE_SCOPE("Graphics::createFactory");
+
 #if defined(_DEBUG) 
 	ComPtr<ID3D12Debug> debugController;
 	if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController))))
@@ -59,6 +66,8 @@ void Graphics::createFactory()
 
 void Graphics::getAdapter()
 {
+	TRACE_SCOPE("Graphics::getAdapter");
+
 	ComPtr<IDXGIAdapter1> adapterTemp;
 
 	for (UINT adapterIndex{ 0 }; factory->EnumAdapters1(adapterIndex, adapterTemp.ReleaseAndGetAddressOf()) != DXGI_ERROR_NOT_FOUND; ++adapterIndex)
@@ -87,6 +96,8 @@ void Graphics::getAdapter()
 
 void Graphics::createDevice()
 {
+	TRACE_SCOPE("Graphics::createDevice");
+
 	if (FAILED(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device))))
 	{
 		throw(runtime_error{ "Error creating device." });
@@ -95,6 +106,8 @@ void Graphics::createDevice()
 
 void Graphics::createCommandQueue()
 {
+	TRACE_SCOPE("Graphics::createCommandQueue");
+
 	D3D12_COMMAND_QUEUE_DESC queueDesc;
 	ZeroMemory(&queueDesc, sizeof(queueDesc));
 	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
@@ -111,6 +124,8 @@ void Graphics::createCommandQueue()
 
 void Graphics::createSwapChain()
 {
+	TRACE_SCOPE("Graphics::createSwapChain");
+
 	POINT wSize(window->getSize());
 
 	DXGI_SWAP_CHAIN_DESC1 swapChainDesc;
@@ -140,6 +155,8 @@ void Graphics::createSwapChain()
 
 void Graphics::getSwapChainBuffers()
 {
+	TRACE_SCOPE("Graphics::getSwapChainBuffers");
+
 	for (UINT i{ 0 }; i < bufferCount; i++)
 	{
 		if (FAILED(swapChain->GetBuffer(i, IID_PPV_ARGS(swapChainBuffers[i].ReleaseAndGetAddressOf()))))
@@ -151,6 +168,8 @@ void Graphics::getSwapChainBuffers()
 
 void Graphics::createDescriptoprHeapRtv()
 {
+	TRACE_SCOPE("Graphics::createDescriptoprHeapRtv");
+
 	D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
 	ZeroMemory(&heapDesc, sizeof(heapDesc));
 	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
@@ -174,6 +193,8 @@ void Graphics::createDescriptoprHeapRtv()
 
 void Graphics::createDepthStencilBuffer()
 {
+	TRACE_SCOPE("Graphics::createDepthStencilBuffer");
+
 	D3D12_CLEAR_VALUE depthOptimizedClearValue;
 	ZeroMemory(&depthOptimizedClearValue, sizeof(depthOptimizedClearValue));
 	depthOptimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
@@ -221,6 +242,8 @@ void Graphics::createDepthStencilBuffer()
 
 void Graphics::createDescriptorHeapDepthStencil()
 {
+	TRACE_SCOPE("Graphics::createDescriptorHeapDepthStencil");
+
 	D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
 	ZeroMemory(&heapDesc, sizeof(heapDesc));
 	heapDesc.NumDescriptors = 1;
@@ -243,6 +266,8 @@ void Graphics::createDescriptorHeapDepthStencil()
 
 void Graphics::createCommandAllocators()
 {
+	TRACE_SCOPE("Graphics::createCommandAllocators");
+
 	for (UINT i{ 0 }; i < bufferCount; i++)
 	{
 		ComPtr<ID3D12CommandAllocator> commandAllocator;
@@ -257,6 +282,8 @@ void Graphics::createCommandAllocators()
 
 void Graphics::createCommandList()
 {
+	TRACE_SCOPE("Graphics::createCommandList");
+
 	if (FAILED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocators[0].Get(), nullptr, IID_PPV_ARGS(commandList.ReleaseAndGetAddressOf()))))
 	{
 		throw(runtime_error{ "Error creating command list." });
@@ -270,6 +297,8 @@ void Graphics::createCommandList()
 
 void Graphics::createFences()
 {
+	TRACE_SCOPE("Graphics::createFences");
+
 	for (UINT i{ 0 }; i < bufferCount; i++)
 	{
 		UINT64 initialValue{ 0 };
@@ -286,6 +315,8 @@ void Graphics::createFences()
 
 void Graphics::createFenceEventHandle()
 {
+	TRACE_SCOPE("Graphics::createFenceEventHandle");
+
 	fenceEventHandle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 	if (fenceEventHandle == NULL)
 	{
@@ -296,7 +327,8 @@ void Graphics::createFenceEventHandle()
 void Graphics::waitFrameComplete(UINT frameIndex)
 {
 	UINT64 fenceValue{ fenceValues[frameIndex] };
-	ComPtr<ID3D12Fence> fence{ fences[frameIndex] };
+	// a raw pointer, copying the ComPtr would AddRef/Release every frame
+	ID3D12Fence* fence{ fences[frameIndex].Get() };
 
 	if (FAILED(fence->SetEventOnCompletion(fenceValue, fenceEventHandle)))
 	{
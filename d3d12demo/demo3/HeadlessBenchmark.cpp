@@ -0,0 +1,1773 @@
+#include "HeadlessBenchmark.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include "AdaptiveTessellator.h"
+#include "AllocationCounter.h"
+#include "AssetStream.h"
+#include "BernsteinTableCache.h"
+#include "CommandStream.h"
+#include "FenceWaiter.h"
+#include "FlightRecorder.h"
+#include "InputEvent.h"
+#include "InputSystem.h"
+#include "JobSystem.h"
+#include "LodChain.h"
+#include "MeshSimplifier.h"
+#include "LoopScheduler.h"
+#include "Metrics.h"
+#include "NullDevice.h"
+#include "ParallelTessellator.h"
+#include "PatchEvaluator.h"
+#include "PatchModelLoader.h"
+#include "PatchTessellator.h"
+#include "RasterReplayDevice.h"
+#include "RecordingDevice.h"
+#include "TeapotRenderer.h"
+#include "TessellationBudget.h"
+#include "Trace.h"
+#include "TripleBuffer.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+	// records into a stream without executing it, for measuring encode cost alone
+	class EncodeDevice : public NullDevice
+	{
+	public:
+		EncodeDevice(uint32_t bufferCount, CommandStream& stream) : NullDevice{ bufferCount }, stream(stream)
+		{
+		}
+
+		CommandList& getCommandList() override
+		{
+			return stream;
+		}
+
+		void updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size) override
+		{
+			stream.updateConstantBuffer(frameIndex, data, size);
+		}
+
+		void executeCommandList() override
+		{
+		}
+
+	private:
+		CommandStream& stream;
+	};
+
+	double perFrame(double value, uint32_t frames)
+	{
+		return frames == 0 ? 0.0 : value / frames;
+	}
+
+	double perSecond(double value, double seconds)
+	{
+		return seconds <= 0.0 ? 0.0 : value / seconds;
+	}
+
+	uint32_t parseCount(const string& value)
+	{
+		char* end{ nullptr };
+		unsigned long count{ strtoul(value.c_str(), &end, 10) };
+		if (value.empty() || *end != '\0')
+		{
+			throw(runtime_error{ "Invalid count: " + value });
+		}
+		return static_cast<uint32_t>(count);
+	}
+
+	// golden frames are small so the reference image stays small; a few levels absorb compilers rounding differently
+	const uint32_t goldenFrameWidth{ 128 };
+	const uint32_t goldenFrameHeight{ 96 };
+	const int goldenTolerance{ 2 };
+
+	// puts an 800x600 frame at about 10 ms of simulated GPU time
+	const uint64_t dynamicResolutionPixelCostPs{ 20000 };
+
+	void checkOptions(const HeadlessOptions& options)
+	{
+		if (options.width <= 0 || options.height <= 0)
+		{
+			throw(runtime_error{ "Invalid headless render size." });
+		}
+	}
+
+	FrameInput getFrameInput(const HeadlessOptions& options, uint32_t frame)
+	{
+		// with lod the camera goes out to the far end and back every 280 frames
+		int32_t zoom{ options.lod ? 12 - abs(static_cast<int32_t>(frame / 10 % 28) - 14) : 0 };
+		return{ options.width, options.height, static_cast<int32_t>((frame * 7) % options.width), static_cast<int32_t>((frame * 3) % options.height), zoom };
+	}
+
+	struct FrameAllocations
+	{
+		uint64_t count;
+		uint64_t bytes;
+	};
+
+	void countFrameAllocation(size_t size, void* context)
+	{
+		FrameAllocations& allocations{ *static_cast<FrameAllocations*>(context) };
+		++allocations.count;
+		allocations.bytes += size;
+	}
+
+	// stands in for CPU work of a known length
+	void spinFor(uint64_t ns)
+	{
+		uint64_t end{ Tracer::now() + ns };
+		while (Tracer::now() < end)
+		{
+		}
+	}
+
+	template<typename T>
+	bool isSameVector(const vector<T>& a, const vector<T>& b)
+	{
+		return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+	}
+
+	bool isSameModel(const PatchModel& a, const PatchModel& b)
+	{
+		return isSameVector(a.points, b.points) && isSameVector(a.patches, b.patches) &&
+			isSameVector(a.patchesTransforms, b.patchesTransforms) && isSameVector(a.patchesColors, b.patchesColors);
+	}
+
+	// writes the model as an asset stream the demo opens by its ".astm" extension, and reads it back
+	string writeModelAssetStream(const PatchModel& model, const string& path)
+	{
+		AssetStreamMetrics metrics;
+		{
+			AssetStreamWriter writer{ path };
+			teapot_tutorial::writePatchModel(writer, model);
+			writer.finish();
+			metrics = writer.getMetrics();
+		}
+
+		AssetStreamReader reader{ path };
+		if (!isSameModel(teapot_tutorial::readPatchModel(reader), model))
+		{
+			throw(runtime_error{ "The asset stream " + path + " does not read back as the model." });
+		}
+
+		char text[256];
+		snprintf(text, sizeof(text), "asset stream %s: %zu patches, %llu bytes, compression %.2fx\n",
+			path.c_str(), model.getPatchCount(), static_cast<unsigned long long>(metrics.compressedBytes), metrics.getCompressionRatio());
+		return text;
+	}
+
+	// NullDevice on a frame budget: closing the list takes the recording time of a heavier scene and
+	// waitFrameComplete sleeps out the rest of the frame interval, like waiting on vsync. Recording sleeps rather
+	// than spins so an input thread still runs on a single core.
+	class PacedDevice : public NullDevice
+	{
+	public:
+		PacedDevice(uint32_t bufferCount, uint64_t recordNs, uint64_t frameIntervalNs) : NullDevice{ bufferCount },
+			recordNs{ recordNs }, frameIntervalNs{ frameIntervalNs }
+		{
+		}
+
+		void close() override
+		{
+			this_thread::sleep_for(chrono::nanoseconds{ recordNs });
+			NullDevice::close();
+		}
+
+		void executeCommandList() override
+		{
+			submitNs = Tracer::now();
+			NullDevice::executeCommandList();
+		}
+
+		void waitFrameComplete(uint32_t frameIndex) override
+		{
+			uint64_t now{ Tracer::now() };
+			nextFrameNs = max(nextFrameNs + frameIntervalNs, now);
+			this_thread::sleep_for(chrono::nanoseconds{ nextFrameNs - now });
+			NullDevice::waitFrameComplete(frameIndex);
+		}
+
+		uint64_t getSubmitNs() const
+		{
+			return submitNs;
+		}
+
+	private:
+		uint64_t recordNs;
+		uint64_t frameIntervalNs;
+		uint64_t nextFrameNs{ 0 };
+		uint64_t submitNs{ 0 };
+	};
+
+	InputEvent getSyntheticInputEvent(uint32_t i)
+	{
+		InputEventType type{ i % 5 == 4 ? InputEventType::Resize : (i % 5 == 3 ? InputEventType::KeyDown : InputEventType::MouseMove) };
+		return InputEvent{ type, i, static_cast<int32_t>(i * 7 % 800), static_cast<int32_t>(i * 13 % 600), 1000 + i };
+	}
+
+	// Latches a synthetic stream in uneven batches, comparing every latch with the state the events should
+	// leave, then overfills the ring to check the overflow is counted.
+	void checkInputLatching()
+	{
+		InputSystem input{ 640, 480 };
+		InputState expected{ 0, 0, 640, 480, 0, 0 };
+		uint32_t pushed{ 0 };
+		for (uint32_t batch = 0; batch < 200; ++batch)
+		{
+			for (uint32_t i = 0; i < batch % 17; ++i, ++pushed)
+			{
+				InputEvent event{ getSyntheticInputEvent(pushed) };
+				input.push(event);
+				if (event.type == InputEventType::MouseMove)
+				{
+					expected.mouseX = event.x;
+					expected.mouseY = event.y;
+				}
+				else if (event.type == InputEventType::Resize)
+				{
+					expected.width = event.x;
+					expected.height = event.y;
+				}
+				expected.timeNs = event.timeNs;
+				++expected.eventCount;
+			}
+
+			uint32_t latchedEvents;
+			const InputState& state{ input.latch(latchedEvents) };
+			if (latchedEvents != batch % 17 || state.mouseX != expected.mouseX || state.mouseY != expected.mouseY ||
+				state.width != expected.width || state.height != expected.height || state.timeNs != expected.timeNs ||
+				state.eventCount != expected.eventCount)
+			{
+				throw(runtime_error{ "Latched input diverged from the event stream." });
+			}
+		}
+
+		for (uint32_t i = 0; i < InputQueue::capacity + 10; ++i)
+		{
+			input.push(getSyntheticInputEvent(i));
+		}
+		if (input.getDroppedCount() != 10)
+		{
+			throw(runtime_error{ "Input overflow was not counted." });
+		}
+	}
+
+	// every word derives from the sequence, so a snapshot read while it was rewritten shows
+	struct StressSnapshot
+	{
+		uint64_t sequence;
+		uint64_t publishNs;
+		uint64_t check[6];
+	};
+
+	uint64_t getSnapshotCheck(uint64_t sequence, uint32_t word)
+	{
+		return (sequence + word) * 0x9E3779B97F4A7C15ull;
+	}
+
+	struct ThreadUsage
+	{
+		uint64_t cpuNs;
+		uint64_t contextSwitches;
+	};
+
+	ThreadUsage getThreadUsage()
+	{
+#if defined(_WIN32)
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		{
+			return{ 0, 0 };
+		}
+		uint64_t kernelTime{ (static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime };
+		uint64_t userTime{ (static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime };
+		return{ (kernelTime + userTime) * 100, 0 };
+#elif defined(__linux__)
+		rusage usage;
+		if (getrusage(RUSAGE_THREAD, &usage) != 0)
+		{
+			return{ 0, 0 };
+		}
+		uint64_t cpuUs{ static_cast<uint64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+			usage.ru_utime.tv_usec + usage.ru_stime.tv_usec };
+		return{ cpuUs * 1000, static_cast<uint64_t>(usage.ru_nvcsw) };
+#else
+		return{ 0, 0 };
+#endif
+	}
+
+	struct IdleScenario
+	{
+		const char* name;
+		bool renderOnDemand;
+		uint64_t idleTickNs;
+		bool minimized;
+		bool occluded;
+		// another thread calls requestRender() this often, 0 for never
+		uint64_t inputIntervalNs;
+		double minFramesPerSecond;
+		double maxFramesPerSecond;
+		double maxWakeupsPerSecond;
+	};
+
+	IdleLoopResult runIdleScenario(const IdleScenario& scenario, uint64_t durationNs)
+	{
+		LoopScheduler scheduler{ scenario.renderOnDemand, scenario.idleTickNs, 100000000 };
+		scheduler.setMinimized(scenario.minimized);
+
+		atomic<bool> stopping{ false };
+		uint64_t frames{ 0 };
+		uint64_t occlusionTests{ 0 };
+		uint64_t wakeups{ 0 };
+		ThreadUsage usage{};
+		uint64_t beginNs{ Tracer::now() };
+		thread loop{ [&]()
+		{
+			ThreadUsage begin{ getThreadUsage() };
+			while (true)
+			{
+				LoopDecision decision{ scheduler.next(Tracer::now()) };
+				if (stopping.load(memory_order_acquire))
+				{
+					break;
+				}
+				if (decision.action == LoopAction::Wait)
+				{
+					scheduler.wait(decision);
+					wakeups += stopping.load(memory_order_acquire) ? 0 : 1;
+				}
+				else if (decision.action == LoopAction::TestOcclusion)
+				{
+					++occlusionTests;
+					scheduler.onOcclusionTested(Tracer::now(), scenario.occluded);
+				}
+				else
+				{
+					this_thread::sleep_for(chrono::milliseconds{ 1 });
+					++frames;
+					scheduler.onFrameRendered(Tracer::now(), scenario.occluded);
+				}
+			}
+			ThreadUsage end{ getThreadUsage() };
+			usage = { end.cpuNs - begin.cpuNs, end.contextSwitches - begin.contextSwitches };
+		} };
+
+		thread input;
+		if (scenario.inputIntervalNs > 0)
+		{
+			input = thread{ [&]()
+			{
+				while (!stopping.load(memory_order_relaxed))
+				{
+					this_thread::sleep_for(chrono::nanoseconds{ scenario.inputIntervalNs });
+					scheduler.requestRender();
+				}
+			} };
+		}
+
+		this_thread::sleep_for(chrono::nanoseconds{ durationNs });
+		stopping.store(true, memory_order_release);
+		scheduler.wake();
+		loop.join();
+		if (input.joinable())
+		{
+			input.join();
+		}
+
+		double seconds{ (Tracer::now() - beginNs) / 1e9 };
+		IdleLoopResult result;
+		result.scenario = scenario.name;
+		result.framesPerSecond = perSecond(static_cast<double>(frames), seconds);
+		result.occlusionTestsPerSecond = perSecond(static_cast<double>(occlusionTests), seconds);
+		result.wakeupsPerSecond = perSecond(static_cast<double>(wakeups), seconds);
+		result.contextSwitchesPerSecond = perSecond(static_cast<double>(usage.contextSwitches), seconds);
+		result.cpuUtilization = seconds > 0.0 ? usage.cpuNs / 1e9 / seconds : 0.0;
+		return result;
+	}
+
+	const uint64_t fenceSignalIntervalNs{ 250000 };
+	const uint64_t fenceJobWorkNs{ 50000 };
+
+	// runs the fence dependent jobs among filler jobs worth about as much CPU time per worker as the GPU timeline
+	double runFenceWorkload(JobSystem& jobs, uint32_t signals, bool blocking, uint64_t& busyNs)
+	{
+		SimulatedFence fence;
+		FenceWaiter waiter{ jobs };
+		unique_ptr<JobCounter[]> gates{ new JobCounter[signals] };
+		JobCounter done;
+		atomic<uint64_t> busy{ 0 };
+		uint32_t fillersPerSignal{ static_cast<uint32_t>(jobs.getThreadCount() * fenceSignalIntervalNs / fenceJobWorkNs * 4 / 5) };
+
+		auto work = [&busy]()
+		{
+			spinFor(fenceJobWorkNs);
+			busy.fetch_add(fenceJobWorkNs, memory_order_relaxed);
+		};
+
+		auto begin = chrono::steady_clock::now();
+		thread gpu{ [&fence, signals]()
+		{
+			uint64_t next{ Tracer::now() };
+			for (uint32_t v = 1; v <= signals; ++v)
+			{
+				next += fenceSignalIntervalNs;
+				while (Tracer::now() < next)
+				{
+					this_thread::yield();
+				}
+				fence.signal(v);
+			}
+		} };
+
+		for (uint32_t v = 1; v <= signals; ++v)
+		{
+			if (blocking)
+			{
+				jobs.run(done, [&fence, &work, v]()
+				{
+					fence.waitBlocking(v);
+					work();
+				});
+			}
+			else
+			{
+				waiter.addDependency(fence, v, gates[v - 1]);
+				jobs.runAfter(gates[v - 1], done, work);
+			}
+
+			for (uint32_t i = 0; i < fillersPerSignal; ++i)
+			{
+				jobs.run(done, work);
+			}
+		}
+
+		jobs.wait(done);
+		auto end = chrono::steady_clock::now();
+		gpu.join();
+
+		busyNs = busy.load();
+		return chrono::duration<double, milli>(end - begin).count();
+	}
+
+	double measureDecode(const CommandStream& stream, uint32_t bufferCount, uint32_t repeats)
+	{
+		NullDevice device{ bufferCount };
+		auto begin = chrono::steady_clock::now();
+		for (uint32_t i = 0; i < repeats; ++i)
+		{
+			stream.replay(device);
+		}
+		auto end = chrono::steady_clock::now();
+		return chrono::duration<double>(end - begin).count();
+	}
+}
+
+double HeadlessResult::getMillisecondsPerFrame() const
+{
+	return perFrame(seconds * 1000.0, frames);
+}
+
+double HeadlessResult::getApiCallsPerFrame() const
+{
+	return perFrame(static_cast<double>(apiCalls), frames);
+}
+
+double HeadlessResult::getAllocationsPerFrame() const
+{
+	return perFrame(static_cast<double>(allocations), frames);
+}
+
+double HeadlessResult::getAllocatedBytesPerFrame() const
+{
+	return perFrame(static_cast<double>(allocatedBytes), frames);
+}
+
+double CommandStreamResult::getEncodeCommandsPerSecond() const
+{
+	return perSecond(static_cast<double>(commands), encodeSeconds);
+}
+
+double CommandStreamResult::getDecodeCommandsPerSecond() const
+{
+	return perSecond(static_cast<double>(commands), decodeSeconds);
+}
+
+double CommandStreamResult::getBytesPerCommand() const
+{
+	return commands == 0 ? 0.0 : static_cast<double>(bytes) / commands;
+}
+
+namespace teapot_tutorial
+{
+	HeadlessResult runHeadlessBenchmark(const PatchModel& model, const HeadlessOptions& options)
+	{
+		checkOptions(options);
+
+		bool tracing{ !options.tracePath.empty() };
+		vector<TraceEvent> traceEvents;
+		if (tracing)
+		{
+			// about a dozen CPU and GPU scopes per frame
+			traceEvents.reserve(static_cast<size_t>(options.frames) * 16);
+			Tracer::setThreadName("render");
+			Tracer::setEnabled(true);
+		}
+
+		NullDevice device{ options.bufferCount };
+		RecordingDevice recorder{ device };
+		TeapotRenderer renderer{ static_cast<uint32_t>(model.patches.size()), options.width, options.height };
+
+		unique_ptr<FramePacer> framePacer;
+		if (!options.pacing.empty())
+		{
+			PacingMode mode{ parsePacingMode(options.pacing) };
+			framePacer = make_unique<FramePacer>(mode, getDefaultMaxQueuedFrames(mode, options.bufferCount));
+			renderer.setFramePacer(framePacer.get());
+		}
+
+		unique_ptr<DynamicResolution> dynamicResolution;
+		if (options.dynamicResolutionMs > 0)
+		{
+			DynamicResolutionSettings settings;
+			settings.budgetNs = options.dynamicResolutionMs * 1000000ull;
+			dynamicResolution = make_unique<DynamicResolution>(settings);
+			renderer.setDynamicResolution(dynamicResolution.get());
+			device.setSimulatedPixelCost(dynamicResolutionPixelCostPs);
+		}
+
+		renderer.setTriangleBudget(options.triangleBudget);
+
+		unique_ptr<LodChain> lodChain;
+		if (options.lod)
+		{
+			lodChain = make_unique<LodChain>(model);
+			renderer.setLodChain(lodChain.get());
+		}
+
+		unique_ptr<FlightRecorder> flightRecorder;
+		if (!options.flightPath.empty())
+		{
+			flightRecorder = make_unique<FlightRecorder>(options.flightPath);
+			recorder.setFlightRecorder(flightRecorder.get());
+		}
+
+		for (uint32_t i = 0; i < options.warmupFrames; ++i)
+		{
+			renderer.render(recorder, getFrameInput(options, i));
+		}
+
+		if (tracing)
+		{
+			Tracer::collect(traceEvents);
+			traceEvents.clear();
+		}
+
+		device.resetCounters();
+		MetricsRegistry::getGlobal().reset();
+		uint64_t allocationsBegin{ AllocationCounter::getAllocationCount() };
+		uint64_t bytesBegin{ AllocationCounter::getAllocatedBytes() };
+		uint32_t lodMeshFrames{ 0 };
+		auto begin = chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < options.frames; ++i)
+		{
+			if (options.assertNoAllocation)
+			{
+				FrameAllocations allocations{ 0, 0 };
+				{
+					ScopedAllocationHook hook{ countFrameAllocation, &allocations };
+					renderer.render(recorder, getFrameInput(options, options.warmupFrames + i));
+				}
+				if (allocations.count != 0)
+				{
+					throw(runtime_error{ "Frame " + to_string(options.warmupFrames + i) + " allocated " + to_string(allocations.count) +
+						" times (" + to_string(allocations.bytes) + " bytes) after warmup." });
+				}
+			}
+			else
+			{
+				renderer.render(recorder, getFrameInput(options, options.warmupFrames + i));
+			}
+			lodMeshFrames += renderer.isLodMeshApplied() ? 1 : 0;
+			if (tracing)
+			{
+				Tracer::collect(traceEvents);
+			}
+		}
+
+		auto end = chrono::steady_clock::now();
+
+		HeadlessResult result;
+		result.frames = options.frames;
+		result.seconds = chrono::duration<double>(end - begin).count();
+		result.apiCalls = device.getApiCallCount();
+		result.draws = device.getDrawCount();
+		result.allocations = AllocationCounter::getAllocationCount() - allocationsBegin;
+		result.allocatedBytes = AllocationCounter::getAllocatedBytes() - bytesBegin;
+
+		HistogramSnapshot frameTime{ MetricsRegistry::getGlobal().getHistogram("teapot_frame_time_ns").snapshot() };
+		result.frameTimeP50Ns = frameTime.getValueAtQuantile(0.5);
+		result.frameTimeP99Ns = frameTime.getValueAtQuantile(0.99);
+		result.frameTimeP999Ns = frameTime.getValueAtQuantile(0.999);
+		result.resolutionScale = dynamicResolution != nullptr ? dynamicResolution->getScale() : 1.0f;
+		result.triangleBudget = options.triangleBudget;
+		result.tessFactor = renderer.getAppliedTessFactor();
+		result.trianglesPerFrame = getTessellationCounts(result.tessFactor, model.getPatchCount(), 1).triangles;
+		result.lod = options.lod;
+		result.lodMeshFrames = lodMeshFrames;
+
+		if (!options.capturePath.empty())
+		{
+			recorder.getLastStream().save(options.capturePath);
+		}
+
+		if (!options.metricsPath.empty())
+		{
+			metrics::writeMetrics(MetricsRegistry::getGlobal(), options.metricsPath, metrics::getFormatForPath(options.metricsPath));
+		}
+
+		if (tracing)
+		{
+			Tracer::setEnabled(false);
+			Tracer::collect(traceEvents);
+			Tracer::writeChromeTrace(options.tracePath, traceEvents);
+		}
+
+		return result;
+	}
+
+	CommandStreamResult runCommandStreamBenchmark(const PatchModel& model, const HeadlessOptions& options)
+	{
+		checkOptions(options);
+
+		CommandStream stream;
+		EncodeDevice device{ options.bufferCount, stream };
+		TeapotRenderer renderer{ static_cast<uint32_t>(model.patches.size()), options.width, options.height };
+
+		// the warmup grows the stream to its final capacity
+		for (uint32_t i = 0; i < options.frames; ++i)
+		{
+			renderer.render(device, getFrameInput(options, i));
+		}
+		stream.clear();
+
+		auto begin = chrono::steady_clock::now();
+		for (uint32_t i = 0; i < options.frames; ++i)
+		{
+			renderer.render(device, getFrameInput(options, i));
+		}
+		auto end = chrono::steady_clock::now();
+
+		CommandStreamResult result;
+		result.frames = options.frames;
+		result.commands = stream.getCommandCount();
+		result.bytes = stream.getSize();
+		result.encodeSeconds = chrono::duration<double>(end - begin).count();
+		result.decodeSeconds = measureDecode(stream, options.bufferCount, 1);
+		return result;
+	}
+
+	CommandStreamResult runReplayBenchmark(const PatchModel& model, const HeadlessOptions& options)
+	{
+		checkOptions(options);
+
+		CommandStream stream;
+		stream.load(options.replayPath);
+
+		CommandStreamResult result;
+		result.frames = options.frames;
+		result.commands = static_cast<uint64_t>(stream.getCommandCount()) * options.frames;
+		result.bytes = static_cast<uint64_t>(stream.getSize()) * options.frames;
+		result.encodeSeconds = 0.0;
+		result.decodeSeconds = measureDecode(stream, options.bufferCount, options.frames);
+
+		if (!options.imagePath.empty())
+		{
+			RasterReplayDevice device{ model, options.bufferCount, static_cast<uint32_t>(options.width), static_cast<uint32_t>(options.height) };
+			stream.replay(device);
+			device.executeCommandList();
+			device.getImage().savePpm(options.imagePath);
+		}
+
+		return result;
+	}
+
+	double measureTraceScopeCost(bool enabled, uint32_t scopes)
+	{
+		bool wasEnabled{ Tracer::isEnabled() };
+		Tracer::setEnabled(enabled);
+
+		// stay below the ring capacity between drains so no event is dropped
+		const uint32_t batch{ details::TraceBuffer::capacity / 2 };
+		vector<TraceEvent> events;
+		events.reserve(batch);
+
+		double seconds{ 0.0 };
+		for (uint32_t done = 0; done < scopes; done += batch)
+		{
+			uint32_t count{ min(batch, scopes - done) };
+			auto begin = chrono::steady_clock::now();
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				TRACE_SCOPE("empty scope");
+			}
+			auto end = chrono::steady_clock::now();
+			seconds += chrono::duration<double>(end - begin).count();
+
+			Tracer::collect(events);
+			events.clear();
+		}
+
+		Tracer::setEnabled(wasEnabled);
+		return scopes == 0 ? 0.0 : seconds * 1e9 / scopes;
+	}
+
+	double measureHistogramRecordCost(uint32_t threadCount, uint32_t records)
+	{
+		Histogram histogram;
+		vector<double> seconds(threadCount);
+		vector<thread> threads;
+
+		for (uint32_t t = 0; t < threadCount; ++t)
+		{
+			threads.emplace_back([&histogram, &seconds, records, t]()
+			{
+				// a spread of frame time like values so the records hit many buckets
+				uint64_t value{ 1000000 + t };
+				auto begin = chrono::steady_clock::now();
+				for (uint32_t i = 0; i < records; ++i)
+				{
+					histogram.record(value);
+					value = value * 6364136223846793005ull + 1442695040888963407ull;
+					value = 100000 + (value >> 40);
+				}
+				auto end = chrono::steady_clock::now();
+				seconds[t] = chrono::duration<double>(end - begin).count();
+			});
+		}
+
+		double total{ 0.0 };
+		for (uint32_t t = 0; t < threadCount; ++t)
+		{
+			threads[t].join();
+			total += seconds[t];
+		}
+		return records == 0 || threadCount == 0 ? 0.0 : total * 1e9 / (static_cast<double>(records) * threadCount);
+	}
+
+	double measureFlightRecordCost(string path, uint32_t records)
+	{
+		double seconds{ 0.0 };
+		{
+			FlightRecorder recorder{ path };
+
+			// touch every page of the ring first so page faults are not measured
+			for (uint32_t i = 0; i < recorder.getCapacity(); ++i)
+			{
+				recorder.recordFrame(i, i % 3, i, 0, 0);
+			}
+
+			auto begin = chrono::steady_clock::now();
+			for (uint32_t i = 0; i < records; ++i)
+			{
+				recorder.recordFrame(i, i % 3, i, 1000 + i, 28);
+			}
+			auto end = chrono::steady_clock::now();
+			seconds = chrono::duration<double>(end - begin).count();
+		}
+
+		remove(path.c_str());
+		return records == 0 ? 0.0 : seconds * 1e9 / records;
+	}
+
+	vector<JobScalingResult> runJobScalingBenchmark(const PatchModel& model, uint32_t maxThreads, uint32_t iterations)
+	{
+		const int factor{ 32 };
+		const uint32_t copies{ 8 };
+		uint32_t items{ static_cast<uint32_t>(model.getPatchCount()) * copies };
+		size_t gridVertices{ getGridVertexCount(factor) };
+		vector<Float3> positions(items * gridVertices);
+
+		auto tessellateItems = [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				tessellatePatch(model, i % model.getPatchCount(), factor, &positions[i * gridVertices]);
+			}
+		};
+
+		vector<JobScalingResult> results;
+		for (uint32_t threads = 1; threads <= max(maxThreads, 1u); threads *= 2)
+		{
+			JobScalingResult result;
+			result.threads = threads;
+
+			{
+				JobSystem jobs{ threads };
+				jobs.parallelFor(0, items, 1, tessellateItems);
+
+				auto begin = chrono::steady_clock::now();
+				for (uint32_t i = 0; i < iterations; ++i)
+				{
+					jobs.parallelFor(0, items, 1, tessellateItems);
+				}
+				auto end = chrono::steady_clock::now();
+				result.jobSystemMs = chrono::duration<double, milli>(end - begin).count() / max(iterations, 1u);
+			}
+
+			auto begin = chrono::steady_clock::now();
+			for (uint32_t i = 0; i < iterations; ++i)
+			{
+				vector<future<void>> futures;
+				for (uint32_t t = 0; t < threads; ++t)
+				{
+					uint32_t chunkBegin{ items * t / threads };
+					uint32_t chunkEnd{ items * (t + 1) / threads };
+					futures.push_back(async(launch::async, tessellateItems, chunkBegin, chunkEnd));
+				}
+				for (future<void>& f : futures)
+				{
+					f.get();
+				}
+			}
+			auto end = chrono::steady_clock::now();
+			result.asyncMs = chrono::duration<double, milli>(end - begin).count() / max(iterations, 1u);
+
+			results.push_back(result);
+		}
+		return results;
+	}
+
+	FenceBenchmarkResult runFenceBenchmark(uint32_t threadCount, uint32_t signals)
+	{
+		JobSystem jobs{ threadCount };
+		FenceBenchmarkResult result;
+		result.threads = jobs.getThreadCount();
+		result.signals = signals;
+
+		// wake-up latency: from the simulated GPU signaling a value to the job depending on it starting
+		{
+			SimulatedFence fence;
+			FenceWaiter waiter{ jobs };
+			unique_ptr<JobCounter[]> gates{ new JobCounter[signals] };
+			vector<uint64_t> signalNs(signals);
+			vector<uint64_t> startNs(signals);
+			JobCounter done;
+
+			for (uint32_t v = 1; v <= signals; ++v)
+			{
+				waiter.addDependency(fence, v, gates[v - 1]);
+				uint64_t* start{ &startNs[v - 1] };
+				jobs.runAfter(gates[v - 1], done, [start]() { *start = Tracer::now(); });
+			}
+
+			thread gpu{ [&fence, &signalNs, signals]()
+			{
+				for (uint32_t v = 1; v <= signals; ++v)
+				{
+					this_thread::sleep_for(chrono::microseconds{ 200 });
+					signalNs[v - 1] = Tracer::now();
+					fence.signal(v);
+				}
+			} };
+			jobs.wait(done);
+			gpu.join();
+
+			Histogram latency;
+			for (uint32_t i = 0; i < signals; ++i)
+			{
+				latency.record(startNs[i] - signalNs[i]);
+			}
+			HistogramSnapshot snapshot{ latency.snapshot() };
+			result.wakeLatencyP50Ns = snapshot.getValueAtQuantile(0.5);
+			result.wakeLatencyP99Ns = snapshot.getValueAtQuantile(0.99);
+			result.wakeLatencyMaxNs = snapshot.getValueAtQuantile(1.0);
+		}
+
+		uint64_t busyNs{ 0 };
+		result.waiterMs = runFenceWorkload(jobs, signals, false, busyNs);
+		result.waiterUtilization = busyNs / (result.waiterMs * 1e6 * result.threads);
+		result.blockingMs = runFenceWorkload(jobs, signals, true, busyNs);
+		result.blockingUtilization = busyNs / (result.blockingMs * 1e6 * result.threads);
+		return result;
+	}
+
+	QueueBenchmarkResult runQueueBenchmark(uint32_t events, uint32_t snapshots)
+	{
+		QueueBenchmarkResult result;
+		result.events = events;
+		result.snapshots = snapshots;
+
+		unique_ptr<InputQueue> queue{ new InputQueue };
+		bool outOfOrder{ false };
+		auto consume = [&queue, &outOfOrder](uint32_t count, Histogram* latency)
+		{
+			InputEvent event;
+			for (uint32_t i = 0; i < count;)
+			{
+				if (!queue->pop(event))
+				{
+					this_thread::yield();
+					continue;
+				}
+				if (latency != nullptr)
+				{
+					latency->record(Tracer::now() - event.timeNs);
+				}
+				if (event.key != i || event.x != static_cast<int32_t>(i) || event.y != ~static_cast<int32_t>(i))
+				{
+					outOfOrder = true;
+				}
+				++i;
+			}
+		};
+		auto produce = [&queue](uint32_t i)
+		{
+			while (!queue->push(InputEvent{ InputEventType::MouseMove, i, static_cast<int32_t>(i), ~static_cast<int32_t>(i), Tracer::now() }))
+			{
+				this_thread::yield();
+			}
+		};
+
+		// throughput, the producer only waits when the queue is full
+		uint64_t beginNs{ Tracer::now() };
+		{
+			thread consumer{ consume, events, nullptr };
+			for (uint32_t i = 0; i < events; ++i)
+			{
+				produce(i);
+			}
+			consumer.join();
+		}
+		result.queueEventsPerSecond = perSecond(events, (Tracer::now() - beginNs) / 1e9);
+
+		// latency, one event every 20 us like a fast mouse
+		const uint32_t pacedEvents{ min(events, 20000u) };
+		Histogram queueLatency;
+		{
+			thread consumer{ consume, pacedEvents, &queueLatency };
+			for (uint32_t i = 0; i < pacedEvents; ++i)
+			{
+				produce(i);
+				this_thread::sleep_for(chrono::microseconds{ 20 });
+			}
+			consumer.join();
+		}
+		if (outOfOrder)
+		{
+			throw(runtime_error{ "Input queue delivered an event out of order." });
+		}
+		HistogramSnapshot queueSnapshot{ queueLatency.snapshot() };
+		result.queueLatencyP50Ns = queueSnapshot.getValueAtQuantile(0.5);
+		result.queueLatencyP99Ns = queueSnapshot.getValueAtQuantile(0.99);
+		result.queueLatencyMaxNs = queueSnapshot.getValueAtQuantile(1.0);
+
+		// the reader spins like a render thread that never waits; it is done once it sees the last snapshot
+		unique_ptr<TripleBuffer<StressSnapshot>> buffer{ new TripleBuffer<StressSnapshot>{ StressSnapshot{} } };
+		Histogram snapshotAge;
+		bool torn{ false };
+		uint32_t snapshotsRead{ 0 };
+		thread reader{ [&buffer, &snapshotAge, &torn, &snapshotsRead, snapshots]()
+		{
+			uint64_t last{ 0 };
+			while (last < snapshots)
+			{
+				if (!buffer->update())
+				{
+					this_thread::yield();
+					continue;
+				}
+				const StressSnapshot& snapshot{ buffer->getReadBuffer() };
+				snapshotAge.record(Tracer::now() - snapshot.publishNs);
+				for (uint32_t word = 0; word < 6; ++word)
+				{
+					torn |= snapshot.check[word] != getSnapshotCheck(snapshot.sequence, word);
+				}
+				torn |= snapshot.sequence <= last;
+				last = snapshot.sequence;
+				++snapshotsRead;
+			}
+		} };
+		for (uint32_t sequence = 1; sequence <= snapshots; ++sequence)
+		{
+			StressSnapshot& snapshot{ buffer->getWriteBuffer() };
+			snapshot.sequence = sequence;
+			for (uint32_t word = 0; word < 6; ++word)
+			{
+				snapshot.check[word] = getSnapshotCheck(sequence, word);
+			}
+			snapshot.publishNs = Tracer::now();
+			buffer->publish();
+			this_thread::sleep_for(chrono::microseconds{ 10 });
+		}
+		reader.join();
+		if (torn)
+		{
+			throw(runtime_error{ "Triple buffer delivered a torn or stale snapshot." });
+		}
+		result.snapshotsRead = snapshotsRead;
+		HistogramSnapshot ageSnapshot{ snapshotAge.snapshot() };
+		result.snapshotAgeP50Ns = ageSnapshot.getValueAtQuantile(0.5);
+		result.snapshotAgeP99Ns = ageSnapshot.getValueAtQuantile(0.99);
+		result.snapshotAgeMaxNs = ageSnapshot.getValueAtQuantile(1.0);
+		return result;
+	}
+
+	InputLatchResult runInputLatchBenchmark(const PatchModel& model, uint32_t frames)
+	{
+		checkInputLatching();
+
+		const int32_t width{ 800 };
+		const int32_t height{ 600 };
+		InputLatchResult result;
+		result.frames = frames;
+		result.events = 0;
+		Histogram latched;
+		Histogram frameStart;
+
+		for (uint32_t late = 0; late < 2; ++late)
+		{
+			InputSystem input{ width, height };
+			PacedDevice device{ 3, 1000000, 4000000 };
+			TeapotRenderer renderer{ static_cast<uint32_t>(model.patches.size()), width, height };
+			if (late != 0)
+			{
+				renderer.setInputSystem(&input);
+			}
+
+			atomic<bool> stopping{ false };
+			thread mouse{ [&input, &stopping, &result]()
+			{
+				for (uint32_t i = 0; !stopping.load(memory_order_relaxed); ++i)
+				{
+					input.push(InputEvent{ InputEventType::MouseMove, 0, static_cast<int32_t>(i % width), height / 2, Tracer::now() });
+					++result.events;
+					this_thread::sleep_for(chrono::milliseconds{ 1 });
+				}
+			} };
+
+			for (uint32_t i = 0; i < frames; ++i)
+			{
+				if (late != 0)
+				{
+					uint64_t eventCount{ input.getState().eventCount };
+					renderer.render(device, FrameInput{ width, height, 0, 0, 0 });
+					const InputState& state{ input.getState() };
+					if (state.eventCount > eventCount)
+					{
+						latched.record(device.getSubmitNs() - state.timeNs);
+					}
+				}
+				else
+				{
+					uint32_t latchedEvents;
+					const InputState& state{ input.latch(latchedEvents) };
+					renderer.render(device, FrameInput{ state.width, state.height, state.mouseX, state.mouseY, 0 });
+					if (latchedEvents > 0)
+					{
+						frameStart.record(device.getSubmitNs() - state.timeNs);
+					}
+				}
+			}
+
+			stopping.store(true, memory_order_relaxed);
+			mouse.join();
+		}
+
+		HistogramSnapshot latchedSnapshot{ latched.snapshot() };
+		HistogramSnapshot frameStartSnapshot{ frameStart.snapshot() };
+		result.latchedP50Ns = latchedSnapshot.getValueAtQuantile(0.5);
+		result.latchedP99Ns = latchedSnapshot.getValueAtQuantile(0.99);
+		result.frameStartP50Ns = frameStartSnapshot.getValueAtQuantile(0.5);
+		result.frameStartP99Ns = frameStartSnapshot.getValueAtQuantile(0.99);
+		return result;
+	}
+
+	GoldenImageResult runGoldenImageCheck(const PatchModel& model, const string& path, bool update)
+	{
+		struct GoldenFrame
+		{
+			PipelineId pipeline;
+			int32_t zoom;
+		};
+		const GoldenFrame frames[]{ { PipelineId::Wireframe, 0 }, { PipelineId::Solid, 0 }, { PipelineId::Wireframe, -8 }, { PipelineId::Solid, -8 } };
+
+		// two frames per row
+		RenderImage image{ goldenFrameWidth * 2, goldenFrameHeight * 2 };
+		for (size_t f = 0; f < 4; ++f)
+		{
+			RasterReplayDevice device{ model, 2, goldenFrameWidth, goldenFrameHeight };
+			TeapotRenderer renderer{ static_cast<uint32_t>(model.patches.size()), goldenFrameWidth, goldenFrameHeight };
+			renderer.setPipeline(frames[f].pipeline);
+			renderer.render(device, { goldenFrameWidth, goldenFrameHeight, 40, 30, frames[f].zoom });
+
+			const RenderImage& frame{ device.getImage() };
+			uint32_t left{ static_cast<uint32_t>(f % 2) * goldenFrameWidth };
+			uint32_t top{ static_cast<uint32_t>(f / 2) * goldenFrameHeight };
+			for (uint32_t y = 0; y < goldenFrameHeight; ++y)
+			{
+				copy(frame.getColorData() + y * goldenFrameWidth, frame.getColorData() + (y + 1) * goldenFrameWidth, image.getColorData() + (top + y) * image.getWidth() + left);
+			}
+		}
+
+		GoldenImageResult result{ image.getWidth(), image.getHeight(), 0, 0, update };
+		if (update)
+		{
+			image.savePpm(path);
+			return result;
+		}
+
+		RenderImage reference{ RenderImage::loadPpm(path) };
+		if (reference.getWidth() != image.getWidth() || reference.getHeight() != image.getHeight())
+		{
+			throw(runtime_error{ "The golden image " + path + " is not " + to_string(image.getWidth()) + "x" + to_string(image.getHeight()) + "." });
+		}
+
+		size_t pixels{ static_cast<size_t>(image.getWidth()) * image.getHeight() };
+		for (size_t i = 0; i < pixels; ++i)
+		{
+			int difference{ 0 };
+			for (uint32_t shift = 0; shift < 24; shift += 8)
+			{
+				int channel{ static_cast<int>((image.getColorData()[i] >> shift) & 0xff) };
+				int expected{ static_cast<int>((reference.getColorData()[i] >> shift) & 0xff) };
+				difference = max(difference, abs(channel - expected));
+			}
+			result.maxDifference = max(result.maxDifference, difference);
+			result.differingPixels += difference > goldenTolerance ? 1 : 0;
+		}
+
+		if (result.differingPixels * 1000 > pixels)
+		{
+			throw(runtime_error{ to_string(result.differingPixels) + " pixels differ from the golden image " + path + "." });
+		}
+		return result;
+	}
+
+	vector<FramePacingResult> runFramePacingBenchmark(uint32_t frames)
+	{
+		const uint64_t workloads[][2]{ { 2000000, 6000000 }, { 6000000, 2000000 }, { 4000000, 4000000 } };
+		vector<FramePacingResult> results;
+		for (const auto& workload : workloads)
+		{
+			for (uint32_t maxQueued = 1; maxQueued <= 3; ++maxQueued)
+			{
+				FramePacingResult throughput{};
+				for (PacingMode mode : { PacingMode::Throughput, PacingMode::LowLatency })
+				{
+					FramePacingSimulation simulation{ mode, maxQueued, frames, workload[0], workload[1], 0.1 };
+					FramePacingResult result{ simulateFramePacing(simulation) };
+					FramePacingResult again{ simulateFramePacing(simulation) };
+					if (again.latencyMeanNs != result.latencyMeanNs || again.framesPerSecond != result.framesPerSecond)
+					{
+						throw(runtime_error{ "Frame pacing simulation is not deterministic." });
+					}
+					if (result.maxInFlight > maxQueued)
+					{
+						throw(runtime_error{ "Frame pacing queued more frames than allowed." });
+					}
+					if (mode == PacingMode::Throughput)
+					{
+						throughput = result;
+					}
+					else if (result.latencyMeanNs > throughput.latencyMeanNs)
+					{
+						throw(runtime_error{ "Low latency pacing added latency." });
+					}
+					results.push_back(result);
+				}
+			}
+		}
+		return results;
+	}
+
+	vector<IdleLoopResult> runIdleLoopBenchmark(uint32_t milliseconds)
+	{
+		double seconds{ milliseconds / 1e3 };
+		// rate limits allow for the first frame, which is always drawn, and for timer slack
+		const IdleScenario scenarios[]
+		{
+			{ "continuous", false, 1000000000, false, false, 0, 100.0, 1e9, 1.0 / seconds },
+			{ "input 100 Hz", true, 1000000000, false, false, 10000000, 50.0, 150.0 + 2.0 / seconds, 150.0 },
+			{ "idle, 250 ms tick", true, 250000000, false, false, 0, 0.0, 4.0 + 2.0 / seconds, 4.0 + 2.0 / seconds },
+			{ "idle, no tick", true, 0, false, false, 0, 0.0, 1.0 / seconds, 0.0 },
+			{ "minimized", true, 250000000, true, false, 0, 0.0, 0.0, 0.0 },
+			{ "occluded", true, 250000000, false, true, 0, 0.0, 1.0 / seconds, 10.0 + 2.0 / seconds }
+		};
+
+		vector<IdleLoopResult> results;
+		for (const IdleScenario& scenario : scenarios)
+		{
+			IdleLoopResult result{ runIdleScenario(scenario, milliseconds * 1000000ull) };
+			if (result.framesPerSecond < scenario.minFramesPerSecond || result.framesPerSecond > scenario.maxFramesPerSecond)
+			{
+				throw(runtime_error{ string{ "Render loop frame rate out of range: " } + scenario.name });
+			}
+			if (result.wakeupsPerSecond > scenario.maxWakeupsPerSecond)
+			{
+				throw(runtime_error{ string{ "Render loop woke up too often: " } + scenario.name });
+			}
+			results.push_back(result);
+		}
+		return results;
+	}
+
+	vector<DynamicResolutionResult> runDynamicResolutionBenchmark(const string& tracePath, uint32_t budgetMs)
+	{
+		const uint32_t frames{ 600 };
+		DynamicResolutionSettings settings;
+		if (budgetMs > 0)
+		{
+			settings.budgetNs = budgetMs * 1000000ull;
+		}
+		uint64_t budgetNs{ settings.budgetNs };
+
+		CostJitter jittered{ 0x9e3779b9u };
+		auto makeTrace = [&](uint64_t ns, double jitter)
+		{
+			vector<uint64_t> trace(frames);
+			for (uint64_t& frameNs : trace)
+			{
+				frameNs = jittered.apply(ns, jitter);
+			}
+			return trace;
+		};
+
+		// a third of the run at five times the cost, e.g. a tessellation factor jump
+		vector<uint64_t> spike{ makeTrace(budgetNs * 36 / 100, 0.05) };
+		for (uint32_t frame = frames / 3; frame < 2 * frames / 3; ++frame)
+		{
+			spike[frame] *= 5;
+		}
+
+		vector<DynamicResolutionSimulation> simulations
+		{
+			{ "light", makeTrace(budgetNs * 6 / 10, 0.1), settings, 0.8, 3 },
+			{ "tess spike", spike, settings, 0.8, 3 },
+			{ "noisy", makeTrace(budgetNs * 12 / 10, 0.25), settings, 0.8, 3 },
+			{ "overload", makeTrace(budgetNs * 36 / 10, 0.05), settings, 0.8, 3 }
+		};
+		if (!tracePath.empty())
+		{
+			simulations.push_back({ tracePath, readFrameTimeTrace(tracePath), settings, 0.8, 3 });
+		}
+
+		vector<DynamicResolutionResult> results;
+		for (const DynamicResolutionSimulation& simulation : simulations)
+		{
+			results.push_back(simulateDynamicResolution(simulation));
+		}
+
+		if (results[0].changes != 0 || results[0].finalScale != settings.maxScale)
+		{
+			throw(runtime_error{ "Dynamic resolution left full resolution under light load." });
+		}
+		if (results[1].overBudgetFrames > frames / 10 || results[1].finalScale != settings.maxScale || results[1].changes > 20)
+		{
+			throw(runtime_error{ "Dynamic resolution did not absorb the spike and recover." });
+		}
+		if (results[2].changes > 20)
+		{
+			throw(runtime_error{ "Dynamic resolution oscillates under noise." });
+		}
+		if (results[3].finalScale != settings.minScale)
+		{
+			throw(runtime_error{ "Dynamic resolution did not reach its minimum scale under overload." });
+		}
+		return results;
+	}
+
+	string formatHeadlessResult(const HeadlessResult& result)
+	{
+		char text[768];
+		snprintf(text, sizeof(text),
+			"frames: %u\n"
+			"cpu ms/frame: %.6f\n"
+			"frame time p50/p99/p99.9 ns: %llu/%llu/%llu\n"
+			"api calls/frame: %.2f\n"
+			"draws/frame: %.2f\n"
+			"allocations/frame: %.2f\n"
+			"allocated bytes/frame: %.2f\n",
+			result.frames,
+			result.getMillisecondsPerFrame(),
+			static_cast<unsigned long long>(result.frameTimeP50Ns),
+			static_cast<unsigned long long>(result.frameTimeP99Ns),
+			static_cast<unsigned long long>(result.frameTimeP999Ns),
+			result.getApiCallsPerFrame(),
+			perFrame(static_cast<double>(result.draws), result.frames),
+			result.getAllocationsPerFrame(),
+			result.getAllocatedBytesPerFrame());
+		string report{ text };
+		if (result.resolutionScale != 1.0f)
+		{
+			snprintf(text, sizeof(text), "resolution scale: %.2f\n", result.resolutionScale);
+			report += text;
+		}
+		if (result.triangleBudget != 0)
+		{
+			snprintf(text, sizeof(text), "tess factor: %d\ntriangles/frame: %llu of %llu\n", result.tessFactor,
+				static_cast<unsigned long long>(result.trianglesPerFrame), static_cast<unsigned long long>(result.triangleBudget));
+			report += text;
+		}
+		if (result.lod)
+		{
+			snprintf(text, sizeof(text), "lod mesh frames: %u of %u\n", result.lodMeshFrames, result.frames);
+			report += text;
+		}
+		return report;
+	}
+
+	string formatCommandStreamResult(const CommandStreamResult& result)
+	{
+		char text[512];
+		snprintf(text, sizeof(text),
+			"stream frames: %u\n"
+			"stream commands: %llu\n"
+			"stream bytes/command: %.2f\n"
+			"encode commands/s: %.0f\n"
+			"decode commands/s: %.0f\n",
+			result.frames,
+			static_cast<unsigned long long>(result.commands),
+			result.getBytesPerCommand(),
+			result.getEncodeCommandsPerSecond(),
+			result.getDecodeCommandsPerSecond());
+		return text;
+	}
+
+	string formatJobScalingResults(const vector<JobScalingResult>& results)
+	{
+		string text;
+		for (const JobScalingResult& result : results)
+		{
+			char line[160];
+			snprintf(line, sizeof(line), "jobs %2u threads: job system %.3f ms, std::async %.3f ms, speedup %.2fx/%.2fx\n",
+				result.threads, result.jobSystemMs, result.asyncMs,
+				result.jobSystemMs > 0.0 ? results.front().jobSystemMs / result.jobSystemMs : 0.0,
+				result.asyncMs > 0.0 ? results.front().asyncMs / result.asyncMs : 0.0);
+			text += line;
+		}
+		return text;
+	}
+
+	string formatFenceBenchmarkResult(const FenceBenchmarkResult& result)
+	{
+		char text[384];
+		snprintf(text, sizeof(text),
+			"fence threads: %u\n"
+			"fence wake latency p50/p99/max us: %.1f/%.1f/%.1f\n"
+			"fence waiter: %.2f ms, worker utilization %.1f%%\n"
+			"blocking waits: %.2f ms, worker utilization %.1f%%\n",
+			result.threads,
+			result.wakeLatencyP50Ns / 1e3, result.wakeLatencyP99Ns / 1e3, result.wakeLatencyMaxNs / 1e3,
+			result.waiterMs, result.waiterUtilization * 100.0,
+			result.blockingMs, result.blockingUtilization * 100.0);
+		return text;
+	}
+
+	string formatQueueBenchmarkResult(const QueueBenchmarkResult& result)
+	{
+		char text[384];
+		snprintf(text, sizeof(text),
+			"input queue events/s: %.0f\n"
+			"input queue latency p50/p99/max us: %.1f/%.1f/%.1f\n"
+			"snapshots read: %u of %u\n"
+			"snapshot age p50/p99/max us: %.1f/%.1f/%.1f\n",
+			result.queueEventsPerSecond,
+			result.queueLatencyP50Ns / 1e3, result.queueLatencyP99Ns / 1e3, result.queueLatencyMaxNs / 1e3,
+			result.snapshotsRead, result.snapshots,
+			result.snapshotAgeP50Ns / 1e3, result.snapshotAgeP99Ns / 1e3, result.snapshotAgeMaxNs / 1e3);
+		return text;
+	}
+
+	string formatInputLatchResult(const InputLatchResult& result)
+	{
+		char text[256];
+		snprintf(text, sizeof(text),
+			"input events: %llu over %u frames\n"
+			"input to submit p50/p99 us (late latched): %.1f/%.1f\n"
+			"input to submit p50/p99 us (frame start): %.1f/%.1f\n",
+			static_cast<unsigned long long>(result.events), result.frames * 2,
+			result.latchedP50Ns / 1e3, result.latchedP99Ns / 1e3,
+			result.frameStartP50Ns / 1e3, result.frameStartP99Ns / 1e3);
+		return text;
+	}
+
+	string formatIdleLoopResults(const vector<IdleLoopResult>& results)
+	{
+		string text;
+		for (const IdleLoopResult& result : results)
+		{
+			char line[192];
+			snprintf(line, sizeof(line), "loop %-18s fps %7.1f, occlusion tests/s %5.1f, wakeups/s %6.1f, context switches/s %6.1f, cpu %.3f%%\n",
+				result.scenario, result.framesPerSecond, result.occlusionTestsPerSecond, result.wakeupsPerSecond,
+				result.contextSwitchesPerSecond, result.cpuUtilization * 100.0);
+			text += line;
+		}
+		return text;
+	}
+
+	string formatGoldenImageResult(const GoldenImageResult& result)
+	{
+		char text[128];
+		if (result.updated)
+		{
+			snprintf(text, sizeof(text), "golden %ux%u written\n", result.width, result.height);
+		}
+		else
+		{
+			snprintf(text, sizeof(text), "golden %ux%u differing pixels: %llu, max difference %d\n", result.width, result.height,
+				static_cast<unsigned long long>(result.differingPixels), result.maxDifference);
+		}
+		return text;
+	}
+
+	void parseHeadlessArguments(const vector<string>& args, HeadlessOptions& options, string& modelPath)
+	{
+		for (size_t i = 0; i < args.size(); ++i)
+		{
+			const string& arg{ args[i] };
+			bool hasValue{ i + 1 < args.size() };
+
+			if (arg == "--frames" && hasValue)
+			{
+				options.frames = parseCount(args[++i]);
+			}
+			else if (arg == "--warmup" && hasValue)
+			{
+				options.warmupFrames = parseCount(args[++i]);
+			}
+			else if (arg == "--buffers" && hasValue)
+			{
+				options.bufferCount = parseCount(args[++i]);
+			}
+			else if (arg == "--size" && hasValue)
+			{
+				const string& size{ args[++i] };
+				size_t x{ size.find('x') };
+				if (x == string::npos)
+				{
+					throw(runtime_error{ "Invalid size: " + size });
+				}
+				options.width = static_cast<int32_t>(parseCount(size.substr(0, x)));
+				options.height = static_cast<int32_t>(parseCount(size.substr(x + 1)));
+			}
+			else if (arg == "--capture" && hasValue)
+			{
+				options.capturePath = args[++i];
+			}
+			else if (arg == "--replay" && hasValue)
+			{
+				options.replayPath = args[++i];
+			}
+			else if (arg == "--image" && hasValue)
+			{
+				options.imagePath = args[++i];
+			}
+			else if (arg == "--trace" && hasValue)
+			{
+				options.tracePath = args[++i];
+			}
+			else if (arg == "--trace-overhead")
+			{
+				options.traceOverhead = true;
+			}
+			else if (arg == "--metrics" && hasValue)
+			{
+				options.metricsPath = args[++i];
+			}
+			else if (arg == "--metrics-bench")
+			{
+				options.metricsBenchmark = true;
+			}
+			else if (arg == "--flight" && hasValue)
+			{
+				options.flightPath = args[++i];
+			}
+			else if (arg == "--flight-decode" && hasValue)
+			{
+				options.flightDecodePath = args[++i];
+			}
+			else if (arg == "--flight-bench")
+			{
+				options.flightBenchmark = true;
+			}
+			else if (arg == "--jobs-bench")
+			{
+				options.jobBenchmark = true;
+			}
+			else if (arg == "--job-threads" && hasValue)
+			{
+				options.jobThreads = parseCount(args[++i]);
+			}
+			else if (arg == "--fence-bench")
+			{
+				options.fenceBenchmark = true;
+			}
+			else if (arg == "--pacing" && hasValue)
+			{
+				options.pacing = args[++i];
+				parsePacingMode(options.pacing);
+			}
+			else if (arg == "--pacing-bench")
+			{
+				options.pacingBenchmark = true;
+			}
+			else if (arg == "--idle-bench")
+			{
+				options.idleBenchmark = true;
+			}
+			else if (arg == "--dynres" && hasValue)
+			{
+				options.dynamicResolutionMs = parseCount(args[++i]);
+			}
+			else if (arg == "--dynres-bench")
+			{
+				options.dynamicResolutionBenchmark = true;
+			}
+			else if (arg == "--dynres-trace" && hasValue)
+			{
+				options.dynamicResolutionTracePath = args[++i];
+			}
+			else if (arg == "--tri-budget" && hasValue)
+			{
+				options.triangleBudget = parseCount(args[++i]);
+			}
+			else if (arg == "--tess-budget-check")
+			{
+				options.tessellationBudgetCheck = true;
+			}
+			else if (arg == "--lod")
+			{
+				options.lod = true;
+			}
+			else if (arg == "--lod-check")
+			{
+				options.lodCheck = true;
+			}
+			else if (arg == "--simplify-bench")
+			{
+				options.simplifyBenchmark = true;
+			}
+			else if (arg == "--adaptive-bench")
+			{
+				options.adaptiveBenchmark = true;
+			}
+			else if (arg == "--evaluator-bench")
+			{
+				options.evaluatorBenchmark = true;
+			}
+			else if (arg == "--normals-check")
+			{
+				options.normalCheck = true;
+			}
+			else if (arg == "--kernel-bench")
+			{
+				options.kernelBenchmark = true;
+			}
+			else if (arg == "--weight-cache-bench")
+			{
+				options.weightCacheBenchmark = true;
+			}
+			else if (arg == "--parallel-tess-bench")
+			{
+				options.parallelTessellationBenchmark = true;
+			}
+			else if (arg == "--write-astm" && hasValue)
+			{
+				options.writeAssetPath = args[++i];
+			}
+			else if (arg == "--golden" && hasValue)
+			{
+				options.goldenPath = args[++i];
+			}
+			else if (arg == "--golden-update")
+			{
+				options.goldenUpdate = true;
+			}
+			else if (arg == "--parse-bench")
+			{
+				options.parseBenchmark = true;
+			}
+			else if (arg == "--parse-size" && hasValue)
+			{
+				options.parseBenchmarkMegabytes = parseCount(args[++i]);
+			}
+			else if (arg == "--asset-bench")
+			{
+				options.assetBenchmark = true;
+			}
+			else if (arg == "--asset-size" && hasValue)
+			{
+				options.assetBenchmarkMegabytes = parseCount(args[++i]);
+			}
+			else if (arg == "--input-bench")
+			{
+				options.inputBenchmark = true;
+			}
+			else if (arg == "--queue-bench")
+			{
+				options.queueBenchmark = true;
+			}
+			else if (arg == "--assert-no-alloc")
+			{
+				options.assertNoAllocation = true;
+			}
+			else if (arg == "--stream")
+			{
+				options.streamBenchmark = true;
+			}
+			else if (arg.compare(0, 2, "--") == 0)
+			{
+				throw(runtime_error{ "Unknown headless argument: " + arg });
+			}
+			else
+			{
+				modelPath = arg;
+			}
+		}
+	}
+
+	string runHeadless(const vector<string>& args)
+	{
+		HeadlessOptions options;
+		string modelPath;
+		parseHeadlessArguments(args, options, modelPath);
+
+		if (!options.flightDecodePath.empty())
+		{
+			return formatFlightRecords(readFlightRecords(options.flightDecodePath));
+		}
+
+		PatchModel model{ openPatchModel(modelPath) };
+
+		if (!options.writeAssetPath.empty())
+		{
+			return writeModelAssetStream(model, options.writeAssetPath);
+		}
+
+		if (!options.replayPath.empty())
+		{
+			return formatCommandStreamResult(runReplayBenchmark(model, options));
+		}
+
+		string report{ formatHeadlessResult(runHeadlessBenchmark(model, options)) };
+		if (options.streamBenchmark)
+		{
+			report += formatCommandStreamResult(runCommandStreamBenchmark(model, options));
+		}
+		if (options.traceOverhead)
+		{
+			char text[128];
+			snprintf(text, sizeof(text), "trace scope ns (enabled): %.2f\ntrace scope ns (disabled): %.2f\n",
+				measureTraceScopeCost(true, 1 << 22), measureTraceScopeCost(false, 1 << 22));
+			report += text;
+		}
+		if (options.metricsBenchmark)
+		{
+			char text[160];
+			snprintf(text, sizeof(text), "histogram record ns (1 thread): %.2f\nhistogram record ns (4 threads): %.2f\n",
+				measureHistogramRecordCost(1, 1 << 22), measureHistogramRecordCost(4, 1 << 20));
+			report += text;
+		}
+		if (options.jobBenchmark)
+		{
+			report += formatJobScalingResults(runJobScalingBenchmark(model, options.jobThreads, 50));
+		}
+		if (options.fenceBenchmark)
+		{
+			report += formatFenceBenchmarkResult(runFenceBenchmark(0, 200));
+		}
+		if (options.queueBenchmark)
+		{
+			report += formatQueueBenchmarkResult(runQueueBenchmark(1 << 22, 20000));
+		}
+		if (options.pacingBenchmark)
+		{
+			report += formatFramePacingResults(runFramePacingBenchmark(600));
+		}
+		if (options.idleBenchmark)
+		{
+			report += formatIdleLoopResults(runIdleLoopBenchmark(1000));
+		}
+		if (options.dynamicResolutionBenchmark || !options.dynamicResolutionTracePath.empty())
+		{
+			report += formatDynamicResolutionResults(runDynamicResolutionBenchmark(options.dynamicResolutionTracePath, options.dynamicResolutionMs));
+		}
+		if (options.tessellationBudgetCheck)
+		{
+			report += formatTessellationBudgetResult(runTessellationBudgetCheck(model));
+		}
+		if (options.lodCheck)
+		{
+			report += formatLodCheckResult(runLodCheck(model, options.width, options.height));
+		}
+		if (options.simplifyBenchmark)
+		{
+			report += formatSimplifyBenchmarkResults(runSimplifyBenchmark(model, options.jobThreads));
+		}
+		if (options.adaptiveBenchmark)
+		{
+			report += formatAdaptiveBenchmarkResults(runAdaptiveTessellationBenchmark(model, options.width, options.height));
+		}
+		if (options.evaluatorBenchmark)
+		{
+			report += formatEvaluatorBenchmarkResults(runEvaluatorBenchmark(model));
+		}
+		if (options.normalCheck)
+		{
+			report += formatNormalCheckResult(runNormalCheck(model));
+		}
+		if (options.kernelBenchmark)
+		{
+			report += formatKernelBenchmarkResults(runKernelBenchmark(model));
+		}
+		if (options.weightCacheBenchmark)
+		{
+			report += formatWeightCacheBenchmarkResults(runWeightCacheBenchmark(model));
+		}
+		if (options.parallelTessellationBenchmark)
+		{
+			report += formatParallelTessellationBenchmarkResults(runParallelTessellationBenchmark(model, options.jobThreads));
+		}
+		if (!options.goldenPath.empty())
+		{
+			report += formatGoldenImageResult(runGoldenImageCheck(model, options.goldenPath, options.goldenUpdate));
+		}
+		if (options.parseBenchmark)
+		{
+			report += formatParseBenchmarkResult(runParseBenchmark("parse-bench.bpt", options.parseBenchmarkMegabytes));
+		}
+		if (options.assetBenchmark)
+		{
+			report += formatAssetStreamBenchmarkResult(runAssetStreamBenchmark("asset-bench.astm", options.assetBenchmarkMegabytes, options.jobThreads));
+		}
+		if (options.inputBenchmark)
+		{
+			report += formatInputLatchResult(runInputLatchBenchmark(model, 250));
+		}
+		if (options.flightBenchmark)
+		{
+			char text[64];
+			snprintf(text, sizeof(text), "flight record ns: %.2f\n", measureFlightRecordCost("flight-bench.rec", 1 << 22));
+			report += text;
+		}
+		return report;
+	}
+}
\ No newline at end of file
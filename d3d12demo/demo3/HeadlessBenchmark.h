@@ -0,0 +1,286 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DynamicResolution.h"
+#include "FramePacer.h"
+#include "PatchModel.h"
+
+struct HeadlessOptions
+{
+	uint32_t frames{ 1000 };
+	uint32_t warmupFrames{ 60 };
+	uint32_t bufferCount{ 3 };
+	int32_t width{ 800 };
+	int32_t height{ 600 };
+	// saves the command stream of the last measured frame
+	std::string capturePath;
+	// replays a saved command stream instead of rendering the model's frame
+	std::string replayPath;
+	// with replayPath, rasterizes the replayed frame to a PPM image
+	std::string imagePath;
+	bool streamBenchmark{ false };
+	// writes a Chrome trace of the measured frames, with simulated GPU timestamps
+	std::string tracePath;
+	bool traceOverhead{ false };
+	// dumps the metrics registry after the run, JSON or Prometheus text by extension
+	std::string metricsPath;
+	bool metricsBenchmark{ false };
+	// records every frame into a flight recorder file
+	std::string flightPath;
+	// decodes a flight recorder file instead of rendering
+	std::string flightDecodePath;
+	bool flightBenchmark{ false };
+	// fails the run if any measured frame reaches operator new
+	bool assertNoAllocation{ false };
+	// compares JobSystem::parallelFor with std::async from 1 to jobThreads threads
+	bool jobBenchmark{ false };
+	uint32_t jobThreads{ 64 };
+	// fence dependency wake-up latency and worker utilization against workers blocking on fences
+	bool fenceBenchmark{ false };
+	// order, tearing and latency of the input queue and snapshot triple buffer between two threads
+	bool queueBenchmark{ false };
+	// input to submit latency of the late latched MVP against sampling input at the start of the frame
+	bool inputBenchmark{ false };
+	// "latency" or "throughput" paces the measured frames with a FramePacer
+	std::string pacing;
+	// simulated CPU/GPU workloads under each pacing mode and queue depth
+	bool pacingBenchmark{ false };
+	// frames and wake ups of the render loop scheduler when busy, idle, minimized and occluded
+	bool idleBenchmark{ false };
+	// GPU budget in ms for dynamic resolution, which also gives the NullDevice a per pixel cost; 0 for none
+	uint32_t dynamicResolutionMs{ 0 };
+	// the dynamic resolution controller against synthetic frame time traces, and dynamicResolutionTracePath
+	bool dynamicResolutionBenchmark{ false };
+	std::string dynamicResolutionTracePath;
+	// triangles per frame the tessellation factor is lowered to fit, 0 for no limit
+	uint64_t triangleBudget{ 0 };
+	// the tessellation count model and budget controller against the reference tessellation
+	bool tessellationBudgetCheck{ false };
+	// draws LodChain levels instead of tessellating where detailed enough, zooming the camera out and back in
+	bool lod{ false };
+	// the LodChain levels against the tessellation and its selection over a zoom sweep
+	bool lodCheck{ false };
+	// quadric mesh simplification throughput and error, with one and with jobThreads threads
+	bool simplifyBenchmark{ false };
+	// adaptive tessellation triangle counts and error against uniform tessellation at the same error
+	bool adaptiveBenchmark{ false };
+	// forward differencing against Bernstein patch evaluation, throughput and error
+	bool evaluatorBenchmark{ false };
+	// analytic patch derivatives and normals against finite differences, and their cost
+	bool normalCheck{ false };
+	// compile time tessellation kernels for the common factors against the run time one
+	bool kernelBenchmark{ false };
+	// the Bernstein weight table cache: lookups across threads and evaluators with and without it
+	bool weightCacheBenchmark{ false };
+	// tessellation of 1k to 1M patches across instances, from one to jobThreads threads
+	bool parallelTessellationBenchmark{ false };
+	// writes the model as an asset stream instead of rendering
+	std::string writeAssetPath;
+	// writes a synthetic asset stream of assetBenchmarkMegabytes, then times decompressing it from one to
+	// jobThreads threads
+	bool assetBenchmark{ false };
+	uint64_t assetBenchmarkMegabytes{ 2048 };
+	// loadPatchModel against std::istream on a synthetic .bpt file of parseBenchmarkMegabytes
+	bool parseBenchmark{ false };
+	uint64_t parseBenchmarkMegabytes{ 128 };
+	// compares the software rasterized frame with the reference image at goldenPath, or writes it with goldenUpdate;
+	// golden/teapot.ppm is the built-in teapot's
+	std::string goldenPath;
+	bool goldenUpdate{ false };
+};
+
+struct HeadlessResult
+{
+	uint32_t frames;
+	double seconds;
+	uint64_t apiCalls;
+	uint64_t draws;
+	uint64_t allocations;
+	uint64_t allocatedBytes;
+	uint64_t frameTimeP50Ns;
+	uint64_t frameTimeP99Ns;
+	uint64_t frameTimeP999Ns;
+	// dynamic resolution scale after the last frame, 1 without it
+	float resolutionScale;
+	// of the last frame, shown with a triangle budget
+	uint64_t triangleBudget;
+	int tessFactor;
+	uint64_t trianglesPerFrame;
+	// frames that drew a LodChain level, shown with lod
+	bool lod;
+	uint32_t lodMeshFrames;
+
+	double getMillisecondsPerFrame() const;
+	double getApiCallsPerFrame() const;
+	double getAllocationsPerFrame() const;
+	double getAllocatedBytesPerFrame() const;
+};
+
+struct CommandStreamResult
+{
+	uint32_t frames;
+	uint64_t commands;
+	uint64_t bytes;
+	double encodeSeconds;
+	double decodeSeconds;
+
+	double getEncodeCommandsPerSecond() const;
+	double getDecodeCommandsPerSecond() const;
+	double getBytesPerCommand() const;
+};
+
+struct JobScalingResult
+{
+	uint32_t threads;
+	double jobSystemMs;
+	double asyncMs;
+};
+
+struct FenceBenchmarkResult
+{
+	uint32_t threads;
+	uint32_t signals;
+	uint64_t wakeLatencyP50Ns;
+	uint64_t wakeLatencyP99Ns;
+	uint64_t wakeLatencyMaxNs;
+	double waiterMs;
+	double waiterUtilization;
+	double blockingMs;
+	double blockingUtilization;
+};
+
+struct QueueBenchmarkResult
+{
+	uint32_t events;
+	double queueEventsPerSecond;
+	uint64_t queueLatencyP50Ns;
+	uint64_t queueLatencyP99Ns;
+	uint64_t queueLatencyMaxNs;
+	uint32_t snapshots;
+	uint32_t snapshotsRead;
+	uint64_t snapshotAgeP50Ns;
+	uint64_t snapshotAgeP99Ns;
+	uint64_t snapshotAgeMaxNs;
+};
+
+struct IdleLoopResult
+{
+	const char* scenario;
+	double framesPerSecond;
+	double occlusionTestsPerSecond;
+	// returns from LoopScheduler::wait
+	double wakeupsPerSecond;
+	// voluntary context switches of the loop thread, 0 where the platform does not count them per thread
+	double contextSwitchesPerSecond;
+	// CPU time of the loop thread over the run time
+	double cpuUtilization;
+};
+
+struct InputLatchResult
+{
+	uint32_t frames;
+	uint64_t events;
+	uint64_t latchedP50Ns;
+	uint64_t latchedP99Ns;
+	uint64_t frameStartP50Ns;
+	uint64_t frameStartP99Ns;
+};
+
+struct GoldenImageResult
+{
+	uint32_t width;
+	uint32_t height;
+	// pixels with a channel more than 2 levels off the reference
+	uint64_t differingPixels;
+	int maxDifference;
+	bool updated;
+};
+
+namespace teapot_tutorial
+{
+	// Runs the demo3 frame, recorded through a CommandStream, against a NullDevice with no window or GPU. The
+	// mouse sweeps the window so the camera math changes every frame; the warmup frames are rendered but not
+	// measured.
+	HeadlessResult runHeadlessBenchmark(const PatchModel& model, const HeadlessOptions& options);
+
+	// Encodes options.frames demo3 frames into one stream, then decodes it into a NullDevice.
+	CommandStreamResult runCommandStreamBenchmark(const PatchModel& model, const HeadlessOptions& options);
+
+	// Decodes options.replayPath options.frames times into a NullDevice and optionally rasterizes it once.
+	CommandStreamResult runReplayBenchmark(const PatchModel& model, const HeadlessOptions& options);
+
+	// average cost of one empty TRACE_SCOPE with tracing enabled or disabled
+	double measureTraceScopeCost(bool enabled, uint32_t scopes);
+
+	// average cost of one Histogram::record with threadCount threads recording into the same histogram
+	double measureHistogramRecordCost(uint32_t threadCount, uint32_t records);
+
+	// average cost of one FlightRecorder::recordFrame into a ring file at path, which is removed afterwards
+	double measureFlightRecordCost(std::string path, uint32_t records);
+
+	// Tessellates 8 copies of every patch at factor 32 per iteration, split into one job per patch copy with the
+	// job system and into one contiguous chunk per thread with std::async; thread counts double from 1 to
+	// maxThreads.
+	std::vector<JobScalingResult> runJobScalingBenchmark(const PatchModel& model, uint32_t maxThreads, uint32_t iterations);
+
+	// A simulated GPU queue signals a fence every 250 us while jobs that depend on each value compete with CPU
+	// work filling the workers. Runs once with FenceWaiter dependencies and once with the jobs sleeping in
+	// SimulatedFence::waitBlocking; threadCount 0 uses every hardware thread.
+	FenceBenchmarkResult runFenceBenchmark(uint32_t threadCount, uint32_t signals);
+
+	// Streams events through an InputQueue from a producer to a consumer thread, first as fast as they go and then
+	// paced, checking every event arrives once and in order; then publishes snapshots through a TripleBuffer to
+	// a spinning reader that checks none is torn or older than the one before. Throws on a violation.
+	QueueBenchmarkResult runQueueBenchmark(uint32_t events, uint32_t snapshots);
+
+	// Checks InputSystem latching against a synthetic event stream, then renders frames twice while a thread
+	// moves the mouse at 1 kHz: once late latching the MVP and once sampling input at the start of the frame.
+	// Recording costs 1 ms and frames are paced to 4 ms, standing in for a heavier scene at a high refresh rate.
+	InputLatchResult runInputLatchBenchmark(const PatchModel& model, uint32_t frames);
+
+	// Rasterizes the model's frame wireframe and solid, at the default distance and zoomed in far enough to clip,
+	// into one image and compares it with the reference at path, or writes the reference when update is set.
+	// Throws when more than 1 in 1000 pixels differ by more than a few levels from the reference.
+	GoldenImageResult runGoldenImageCheck(const PatchModel& model, const std::string& path, bool update);
+
+	// Simulates GPU bound, CPU bound and balanced workloads with every pacing mode and queue depth from 1 to 3.
+	// Throws unless the runs are deterministic, never exceed their queue depth and low latency pacing beats
+	// throughput pacing at the same depth on latency.
+	std::vector<FramePacingResult> runFramePacingBenchmark(uint32_t frames);
+
+	// Runs a render loop driven by a LoopScheduler for milliseconds per scenario: continuous, on demand with
+	// input at 100 Hz, idle with and without an idle tick, minimized and occluded. A frame sleeps 1 ms like a
+	// present waiting for vblank. Throws when a scenario draws or wakes up more often than its policy allows.
+	std::vector<IdleLoopResult> runIdleLoopBenchmark(uint32_t milliseconds);
+
+	// Replays synthetic GPU frame time traces (light, a tessellation spike, noisy, overload) through the dynamic
+	// resolution controller, plus the trace at tracePath if not empty, with the budget of budgetMs or 60 Hz.
+	// Throws unless light load keeps full resolution, the spike is brought back within budget and recovered
+	// from, the scale does not oscillate under noise and overload ends at the minimum scale.
+	std::vector<DynamicResolutionResult> runDynamicResolutionBenchmark(const std::string& tracePath, uint32_t budgetMs);
+
+	std::string formatHeadlessResult(const HeadlessResult& result);
+	std::string formatCommandStreamResult(const CommandStreamResult& result);
+	std::string formatJobScalingResults(const std::vector<JobScalingResult>& results);
+	std::string formatFenceBenchmarkResult(const FenceBenchmarkResult& result);
+	std::string formatQueueBenchmarkResult(const QueueBenchmarkResult& result);
+	std::string formatInputLatchResult(const InputLatchResult& result);
+	std::string formatIdleLoopResults(const std::vector<IdleLoopResult>& results);
+	std::string formatGoldenImageResult(const GoldenImageResult& result);
+
+	// "--frames N", "--warmup N", "--buffers N", "--size WxH", "--capture path", "--replay path",
+	// "--image path", "--stream", "--trace path", "--trace-overhead", "--metrics path", "--metrics-bench",
+	// "--flight path", "--flight-decode path", "--flight-bench", "--assert-no-alloc", "--jobs-bench",
+	// "--job-threads N", "--fence-bench", "--queue-bench", "--input-bench", "--pacing latency|throughput",
+	// "--pacing-bench", "--idle-bench", "--dynres ms", "--dynres-bench", "--dynres-trace path", "--tri-budget n",
+	// "--tess-budget-check", "--lod", "--lod-check", "--simplify-bench", "--adaptive-bench",
+	// "--evaluator-bench", "--normals-check", "--kernel-bench", "--weight-cache-bench", "--parallel-tess-bench",
+	// "--write-astm path", "--asset-bench", "--asset-size MB",
+	// "--parse-bench", "--parse-size MB", "--golden path", "--golden-update" and an optional model path
+	void parseHeadlessArguments(const std::vector<std::string>& args, HeadlessOptions& options, std::string& modelPath);
+
+	// parses args, runs the selected benchmarks and returns the report
+	std::string runHeadless(const std::vector<std::string>& args);
+}
\ No newline at end of file
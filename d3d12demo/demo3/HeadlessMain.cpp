@@ -0,0 +1,31 @@
+#if !defined(_WIN32)
+
+// Entry point for the headless benchmark outside Windows. Every source except the D3D12/Win32 ones builds:
+// g++ -std=c++14 -O2 -pthread -o headless $(ls *.cpp | grep -vxE 'Main.cpp|Graphics.cpp|Window.cpp|Demo.cpp|D3D12Backend.cpp')
+// On Windows the same run is "demo3.exe --headless [arguments]".
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "HeadlessBenchmark.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		vector<string> args(argv + 1, argv + argc);
+		fputs(teapot_tutorial::runHeadless(args).c_str(), stdout);
+	}
+	catch (runtime_error& err)
+	{
+		fprintf(stderr, "Error: %s\n", err.what());
+		return 1;
+	}
+
+	return 0;
+}
+
+#endif
\ No newline at end of file
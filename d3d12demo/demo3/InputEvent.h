@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include "SpscQueue.h"
+
+enum class InputEventType : uint32_t
+{
+	KeyDown,
+	MouseMove,
+	Resize
+};
+
+// A window message reduced to what the simulation uses. key is the virtual key code of KeyDown; x and y are the
+// client area cursor position of MouseMove and the client area size of Resize.
+struct InputEvent
+{
+	InputEventType type;
+	uint32_t key;
+	int32_t x;
+	int32_t y;
+	// Tracer::now() when the window received the message
+	uint64_t timeNs;
+};
+
+// filled by Window::WndProc on the message pump thread
+typedef SpscQueue<InputEvent, 1024> InputQueue;
\ No newline at end of file
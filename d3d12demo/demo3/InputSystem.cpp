@@ -0,0 +1,52 @@
+#include "InputSystem.h"
+
+using namespace std;
+
+InputSystem::InputSystem(int32_t width, int32_t height)
+{
+	state = InputState{ 0, 0, width, height, 0, 0 };
+}
+
+void InputSystem::push(const InputEvent& event)
+{
+	if (!events.push(event))
+	{
+		droppedEvents.fetch_add(1, memory_order_relaxed);
+	}
+}
+
+const InputState& InputSystem::latch(uint32_t& latchedEvents)
+{
+	latchedEvents = 0;
+	InputEvent event;
+	while (events.pop(event))
+	{
+		switch (event.type)
+		{
+		case InputEventType::MouseMove:
+			state.mouseX = event.x;
+			state.mouseY = event.y;
+			break;
+		case InputEventType::Resize:
+			state.width = event.x;
+			state.height = event.y;
+			break;
+		case InputEventType::KeyDown:
+			break;
+		}
+		state.timeNs = event.timeNs;
+		++latchedEvents;
+	}
+	state.eventCount += latchedEvents;
+	return state;
+}
+
+const InputState& InputSystem::getState() const
+{
+	return state;
+}
+
+uint64_t InputSystem::getDroppedCount() const
+{
+	return droppedEvents.load(memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "InputEvent.h"
+
+// pointer and window state as of the newest event latched
+struct InputState
+{
+	int32_t mouseX;
+	int32_t mouseY;
+	int32_t width;
+	int32_t height;
+	// Tracer::now() of the newest event latched, 0 before the first
+	uint64_t timeNs;
+	// events latched so far
+	uint64_t eventCount;
+};
+
+// Timestamped raw input from the window thread, applied on the render thread as late as possible. The window
+// thread pushes every event into a lock free ring; latch() drains it right before the state is used, e.g.
+// before the MVP constant is written, so a frame sees input that arrived while it was being recorded.
+class InputSystem
+{
+public:
+	InputSystem(int32_t width, int32_t height);
+
+	InputSystem(const InputSystem&) = delete;
+	InputSystem& operator=(const InputSystem&) = delete;
+
+	// producer thread only; counts the event as dropped when the ring is full
+	void push(const InputEvent& event);
+
+	// Consumer thread only: applies the events pushed so far and returns the state they leave. latchedEvents
+	// gets how many were applied.
+	const InputState& latch(uint32_t& latchedEvents);
+	// consumer thread only, the state of the last latch
+	const InputState& getState() const;
+
+	uint64_t getDroppedCount() const;
+
+private:
+	InputQueue events;
+	InputState state;
+	std::atomic<uint64_t> droppedEvents{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,626 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "Trace.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+using namespace details;
+
+namespace
+{
+	struct CpuInfo
+	{
+		uint32_t cpu;
+		uint32_t node;
+		uint32_t core;
+		uint32_t smtIndex;
+	};
+
+	void lockCounter(atomic_flag& lock)
+	{
+		while (lock.test_and_set(memory_order_acquire))
+		{
+			this_thread::yield();
+		}
+	}
+
+	uint32_t nextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+#if defined(_WIN32)
+
+	// processor group 0 only, which covers every machine with at most 64 logical processors
+	vector<CpuInfo> getCpuTopology()
+	{
+		DWORD length{ 0 };
+		GetLogicalProcessorInformation(nullptr, &length);
+		vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> information(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+		if (information.empty() || !GetLogicalProcessorInformation(information.data(), &length))
+		{
+			return{};
+		}
+
+		vector<CpuInfo> cpus;
+		uint32_t core{ 0 };
+		for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& entry : information)
+		{
+			if (entry.Relationship != RelationProcessorCore)
+			{
+				continue;
+			}
+
+			uint32_t smtIndex{ 0 };
+			for (uint32_t cpu = 0; cpu < sizeof(ULONG_PTR) * 8; ++cpu)
+			{
+				if ((entry.ProcessorMask >> cpu) & 1)
+				{
+					cpus.push_back({ cpu, 0, core, smtIndex++ });
+				}
+			}
+			++core;
+		}
+
+		for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& entry : information)
+		{
+			if (entry.Relationship != RelationNumaNode)
+			{
+				continue;
+			}
+
+			for (CpuInfo& info : cpus)
+			{
+				if ((entry.ProcessorMask >> info.cpu) & 1)
+				{
+					info.node = entry.NumaNode.NodeNumber;
+				}
+			}
+		}
+
+		return cpus;
+	}
+
+	void pinThread(thread& t, uint32_t cpu)
+	{
+		SetThreadAffinityMask(t.native_handle(), static_cast<DWORD_PTR>(1) << cpu);
+	}
+
+#else
+
+	bool readValue(const string& path, uint32_t& value)
+	{
+		ifstream file{ path };
+		return static_cast<bool>(file >> value);
+	}
+
+	// "0-3,8-11"
+	vector<uint32_t> parseCpuList(const string& list)
+	{
+		vector<uint32_t> cpus;
+		istringstream stream{ list };
+		string range;
+		while (getline(stream, range, ','))
+		{
+			uint32_t first{ 0 };
+			uint32_t last{ 0 };
+			char dash{ 0 };
+			istringstream rangeStream{ range };
+			if (!(rangeStream >> first))
+			{
+				continue;
+			}
+			last = rangeStream >> dash >> last && dash == '-' ? last : first;
+			for (uint32_t cpu = first; cpu <= last; ++cpu)
+			{
+				cpus.push_back(cpu);
+			}
+		}
+		return cpus;
+	}
+
+	// sysfs topology of the CPUs this process may run on
+	vector<CpuInfo> getCpuTopology()
+	{
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+		{
+			return{};
+		}
+
+		vector<uint32_t> nodes(CPU_SETSIZE, 0);
+		for (uint32_t node = 0;; ++node)
+		{
+			ifstream file{ "/sys/devices/system/node/node" + to_string(node) + "/cpulist" };
+			string list;
+			if (!getline(file, list))
+			{
+				break;
+			}
+			for (uint32_t cpu : parseCpuList(list))
+			{
+				if (cpu < CPU_SETSIZE)
+				{
+					nodes[cpu] = node;
+				}
+			}
+		}
+
+		// a core is identified by package and core id together, core ids repeat across packages
+		vector<CpuInfo> cpus;
+		vector<pair<uint64_t, uint32_t>> coreSiblings;
+		for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+		{
+			if (!CPU_ISSET(cpu, &allowed))
+			{
+				continue;
+			}
+
+			string topology{ "/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/" };
+			uint32_t package{ 0 };
+			uint32_t coreId{ cpu };
+			readValue(topology + "physical_package_id", package);
+			readValue(topology + "core_id", coreId);
+
+			uint64_t key{ (static_cast<uint64_t>(package) << 32) | coreId };
+			auto sibling = find_if(coreSiblings.begin(), coreSiblings.end(), [key](const pair<uint64_t, uint32_t>& s) { return s.first == key; });
+			if (sibling == coreSiblings.end())
+			{
+				coreSiblings.push_back({ key, 0 });
+				sibling = coreSiblings.end() - 1;
+			}
+
+			cpus.push_back({ cpu, nodes[cpu], static_cast<uint32_t>(sibling - coreSiblings.begin()), sibling->second++ });
+		}
+
+		return cpus;
+	}
+
+	void pinThread(thread& t, uint32_t cpu)
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+	}
+
+#endif
+}
+
+JobPool::JobPool(uint32_t size) : jobs{ new Job[size] }
+{
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		jobs[i].pool = this;
+		jobs[i].next = i + 1 < size ? &jobs[i + 1] : nullptr;
+	}
+	freeJobs = &jobs[0];
+}
+
+Job* JobPool::allocate()
+{
+	if (freeJobs == nullptr)
+	{
+		freeJobs = returnedJobs.exchange(nullptr, memory_order_acquire);
+		if (freeJobs == nullptr)
+		{
+			return nullptr;
+		}
+	}
+
+	Job* job{ freeJobs };
+	freeJobs = job->next;
+	return job;
+}
+
+void JobPool::release(Job* job)
+{
+	Job* head{ returnedJobs.load(memory_order_relaxed) };
+	do
+	{
+		job->next = head;
+	} while (!returnedJobs.compare_exchange_weak(head, job, memory_order_release, memory_order_relaxed));
+}
+
+bool JobCounter::isDone() const
+{
+	return value.load(memory_order_acquire) == 0;
+}
+
+WorkStealingDeque::WorkStealingDeque() : jobs{ new atomic<Job*>[capacity] }
+{
+}
+
+bool WorkStealingDeque::push(Job* job)
+{
+	int64_t b{ bottom.load(memory_order_relaxed) };
+	int64_t t{ top.load(memory_order_acquire) };
+	if (b - t >= static_cast<int64_t>(capacity))
+	{
+		return false;
+	}
+
+	jobs[b & (capacity - 1)].store(job, memory_order_relaxed);
+	// a release store rather than the paper's release fence, which publishes the job the same way
+	bottom.store(b + 1, memory_order_release);
+	return true;
+}
+
+Job* WorkStealingDeque::pop()
+{
+	int64_t b{ bottom.load(memory_order_relaxed) - 1 };
+	bottom.store(b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t t{ top.load(memory_order_relaxed) };
+
+	if (t > b)
+	{
+		bottom.store(b + 1, memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job{ jobs[b & (capacity - 1)].load(memory_order_relaxed) };
+	if (t == b)
+	{
+		// the last job, race the thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+		{
+			job = nullptr;
+		}
+		bottom.store(b + 1, memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* WorkStealingDeque::steal()
+{
+	int64_t t{ top.load(memory_order_acquire) };
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t b{ bottom.load(memory_order_acquire) };
+	if (t >= b)
+	{
+		return nullptr;
+	}
+
+	Job* job{ jobs[t & (capacity - 1)].load(memory_order_relaxed) };
+	if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+	{
+		return nullptr;
+	}
+	return job;
+}
+
+bool WorkStealingDeque::isEmpty() const
+{
+	return bottom.load(memory_order_relaxed) <= top.load(memory_order_relaxed);
+}
+
+thread_local JobSystem* JobSystem::currentSystem{ nullptr };
+thread_local JobSystem::Worker* JobSystem::currentWorker{ nullptr };
+
+JobSystem::JobSystem(unsigned threadCount, bool pinThreads) : threadCount{ threadCount == 0 ? max(thread::hardware_concurrency(), 1u) : threadCount },
+	previousSystem{ currentSystem }, previousWorker{ currentWorker }
+{
+	for (unsigned i = 0; i < this->threadCount; ++i)
+	{
+		unique_ptr<Worker> worker{ new Worker };
+		worker->random = i * 2654435761u + 1;
+		workers.push_back(move(worker));
+	}
+
+	currentSystem = this;
+	currentWorker = workers[0].get();
+
+	vector<uint32_t> pinningOrder;
+	if (pinThreads)
+	{
+		pinningOrder = getPinningOrder();
+	}
+
+	// worker 0 is the caller's thread and keeps its affinity, but the first processor stays reserved for it
+	for (unsigned i = 1; i < this->threadCount; ++i)
+	{
+		workers[i]->thread = thread{ &JobSystem::workerLoop, this, i };
+		if (!pinningOrder.empty())
+		{
+			pinThread(workers[i]->thread, pinningOrder[i % pinningOrder.size()]);
+		}
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		lock_guard<mutex> lock{ sleepMutex };
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (unsigned i = 1; i < threadCount; ++i)
+	{
+		workers[i]->thread.join();
+	}
+
+	currentSystem = previousSystem;
+	currentWorker = previousWorker;
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	Worker* worker{ getWorker() };
+	while (counter.value.load(memory_order_acquire) != 0)
+	{
+		Job* job{ findJob(worker) };
+		if (job != nullptr)
+		{
+			execute(job);
+		}
+		else
+		{
+			this_thread::yield();
+		}
+	}
+
+	// the thread that made the value zero may still hold the lock
+	lockCounter(counter.lock);
+	counter.lock.clear(memory_order_release);
+}
+
+void JobSystem::addPending(JobCounter& counter)
+{
+	counter.value.fetch_add(1, memory_order_relaxed);
+}
+
+void JobSystem::completePending(JobCounter& counter)
+{
+	finishJob(counter);
+}
+
+unsigned JobSystem::getThreadCount() const
+{
+	return threadCount;
+}
+
+vector<uint32_t> JobSystem::getPinningOrder()
+{
+	vector<CpuInfo> cpus{ getCpuTopology() };
+
+	// one processor per physical core, node by node, then the hyperthread siblings in the same order
+	sort(cpus.begin(), cpus.end(), [](const CpuInfo& a, const CpuInfo& b)
+	{
+		if (a.smtIndex != b.smtIndex)
+		{
+			return a.smtIndex < b.smtIndex;
+		}
+		if (a.node != b.node)
+		{
+			return a.node < b.node;
+		}
+		return a.cpu < b.cpu;
+	});
+
+	vector<uint32_t> order;
+	for (const CpuInfo& info : cpus)
+	{
+		order.push_back(info.cpu);
+	}
+	return order;
+}
+
+JobSystem::Worker* JobSystem::getWorker() const
+{
+	return currentSystem == this ? currentWorker : nullptr;
+}
+
+Job* JobSystem::allocateJob()
+{
+	Worker* worker{ getWorker() };
+	if (worker != nullptr)
+	{
+		return worker->jobPool.allocate();
+	}
+
+	lock_guard<mutex> lock{ externalMutex };
+	return externalJobPool.allocate();
+}
+
+void JobSystem::submit(Job* job)
+{
+	Worker* worker{ getWorker() };
+	if (worker != nullptr)
+	{
+		if (!worker->deque.push(job))
+		{
+			// the deque is full, which only deep recursion reaches; running it here keeps progress
+			execute(job);
+			return;
+		}
+	}
+	else
+	{
+		lock_guard<mutex> lock{ externalMutex };
+		externalJobs.push_back(job);
+		externalJobCount.fetch_add(1, memory_order_relaxed);
+	}
+
+	wakeWorkers();
+}
+
+bool JobSystem::addContinuation(JobCounter& dependency, Job* job)
+{
+	lockCounter(dependency.lock);
+	bool waiting{ dependency.value.load(memory_order_acquire) != 0 };
+	if (waiting)
+	{
+		job->next = dependency.continuations;
+		dependency.continuations = job;
+	}
+	dependency.lock.clear(memory_order_release);
+	return waiting;
+}
+
+void JobSystem::execute(Job* job)
+{
+	JobCounter& counter{ *job->counter };
+	job->invoke(*job);
+	job->pool->release(job);
+	finishJob(counter);
+}
+
+void JobSystem::finishJob(JobCounter& counter)
+{
+	uint32_t value{ counter.value.load(memory_order_relaxed) };
+	while (value > 1)
+	{
+		if (counter.value.compare_exchange_weak(value, value - 1, memory_order_acq_rel, memory_order_relaxed))
+		{
+			return;
+		}
+	}
+
+	// Probably the last job. The final decrement happens under the lock, which wait() takes once the value is
+	// zero, so the counter is not destroyed while the continuations are taken out of it.
+	lockCounter(counter.lock);
+	Job* job{ nullptr };
+	if (counter.value.fetch_sub(1, memory_order_acq_rel) == 1)
+	{
+		job = counter.continuations;
+		counter.continuations = nullptr;
+	}
+	counter.lock.clear(memory_order_release);
+
+	while (job != nullptr)
+	{
+		Job* next{ job->next };
+		submit(job);
+		job = next;
+	}
+}
+
+Job* JobSystem::findJob(Worker* worker)
+{
+	if (worker != nullptr)
+	{
+		Job* job{ worker->deque.pop() };
+		if (job != nullptr)
+		{
+			return job;
+		}
+	}
+
+	if (externalJobCount.load(memory_order_relaxed) != 0)
+	{
+		lock_guard<mutex> lock{ externalMutex };
+		if (!externalJobs.empty())
+		{
+			Job* job{ externalJobs.back() };
+			externalJobs.pop_back();
+			externalJobCount.fetch_sub(1, memory_order_relaxed);
+			return job;
+		}
+	}
+
+	uint32_t random{ worker != nullptr ? nextRandom(worker->random) : 0 };
+	for (unsigned i = 0; i < threadCount; ++i)
+	{
+		Worker& victim{ *workers[(random + i) % threadCount] };
+		if (&victim != worker)
+		{
+			Job* job{ victim.deque.steal() };
+			if (job != nullptr)
+			{
+				return job;
+			}
+		}
+	}
+	return nullptr;
+}
+
+bool JobSystem::hasQueuedJobs() const
+{
+	if (externalJobCount.load(memory_order_relaxed) != 0)
+	{
+		return true;
+	}
+	for (const unique_ptr<Worker>& worker : workers)
+	{
+		if (!worker->deque.isEmpty())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::wakeWorkers()
+{
+	// pairs with the fence in workerLoop: either the sleeper sees the new job or we see the sleeper
+	atomic_thread_fence(memory_order_seq_cst);
+	if (sleepingWorkers.load(memory_order_relaxed) != 0)
+	{
+		lock_guard<mutex> lock{ sleepMutex };
+		wakeCondition.notify_one();
+	}
+}
+
+void JobSystem::workerLoop(unsigned index)
+{
+	currentSystem = this;
+	currentWorker = workers[index].get();
+	if (Tracer::isEnabled())
+	{
+		Tracer::setThreadName("job worker");
+	}
+
+	const uint32_t spinsBeforeSleep{ 64 };
+	uint32_t idleSpins{ 0 };
+	for (;;)
+	{
+		Job* job{ findJob(currentWorker) };
+		if (job != nullptr)
+		{
+			execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < spinsBeforeSleep)
+		{
+			this_thread::yield();
+			continue;
+		}
+
+		sleepingWorkers.fetch_add(1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		bool stop;
+		{
+			unique_lock<mutex> lock{ sleepMutex };
+			while (!stopping && !hasQueuedJobs())
+			{
+				wakeCondition.wait(lock);
+			}
+			stop = stopping;
+		}
+		sleepingWorkers.fetch_sub(1, memory_order_relaxed);
+		idleSpins = 0;
+
+		if (stop)
+		{
+			return;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class JobSystem;
+
+namespace details
+{
+	struct Job;
+	class JobPool;
+}
+
+// Number of unfinished jobs started with it. A counter can be waited on, also from inside a job, or be the
+// dependency of jobs that are only queued once it drops to zero.
+class JobCounter
+{
+public:
+	JobCounter() = default;
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	// a hint only, destroying the counter is safe after JobSystem::wait
+	bool isDone() const;
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> value{ 0 };
+	// guards continuations, jobs waiting for value to reach zero
+	std::atomic_flag lock = ATOMIC_FLAG_INIT;
+	details::Job* continuations{ nullptr };
+};
+
+namespace details
+{
+	// A callable stored inline, so starting a job never allocates. Jobs come from the pool of the thread that
+	// starts them and go back to it from whichever thread ran them.
+	struct Job
+	{
+		static const size_t storageSize{ 96 };
+
+		// calls and destroys the stored callable
+		void(*invoke)(Job& job);
+		JobCounter* counter;
+		JobPool* pool;
+		Job* next;
+		std::aligned_storage<storageSize, alignof(void*)>::type storage;
+	};
+
+	// Fixed set of jobs allocated by one thread at a time. Any thread returns jobs to a lock free stack that the
+	// allocating thread takes over whole once its private free list runs dry, so there is no ABA problem.
+	class JobPool
+	{
+	public:
+		JobPool(uint32_t size);
+
+		JobPool(const JobPool&) = delete;
+		JobPool& operator=(const JobPool&) = delete;
+
+		// null when every job is in flight
+		Job* allocate();
+		void release(Job* job);
+
+	private:
+		std::unique_ptr<Job[]> jobs;
+		Job* freeJobs{ nullptr };
+		std::atomic<Job*> returnedJobs{ nullptr };
+	};
+
+	template <typename Function>
+	void invokeJob(Job& job)
+	{
+		Function& function{ *reinterpret_cast<Function*>(&job.storage) };
+		function();
+		function.~Function();
+	}
+
+	// Chase-Lev work stealing deque of fixed capacity (the C11 formulation of Le, Pop, Cohen and Zappa Nardelli).
+	// The owner pushes and pops at the bottom, other workers steal from the top.
+	class WorkStealingDeque
+	{
+	public:
+		static const uint32_t capacity{ 4096 };
+
+		WorkStealingDeque();
+
+		// false when full
+		bool push(Job* job);
+		Job* pop();
+		Job* steal();
+		bool isEmpty() const;
+
+	private:
+		// top and bottom on their own cache lines, the owner and the thieves write different ones
+		std::atomic<int64_t> top{ 0 };
+		char topPadding[64 - sizeof(std::atomic<int64_t>)];
+		std::atomic<int64_t> bottom{ 0 };
+		char bottomPadding[64 - sizeof(std::atomic<int64_t>)];
+		std::unique_ptr<std::atomic<Job*>[]> jobs;
+	};
+}
+
+// Work stealing job system. The constructing thread is worker 0 and runs jobs while it waits; threadCount - 1
+// more workers are started and, optionally, pinned one per physical core, filling a NUMA node before the next
+// and using hyperthread siblings last. Threads that are not workers can also start and wait on jobs, through
+// a locked queue.
+class JobSystem
+{
+public:
+	static const uint32_t jobPoolSize{ 1024 };
+
+	// threadCount 0 uses std::thread::hardware_concurrency()
+	JobSystem(unsigned threadCount = 0, bool pinThreads = true);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// runs function inline instead when the calling thread has jobPoolSize jobs in flight
+	template <typename Function>
+	void run(JobCounter& counter, Function&& function)
+	{
+		details::Job* job{ createJob(counter, std::forward<Function>(function)) };
+		if (job == nullptr)
+		{
+			function();
+			return;
+		}
+		submit(job);
+	}
+
+	// queues the job once dependency has dropped to zero
+	template <typename Function>
+	void runAfter(JobCounter& dependency, JobCounter& counter, Function&& function)
+	{
+		details::Job* job{ createJob(counter, std::forward<Function>(function)) };
+		if (job == nullptr)
+		{
+			wait(dependency);
+			function();
+			return;
+		}
+		if (!addContinuation(dependency, job))
+		{
+			submit(job);
+		}
+	}
+
+	// runs other jobs until counter drops to zero; afterwards the counter may be destroyed or reused
+	void wait(JobCounter& counter);
+
+	// Counts work that is not a job, e.g. GPU work, in counter; completePending from any thread releases the
+	// jobs waiting on it like a finished job would.
+	void addPending(JobCounter& counter);
+	void completePending(JobCounter& counter);
+
+	// Calls function(rangeBegin, rangeEnd) over [begin, end) in pieces of at most grainSize, splitting the range
+	// in halves so idle workers steal large pieces first. Returns when every piece has run.
+	template <typename Function>
+	void parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const Function& function)
+	{
+		JobCounter counter;
+		splitRange(counter, begin, end, grainSize == 0 ? 1 : grainSize, function);
+		wait(counter);
+	}
+
+	unsigned getThreadCount() const;
+
+	// logical processors in the order workers are pinned to them
+	static std::vector<uint32_t> getPinningOrder();
+
+private:
+	struct Worker
+	{
+		details::WorkStealingDeque deque;
+		details::JobPool jobPool{ jobPoolSize };
+		uint32_t random;
+		std::thread thread;
+	};
+
+	template <typename Function>
+	details::Job* createJob(JobCounter& counter, Function&& function)
+	{
+		typedef typename std::decay<Function>::type Stored;
+		static_assert(sizeof(Stored) <= details::Job::storageSize, "Job captures too much, capture by reference.");
+		static_assert(alignof(Stored) <= alignof(void*), "Job callable is over-aligned.");
+
+		details::Job* job{ allocateJob() };
+		if (job == nullptr)
+		{
+			return nullptr;
+		}
+		new (&job->storage) Stored(std::forward<Function>(function));
+		job->invoke = &details::invokeJob<Stored>;
+		job->counter = &counter;
+		job->next = nullptr;
+		counter.value.fetch_add(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	template <typename Function>
+	void splitRange(JobCounter& counter, uint32_t begin, uint32_t end, uint32_t grainSize, const Function& function)
+	{
+		while (end - begin > grainSize)
+		{
+			uint32_t middle{ begin + (end - begin) / 2 };
+			const Function* f{ &function };
+			run(counter, [this, &counter, middle, end, grainSize, f]() { splitRange(counter, middle, end, grainSize, *f); });
+			end = middle;
+		}
+		if (begin < end)
+		{
+			function(begin, end);
+		}
+	}
+
+	Worker* getWorker() const;
+	details::Job* allocateJob();
+	void submit(details::Job* job);
+	bool addContinuation(JobCounter& dependency, details::Job* job);
+	void execute(details::Job* job);
+	void finishJob(JobCounter& counter);
+	details::Job* findJob(Worker* worker);
+	bool hasQueuedJobs() const;
+	void wakeWorkers();
+	void workerLoop(unsigned index);
+
+private:
+	unsigned threadCount;
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	// jobs started by threads that are not workers
+	std::mutex externalMutex;
+	std::vector<details::Job*> externalJobs;
+	std::atomic<uint32_t> externalJobCount{ 0 };
+	details::JobPool externalJobPool{ jobPoolSize };
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeCondition;
+	std::atomic<uint32_t> sleepingWorkers{ 0 };
+	bool stopping{ false };
+
+	// what the constructing thread was a worker of before, restored on destruction
+	JobSystem* previousSystem;
+	Worker* previousWorker;
+
+	static thread_local JobSystem* currentSystem;
+	static thread_local Worker* currentWorker;
+};
\ No newline at end of file
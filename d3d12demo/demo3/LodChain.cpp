@@ -0,0 +1,298 @@
+#include "LodChain.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <stdexcept>
+#include "PatchTessellator.h"
+#include "SoftwareRasterizer.h"
+#include "TessellationBudget.h"
+
+using namespace std;
+
+LodChain::LodChain(const PatchModel& model, const vector<int>& factors) : patchCount{ model.getPatchCount() }
+{
+	if (factors.empty() || patchCount == 0)
+	{
+		throw(runtime_error{ "LOD chain needs factors and patches." });
+	}
+
+	TessellatedMesh mesh;
+	for (int factor : factors)
+	{
+		if (factor != teapot_tutorial::clampTessFactor(factor) || (!levels.empty() && factor <= levels.back().factor))
+		{
+			throw(runtime_error{ "LOD factors must increase within the tessellation factor range." });
+		}
+
+		teapot_tutorial::tessellate(model, factor, mesh);
+		LodLevel level{ factor, static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(mesh.indices.size()),
+			static_cast<int32_t>(vertices.size()), static_cast<uint32_t>(mesh.positions.size()) };
+		for (size_t i = 0; i < mesh.positions.size(); ++i)
+		{
+			vertices.push_back({ mesh.positions[i], mesh.colors[i] });
+		}
+		indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+		levels.push_back(level);
+	}
+
+	// the finest level is closest to the surface; its bounds stand in for the model's
+	const LodLevel& finest{ levels.back() };
+	const LodVertex* finestVertices{ vertices.data() + finest.baseVertex };
+	Float3 low{ FLT_MAX, FLT_MAX, FLT_MAX };
+	Float3 high{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t i = 0; i < finest.vertexCount; ++i)
+	{
+		const Float3& p{ finestVertices[i].position };
+		low = Float3{ min(low.x, p.x), min(low.y, p.y), min(low.z, p.z) };
+		high = Float3{ max(high.x, p.x), max(high.y, p.y), max(high.z, p.z) };
+	}
+	center = (low + high) * 0.5f;
+	radius = 0.0f;
+	for (uint32_t i = 0; i < finest.vertexCount; ++i)
+	{
+		radius = max(radius, math::length(finestVertices[i].position - center));
+	}
+
+	uint32_t patchVertices{ finest.vertexCount / static_cast<uint32_t>(patchCount) };
+	float sizeSum{ 0.0f };
+	for (size_t patch = 0; patch < patchCount; ++patch)
+	{
+		const LodVertex* first{ finestVertices + patch * patchVertices };
+		// the grid's corners and middle span the patch
+		const Float3& corner00{ first[0].position };
+		const Float3& corner11{ first[patchVertices - 1].position };
+		int n{ finest.factor };
+		const Float3& corner10{ first[n].position };
+		const Float3& corner01{ first[patchVertices - 1 - n].position };
+		sizeSum += max(math::length(corner11 - corner00), math::length(corner01 - corner10));
+	}
+	patchSize = sizeSum / patchCount;
+}
+
+const vector<LodVertex>& LodChain::getVertices() const
+{
+	return vertices;
+}
+
+const vector<uint32_t>& LodChain::getIndices() const
+{
+	return indices;
+}
+
+const vector<LodLevel>& LodChain::getLevels() const
+{
+	return levels;
+}
+
+size_t LodChain::getPatchCount() const
+{
+	return patchCount;
+}
+
+size_t LodChain::getMemoryBytes() const
+{
+	return vertices.size() * sizeof(LodVertex) + indices.size() * sizeof(uint32_t);
+}
+
+const Float3& LodChain::getCenter() const
+{
+	return center;
+}
+
+float LodChain::getRadius() const
+{
+	return radius;
+}
+
+float LodChain::getPatchSize() const
+{
+	return patchSize;
+}
+
+float LodChain::getWantedFactor(const Float4x4& worldViewProj, float viewportHeight, const LodSettings& settings) const
+{
+	float w{ math::transformPoint(center, worldViewProj).w };
+	if (w <= 0.0f)
+	{
+		return FLT_MAX;
+	}
+	// clip space y per unit of model space length; rotations leave the column's length alone
+	Float3 yColumn{ worldViewProj.m[0][1], worldViewProj.m[1][1], worldViewProj.m[2][1] };
+	float pixels{ patchSize * math::length(yColumn) / w * viewportHeight * 0.5f };
+	return pixels / settings.pixelsPerSegment;
+}
+
+uint32_t LodChain::selectLevel(float wantedFactor, int maxFactor) const
+{
+	float target{ min(wantedFactor, static_cast<float>(maxFactor)) };
+	for (uint32_t i = 0; i < levels.size() && levels[i].factor <= maxFactor; ++i)
+	{
+		if (static_cast<float>(levels[i].factor) >= target)
+		{
+			return i;
+		}
+	}
+	return tessellateLevel;
+}
+
+uint32_t LodChain::selectLevel(float wantedFactor, uint32_t currentLevel, int maxFactor, const LodSettings& settings) const
+{
+	uint32_t level{ selectLevel(wantedFactor, maxFactor) };
+	bool currentValid{ currentLevel == tessellateLevel || (currentLevel < levels.size() && levels[currentLevel].factor <= maxFactor) };
+	if (level == currentLevel || !currentValid)
+	{
+		return level;
+	}
+	// a level at the factor being tessellated draws the same triangles
+	if (currentLevel == tessellateLevel && level != tessellateLevel && levels[level].factor == maxFactor)
+	{
+		return level;
+	}
+
+	bool finer{ currentLevel != tessellateLevel && (level == tessellateLevel || level > currentLevel) };
+	if (finer)
+	{
+		return wantedFactor > levels[currentLevel].factor * (1.0f + settings.hysteresis) ? level : currentLevel;
+	}
+
+	// the factor below which the next coarser level would do
+	uint32_t coarser{ currentLevel };
+	if (currentLevel == tessellateLevel)
+	{
+		coarser = 0;
+		while (coarser < levels.size() && levels[coarser].factor <= maxFactor)
+		{
+			++coarser;
+		}
+	}
+	float lowerFactor{ static_cast<float>(levels[coarser - 1].factor) };
+	return wantedFactor <= lowerFactor * (1.0f - settings.hysteresis) ? level : currentLevel;
+}
+
+namespace
+{
+	Float4x4 getSweepWorldViewProj(float distance, float ratio)
+	{
+		Float4x4 projMatrix{ math::perspectiveFovLH(math::toRadians(45), ratio, 1.0f, 100.0f) };
+		Float4x4 viewMatrix{ math::lookAtLH(Float3{ 0.0f, 0.0f, -distance }, Float3{ 0.0f, 0.0f, 0.0f }, Float3{ 0.0f, 1.0f, 0.0f }) };
+		return math::multiply(math::translation(0.0f, -1.0f, 0.0f), math::multiply(viewMatrix, projMatrix));
+	}
+}
+
+namespace teapot_tutorial
+{
+	LodCheckResult runLodCheck(const PatchModel& model, uint32_t width, uint32_t height)
+	{
+		LodChain chain{ model };
+		LodCheckResult result;
+		result.levels = chain.getLevels();
+		result.memoryBytes = chain.getMemoryBytes();
+		result.patchMemoryBytes = model.points.size() * sizeof(Float3) + model.patches.size() * sizeof(uint32_t);
+		result.imagesMatched = 0;
+
+		float ratio{ static_cast<float>(width) / static_cast<float>(height) };
+		Float4x4 worldViewProj{ getSweepWorldViewProj(10.0f, ratio) };
+		SoftwareRasterizer rasterizer;
+		rasterizer.setViewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f);
+		rasterizer.setScissorRect(0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height));
+		rasterizer.setPipelineState(RasterFillMode::Wireframe, RasterCullMode::None);
+		const float clearColor[]{ 0.1f, 0.1f, 0.1f, 1.0f };
+		RenderImage patchImage{ width, height };
+		RenderImage meshImage{ width, height };
+		vector<RasterVertex> meshVertices;
+		for (const LodLevel& level : chain.getLevels())
+		{
+			TessellationCounts counts{ getTessellationCounts(level.factor, chain.getPatchCount(), 1) };
+			if (counts.vertices != level.vertexCount || counts.triangles != level.indexCount / 3)
+			{
+				throw(runtime_error{ "LOD level " + to_string(level.factor) + " does not match the tessellation counts." });
+			}
+
+			rasterizer.clearRenderTarget(patchImage, clearColor);
+			rasterizer.clearDepth(patchImage, 1.0f);
+			rasterizer.drawPatches(patchImage, model, worldViewProj, level.factor);
+
+			meshVertices.resize(level.vertexCount);
+			for (uint32_t i = 0; i < level.vertexCount; ++i)
+			{
+				const LodVertex& vertex{ chain.getVertices()[level.baseVertex + i] };
+				meshVertices[i].position = math::transformPoint(vertex.position, worldViewProj);
+				meshVertices[i].color = vertex.color;
+			}
+			rasterizer.clearRenderTarget(meshImage, clearColor);
+			rasterizer.clearDepth(meshImage, 1.0f);
+			rasterizer.drawTriangles(meshImage, meshVertices.data(), meshVertices.size(), chain.getIndices().data() + level.startIndex, level.indexCount);
+
+			size_t pixels{ static_cast<size_t>(width) * height };
+			if (!equal(patchImage.getColorData(), patchImage.getColorData() + pixels, meshImage.getColorData()))
+			{
+				throw(runtime_error{ "LOD level " + to_string(level.factor) + " does not render like its tessellated patches." });
+			}
+			++result.imagesMatched;
+		}
+
+		// zoom from 5 to 80 and back on a 4K output, the distance jittering by 3% from frame to frame
+		const uint32_t halfSweep{ 1000 };
+		const float sweepWidth{ 3840.0f };
+		const float sweepHeight{ 2160.0f };
+		result.sweepFrames = 2 * halfSweep;
+		result.meshFrames = 0;
+		result.switches = 0;
+		result.switchesWithoutHysteresis = 0;
+		LodSettings settings;
+		LodSettings noHysteresis{ settings.pixelsPerSegment, 0.0f };
+		uint32_t level{ LodChain::tessellateLevel };
+		uint32_t levelWithoutHysteresis{ LodChain::tessellateLevel };
+		uint32_t state{ 0x9e3779b9u };
+		for (uint32_t frame = 0; frame < result.sweepFrames; ++frame)
+		{
+			uint32_t step{ frame < halfSweep ? frame : result.sweepFrames - 1 - frame };
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			float jitter{ 1.0f + 0.03f * ((state & 0xffff) / 32767.5f - 1.0f) };
+			float distance{ 5.0f * pow(16.0f, step / static_cast<float>(halfSweep - 1)) * jitter };
+			float wanted{ chain.getWantedFactor(getSweepWorldViewProj(distance, sweepWidth / sweepHeight), sweepHeight, settings) };
+
+			uint32_t next{ chain.selectLevel(wanted, level, maxTessFactor, settings) };
+			result.switches += next != level ? 1 : 0;
+			level = next;
+			uint32_t nextWithoutHysteresis{ chain.selectLevel(wanted, levelWithoutHysteresis, maxTessFactor, noHysteresis) };
+			result.switchesWithoutHysteresis += nextWithoutHysteresis != levelWithoutHysteresis ? 1 : 0;
+			levelWithoutHysteresis = nextWithoutHysteresis;
+
+			if (level != LodChain::tessellateLevel)
+			{
+				++result.meshFrames;
+				if (chain.getLevels()[level].factor * (1.0f + settings.hysteresis) < min(wanted, static_cast<float>(maxTessFactor)))
+				{
+					throw(runtime_error{ "LOD level less detailed than wanted." });
+				}
+			}
+		}
+		if (result.meshFrames == 0 || result.meshFrames == result.sweepFrames || result.switches >= result.switchesWithoutHysteresis)
+		{
+			throw(runtime_error{ "LOD selection did not use both paths or hysteresis did not reduce switching." });
+		}
+		return result;
+	}
+
+	string formatLodCheckResult(const LodCheckResult& result)
+	{
+		char text[256];
+		string report;
+		for (const LodLevel& level : result.levels)
+		{
+			snprintf(text, sizeof(text), "lod factor %2d: %u vertices, %u triangles\n", level.factor, level.vertexCount, level.indexCount / 3);
+			report += text;
+		}
+		snprintf(text, sizeof(text),
+			"lod memory KB: %.1f (patches %.1f)\n"
+			"lod images matching tessellation: %u of %zu\n"
+			"lod sweep: %u of %u frames without tessellation, %u switches (%u without hysteresis)\n",
+			result.memoryBytes / 1024.0, result.patchMemoryBytes / 1024.0, result.imagesMatched, result.levels.size(),
+			result.meshFrames, result.sweepFrames, result.switches, result.switchesWithoutHysteresis);
+		report += text;
+		return report;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MathTypes.h"
+#include "PatchModel.h"
+
+// vertex of a pre-tessellated level, as MeshVertexShader.hlsl reads it
+struct LodVertex
+{
+	Float3 position;
+	Float3 color;
+};
+
+// where a level lives in the chain's buffers; indices are relative to baseVertex
+struct LodLevel
+{
+	int factor;
+	uint32_t startIndex;
+	uint32_t indexCount;
+	int32_t baseVertex;
+	uint32_t vertexCount;
+};
+
+struct LodSettings
+{
+	// a tessellated edge segment should cover about this many pixels
+	float pixelsPerSegment{ 8.0f };
+	// fraction past a level's factor the wanted factor has to move before the level changes
+	float hysteresis{ 0.15f };
+};
+
+// The patches of a model tessellated once at each factor of a chain, e.g. 1, 2, 4, 8, 16, 32, into one vertex
+// and one index buffer, exactly as the tessellator would produce them. Instances far enough away for one of
+// these to be as detailed as wanted draw it as a plain triangle list and skip the tessellation stages.
+class LodChain
+{
+public:
+	static const uint32_t tessellateLevel{ UINT32_MAX };
+
+	LodChain(const PatchModel& model, const std::vector<int>& factors = { 1, 2, 4, 8, 16, 32 });
+
+	const std::vector<LodVertex>& getVertices() const;
+	const std::vector<uint32_t>& getIndices() const;
+	// by increasing factor
+	const std::vector<LodLevel>& getLevels() const;
+	size_t getPatchCount() const;
+	size_t getMemoryBytes() const;
+
+	// bounding sphere of the model, patch transforms applied
+	const Float3& getCenter() const;
+	float getRadius() const;
+	// mean bounding sphere diameter of a patch
+	float getPatchSize() const;
+
+	// The tessellation factor an instance drawn with worldViewProj into a viewport viewportHeight pixels high
+	// wants for its patches' segments to cover settings.pixelsPerSegment pixels.
+	float getWantedFactor(const Float4x4& worldViewProj, float viewportHeight, const LodSettings& settings) const;
+	// Level index for wantedFactor given the instance's current level, or tessellateLevel when no level below
+	// maxFactor is detailed enough and the patches should be tessellated at maxFactor instead. The level only
+	// changes once wantedFactor leaves the current level's range by the hysteresis fraction, or right away for a
+	// level at maxFactor in place of tessellating at it.
+	uint32_t selectLevel(float wantedFactor, uint32_t currentLevel, int maxFactor, const LodSettings& settings) const;
+
+private:
+	uint32_t selectLevel(float wantedFactor, int maxFactor) const;
+
+private:
+	std::vector<LodVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<LodLevel> levels;
+	size_t patchCount;
+	Float3 center;
+	float radius;
+	float patchSize;
+};
+
+struct LodCheckResult
+{
+	std::vector<LodLevel> levels;
+	size_t memoryBytes;
+	// bytes of the control points and patch indices the tessellated path draws from
+	size_t patchMemoryBytes;
+	// levels whose image matched the patches tessellated at the same factor, pixel for pixel
+	uint32_t imagesMatched;
+	// level changes over a zoom out and back in, with and without hysteresis, while the distance jitters
+	uint32_t switches;
+	uint32_t switchesWithoutHysteresis;
+	// frames of that sweep that skipped tessellation
+	uint32_t meshFrames;
+	uint32_t sweepFrames;
+};
+
+namespace teapot_tutorial
+{
+	// Checks every level's counts against the tessellation model and its rasterized image against the patches
+	// rasterized at the same factor, then sweeps the camera distance; throws on the first mismatch, on a level
+	// less detailed than wanted and on hysteresis not reducing the switches.
+	LodCheckResult runLodCheck(const PatchModel& model, uint32_t width, uint32_t height);
+
+	std::string formatLodCheckResult(const LodCheckResult& result);
+}
\ No newline at end of file
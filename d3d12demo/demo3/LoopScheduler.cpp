@@ -0,0 +1,149 @@
+#include "LoopScheduler.h"
+#include <chrono>
+#include "Trace.h"
+
+using namespace std;
+
+LoopScheduler::LoopScheduler(bool renderOnDemand, uint64_t idleTickNs, uint64_t occlusionPollNs) :
+	renderOnDemand{ renderOnDemand }, idleTickNs{ idleTickNs }, occlusionPollNs{ occlusionPollNs }
+{
+}
+
+void LoopScheduler::requestRender()
+{
+	{
+		lock_guard<mutex> lock{ stateMutex };
+		renderRequested = true;
+		woken = true;
+	}
+	wakeCondition.notify_one();
+}
+
+void LoopScheduler::setMinimized(bool minimized)
+{
+	{
+		lock_guard<mutex> lock{ stateMutex };
+		if (this->minimized == minimized)
+		{
+			return;
+		}
+		this->minimized = minimized;
+		// restoring shows whatever was last presented, draw a fresh frame
+		renderRequested = renderRequested || !minimized;
+		woken = true;
+	}
+	wakeCondition.notify_one();
+}
+
+void LoopScheduler::wake()
+{
+	{
+		lock_guard<mutex> lock{ stateMutex };
+		woken = true;
+	}
+	wakeCondition.notify_one();
+}
+
+void LoopScheduler::setRenderOnDemand(bool renderOnDemand)
+{
+	{
+		lock_guard<mutex> lock{ stateMutex };
+		this->renderOnDemand = renderOnDemand;
+		woken = true;
+	}
+	wakeCondition.notify_one();
+}
+
+void LoopScheduler::setIdleTick(uint64_t idleTickNs)
+{
+	{
+		lock_guard<mutex> lock{ stateMutex };
+		this->idleTickNs = idleTickNs;
+		woken = true;
+	}
+	wakeCondition.notify_one();
+}
+
+LoopDecision LoopScheduler::next(uint64_t nowNs)
+{
+	lock_guard<mutex> lock{ stateMutex };
+	// wake ups from before this decision are part of it; only later ones may cut the wait short
+	woken = false;
+
+	if (minimized)
+	{
+		return{ LoopAction::Wait, noTimeout };
+	}
+
+	if (occluded)
+	{
+		uint64_t testNs{ lastOcclusionTestNs + occlusionPollNs };
+		return nowNs >= testNs ? LoopDecision{ LoopAction::TestOcclusion, 0 } : LoopDecision{ LoopAction::Wait, testNs };
+	}
+
+	if (renderRequested || !renderOnDemand)
+	{
+		renderRequested = false;
+		return{ LoopAction::Render, 0 };
+	}
+
+	if (idleTickNs == 0)
+	{
+		return{ LoopAction::Wait, noTimeout };
+	}
+	uint64_t tickNs{ lastFrameNs + idleTickNs };
+	return nowNs >= tickNs ? LoopDecision{ LoopAction::Render, 0 } : LoopDecision{ LoopAction::Wait, tickNs };
+}
+
+void LoopScheduler::onFrameRendered(uint64_t nowNs, bool occluded)
+{
+	lock_guard<mutex> lock{ stateMutex };
+	lastFrameNs = nowNs;
+	this->occluded = occluded;
+	lastOcclusionTestNs = nowNs;
+}
+
+void LoopScheduler::onOcclusionTested(uint64_t nowNs, bool occluded)
+{
+	lock_guard<mutex> lock{ stateMutex };
+	lastOcclusionTestNs = nowNs;
+	if (this->occluded && !occluded)
+	{
+		// the output is visible again but shows a frame from before it was covered
+		renderRequested = true;
+	}
+	this->occluded = occluded;
+}
+
+void LoopScheduler::wait(const LoopDecision& decision)
+{
+	if (decision.action != LoopAction::Wait)
+	{
+		return;
+	}
+
+	unique_lock<mutex> lock{ stateMutex };
+	if (decision.wakeNs == noTimeout)
+	{
+		wakeCondition.wait(lock, [this]() { return woken; });
+		return;
+	}
+
+	uint64_t nowNs{ Tracer::now() };
+	if (decision.wakeNs > nowNs)
+	{
+		wakeCondition.wait_for(lock, chrono::nanoseconds{ decision.wakeNs - nowNs }, [this]() { return woken; });
+	}
+}
+
+bool LoopScheduler::isOccluded() const
+{
+	lock_guard<mutex> lock{ stateMutex };
+	return occluded;
+}
+
+bool LoopScheduler::isMinimized() const
+{
+	lock_guard<mutex> lock{ stateMutex };
+	return minimized;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+enum class LoopAction : uint32_t
+{
+	Render,
+	// present nothing, only ask the swap chain whether the output is still occluded
+	TestOcclusion,
+	Wait
+};
+
+struct LoopDecision
+{
+	LoopAction action;
+	// for Wait, when to run the loop again unless woken earlier; LoopScheduler::noTimeout waits for a wake up only
+	uint64_t wakeNs;
+};
+
+// Decides whether the render loop draws, checks occlusion or sleeps. Nothing is drawn while the window is
+// minimized, and while the output is occluded the loop only tests it every occlusionPollNs. With render on
+// demand a frame is drawn only after requestRender(), plus one every idleTickNs (0 for none) so the output
+// never goes stale. Other threads report changes with requestRender() and setMinimized(), which also end a
+// wait(). Times are Tracer::now() ns.
+class LoopScheduler
+{
+public:
+	static const uint64_t noTimeout{ UINT64_MAX };
+
+	LoopScheduler(bool renderOnDemand = true, uint64_t idleTickNs = 1000000000, uint64_t occlusionPollNs = 100000000);
+
+	LoopScheduler(const LoopScheduler&) = delete;
+	LoopScheduler& operator=(const LoopScheduler&) = delete;
+
+	// any thread
+	void requestRender();
+	void setMinimized(bool minimized);
+	// ends a wait without asking for a frame, e.g. to stop the loop
+	void wake();
+	void setRenderOnDemand(bool renderOnDemand);
+	void setIdleTick(uint64_t idleTickNs);
+
+	// render thread
+	LoopDecision next(uint64_t nowNs);
+	void onFrameRendered(uint64_t nowNs, bool occluded);
+	void onOcclusionTested(uint64_t nowNs, bool occluded);
+	// blocks until decision.wakeNs or the next requestRender(), setMinimized() or wake(), whichever is first
+	void wait(const LoopDecision& decision);
+
+	bool isOccluded() const;
+	bool isMinimized() const;
+
+private:
+	mutable std::mutex stateMutex;
+	std::condition_variable wakeCondition;
+	bool renderOnDemand;
+	uint64_t idleTickNs;
+	uint64_t occlusionPollNs;
+	// the first frame is always drawn
+	bool renderRequested{ true };
+	bool minimized{ false };
+	bool occluded{ false };
+	bool woken{ false };
+	uint64_t lastFrameNs{ 0 };
+	uint64_t lastOcclusionTestNs{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "Lz4.h"
+#include <cstring>
+
+namespace
+{
+	const size_t minMatch{ 4 };
+	const size_t lastLiterals{ 5 };
+	const size_t matchFindLimit{ 12 };
+	const size_t maxOffset{ 65535 };
+	const int hashLog{ 12 };
+
+	uint32_t read32(const uint8_t* p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	uint32_t hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - hashLog);
+	}
+
+	bool writeLength(uint8_t*& op, const uint8_t* opEnd, size_t length)
+	{
+		while (length >= 255)
+		{
+			if (op >= opEnd) return false;
+			*op++ = 255;
+			length -= 255;
+		}
+
+		if (op >= opEnd) return false;
+		*op++ = static_cast<uint8_t>(length);
+		return true;
+	}
+
+	bool writeSequence(uint8_t*& op, const uint8_t* opEnd, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		if (op >= opEnd) return false;
+		uint8_t* token{ op++ };
+
+		*token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+		if (literalLength >= 15 && !writeLength(op, opEnd, literalLength - 15)) return false;
+
+		if (static_cast<size_t>(opEnd - op) < literalLength) return false;
+		memcpy(op, literals, literalLength);
+		op += literalLength;
+
+		// the last sequence of a block carries literals only
+		if (matchLength == 0) return true;
+
+		if (opEnd - op < 2) return false;
+		*op++ = static_cast<uint8_t>(offset & 0xff);
+		*op++ = static_cast<uint8_t>(offset >> 8);
+
+		size_t code{ matchLength - minMatch };
+		*token |= static_cast<uint8_t>(code >= 15 ? 15 : code);
+		if (code >= 15 && !writeLength(op, opEnd, code - 15)) return false;
+
+		return true;
+	}
+}
+
+namespace lz4
+{
+	size_t compressBound(size_t inputSize)
+	{
+		return inputSize + inputSize / 255 + 16;
+	}
+
+	size_t compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+	{
+		uint8_t* op{ dst };
+		const uint8_t* opEnd{ dst + dstCapacity };
+		size_t anchor{ 0 };
+
+		if (srcSize > matchFindLimit)
+		{
+			// positions are stored +1 so that zero marks an empty slot
+			uint32_t table[1 << hashLog];
+			memset(table, 0, sizeof(table));
+
+			const size_t matchLimit{ srcSize - lastLiterals };
+			const size_t searchLimit{ srcSize - matchFindLimit };
+			size_t ip{ 0 };
+			size_t misses{ 0 };
+
+			while (ip <= searchLimit)
+			{
+				uint32_t sequence{ read32(src + ip) };
+				uint32_t& slot{ table[hash(sequence)] };
+				size_t candidate{ slot };
+				slot = static_cast<uint32_t>(ip + 1);
+
+				if (candidate == 0 || ip - (candidate - 1) > maxOffset || read32(src + candidate - 1) != sequence)
+				{
+					// skip faster through incompressible data
+					ip += 1 + (misses++ >> 6);
+					continue;
+				}
+
+				size_t ref{ candidate - 1 };
+				size_t length{ minMatch };
+				while (ip + length < matchLimit && src[ref + length] == src[ip + length])
+				{
+					++length;
+				}
+
+				if (!writeSequence(op, opEnd, src + anchor, ip - anchor, ip - ref, length))
+				{
+					return 0;
+				}
+
+				ip += length;
+				anchor = ip;
+				misses = 0;
+
+				if (ip <= searchLimit)
+				{
+					table[hash(read32(src + ip - 2))] = static_cast<uint32_t>(ip - 1);
+				}
+			}
+		}
+
+		if (!writeSequence(op, opEnd, src + anchor, srcSize - anchor, 0, 0))
+		{
+			return 0;
+		}
+
+		return static_cast<size_t>(op - dst);
+	}
+
+	size_t decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+	{
+		const uint8_t* ip{ src };
+		const uint8_t* ipEnd{ src + srcSize };
+		uint8_t* op{ dst };
+		uint8_t* opEnd{ dst + dstCapacity };
+
+		while (ip < ipEnd)
+		{
+			uint8_t token{ *ip++ };
+
+			size_t literalLength{ static_cast<size_t>(token >> 4) };
+			if (literalLength == 15)
+			{
+				uint8_t b;
+				do
+				{
+					if (ip >= ipEnd) return SIZE_MAX;
+					b = *ip++;
+					literalLength += b;
+				} while (b == 255);
+			}
+
+			if (static_cast<size_t>(ipEnd - ip) < literalLength || static_cast<size_t>(opEnd - op) < literalLength)
+			{
+				return SIZE_MAX;
+			}
+
+			memcpy(op, ip, literalLength);
+			op += literalLength;
+			ip += literalLength;
+
+			if (ip == ipEnd)
+			{
+				break;
+			}
+
+			if (ipEnd - ip < 2) return SIZE_MAX;
+			size_t offset{ static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8) };
+			ip += 2;
+
+			if (offset == 0 || offset > static_cast<size_t>(op - dst))
+			{
+				return SIZE_MAX;
+			}
+
+			size_t matchLength{ static_cast<size_t>(token & 15) };
+			if (matchLength == 15)
+			{
+				uint8_t b;
+				do
+				{
+					if (ip >= ipEnd) return SIZE_MAX;
+					b = *ip++;
+					matchLength += b;
+				} while (b == 255);
+			}
+			matchLength += minMatch;
+
+			if (static_cast<size_t>(opEnd - op) < matchLength)
+			{
+				return SIZE_MAX;
+			}
+
+			const uint8_t* match{ op - offset };
+			if (offset >= matchLength)
+			{
+				memcpy(op, match, matchLength);
+				op += matchLength;
+			}
+			else
+			{
+				// overlapping copy repeats the last offset bytes
+				for (size_t i{ 0 }; i < matchLength; ++i)
+				{
+					*op++ = match[i];
+				}
+			}
+		}
+
+		return static_cast<size_t>(op - dst);
+	}
+}
\ No newline at end of file
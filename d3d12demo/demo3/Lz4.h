@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Minimal LZ4 block format codec (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md).
+// Output is compatible with LZ4_compress_default()/LZ4_decompress_safe().
+namespace lz4
+{
+	size_t compressBound(size_t inputSize);
+
+	// Returns the number of bytes written to dst, or 0 if dst is too small.
+	size_t compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+
+	// Returns the number of bytes written to dst, or SIZE_MAX on malformed input or overflow.
+	size_t decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+}
\ No newline at end of file
@@ -1,6 +1,16 @@
 #include "Demo.h"
+#include "AssetStream.h"
+#include "FlightRecorder.h"
+#include "PatchModelLoader.h"
+#include "HeadlessBenchmark.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include <wrl/client.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
 
 #pragma comment(lib, "dxgi.lib")
@@ -10,47 +20,270 @@
 using namespace std;
 using namespace Microsoft::WRL;
 
-int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+namespace
+{
+	// "--headless [arguments]" renders against a NullDevice without creating a window or device
+	int reportHeadless(const vector<string>& args)
+	{
+		string report{ teapot_tutorial::runHeadless(args) };
+
+		if (AttachConsole(ATTACH_PARENT_PROCESS))
+		{
+			FILE* out{ nullptr };
+			if (freopen_s(&out, "CONOUT$", "w", stdout) == 0)
+			{
+				fputs(report.c_str(), stdout);
+				fflush(stdout);
+				return 0;
+			}
+		}
+
+		MessageBox(nullptr, report.c_str(), "Headless", MB_OK);
+		return 0;
+	}
+
+	// the flight recorder is diagnostics only, the demo runs without it when the file cannot be opened
+	unique_ptr<FlightRecorder> openFlightRecorder(const string& path)
+	{
+		try
+		{
+			return make_unique<FlightRecorder>(path);
+		}
+		catch (runtime_error&)
+		{
+			return nullptr;
+		}
+	}
+
+	void reportError(const runtime_error& err, FlightRecorder* flightRecorder)
+	{
+		// record before the MessageBox, which blocks until the user answers
+		if (flightRecorder != nullptr)
+		{
+			flightRecorder->recordError(err.what());
+		}
+		MessageBox(nullptr, err.what(), "Error", MB_OK);
+	}
+
+	uint64_t parseMilliseconds(const string& text)
+	{
+		char* end{ nullptr };
+		unsigned long long ms{ strtoull(text.c_str(), &end, 10) };
+		if (text.empty() || *end != '\0')
+		{
+			throw(runtime_error{ "Invalid milliseconds: " + text });
+		}
+		return ms * 1000000;
+	}
+
+	uint64_t parseTriangleCount(const string& text)
+	{
+		char* end{ nullptr };
+		unsigned long long count{ strtoull(text.c_str(), &end, 10) };
+		if (text.empty() || *end != '\0')
+		{
+			throw(runtime_error{ "Invalid triangle count: " + text });
+		}
+		return count;
+	}
+
+	// "on-demand" draws a frame when input changes something, "continuous" draws every frame
+	bool parseRenderOnDemand(const string& name)
+	{
+		if (name != "on-demand" && name != "continuous")
+		{
+			throw(runtime_error{ "Unknown render mode: " + name });
+		}
+		return name == "on-demand";
+	}
+
+	bool parseOnOff(const string& text)
+	{
+		if (text != "on" && text != "off")
+		{
+			throw(runtime_error{ "Expected on or off: " + text });
+		}
+		return text == "on";
+	}
+
+	void writeTrace(const string& path, vector<TraceEvent>& events)
+	{
+		if (path.empty())
+		{
+			return;
+		}
+
+		try
+		{
+			Tracer::collect(events);
+			Tracer::writeChromeTrace(path, events);
+		}
+		catch (runtime_error& err)
+		{
+			MessageBox(nullptr, err.what(), "Error", MB_OK);
+		}
+	}
+}
+
+int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR lpCmdLine, int)
 {
 	const LONG width{ 800 };
 	const LONG height{ 600 };
 	const UINT bufferCount{ 3 };
 
+	// declared first so it outlives the demo that records into it
+	unique_ptr<FlightRecorder> flightRecorder;
 	shared_ptr<Demo> teapot;
+	string tracePath;
+	vector<TraceEvent> traceEvents;
+	unique_ptr<PeriodicMetricsDump> metricsDump;
 
 	try
 	{
-		teapot = make_shared<Demo>(bufferCount, "Hello Teapot!", width, height);
+		istringstream cmdLine{ lpCmdLine };
+		vector<string> args{ istream_iterator<string>{ cmdLine }, istream_iterator<string>{} };
+		if (!args.empty() && args[0] == "--headless")
+		{
+			return reportHeadless(vector<string>(args.begin() + 1, args.end()));
+		}
+
+		// "--trace path" records a Chrome trace of the whole run, including device creation,
+		// "--metrics path" keeps a JSON (or ".prom" Prometheus) dump of the frame metrics updated every second and
+		// "--flight path" moves the flight recorder ring from flight.rec; decode it with --headless --flight-decode
+		// "--pacing latency" starts frames just in time for the GPU instead of queueing one per back buffer,
+		// "--render continuous" draws frames back to back instead of on demand and "--idle-tick ms" sets how often
+		// an idle window is redrawn, 0 for never, "--dynres ms" scales the render resolution to keep the GPU time
+		// within ms per frame, "--tri-budget n" lowers the tessellation factor to stay within n triangles per frame and
+		// "--lod on" draws pre-tessellated meshes instead of tessellating wherever they have enough detail
+		string metricsPath;
+		string flightPath{ "flight.rec" };
+		PacingMode pacingMode{ PacingMode::Throughput };
+		bool renderOnDemand{ true };
+		uint64_t idleTickNs{ 1000000000 };
+		uint64_t dynamicResolutionNs{ 0 };
+		uint64_t triangleBudget{ 0 };
+		bool lod{ false };
+		size_t arg{ 0 };
+		for (; arg + 1 < args.size() && (args[arg] == "--trace" || args[arg] == "--metrics" || args[arg] == "--flight" || args[arg] == "--pacing" ||
+			args[arg] == "--render" || args[arg] == "--idle-tick" || args[arg] == "--dynres" || args[arg] == "--tri-budget" ||
+			args[arg] == "--lod"); arg += 2)
+		{
+			if (args[arg] == "--trace")
+			{
+				tracePath = args[arg + 1];
+			}
+			else if (args[arg] == "--metrics")
+			{
+				metricsPath = args[arg + 1];
+			}
+			else if (args[arg] == "--pacing")
+			{
+				pacingMode = teapot_tutorial::parsePacingMode(args[arg + 1]);
+			}
+			else if (args[arg] == "--render")
+			{
+				renderOnDemand = parseRenderOnDemand(args[arg + 1]);
+			}
+			else if (args[arg] == "--idle-tick")
+			{
+				idleTickNs = parseMilliseconds(args[arg + 1]);
+			}
+			else if (args[arg] == "--dynres")
+			{
+				dynamicResolutionNs = parseMilliseconds(args[arg + 1]);
+			}
+			else if (args[arg] == "--tri-budget")
+			{
+				triangleBudget = parseTriangleCount(args[arg + 1]);
+			}
+			else if (args[arg] == "--lod")
+			{
+				lod = parseOnOff(args[arg + 1]);
+			}
+			else
+			{
+				flightPath = args[arg + 1];
+			}
+		}
+
+		flightRecorder = openFlightRecorder(flightPath);
+
+		string modelPath{ arg == 0 ? lpCmdLine : "" };
+		for (size_t i = arg; arg > 0 && i < args.size(); ++i)
+		{
+			modelPath += (i > arg ? " " : "") + args[i];
+		}
+
+		if (!tracePath.empty())
+		{
+			Tracer::setThreadName("main");
+			Tracer::setEnabled(true);
+		}
+
+		if (!metricsPath.empty())
+		{
+			metricsDump = make_unique<PeriodicMetricsDump>(MetricsRegistry::getGlobal(), metricsPath, metrics::getFormatForPath(metricsPath));
+		}
+
+		// An optional command line argument names a .bpt/Newell patch file or an .astm asset stream. The asset
+		// stream decompresses straight into the upload heaps unless the LodChain needs the model in memory.
+		if (!lod && teapot_tutorial::isAssetStreamPath(modelPath))
+		{
+			AssetStreamReader stream{ modelPath };
+			teapot = make_shared<Demo>(bufferCount, "Hello Teapot!", width, height, stream);
+		}
+		else
+		{
+			PatchModel model{ teapot_tutorial::openPatchModel(modelPath) };
+			teapot = make_shared<Demo>(bufferCount, "Hello Teapot!", width, height, model, lod);
+		}
+		teapot->setFlightRecorder(flightRecorder.get());
+		teapot->setPacingMode(pacingMode);
+		teapot->setRenderOnDemand(renderOnDemand);
+		teapot->setIdleTick(idleTickNs);
+		teapot->setDynamicResolution(dynamicResolutionNs);
+		teapot->setTriangleBudget(triangleBudget);
 	}
 	catch (runtime_error& err)
 	{
-		MessageBox(nullptr, err.what(), "Error", MB_OK);
+		reportError(err, flightRecorder.get());
+		writeTrace(tracePath, traceEvents);
 		return 0;
 	}
 
+	// This thread only pumps messages and runs the simulation; WndProc queues the input, update() publishes it to
+	// the render thread, so a burst of messages no longer holds up frames.
+	teapot->start();
+
 	MSG msg;
 	ZeroMemory(&msg, sizeof(msg));
 
 	while (msg.message != WM_QUIT)
 	{
-		BOOL r{ PeekMessage(&msg, NULL, 0, 0, PM_REMOVE) };
-		if (r == 0)
+		// wakes for new messages only, or also every 100 ms to drain the render thread's trace buffer
+		MsgWaitForMultipleObjects(0, nullptr, FALSE, tracePath.empty() ? INFINITE : 100, QS_ALLINPUT);
+		while (msg.message != WM_QUIT && PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 		{
-			try
-			{
-				teapot->render();
-			}
-			catch (runtime_error& err)
-			{
-				MessageBox(nullptr, err.what(), "Error", MB_OK);
-				return 0;
-			}
+			DispatchMessage(&msg);
 		}
-		else
+		teapot->update();
+		if (!tracePath.empty())
 		{
-			DispatchMessage(&msg);
+			Tracer::collect(traceEvents);
 		}
 	}
 
+	try
+	{
+		teapot->stop();
+	}
+	catch (runtime_error& err)
+	{
+		reportError(err, flightRecorder.get());
+		writeTrace(tracePath, traceEvents);
+		return 0;
+	}
+
+	writeTrace(tracePath, traceEvents);
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "MappedFile.h"
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(string path)
+{
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		fileHandle = nullptr;
+		throw(runtime_error{ "Error opening file." });
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		CloseHandle(fileHandle);
+		throw(runtime_error{ "Error getting file size." });
+	}
+
+	size = static_cast<size_t>(fileSize.QuadPart);
+	if (size == 0)
+	{
+		return;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr)
+	{
+		CloseHandle(fileHandle);
+		throw(runtime_error{ "Error creating file mapping." });
+	}
+
+	data = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr)
+	{
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		throw(runtime_error{ "Error mapping file." });
+	}
+}
+
+MappedFile::MappedFile(string path, size_t size) : size{ size }, writable{ true }
+{
+	if (size == 0)
+	{
+		throw(runtime_error{ "Invalid mapping size." });
+	}
+
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		fileHandle = nullptr;
+		throw(runtime_error{ "Error opening file." });
+	}
+
+	// the mapping grows the file to its size; shrink it first so a larger old file does not keep its tail
+	LARGE_INTEGER fileSize;
+	fileSize.QuadPart = static_cast<LONGLONG>(size);
+	if (!SetFilePointerEx(fileHandle, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(fileHandle))
+	{
+		CloseHandle(fileHandle);
+		throw(runtime_error{ "Error resizing file." });
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), nullptr);
+	if (mappingHandle == nullptr)
+	{
+		CloseHandle(fileHandle);
+		throw(runtime_error{ "Error creating file mapping." });
+	}
+
+	data = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_WRITE, 0, 0, 0));
+	if (data == nullptr)
+	{
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		throw(runtime_error{ "Error mapping file." });
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+	}
+
+	if (fileHandle != nullptr)
+	{
+		CloseHandle(fileHandle);
+	}
+}
+
+void MappedFile::flush()
+{
+	if (writable && data != nullptr)
+	{
+		FlushViewOfFile(data, 0);
+	}
+}
+
+#else
+
+MappedFile::MappedFile(string path)
+{
+	fileDescriptor = open(path.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		throw(runtime_error{ "Error opening file." });
+	}
+
+	struct stat fileStat;
+	if (fstat(fileDescriptor, &fileStat) != 0)
+	{
+		close(fileDescriptor);
+		throw(runtime_error{ "Error getting file size." });
+	}
+
+	size = static_cast<size_t>(fileStat.st_size);
+	if (size == 0)
+	{
+		return;
+	}
+
+	void* mapping{ mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0) };
+	if (mapping == MAP_FAILED)
+	{
+		close(fileDescriptor);
+		throw(runtime_error{ "Error mapping file." });
+	}
+
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	data = static_cast<const uint8_t*>(mapping);
+}
+
+MappedFile::MappedFile(string path, size_t size) : size{ size }, writable{ true }
+{
+	if (size == 0)
+	{
+		throw(runtime_error{ "Invalid mapping size." });
+	}
+
+	fileDescriptor = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fileDescriptor < 0)
+	{
+		throw(runtime_error{ "Error opening file." });
+	}
+
+	if (ftruncate(fileDescriptor, static_cast<off_t>(size)) != 0)
+	{
+		close(fileDescriptor);
+		throw(runtime_error{ "Error resizing file." });
+	}
+
+	void* mapping{ mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0) };
+	if (mapping == MAP_FAILED)
+	{
+		close(fileDescriptor);
+		throw(runtime_error{ "Error mapping file." });
+	}
+
+	data = static_cast<const uint8_t*>(mapping);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data != nullptr)
+	{
+		munmap(const_cast<uint8_t*>(data), size);
+	}
+
+	if (fileDescriptor >= 0)
+	{
+		close(fileDescriptor);
+	}
+}
+
+void MappedFile::flush()
+{
+	if (writable && data != nullptr)
+	{
+		msync(const_cast<uint8_t*>(data), size, MS_ASYNC);
+	}
+}
+
+#endif
+
+const uint8_t* MappedFile::getData() const
+{
+	return data;
+}
+
+uint8_t* MappedFile::getWritableData()
+{
+	return writable ? const_cast<uint8_t*>(data) : nullptr;
+}
+
+size_t MappedFile::getSize() const
+{
+	return size;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Memory mapping of a whole file (CreateFileMapping on Windows, mmap elsewhere).
+class MappedFile
+{
+public:
+	// read-only mapping of an existing file
+	MappedFile(std::string path);
+	// Shared read-write mapping of a file created if missing and resized to size bytes. Stores land in the
+	// system file cache, so they reach the file even if the process crashes before unmapping.
+	MappedFile(std::string path, size_t size);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* getData() const;
+	// null for a read-only mapping
+	uint8_t* getWritableData();
+	size_t getSize() const;
+
+	// asks the OS to write dirty pages back now, which only matters if the machine itself goes down
+	void flush();
+
+private:
+	const uint8_t* data{ nullptr };
+	size_t size{ 0 };
+	bool writable{ false };
+#if defined(_WIN32)
+	void* fileHandle{ nullptr };
+	void* mappingHandle{ nullptr };
+#else
+	int fileDescriptor{ -1 };
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cmath>
+
+// Platform neutral counterparts of the DirectXMath storage types. The layouts match XMFLOAT3/XMFLOAT4/XMFLOAT4X4
+// so arrays of them can be uploaded as is, and the matrix helpers follow the DirectXMath row vector conventions.
+
+struct Float2
+{
+	float x;
+	float y;
+};
+
+struct Float3
+{
+	float x;
+	float y;
+	float z;
+};
+
+struct Float4
+{
+	float x;
+	float y;
+	float z;
+	float w;
+};
+
+struct Float4x4
+{
+	float m[4][4];
+};
+
+inline Float3 operator+(const Float3& a, const Float3& b) { return{ a.x + b.x, a.y + b.y, a.z + b.z }; }
+inline Float3 operator-(const Float3& a, const Float3& b) { return{ a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline Float3 operator*(const Float3& a, float s) { return{ a.x * s, a.y * s, a.z * s }; }
+inline Float3 operator*(float s, const Float3& a) { return{ a.x * s, a.y * s, a.z * s }; }
+
+namespace math
+{
+	const float pi{ 3.14159265358979323846f };
+
+	inline float toRadians(float degrees)
+	{
+		return degrees * (pi / 180.0f);
+	}
+
+	inline float dot(const Float3& a, const Float3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline Float3 cross(const Float3& a, const Float3& b)
+	{
+		return{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	inline float length(const Float3& a)
+	{
+		return std::sqrt(dot(a, a));
+	}
+
+	inline Float3 normalize(const Float3& a)
+	{
+		float len{ length(a) };
+		return len > 0.0f ? a * (1.0f / len) : a;
+	}
+
+	inline Float4x4 identity()
+	{
+		return{ { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+	}
+
+	inline Float4x4 multiply(const Float4x4& a, const Float4x4& b)
+	{
+		Float4x4 r;
+		for (int i{ 0 }; i < 4; ++i)
+		{
+			for (int j{ 0 }; j < 4; ++j)
+			{
+				r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+			}
+		}
+		return r;
+	}
+
+	inline Float4 transform(const Float4& v, const Float4x4& m)
+	{
+		return{
+			v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + v.w * m.m[3][0],
+			v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + v.w * m.m[3][1],
+			v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + v.w * m.m[3][2],
+			v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + v.w * m.m[3][3]
+		};
+	}
+
+	inline Float4 transformPoint(const Float3& p, const Float4x4& m)
+	{
+		return transform(Float4{ p.x, p.y, p.z, 1.0f }, m);
+	}
+
+	inline Float4x4 scaling(float x, float y, float z)
+	{
+		return{ { { x, 0.0f, 0.0f, 0.0f }, { 0.0f, y, 0.0f, 0.0f }, { 0.0f, 0.0f, z, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+	}
+
+	inline Float4x4 translation(float x, float y, float z)
+	{
+		return{ { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { x, y, z, 1.0f } } };
+	}
+
+	inline Float4x4 rotationX(float angle)
+	{
+		float s{ std::sin(angle) };
+		float c{ std::cos(angle) };
+		return{ { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, c, s, 0.0f }, { 0.0f, -s, c, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+	}
+
+	inline Float4x4 rotationY(float angle)
+	{
+		float s{ std::sin(angle) };
+		float c{ std::cos(angle) };
+		return{ { { c, 0.0f, -s, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { s, 0.0f, c, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+	}
+
+	inline Float4x4 rotationZ(float angle)
+	{
+		float s{ std::sin(angle) };
+		float c{ std::cos(angle) };
+		return{ { { c, s, 0.0f, 0.0f }, { -s, c, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+	}
+
+	// same order as XMMatrixRotationRollPitchYaw: roll about z, then pitch about x, then yaw about y
+	inline Float4x4 rotationRollPitchYaw(float pitch, float yaw, float roll)
+	{
+		return multiply(multiply(rotationZ(roll), rotationX(pitch)), rotationY(yaw));
+	}
+
+	inline Float4x4 perspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+	{
+		float h{ 1.0f / std::tan(fovAngleY * 0.5f) };
+		float w{ h / aspectRatio };
+		float range{ farZ / (farZ - nearZ) };
+		return{ { { w, 0.0f, 0.0f, 0.0f }, { 0.0f, h, 0.0f, 0.0f }, { 0.0f, 0.0f, range, 1.0f }, { 0.0f, 0.0f, -range * nearZ, 0.0f } } };
+	}
+
+	inline Float4x4 lookAtLH(const Float3& eye, const Float3& focus, const Float3& up)
+	{
+		Float3 zAxis{ normalize(focus - eye) };
+		Float3 xAxis{ normalize(cross(up, zAxis)) };
+		Float3 yAxis{ cross(zAxis, xAxis) };
+		return{ {
+			{ xAxis.x, yAxis.x, zAxis.x, 0.0f },
+			{ xAxis.y, yAxis.y, zAxis.y, 0.0f },
+			{ xAxis.z, yAxis.z, zAxis.z, 0.0f },
+			{ -dot(xAxis, eye), -dot(yAxis, eye), -dot(zAxis, eye), 1.0f }
+		} };
+	}
+}
\ No newline at end of file
@@ -0,0 +1,1107 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include "JobSystem.h"
+
+using namespace std;
+
+namespace
+{
+	// plane through an open edge, perpendicular to its triangle, against the area weighted triangle planes
+	const double borderWeight{ 10.0 };
+	// vertices at one position that a collapse can map; positions with more never move
+	const uint32_t maxWedges{ 4 };
+	// owners of positions used by more than one cluster, and of ones not yet seen
+	const uint32_t sharedPosition{ UINT32_MAX };
+	const uint32_t unownedPosition{ UINT32_MAX - 1 };
+
+	enum class PositionKind : uint8_t
+	{
+		// may collapse into any neighbour
+		Manifold,
+		// on exactly two open edges, a border or a seam, and may only collapse along them
+		Border,
+		// a corner, or shared with another cluster
+		Locked
+	};
+
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+
+	Quadric makePlaneQuadric(const Float3& normal, const Float3& point, double weight)
+	{
+		double x{ normal.x };
+		double y{ normal.y };
+		double z{ normal.z };
+		double d{ -(x * point.x + y * point.y + z * point.z) };
+		return{ x * x * weight, x * y * weight, x * z * weight, y * y * weight, y * z * weight, z * z * weight,
+			x * d * weight, y * d * weight, z * d * weight, d * d * weight, weight };
+	}
+
+	void addQuadric(Quadric& q, const Quadric& r)
+	{
+		q.a00 += r.a00;
+		q.a01 += r.a01;
+		q.a02 += r.a02;
+		q.a11 += r.a11;
+		q.a12 += r.a12;
+		q.a22 += r.a22;
+		q.b0 += r.b0;
+		q.b1 += r.b1;
+		q.b2 += r.b2;
+		q.c += r.c;
+		q.weight += r.weight;
+	}
+
+	// weighted mean squared distance of p to the planes of q
+	double getQuadricError(const Quadric& q, const Float3& p)
+	{
+		double x{ p.x };
+		double y{ p.y };
+		double z{ p.z };
+		double e{ q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+			2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c };
+		return q.weight > 0.0 ? max(e, 0.0) / q.weight : 0.0;
+	}
+
+	bool isSamePosition(const Float3& a, const Float3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	bool isLessPosition(const Float3& a, const Float3& b)
+	{
+		return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+	}
+
+	uint64_t makeEdgeKey(uint32_t a, uint32_t b)
+	{
+		return static_cast<uint64_t>(a) << 32 | b;
+	}
+
+	// The input with vertices of the same position and color merged into the first of them and triangles of
+	// zero area by position dropped; the vertices are grouped by position for the topology.
+	struct WeldedMesh
+	{
+		vector<Float3> positions;
+		// by input vertex
+		vector<uint32_t> positionOf;
+		// input vertices
+		vector<uint32_t> indices;
+		Float3 center;
+		float radius;
+	};
+
+	void weldMesh(const TessellatedMesh& mesh, WeldedMesh& welded)
+	{
+		const vector<Float3>& positions{ mesh.positions };
+		bool hasColors{ mesh.colors.size() == positions.size() };
+		vector<uint32_t> order(positions.size());
+		iota(order.begin(), order.end(), 0);
+		sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+		{
+			if (!isSamePosition(positions[a], positions[b]))
+			{
+				return isLessPosition(positions[a], positions[b]);
+			}
+			if (hasColors && !isSamePosition(mesh.colors[a], mesh.colors[b]))
+			{
+				return isLessPosition(mesh.colors[a], mesh.colors[b]);
+			}
+			return a < b;
+		});
+
+		vector<uint32_t> canonical(positions.size());
+		welded.positions.clear();
+		welded.positionOf.assign(positions.size(), 0);
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			uint32_t v{ order[i] };
+			bool samePosition{ i > 0 && isSamePosition(positions[order[i - 1]], positions[v]) };
+			bool sameVertex{ samePosition && (!hasColors || isSamePosition(mesh.colors[order[i - 1]], mesh.colors[v])) };
+			canonical[v] = sameVertex ? canonical[order[i - 1]] : v;
+			if (!samePosition)
+			{
+				welded.positions.push_back(positions[v]);
+			}
+			welded.positionOf[v] = static_cast<uint32_t>(welded.positions.size() - 1);
+		}
+
+		welded.indices.clear();
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			uint32_t a{ mesh.indices[i] };
+			uint32_t b{ mesh.indices[i + 1] };
+			uint32_t c{ mesh.indices[i + 2] };
+			if (a >= positions.size() || b >= positions.size() || c >= positions.size())
+			{
+				throw(runtime_error{ "Mesh index out of range." });
+			}
+			uint32_t pa{ welded.positionOf[a] };
+			uint32_t pb{ welded.positionOf[b] };
+			uint32_t pc{ welded.positionOf[c] };
+			if (pa != pb && pb != pc && pa != pc)
+			{
+				welded.indices.insert(welded.indices.end(), { canonical[a], canonical[b], canonical[c] });
+			}
+		}
+
+		Float3 low{ numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::max() };
+		Float3 high{ -low.x, -low.y, -low.z };
+		for (const Float3& p : welded.positions)
+		{
+			low = { min(low.x, p.x), min(low.y, p.y), min(low.z, p.z) };
+			high = { max(high.x, p.x), max(high.y, p.y), max(high.z, p.z) };
+		}
+		welded.center = welded.positions.empty() ? Float3{ 0.0f, 0.0f, 0.0f } : (low + high) * 0.5f;
+		welded.radius = 0.0f;
+		for (const Float3& p : welded.positions)
+		{
+			welded.radius = max(welded.radius, math::length(p - welded.center));
+		}
+	}
+
+	// Triangles around each position of a set of triangles and how each position may collapse. The positions of
+	// the corners, by index, are set before build and number from 0 to positionCount.
+	struct Topology
+	{
+		vector<uint32_t> cornerPositions;
+		vector<uint32_t> triangleOffsets;
+		vector<uint32_t> triangles;
+		// by index, whether the edge to the triangle's next corner is open: no triangle runs it the other way, so
+		// it is on a border or a seam
+		vector<uint8_t> openEdges;
+		// distinct vertices at each position
+		vector<uint32_t> wedgeOffsets;
+		vector<uint32_t> wedges;
+		vector<PositionKind> kinds;
+		// the two positions along the open edges of a Border position
+		vector<uint32_t> openNeighbors;
+
+		// locked flags positions that must not move, by local position, or null for none
+		void build(const vector<uint32_t>& indices, size_t positionCount, const vector<uint8_t>* locked)
+		{
+			triangleOffsets.assign(positionCount + 1, 0);
+			for (uint32_t p : cornerPositions)
+			{
+				++triangleOffsets[p + 1];
+			}
+			partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+			triangles.resize(cornerPositions.size());
+			vector<uint32_t> cursors{ triangleOffsets.begin(), triangleOffsets.end() - 1 };
+			for (size_t i = 0; i < cornerPositions.size(); ++i)
+			{
+				triangles[cursors[cornerPositions[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			// the triangle running an edge the other way has a corner at the edge's start too
+			openEdges.resize(indices.size());
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				uint32_t a{ indices[i] };
+				uint32_t b{ indices[i - i % 3 + (i + 1) % 3] };
+				uint32_t p{ cornerPositions[i] };
+				openEdges[i] = 1;
+				for (uint32_t j = triangleOffsets[p]; j < triangleOffsets[p + 1] && openEdges[i] != 0; ++j)
+				{
+					const uint32_t* other{ &indices[triangles[j] * 3] };
+					openEdges[i] = (other[0] == b && other[1] == a) || (other[1] == b && other[2] == a) || (other[2] == b && other[0] == a) ? 0 : 1;
+				}
+			}
+
+			wedgeOffsets.assign(positionCount + 1, 0);
+			wedges.clear();
+			for (uint32_t p = 0; p < positionCount; ++p)
+			{
+				for (uint32_t i = triangleOffsets[p]; i < triangleOffsets[p + 1]; ++i)
+				{
+					size_t t{ triangles[i] };
+					uint32_t v{ indices[t * 3 + (cornerPositions[t * 3] == p ? 0 : cornerPositions[t * 3 + 1] == p ? 1 : 2)] };
+					if (find(wedges.begin() + wedgeOffsets[p], wedges.end(), v) == wedges.end())
+					{
+						wedges.push_back(v);
+					}
+				}
+				wedgeOffsets[p + 1] = static_cast<uint32_t>(wedges.size());
+			}
+
+			kinds.assign(positionCount, PositionKind::Locked);
+			openNeighbors.assign(positionCount * 2, UINT32_MAX);
+			for (uint32_t p = 0; p < positionCount; ++p)
+			{
+				if ((locked != nullptr && (*locked)[p] != 0) || triangleOffsets[p] == triangleOffsets[p + 1])
+				{
+					continue;
+				}
+
+				uint32_t neighbors[3];
+				uint32_t neighborCount{ 0 };
+				for (uint32_t i = triangleOffsets[p]; i < triangleOffsets[p + 1] && neighborCount < 3; ++i)
+				{
+					size_t t{ triangles[i] };
+					for (size_t k = 0; k < 3; ++k)
+					{
+						if (cornerPositions[t * 3 + k] != p)
+						{
+							continue;
+						}
+						size_t next{ t * 3 + (k + 1) % 3 };
+						size_t previous{ t * 3 + (k + 2) % 3 };
+						uint32_t candidates[2]{ openEdges[t * 3 + k] != 0 ? cornerPositions[next] : UINT32_MAX,
+							openEdges[previous] != 0 ? cornerPositions[previous] : UINT32_MAX };
+						for (uint32_t q : candidates)
+						{
+							if (q != UINT32_MAX && neighborCount < 3 && find(neighbors, neighbors + neighborCount, q) == neighbors + neighborCount)
+							{
+								neighbors[neighborCount++] = q;
+							}
+						}
+					}
+				}
+
+				uint32_t wedgeCount{ wedgeOffsets[p + 1] - wedgeOffsets[p] };
+				if (neighborCount == 0 && wedgeCount == 1)
+				{
+					kinds[p] = PositionKind::Manifold;
+				}
+				else if (neighborCount == 2 && wedgeCount <= maxWedges)
+				{
+					kinds[p] = PositionKind::Border;
+					openNeighbors[p * 2] = neighbors[0];
+					openNeighbors[p * 2 + 1] = neighbors[1];
+				}
+			}
+		}
+
+		bool canCollapse(uint32_t from, uint32_t to) const
+		{
+			return kinds[from] == PositionKind::Manifold ||
+				(kinds[from] == PositionKind::Border && (openNeighbors[from * 2] == to || openNeighbors[from * 2 + 1] == to));
+		}
+
+		bool isAdjacent(uint32_t p, uint32_t q) const
+		{
+			for (uint32_t i = triangleOffsets[p]; i < triangleOffsets[p + 1]; ++i)
+			{
+				const uint32_t* corners{ &cornerPositions[triangles[i] * 3] };
+				if (corners[0] == q || corners[1] == q || corners[2] == q)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double error;
+	};
+
+	struct SimplifyState
+	{
+		const WeldedMesh* mesh;
+		vector<Quadric> quadrics;
+		// by position, the cluster whose triangles use it or sharedPosition
+		vector<uint32_t> owners;
+		// by vertex, the vertex it collapsed into
+		vector<uint32_t> vertexRemap;
+		double maxError;
+	};
+
+	struct ClusterResult
+	{
+		vector<uint32_t> indices;
+		// quadrics of collapsed positions to add to shared positions once every cluster is done
+		vector<pair<uint32_t, Quadric>> sharedMerges;
+		double error;
+		size_t collapses;
+	};
+
+	void initializeQuadrics(const WeldedMesh& mesh, vector<Quadric>& quadrics)
+	{
+		quadrics.assign(mesh.positions.size(), Quadric{});
+		vector<uint64_t> edges(mesh.indices.size());
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			for (size_t k = 0; k < 3; ++k)
+			{
+				edges[i + k] = makeEdgeKey(mesh.indices[i + k], mesh.indices[i + (k + 1) % 3]);
+			}
+		}
+		sort(edges.begin(), edges.end());
+
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			uint32_t p[3]{ mesh.positionOf[mesh.indices[i]], mesh.positionOf[mesh.indices[i + 1]], mesh.positionOf[mesh.indices[i + 2]] };
+			const Float3& a{ mesh.positions[p[0]] };
+			Float3 normal{ math::cross(mesh.positions[p[1]] - a, mesh.positions[p[2]] - a) };
+			float area{ math::length(normal) * 0.5f };
+			if (area == 0.0f)
+			{
+				continue;
+			}
+			normal = normal * (0.5f / area);
+			Quadric plane{ makePlaneQuadric(normal, a, area) };
+			for (size_t k = 0; k < 3; ++k)
+			{
+				addQuadric(quadrics[p[k]], plane);
+
+				uint32_t from{ mesh.indices[i + k] };
+				uint32_t to{ mesh.indices[i + (k + 1) % 3] };
+				if (!binary_search(edges.begin(), edges.end(), makeEdgeKey(to, from)))
+				{
+					const Float3& start{ mesh.positions[p[k]] };
+					Float3 edge{ mesh.positions[p[(k + 1) % 3]] - start };
+					Quadric border{ makePlaneQuadric(math::normalize(math::cross(edge, normal)), start, math::dot(edge, edge) * borderWeight) };
+					addQuadric(quadrics[p[k]], border);
+					addQuadric(quadrics[p[(k + 1) % 3]], border);
+				}
+			}
+		}
+	}
+
+	// collapses from into to if the vertices map onto each other, the mesh stays manifold and nothing flips
+	bool tryCollapse(SimplifyState& state, const vector<uint32_t>& localPositions, const vector<uint32_t>& indices, const Topology& topology,
+		const Collapse& collapse, vector<uint8_t>& touched, vector<uint32_t>& positionRemap, ClusterResult& result, size_t& removedTriangles)
+	{
+		const WeldedMesh& mesh{ *state.mesh };
+		uint32_t from{ collapse.from };
+		uint32_t to{ collapse.to };
+
+		uint32_t wedgeCount{ topology.wedgeOffsets[from + 1] - topology.wedgeOffsets[from] };
+		if (wedgeCount > maxWedges)
+		{
+			return false;
+		}
+		const uint32_t* wedges{ &topology.wedges[topology.wedgeOffsets[from]] };
+		uint32_t targets[maxWedges];
+		fill_n(targets, maxWedges, UINT32_MAX);
+		uint32_t wings[maxWedges * 2];
+		uint32_t wingCount{ 0 };
+		for (uint32_t i = topology.triangleOffsets[from]; i < topology.triangleOffsets[from + 1]; ++i)
+		{
+			size_t t{ topology.triangles[i] };
+			const uint32_t* corners{ &topology.cornerPositions[t * 3] };
+			size_t fromCorner{ corners[0] == from ? 0u : corners[1] == from ? 1u : 2u };
+			size_t toCorner{ corners[0] == to ? 0u : corners[1] == to ? 1u : corners[2] == to ? 2u : 3u };
+			if (toCorner == 3)
+			{
+				continue;
+			}
+
+			size_t wedge{ static_cast<size_t>(find(wedges, wedges + wedgeCount, indices[t * 3 + fromCorner]) - wedges) };
+			uint32_t target{ indices[t * 3 + toCorner] };
+			if ((targets[wedge] != UINT32_MAX && targets[wedge] != target) || wingCount == maxWedges * 2)
+			{
+				return false;
+			}
+			targets[wedge] = target;
+			wings[wingCount++] = corners[3 - fromCorner - toCorner];
+		}
+		if (wingCount == 0 || find(targets, targets + wedgeCount, UINT32_MAX) != targets + wedgeCount)
+		{
+			return false;
+		}
+
+		// Only the wings of the removed triangles may be neighbours of both. The triangles of a shared position
+		// are partly in other clusters, so around one a shared neighbour that is no wing is taken as common.
+		bool toShared{ state.owners[localPositions[to]] == sharedPosition };
+		const Float3& target{ mesh.positions[localPositions[to]] };
+		for (uint32_t i = topology.triangleOffsets[from]; i < topology.triangleOffsets[from + 1]; ++i)
+		{
+			size_t t{ topology.triangles[i] };
+			const uint32_t* corners{ &topology.cornerPositions[t * 3] };
+			if (corners[0] == to || corners[1] == to || corners[2] == to)
+			{
+				continue;
+			}
+
+			for (size_t k = 0; k < 3; ++k)
+			{
+				uint32_t neighbor{ corners[k] };
+				if (neighbor == from || find(wings, wings + wingCount, neighbor) != wings + wingCount)
+				{
+					continue;
+				}
+				if ((toShared && state.owners[localPositions[neighbor]] == sharedPosition) || topology.isAdjacent(to, neighbor))
+				{
+					return false;
+				}
+			}
+
+			Float3 p[3]{ mesh.positions[localPositions[corners[0]]], mesh.positions[localPositions[corners[1]]], mesh.positions[localPositions[corners[2]]] };
+			Float3 before{ math::cross(p[1] - p[0], p[2] - p[0]) };
+			for (Float3& position : p)
+			{
+				position = isSamePosition(position, mesh.positions[localPositions[from]]) ? target : position;
+			}
+			Float3 after{ math::cross(p[1] - p[0], p[2] - p[0]) };
+			if (math::dot(before, after) <= 0.0f)
+			{
+				return false;
+			}
+		}
+
+		for (uint32_t i = 0; i < wedgeCount; ++i)
+		{
+			state.vertexRemap[wedges[i]] = targets[i];
+		}
+		positionRemap[from] = to;
+		const Quadric& quadric{ state.quadrics[localPositions[from]] };
+		if (toShared)
+		{
+			result.sharedMerges.push_back({ localPositions[to], quadric });
+		}
+		else
+		{
+			addQuadric(state.quadrics[localPositions[to]], quadric);
+		}
+
+		for (uint32_t i = topology.triangleOffsets[from]; i < topology.triangleOffsets[from + 1]; ++i)
+		{
+			const uint32_t* corners{ &topology.cornerPositions[topology.triangles[i] * 3] };
+			touched[corners[0]] = touched[corners[1]] = touched[corners[2]] = 1;
+		}
+		removedTriangles += wingCount;
+		result.error = max(result.error, collapse.error);
+		++result.collapses;
+		return true;
+	}
+
+	void simplifyCluster(SimplifyState& state, uint32_t cluster, const uint32_t* clusterTriangles, size_t triangleCount, size_t targetTriangles,
+		const vector<uint32_t>& indices, ClusterResult& result)
+	{
+		const WeldedMesh& mesh{ *state.mesh };
+		result.indices.resize(triangleCount * 3);
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			copy_n(&indices[clusterTriangles[i] * 3], 3, &result.indices[i * 3]);
+		}
+
+		vector<uint32_t> localPositions(result.indices.size());
+		for (size_t i = 0; i < result.indices.size(); ++i)
+		{
+			localPositions[i] = mesh.positionOf[result.indices[i]];
+		}
+		sort(localPositions.begin(), localPositions.end());
+		localPositions.erase(unique(localPositions.begin(), localPositions.end()), localPositions.end());
+		vector<uint8_t> locked(localPositions.size());
+		for (size_t p = 0; p < localPositions.size(); ++p)
+		{
+			locked[p] = state.owners[localPositions[p]] != cluster ? 1 : 0;
+		}
+
+		Topology topology;
+		topology.cornerPositions.resize(result.indices.size());
+		for (size_t i = 0; i < result.indices.size(); ++i)
+		{
+			topology.cornerPositions[i] = static_cast<uint32_t>(lower_bound(localPositions.begin(), localPositions.end(),
+				mesh.positionOf[result.indices[i]]) - localPositions.begin());
+		}
+		vector<uint32_t> positionRemap(localPositions.size());
+		iota(positionRemap.begin(), positionRemap.end(), 0);
+
+		vector<uint32_t> visited;
+		vector<Collapse> candidates;
+		vector<uint8_t> touched;
+		bool passLimited{ true };
+		while (result.indices.size() / 3 > targetTriangles)
+		{
+			topology.build(result.indices, localPositions.size(), &locked);
+
+			// every edge once, from the end with the lower position, in its cheaper direction
+			candidates.clear();
+			visited.assign(localPositions.size(), UINT32_MAX);
+			for (uint32_t p = 0; p < localPositions.size(); ++p)
+			{
+				for (uint32_t i = topology.triangleOffsets[p]; i < topology.triangleOffsets[p + 1]; ++i)
+				{
+					for (size_t k = 0; k < 3; ++k)
+					{
+						uint32_t q{ topology.cornerPositions[topology.triangles[i] * 3 + k] };
+						if (q <= p || visited[q] == p)
+						{
+							continue;
+						}
+						visited[q] = p;
+
+						uint32_t ends[2]{ p, q };
+						Collapse best{ 0, 0, numeric_limits<double>::infinity() };
+						for (size_t e = 0; e < 2; ++e)
+						{
+							if (topology.canCollapse(ends[e], ends[1 - e]))
+							{
+								double error{ getQuadricError(state.quadrics[localPositions[ends[e]]], mesh.positions[localPositions[ends[1 - e]]]) };
+								best = error < best.error ? Collapse{ ends[e], ends[1 - e], error } : best;
+							}
+						}
+						if (best.error <= state.maxError)
+						{
+							candidates.push_back(best);
+						}
+					}
+				}
+			}
+			// A pass only takes collapses up to a bit above the error of the one that would reach the target if
+			// each removed two triangles, so the cheap collapses a pass blocks come before the expensive ones.
+			size_t goal{ (result.indices.size() / 3 - targetTriangles) / 2 };
+			double passError{ state.maxError };
+			if (passLimited && goal < candidates.size())
+			{
+				nth_element(candidates.begin(), candidates.begin() + goal, candidates.end(), [](const Collapse& a, const Collapse& b)
+				{
+					return a.error < b.error;
+				});
+				passError = candidates[goal].error * 1.5;
+			}
+			auto last = partition(candidates.begin(), candidates.end(), [passError](const Collapse& c) { return c.error <= passError; });
+			sort(candidates.begin(), last, [](const Collapse& a, const Collapse& b)
+			{
+				return a.error != b.error ? a.error < b.error : a.from != b.from ? a.from < b.from : a.to < b.to;
+			});
+			candidates.erase(last, candidates.end());
+
+			touched.assign(localPositions.size(), 0);
+			size_t collapses{ result.collapses };
+			size_t removedTriangles{ 0 };
+			for (const Collapse& collapse : candidates)
+			{
+				if (result.indices.size() / 3 - removedTriangles <= targetTriangles || collapse.error > passError)
+				{
+					break;
+				}
+				if (touched[collapse.from] == 0 && touched[collapse.to] == 0)
+				{
+					tryCollapse(state, localPositions, result.indices, topology, collapse, touched, positionRemap, result, removedTriangles);
+				}
+			}
+			if (result.collapses == collapses)
+			{
+				if (passError >= state.maxError)
+				{
+					break;
+				}
+				// everything below the pass limit was rejected, try the rest
+				passLimited = false;
+				continue;
+			}
+			passLimited = true;
+
+			vector<uint32_t>& corners{ topology.cornerPositions };
+			size_t kept{ 0 };
+			for (size_t i = 0; i < result.indices.size(); i += 3)
+			{
+				uint32_t p[3]{ positionRemap[corners[i]], positionRemap[corners[i + 1]], positionRemap[corners[i + 2]] };
+				if (p[0] != p[1] && p[1] != p[2] && p[0] != p[2])
+				{
+					for (size_t k = 0; k < 3; ++k)
+					{
+						result.indices[kept] = state.vertexRemap[result.indices[i + k]];
+						corners[kept++] = p[k];
+					}
+				}
+			}
+			result.indices.resize(kept);
+			corners.resize(kept);
+		}
+	}
+
+	uint32_t spreadBits(uint32_t v)
+	{
+		v &= 0x3ff;
+		v = (v | v << 16) & 0x030000ff;
+		v = (v | v << 8) & 0x0300f00f;
+		v = (v | v << 4) & 0x030c30c3;
+		v = (v | v << 2) & 0x09249249;
+		return v;
+	}
+
+	// triangles sorted along a Morton curve through their centroids, so consecutive ones are close together
+	vector<uint32_t> sortTriangles(const WeldedMesh& mesh, const vector<uint32_t>& indices)
+	{
+		vector<uint64_t> keys(indices.size() / 3);
+		float scale{ mesh.radius > 0.0f ? 511.5f / mesh.radius : 0.0f };
+		for (size_t t = 0; t < keys.size(); ++t)
+		{
+			Float3 centroid{ (mesh.positions[mesh.positionOf[indices[t * 3]]] + mesh.positions[mesh.positionOf[indices[t * 3 + 1]]] +
+				mesh.positions[mesh.positionOf[indices[t * 3 + 2]]]) * (1.0f / 3.0f) - mesh.center };
+			uint32_t x{ static_cast<uint32_t>(min(max((centroid.x * scale + 512.0f), 0.0f), 1023.0f)) };
+			uint32_t y{ static_cast<uint32_t>(min(max((centroid.y * scale + 512.0f), 0.0f), 1023.0f)) };
+			uint32_t z{ static_cast<uint32_t>(min(max((centroid.z * scale + 512.0f), 0.0f), 1023.0f)) };
+			keys[t] = static_cast<uint64_t>(spreadBits(x) | spreadBits(y) << 1 | spreadBits(z) << 2) << 32 | t;
+		}
+		sort(keys.begin(), keys.end());
+
+		vector<uint32_t> order(keys.size());
+		for (size_t t = 0; t < keys.size(); ++t)
+		{
+			order[t] = static_cast<uint32_t>(keys[t]);
+		}
+		return order;
+	}
+
+	// Ericson, Real-Time Collision Detection 5.1.5
+	Float3 getClosestPointOnTriangle(const Float3& p, const Float3& a, const Float3& b, const Float3& c)
+	{
+		Float3 ab{ b - a };
+		Float3 ac{ c - a };
+		Float3 ap{ p - a };
+		float d1{ math::dot(ab, ap) };
+		float d2{ math::dot(ac, ap) };
+		if (d1 <= 0.0f && d2 <= 0.0f)
+		{
+			return a;
+		}
+
+		Float3 bp{ p - b };
+		float d3{ math::dot(ab, bp) };
+		float d4{ math::dot(ac, bp) };
+		if (d3 >= 0.0f && d4 <= d3)
+		{
+			return b;
+		}
+
+		float vc{ d1 * d4 - d3 * d2 };
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		{
+			return a + ab * (d1 / (d1 - d3));
+		}
+
+		Float3 cp{ p - c };
+		float d5{ math::dot(ab, cp) };
+		float d6{ math::dot(ac, cp) };
+		if (d6 >= 0.0f && d5 <= d6)
+		{
+			return c;
+		}
+
+		float vb{ d5 * d2 - d1 * d6 };
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		{
+			return a + ac * (d2 / (d2 - d6));
+		}
+
+		float va{ d3 * d6 - d5 * d4 };
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+		{
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		}
+
+		float denominator{ 1.0f / (va + vb + vc) };
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	// kinds of the welded positions of a whole mesh
+	vector<PositionKind> getPositionKinds(const WeldedMesh& mesh)
+	{
+		Topology topology;
+		topology.cornerPositions.resize(mesh.indices.size());
+		for (size_t i = 0; i < mesh.indices.size(); ++i)
+		{
+			topology.cornerPositions[i] = mesh.positionOf[mesh.indices[i]];
+		}
+		topology.build(mesh.indices, mesh.positions.size(), nullptr);
+		return topology.kinds;
+	}
+
+	uint32_t findPosition(const WeldedMesh& mesh, const Float3& position)
+	{
+		auto found = lower_bound(mesh.positions.begin(), mesh.positions.end(), position, isLessPosition);
+		return found != mesh.positions.end() && isSamePosition(*found, position) ? static_cast<uint32_t>(found - mesh.positions.begin()) : UINT32_MAX;
+	}
+
+	void checkSimplifiedMesh(const TessellatedMesh& input, const TessellatedMesh& output, const string& name)
+	{
+		WeldedMesh weldedInput;
+		WeldedMesh weldedOutput;
+		weldMesh(input, weldedInput);
+		weldMesh(output, weldedOutput);
+		if (weldedOutput.indices.size() != output.indices.size())
+		{
+			throw(runtime_error{ "Simplified mesh " + name + " has degenerate triangles." });
+		}
+
+		vector<PositionKind> inputKinds{ getPositionKinds(weldedInput) };
+		vector<PositionKind> outputKinds{ getPositionKinds(weldedOutput) };
+		vector<uint8_t> used(weldedInput.positions.size(), 0);
+		for (uint32_t v : weldedInput.indices)
+		{
+			used[weldedInput.positionOf[v]] = 1;
+		}
+		for (size_t p = 0; p < weldedInput.positions.size(); ++p)
+		{
+			if (used[p] != 0 && inputKinds[p] == PositionKind::Locked && findPosition(weldedOutput, weldedInput.positions[p]) == UINT32_MAX)
+			{
+				throw(runtime_error{ "Simplified mesh " + name + " lost a corner." });
+			}
+		}
+		for (size_t p = 0; p < weldedOutput.positions.size(); ++p)
+		{
+			uint32_t inputPosition{ findPosition(weldedInput, weldedOutput.positions[p]) };
+			if (inputPosition == UINT32_MAX)
+			{
+				throw(runtime_error{ "Simplified mesh " + name + " has a vertex that is not in the input." });
+			}
+			if (outputKinds[p] != PositionKind::Manifold && inputKinds[inputPosition] == PositionKind::Manifold)
+			{
+				throw(runtime_error{ "Simplified mesh " + name + " opened a border or seam." });
+			}
+		}
+	}
+
+	SimplifyBenchmarkResult runSimplifyCase(const string& name, const TessellatedMesh& mesh, const SimplifySettings& settings, JobSystem* jobs,
+		TessellatedMesh& simplified)
+	{
+		auto begin = chrono::steady_clock::now();
+		SimplifyResult simplification{ teapot_tutorial::simplifyMesh(mesh, settings, simplified, jobs) };
+		auto end = chrono::steady_clock::now();
+
+		checkSimplifiedMesh(mesh, simplified, name);
+		SimplifyBenchmarkResult result;
+		result.name = name;
+		result.threads = jobs != nullptr ? jobs->getThreadCount() : 1;
+		result.inputTriangles = simplification.inputTriangles;
+		result.triangles = simplification.triangles;
+		result.ms = chrono::duration<double, milli>(end - begin).count();
+		result.trianglesPerSecond = result.ms > 0.0 ? result.inputTriangles * 1000.0 / result.ms : 0.0;
+		result.estimatedError = simplification.error;
+		result.distance = teapot_tutorial::measureMeshDistance(mesh, simplified);
+		return result;
+	}
+}
+
+namespace teapot_tutorial
+{
+	SimplifyResult simplifyMesh(const TessellatedMesh& mesh, const SimplifySettings& settings, TessellatedMesh& simplified, JobSystem* jobs)
+	{
+		if (mesh.positions.size() >= UINT32_MAX || settings.clusterTriangles == 0 || !(settings.targetError >= 0.0f))
+		{
+			throw(runtime_error{ "Invalid mesh simplification input." });
+		}
+
+		WeldedMesh welded;
+		weldMesh(mesh, welded);
+		SimplifyState state;
+		state.mesh = &welded;
+		initializeQuadrics(welded, state.quadrics);
+		state.vertexRemap.resize(mesh.positions.size());
+		iota(state.vertexRemap.begin(), state.vertexRemap.end(), 0);
+		double maxDistance{ static_cast<double>(settings.targetError) * welded.radius };
+		state.maxError = maxDistance * maxDistance;
+
+		SimplifyResult result;
+		result.inputTriangles = mesh.getTriangleCount();
+		result.passes = 0;
+		result.clusters = 0;
+		result.error = 0.0f;
+
+		vector<uint32_t> indices{ welded.indices };
+		vector<ClusterResult> clusters;
+		double error{ 0.0 };
+		for (size_t clusterTriangles = settings.clusterTriangles; indices.size() / 3 > settings.targetTriangles; clusterTriangles *= 2)
+		{
+			size_t triangleCount{ indices.size() / 3 };
+			uint32_t clusterCount{ static_cast<uint32_t>((triangleCount + clusterTriangles - 1) / clusterTriangles) };
+			vector<uint32_t> order{ sortTriangles(welded, indices) };
+
+			state.owners.assign(welded.positions.size(), unownedPosition);
+			for (size_t i = 0; i < order.size(); ++i)
+			{
+				uint32_t cluster{ static_cast<uint32_t>(i / clusterTriangles) };
+				for (size_t k = 0; k < 3; ++k)
+				{
+					uint32_t& owner{ state.owners[welded.positionOf[indices[order[i] * 3 + k]]] };
+					owner = owner == unownedPosition || owner == cluster ? cluster : sharedPosition;
+				}
+			}
+
+			// Clusters cannot trade triangles for error with each other, so while there are several each pass
+			// at most halves them and the passes with fewer, larger clusters put the detail where it matters.
+			size_t passTarget{ clusterCount > 1 ? max(settings.targetTriangles, triangleCount / 2) : settings.targetTriangles };
+			clusters.assign(clusterCount, ClusterResult{});
+			auto simplifyClusters = [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t c = begin; c < end; ++c)
+				{
+					size_t first{ c * clusterTriangles };
+					size_t count{ min(clusterTriangles, triangleCount - first) };
+					// the target split in proportion, rounded up so the clusters together never undershoot it
+					size_t target{ (passTarget * count + triangleCount - 1) / triangleCount };
+					clusters[c].error = 0.0;
+					clusters[c].collapses = 0;
+					simplifyCluster(state, c, &order[first], count, target, indices, clusters[c]);
+				}
+			};
+			if (jobs != nullptr && clusterCount > 1)
+			{
+				jobs->parallelFor(0, clusterCount, 1, simplifyClusters);
+			}
+			else
+			{
+				simplifyClusters(0, clusterCount);
+			}
+
+			indices.clear();
+			for (ClusterResult& cluster : clusters)
+			{
+				indices.insert(indices.end(), cluster.indices.begin(), cluster.indices.end());
+				for (const pair<uint32_t, Quadric>& merge : cluster.sharedMerges)
+				{
+					addQuadric(state.quadrics[merge.first], merge.second);
+				}
+				error = max(error, cluster.error);
+			}
+			result.clusters = result.passes == 0 ? clusterCount : result.clusters;
+			++result.passes;
+			if (clusterCount == 1)
+			{
+				break;
+			}
+		}
+
+		// compact the vertices the triangles still use, in input order
+		vector<uint32_t> newIndices(mesh.positions.size(), UINT32_MAX);
+		for (uint32_t v : indices)
+		{
+			newIndices[v] = 0;
+		}
+		bool hasColors{ mesh.colors.size() == mesh.positions.size() };
+		simplified.positions.clear();
+		simplified.colors.clear();
+		for (size_t v = 0; v < newIndices.size(); ++v)
+		{
+			if (newIndices[v] == 0)
+			{
+				newIndices[v] = static_cast<uint32_t>(simplified.positions.size());
+				simplified.positions.push_back(mesh.positions[v]);
+				if (hasColors)
+				{
+					simplified.colors.push_back(mesh.colors[v]);
+				}
+			}
+		}
+		simplified.indices.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			simplified.indices[i] = newIndices[indices[i]];
+		}
+
+		result.triangles = simplified.getTriangleCount();
+		result.error = welded.radius > 0.0f ? static_cast<float>(sqrt(error) / welded.radius) : 0.0f;
+		return result;
+	}
+
+	MeshDistance measureMeshDistance(const TessellatedMesh& from, const TessellatedMesh& to)
+	{
+		MeshDistance distance{ 0.0f, 0.0f };
+		size_t triangleCount{ to.getTriangleCount() };
+		if (from.positions.empty() || triangleCount == 0)
+		{
+			return distance;
+		}
+
+		Float3 low{ numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::max() };
+		Float3 high{ -low.x, -low.y, -low.z };
+		for (const vector<Float3>* positions : { &from.positions, &to.positions })
+		{
+			for (const Float3& p : *positions)
+			{
+				low = { min(low.x, p.x), min(low.y, p.y), min(low.z, p.z) };
+				high = { max(high.x, p.x), max(high.y, p.y), max(high.z, p.z) };
+			}
+		}
+		Float3 extent{ high - low };
+		float cellSize{ max(max(max(extent.x, extent.y), extent.z), 1e-6f) / max(static_cast<float>(cbrt(static_cast<double>(triangleCount))), 1.0f) };
+		int32_t size[3]{ static_cast<int32_t>(extent.x / cellSize) + 1, static_cast<int32_t>(extent.y / cellSize) + 1, static_cast<int32_t>(extent.z / cellSize) + 1 };
+		auto getCell = [&](const Float3& p, int32_t* cell)
+		{
+			const float coordinates[3]{ p.x - low.x, p.y - low.y, p.z - low.z };
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				cell[axis] = min(max(static_cast<int32_t>(coordinates[axis] / cellSize), 0), size[axis] - 1);
+			}
+		};
+
+		// triangles by the cells their bounds overlap
+		vector<uint32_t> cellOffsets(static_cast<size_t>(size[0]) * size[1] * size[2] + 1, 0);
+		vector<uint32_t> cellTriangles;
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				const Float3& a{ to.positions[to.indices[t * 3]] };
+				const Float3& b{ to.positions[to.indices[t * 3 + 1]] };
+				const Float3& c{ to.positions[to.indices[t * 3 + 2]] };
+				int32_t first[3];
+				int32_t last[3];
+				getCell({ min(min(a.x, b.x), c.x), min(min(a.y, b.y), c.y), min(min(a.z, b.z), c.z) }, first);
+				getCell({ max(max(a.x, b.x), c.x), max(max(a.y, b.y), c.y), max(max(a.z, b.z), c.z) }, last);
+				for (int32_t z = first[2]; z <= last[2]; ++z)
+				{
+					for (int32_t y = first[1]; y <= last[1]; ++y)
+					{
+						for (int32_t x = first[0]; x <= last[0]; ++x)
+						{
+							size_t cell{ (static_cast<size_t>(z) * size[1] + y) * size[0] + x };
+							if (pass == 0)
+							{
+								++cellOffsets[cell + 1];
+							}
+							else
+							{
+								cellTriangles[cellOffsets[cell]++] = static_cast<uint32_t>(t);
+							}
+						}
+					}
+				}
+			}
+			if (pass == 0)
+			{
+				partial_sum(cellOffsets.begin(), cellOffsets.end(), cellOffsets.begin());
+				cellTriangles.resize(cellOffsets.back());
+			}
+			else
+			{
+				// the fill advanced every offset to the start of the next cell
+				rotate(cellOffsets.begin(), cellOffsets.end() - 1, cellOffsets.end());
+				cellOffsets[0] = 0;
+			}
+		}
+
+		// rings of cells around the vertex's own until none can hold a closer triangle
+		double sum{ 0.0 };
+		float maxDistance{ 0.0f };
+		int32_t maxRing{ max(max(size[0], size[1]), size[2]) };
+		for (const Float3& p : from.positions)
+		{
+			int32_t cell[3];
+			getCell(p, cell);
+			float best{ numeric_limits<float>::max() };
+			for (int32_t ring = 0; ring <= maxRing && (ring == 0 || best > (ring - 1) * cellSize * (ring - 1) * cellSize); ++ring)
+			{
+				for (int32_t z = max(cell[2] - ring, 0); z <= min(cell[2] + ring, size[2] - 1); ++z)
+				{
+					for (int32_t y = max(cell[1] - ring, 0); y <= min(cell[1] + ring, size[1] - 1); ++y)
+					{
+						for (int32_t x = max(cell[0] - ring, 0); x <= min(cell[0] + ring, size[0] - 1); ++x)
+						{
+							if (max(max(abs(x - cell[0]), abs(y - cell[1])), abs(z - cell[2])) != ring)
+							{
+								continue;
+							}
+							size_t index{ (static_cast<size_t>(z) * size[1] + y) * size[0] + x };
+							for (uint32_t i = cellOffsets[index]; i < cellOffsets[index + 1]; ++i)
+							{
+								const uint32_t* triangle{ &to.indices[cellTriangles[i] * 3] };
+								Float3 offset{ getClosestPointOnTriangle(p, to.positions[triangle[0]], to.positions[triangle[1]], to.positions[triangle[2]]) - p };
+								best = min(best, math::dot(offset, offset));
+							}
+						}
+					}
+				}
+			}
+			float d{ sqrt(best) };
+			maxDistance = max(maxDistance, d);
+			sum += d;
+		}
+
+		WeldedMesh welded;
+		weldMesh(from, welded);
+		float scale{ welded.radius > 0.0f ? 1.0f / welded.radius : 0.0f };
+		distance.maxDistance = maxDistance * scale;
+		distance.meanDistance = static_cast<float>(sum / from.positions.size()) * scale;
+		return distance;
+	}
+
+	vector<SimplifyBenchmarkResult> runSimplifyBenchmark(const PatchModel& model, uint32_t threadCount)
+	{
+		JobSystem jobs{ min(threadCount, max(thread::hardware_concurrency(), 1u)) };
+		TessellatedMesh fine;
+		tessellate(model, 64, fine);
+		size_t triangles{ fine.getTriangleCount() };
+
+		vector<SimplifyBenchmarkResult> results;
+		TessellatedMesh single;
+		TessellatedMesh parallel;
+		SimplifySettings settings;
+		settings.targetError = numeric_limits<float>::infinity();
+		for (size_t divisor : { 2u, 16u, 128u })
+		{
+			settings.targetTriangles = triangles / divisor;
+			string name{ "f64 1/" + to_string(divisor) };
+			results.push_back(runSimplifyCase(name, fine, settings, nullptr, single));
+			results.push_back(runSimplifyCase(name, fine, settings, &jobs, parallel));
+			if (single.indices != parallel.indices || single.positions.size() != parallel.positions.size())
+			{
+				throw(runtime_error{ "Simplified mesh " + name + " depends on the thread count." });
+			}
+		}
+
+		settings.targetTriangles = 0;
+		settings.targetError = 0.001f;
+		results.push_back(runSimplifyCase("f64 err 1e-3", fine, settings, nullptr, single));
+		results.push_back(runSimplifyCase("f64 err 1e-3", fine, settings, &jobs, parallel));
+		if (single.indices != parallel.indices)
+		{
+			throw(runtime_error{ "Simplified mesh f64 err 1e-3 depends on the thread count." });
+		}
+
+		// a far LOD: as many triangles as tessellating at factor 4, against factor 4 itself
+		TessellatedMesh reference;
+		TessellatedMesh coarse;
+		tessellate(model, 32, reference);
+		tessellate(model, 4, coarse);
+		settings.targetTriangles = coarse.getTriangleCount();
+		settings.targetError = numeric_limits<float>::infinity();
+		results.push_back(runSimplifyCase("f32 to f4", reference, settings, &jobs, parallel));
+
+		SimplifyBenchmarkResult uniform;
+		uniform.name = "f4 uniform";
+		uniform.threads = 0;
+		uniform.inputTriangles = coarse.getTriangleCount();
+		uniform.triangles = coarse.getTriangleCount();
+		uniform.ms = 0.0;
+		uniform.trianglesPerSecond = 0.0;
+		uniform.estimatedError = 0.0f;
+		uniform.distance = measureMeshDistance(reference, coarse);
+		results.push_back(uniform);
+		return results;
+	}
+
+	string formatSimplifyBenchmarkResults(const vector<SimplifyBenchmarkResult>& results)
+	{
+		string text;
+		for (const SimplifyBenchmarkResult& result : results)
+		{
+			char line[256];
+			if (result.threads == 0)
+			{
+				snprintf(line, sizeof(line), "simplify %-12s %zu triangles: distance max %.5f mean %.6f\n",
+					result.name.c_str(), result.triangles, result.distance.maxDistance, result.distance.meanDistance);
+			}
+			else
+			{
+				snprintf(line, sizeof(line), "simplify %-12s %2u threads: %zu -> %zu triangles in %.2f ms, %.2f Mtris/s, error %.5f, distance max %.5f mean %.6f\n",
+					result.name.c_str(), result.threads, result.inputTriangles, result.triangles, result.ms, result.trianglesPerSecond / 1e6,
+					result.estimatedError, result.distance.maxDistance, result.distance.meanDistance);
+			}
+			text += line;
+		}
+		return text;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PatchModel.h"
+#include "PatchTessellator.h"
+
+class JobSystem;
+
+struct SimplifySettings
+{
+	// stop once at most this many triangles are left, 0 to go by targetError only
+	size_t targetTriangles{ 0 };
+	// largest error a collapse may add, as a distance relative to the mesh's bounding radius
+	float targetError{ 0.01f };
+	// triangles per cluster of the first pass; clusters double every pass until one is left
+	uint32_t clusterTriangles{ 4096 };
+};
+
+struct SimplifyResult
+{
+	size_t inputTriangles;
+	size_t triangles;
+	uint32_t passes;
+	// clusters of the first pass
+	uint32_t clusters;
+	// largest quadric error of a collapse, relative to the bounding radius
+	float error;
+};
+
+struct MeshDistance
+{
+	// from the vertices of one mesh to the surface of another, relative to the bounding radius
+	float maxDistance;
+	float meanDistance;
+};
+
+struct SimplifyBenchmarkResult
+{
+	std::string name;
+	uint32_t threads;
+	size_t inputTriangles;
+	size_t triangles;
+	double ms;
+	double trianglesPerSecond;
+	float estimatedError;
+	MeshDistance distance;
+};
+
+// Quadric error metric simplification (Garland and Heckbert) of an indexed mesh by half edge collapses, so the
+// result only uses vertices of the input. Vertices at the same position are welded; edges where the welded
+// triangles disagree on the vertex, which includes open borders and the seams between patches of different
+// colors, only collapse along themselves and vertices where more than two of them meet never move. The mesh is
+// split into clusters of nearby triangles that are simplified in parallel with the vertices they share locked,
+// then clustered again coarser until the target is met or one cluster was simplified.
+namespace teapot_tutorial
+{
+	// jobs null simplifies on the calling thread; the result does not depend on the thread count
+	SimplifyResult simplifyMesh(const TessellatedMesh& mesh, const SimplifySettings& settings, TessellatedMesh& simplified, JobSystem* jobs = nullptr);
+
+	MeshDistance measureMeshDistance(const TessellatedMesh& from, const TessellatedMesh& to);
+
+	// Simplifies the model tessellated at factor 64 to fractions of its triangles and to an error, on one thread
+	// and on threadCount (0, or more than the hardware has, for every hardware thread), and a factor 32
+	// tessellation down to the triangles of factor 4 next to factor 4 itself. Throws when an output has an
+	// invalid or degenerate triangle, loses a corner, opens a new border or seam or differs between thread counts.
+	std::vector<SimplifyBenchmarkResult> runSimplifyBenchmark(const PatchModel& model, uint32_t threadCount);
+
+	// one line per result
+	std::string formatSimplifyBenchmarkResults(const std::vector<SimplifyBenchmarkResult>& results);
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+struct ConstantBufferPerObj
+{
+	row_major float4x4 wvpMat;
+};
+ConstantBuffer<ConstantBufferPerObj> constPerObject : register(b0);
+
+// a LodChain vertex, already tessellated and transformed by its patch
+struct VertexData
+{
+	float3 pos : POSITION;
+	float3 color : COLOR;
+};
+
+struct VertexToPixel
+{
+	float4 pos : SV_POSITION;
+	float3 color : COLOR;
+};
+
+VertexToPixel main(VertexData input)
+{
+	VertexToPixel output;
+	output.pos = mul(float4(input.pos, 1.0f), constPerObject.wvpMat);
+	output.color = input.color;
+
+	return output;
+}
\ No newline at end of file
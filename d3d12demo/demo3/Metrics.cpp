@@ -0,0 +1,378 @@
+#include "Metrics.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+	uint32_t findMostSignificantBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index;
+#else
+		return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+	}
+
+	const double reportedQuantiles[]{ 0.5, 0.9, 0.99, 0.999 };
+	const char* const reportedQuantileNames[]{ "p50", "p90", "p99", "p999" };
+
+	void appendNumber(string& out, const char* format, double value)
+	{
+		char text[64];
+		snprintf(text, sizeof(text), format, value);
+		out += text;
+	}
+}
+
+double HistogramSnapshot::getMean() const
+{
+	return count == 0 ? 0.0 : static_cast<double>(sum) / count;
+}
+
+uint64_t HistogramSnapshot::getValueAtQuantile(double quantile) const
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	quantile = quantile < 0.0 ? 0.0 : (quantile > 1.0 ? 1.0 : quantile);
+	uint64_t rank{ static_cast<uint64_t>(quantile * count + 0.5) };
+	rank = rank == 0 ? 1 : (rank > count ? count : rank);
+
+	uint64_t seen{ 0 };
+	for (uint32_t i = 0; i < buckets.size(); ++i)
+	{
+		seen += buckets[i];
+		if (seen >= rank)
+		{
+			// the bucket's upper bound, clamped to what was actually recorded
+			uint64_t value{ Histogram::getBucketUpperBound(i) };
+			return value < min ? min : (value > max ? max : value);
+		}
+	}
+	return max;
+}
+
+Histogram::Histogram()
+{
+	for (auto& bucket : buckets)
+	{
+		bucket.store(0, memory_order_relaxed);
+	}
+}
+
+void Histogram::record(uint64_t value)
+{
+	buckets[getBucketIndex(value)].fetch_add(1, memory_order_relaxed);
+	sum.fetch_add(value, memory_order_relaxed);
+
+	uint64_t currentMin{ min.load(memory_order_relaxed) };
+	while (value < currentMin && !min.compare_exchange_weak(currentMin, value, memory_order_relaxed))
+	{
+	}
+
+	uint64_t currentMax{ max.load(memory_order_relaxed) };
+	while (value > currentMax && !max.compare_exchange_weak(currentMax, value, memory_order_relaxed))
+	{
+	}
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+	HistogramSnapshot result;
+	result.buckets.resize(bucketCount);
+
+	// the fields are read independently, so a snapshot taken while recording may be off by the in flight values
+	uint64_t total{ 0 };
+	for (uint32_t i = 0; i < bucketCount; ++i)
+	{
+		result.buckets[i] = buckets[i].load(memory_order_relaxed);
+		total += result.buckets[i];
+	}
+	result.count = total;
+	result.sum = sum.load(memory_order_relaxed);
+	result.min = total == 0 ? 0 : min.load(memory_order_relaxed);
+	result.max = max.load(memory_order_relaxed);
+	return result;
+}
+
+void Histogram::reset()
+{
+	for (auto& bucket : buckets)
+	{
+		bucket.store(0, memory_order_relaxed);
+	}
+	sum.store(0, memory_order_relaxed);
+	min.store(UINT64_MAX, memory_order_relaxed);
+	max.store(0, memory_order_relaxed);
+}
+
+uint32_t Histogram::getBucketIndex(uint64_t value)
+{
+	const uint64_t subBucketCount{ 1ull << subBucketBits };
+	if (value < subBucketCount)
+	{
+		return static_cast<uint32_t>(value);
+	}
+
+	uint32_t shift{ findMostSignificantBit(value) - subBucketBits + 1 };
+	return (shift << (subBucketBits - 1)) + static_cast<uint32_t>(value >> shift);
+}
+
+uint64_t Histogram::getBucketLowerBound(uint32_t index)
+{
+	const uint32_t subBucketCount{ 1u << subBucketBits };
+	if (index < subBucketCount)
+	{
+		return index;
+	}
+
+	uint32_t shift{ (index >> (subBucketBits - 1)) - 1 };
+	uint64_t subBucket{ index - (shift << (subBucketBits - 1)) };
+	return subBucket << shift;
+}
+
+uint64_t Histogram::getBucketUpperBound(uint32_t index)
+{
+	return index + 1 < bucketCount ? getBucketLowerBound(index + 1) - 1 : UINT64_MAX;
+}
+
+MetricsRegistry& MetricsRegistry::getGlobal()
+{
+	static MetricsRegistry registry;
+	return registry;
+}
+
+Histogram& MetricsRegistry::getHistogram(string name, string help)
+{
+	lock_guard<mutex> guard{ lock };
+	for (auto& entry : histograms)
+	{
+		if (entry.name == name)
+		{
+			return *entry.histogram;
+		}
+	}
+	histograms.push_back({ name, help, make_unique<Histogram>() });
+	return *histograms.back().histogram;
+}
+
+Counter& MetricsRegistry::getCounter(string name, string help)
+{
+	lock_guard<mutex> guard{ lock };
+	for (auto& entry : counters)
+	{
+		if (entry.name == name)
+		{
+			return *entry.counter;
+		}
+	}
+	counters.push_back({ name, help, make_unique<Counter>() });
+	return *counters.back().counter;
+}
+
+const Histogram* MetricsRegistry::findHistogram(string name) const
+{
+	lock_guard<mutex> guard{ lock };
+	for (auto& entry : histograms)
+	{
+		if (entry.name == name)
+		{
+			return entry.histogram.get();
+		}
+	}
+	return nullptr;
+}
+
+const Counter* MetricsRegistry::findCounter(string name) const
+{
+	lock_guard<mutex> guard{ lock };
+	for (auto& entry : counters)
+	{
+		if (entry.name == name)
+		{
+			return entry.counter.get();
+		}
+	}
+	return nullptr;
+}
+
+void MetricsRegistry::reset()
+{
+	lock_guard<mutex> guard{ lock };
+	for (auto& entry : histograms)
+	{
+		entry.histogram->reset();
+	}
+	for (auto& entry : counters)
+	{
+		entry.counter->reset();
+	}
+}
+
+string MetricsRegistry::toJson() const
+{
+	lock_guard<mutex> guard{ lock };
+
+	string json{ "{\n\"histograms\":{" };
+	for (size_t i = 0; i < histograms.size(); ++i)
+	{
+		HistogramSnapshot snapshot{ histograms[i].histogram->snapshot() };
+		json += i == 0 ? "\n" : ",\n";
+		json += "\"" + histograms[i].name + "\":{";
+		appendNumber(json, "\"count\":%.0f", static_cast<double>(snapshot.count));
+		appendNumber(json, ",\"sum\":%.0f", static_cast<double>(snapshot.sum));
+		appendNumber(json, ",\"min\":%.0f", static_cast<double>(snapshot.min));
+		appendNumber(json, ",\"max\":%.0f", static_cast<double>(snapshot.max));
+		appendNumber(json, ",\"mean\":%.3f", snapshot.getMean());
+		for (size_t q = 0; q < 4; ++q)
+		{
+			json += ",\"";
+			json += reportedQuantileNames[q];
+			appendNumber(json, "\":%.0f", static_cast<double>(snapshot.getValueAtQuantile(reportedQuantiles[q])));
+		}
+		json += "}";
+	}
+	json += "\n},\n\"counters\":{";
+	for (size_t i = 0; i < counters.size(); ++i)
+	{
+		json += i == 0 ? "\n" : ",\n";
+		json += "\"" + counters[i].name + "\":";
+		appendNumber(json, "%.0f", static_cast<double>(counters[i].counter->get()));
+	}
+	json += "\n}\n}\n";
+	return json;
+}
+
+string MetricsRegistry::toPrometheus() const
+{
+	lock_guard<mutex> guard{ lock };
+
+	string text;
+	for (auto& entry : histograms)
+	{
+		HistogramSnapshot snapshot{ entry.histogram->snapshot() };
+		if (!entry.help.empty())
+		{
+			text += "# HELP " + entry.name + " " + entry.help + "\n";
+		}
+		text += "# TYPE " + entry.name + " summary\n";
+		for (double quantile : reportedQuantiles)
+		{
+			text += entry.name;
+			appendNumber(text, "{quantile=\"%g\"} ", quantile);
+			appendNumber(text, "%.0f\n", static_cast<double>(snapshot.getValueAtQuantile(quantile)));
+		}
+		text += entry.name + "_sum ";
+		appendNumber(text, "%.0f\n", static_cast<double>(snapshot.sum));
+		text += entry.name + "_count ";
+		appendNumber(text, "%.0f\n", static_cast<double>(snapshot.count));
+	}
+	for (auto& entry : counters)
+	{
+		if (!entry.help.empty())
+		{
+			text += "# HELP " + entry.name + " " + entry.help + "\n";
+		}
+		text += "# TYPE " + entry.name + " counter\n";
+		text += entry.name + " ";
+		appendNumber(text, "%.0f\n", static_cast<double>(entry.counter->get()));
+	}
+	return text;
+}
+
+PeriodicMetricsDump::PeriodicMetricsDump(const MetricsRegistry& registry, string path, MetricsFormat format, uint32_t intervalMs) :
+	registry(registry), path{ path }, format{ format }, intervalMs{ intervalMs }
+{
+	thread = std::thread{ &PeriodicMetricsDump::run, this };
+}
+
+PeriodicMetricsDump::~PeriodicMetricsDump()
+{
+	{
+		lock_guard<std::mutex> guard{ mutex };
+		stopping = true;
+	}
+	stopCondition.notify_all();
+	thread.join();
+
+	try
+	{
+		dump();
+	}
+	catch (runtime_error&)
+	{
+	}
+}
+
+void PeriodicMetricsDump::dump()
+{
+	metrics::writeMetrics(registry, path, format);
+}
+
+void PeriodicMetricsDump::run()
+{
+	unique_lock<std::mutex> guard{ mutex };
+	while (!stopCondition.wait_for(guard, chrono::milliseconds(intervalMs), [this] { return stopping; }))
+	{
+		guard.unlock();
+		try
+		{
+			dump();
+		}
+		catch (runtime_error&)
+		{
+			// a failed dump is retried on the next interval
+		}
+		guard.lock();
+	}
+}
+
+namespace metrics
+{
+	MetricsFormat getFormatForPath(const string& path)
+	{
+		size_t dot{ path.rfind('.') };
+		string extension{ dot == string::npos ? "" : path.substr(dot) };
+		return extension == ".prom" || extension == ".txt" ? MetricsFormat::Prometheus : MetricsFormat::Json;
+	}
+
+	void writeMetrics(const MetricsRegistry& registry, string path, MetricsFormat format)
+	{
+		string text{ format == MetricsFormat::Prometheus ? registry.toPrometheus() : registry.toJson() };
+		string temporaryPath{ path + ".tmp" };
+
+		{
+			ofstream file{ temporaryPath, ios::binary | ios::trunc };
+			if (!file || !file.write(text.data(), text.size()))
+			{
+				throw(runtime_error{ "Error writing metrics file." });
+			}
+		}
+
+#if defined(_WIN32)
+		if (!MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+#else
+		if (rename(temporaryPath.c_str(), path.c_str()) != 0)
+#endif
+		{
+			throw(runtime_error{ "Error replacing metrics file." });
+		}
+	}
+}
\ No newline at end of file
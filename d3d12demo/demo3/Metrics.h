@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct HistogramSnapshot
+{
+	uint64_t count{ 0 };
+	uint64_t sum{ 0 };
+	uint64_t min{ 0 };
+	uint64_t max{ 0 };
+	std::vector<uint64_t> buckets;
+
+	double getMean() const;
+	// value at or below which the given fraction (0..1) of the recorded values lies, within the bucket precision
+	uint64_t getValueAtQuantile(double quantile) const;
+};
+
+// High dynamic range histogram over the full uint64_t range: 64 linear sub-buckets per power of two, so any
+// recorded value is reported within 1/64 (1.6%) of its magnitude. Recording is a handful of relaxed atomic
+// operations and never blocks, from any number of threads.
+class Histogram
+{
+public:
+	static const uint32_t subBucketBits{ 7 };
+	static const uint32_t bucketCount{ (64 - subBucketBits + 2) << (subBucketBits - 1) };
+
+	Histogram();
+
+	void record(uint64_t value);
+	HistogramSnapshot snapshot() const;
+	void reset();
+
+	static uint32_t getBucketIndex(uint64_t value);
+	static uint64_t getBucketLowerBound(uint32_t index);
+	static uint64_t getBucketUpperBound(uint32_t index);
+
+private:
+	std::atomic<uint64_t> sum{ 0 };
+	std::atomic<uint64_t> min{ UINT64_MAX };
+	std::atomic<uint64_t> max{ 0 };
+	std::atomic<uint64_t> buckets[bucketCount];
+};
+
+class Counter
+{
+public:
+	void add(uint64_t value)
+	{
+		total.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	uint64_t get() const
+	{
+		return total.load(std::memory_order_relaxed);
+	}
+
+	void reset()
+	{
+		total.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> total{ 0 };
+};
+
+// Named metrics. Registration takes a lock and is meant for initialization; callers keep the returned
+// reference, which stays valid for the registry's lifetime, and record through it lock free.
+class MetricsRegistry
+{
+public:
+	static MetricsRegistry& getGlobal();
+
+	Histogram& getHistogram(std::string name, std::string help = "");
+	Counter& getCounter(std::string name, std::string help = "");
+
+	// null if no metric of that name has been registered
+	const Histogram* findHistogram(std::string name) const;
+	const Counter* findCounter(std::string name) const;
+
+	void reset();
+
+	// histograms report count, sum, min, max, mean, p50, p90, p99 and p99.9
+	std::string toJson() const;
+	// histograms as summaries with 0.5/0.9/0.99/0.999 quantiles, counters as counters
+	std::string toPrometheus() const;
+
+private:
+	struct HistogramEntry
+	{
+		std::string name;
+		std::string help;
+		std::unique_ptr<Histogram> histogram;
+	};
+
+	struct CounterEntry
+	{
+		std::string name;
+		std::string help;
+		std::unique_ptr<Counter> counter;
+	};
+
+	mutable std::mutex lock;
+	std::vector<HistogramEntry> histograms;
+	std::vector<CounterEntry> counters;
+};
+
+enum class MetricsFormat
+{
+	Json,
+	Prometheus
+};
+
+// Rewrites a file with the registry's metrics every interval from a background thread. The file is written
+// next to the target and renamed over it, so readers never see a partial dump.
+class PeriodicMetricsDump
+{
+public:
+	PeriodicMetricsDump(const MetricsRegistry& registry, std::string path, MetricsFormat format, uint32_t intervalMs = 1000);
+	~PeriodicMetricsDump();
+
+	PeriodicMetricsDump(const PeriodicMetricsDump&) = delete;
+	PeriodicMetricsDump& operator=(const PeriodicMetricsDump&) = delete;
+
+	void dump();
+
+private:
+	void run();
+
+private:
+	const MetricsRegistry& registry;
+	std::string path;
+	MetricsFormat format;
+	uint32_t intervalMs;
+	std::mutex mutex;
+	std::condition_variable stopCondition;
+	bool stopping{ false };
+	std::thread thread;
+};
+
+namespace metrics
+{
+	// guesses the format from the extension: ".prom" and ".txt" are Prometheus text, anything else JSON
+	MetricsFormat getFormatForPath(const std::string& path);
+	void writeMetrics(const MetricsRegistry& registry, std::string path, MetricsFormat format);
+}
\ No newline at end of file
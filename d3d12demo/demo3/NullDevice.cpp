@@ -0,0 +1,388 @@
+#include "NullDevice.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "Trace.h"
+
+using namespace std;
+
+namespace
+{
+	// same per frame slice the D3D12 backend uses
+	const size_t constantBufferSliceSize{ 256 };
+}
+
+NullDevice::NullDevice(uint32_t bufferCount) : bufferCount{ bufferCount }, fenceValues(bufferCount, 0), constantBuffer(bufferCount * constantBufferSliceSize),
+	timestamps(bufferCount * maxTimestampQueries, 0)
+{
+	if (bufferCount == 0)
+	{
+		throw(runtime_error{ "Null device needs at least one buffer." });
+	}
+
+	for (uint32_t i = 0; i < bufferCount; ++i)
+	{
+		fences.push_back(make_unique<SimulatedFence>());
+	}
+}
+
+uint32_t NullDevice::getBufferCount()
+{
+	++apiCalls;
+	return bufferCount;
+}
+
+uint32_t NullDevice::getCurrentBackBufferIndex()
+{
+	++apiCalls;
+	return backBufferIndex;
+}
+
+CommandList& NullDevice::getCommandList()
+{
+	return *this;
+}
+
+void NullDevice::resetCommandAllocator(uint32_t frameIndex)
+{
+	++apiCalls;
+	checkFrameIndex(frameIndex);
+}
+
+void NullDevice::updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size)
+{
+	// Map + Unmap
+	apiCalls += 2;
+	checkFrameIndex(frameIndex);
+	if (size > constantBufferSliceSize)
+	{
+		throw(runtime_error{ "Constant buffer update too large." });
+	}
+	memcpy(&constantBuffer[frameIndex * constantBufferSliceSize], data, size);
+}
+
+void NullDevice::executeCommandList()
+{
+	++apiCalls;
+	if (recording)
+	{
+		throw(runtime_error{ "Executing an open command list." });
+	}
+
+	uint64_t start{ max(Tracer::now(), gpuBusyUntil) };
+	for (uint32_t i = 0; i < recordedQueries; ++i)
+	{
+		if (queryOffsets[i] != UINT64_MAX)
+		{
+			timestamps[recordingFrame * maxTimestampQueries + i] = start + queryOffsets[i];
+		}
+	}
+	gpuBusyUntil = start + recordedCost;
+}
+
+void NullDevice::present(uint32_t)
+{
+	++apiCalls;
+	++frames;
+	backBufferIndex = (backBufferIndex + 1) % bufferCount;
+}
+
+bool NullDevice::isOccluded()
+{
+	return false;
+}
+
+bool NullDevice::testOcclusion()
+{
+	++apiCalls;
+	return false;
+}
+
+void NullDevice::signal(uint32_t frameIndex)
+{
+	++apiCalls;
+	checkFrameIndex(frameIndex);
+	++fenceValues[frameIndex];
+	fences[frameIndex]->signal(fenceValues[frameIndex]);
+}
+
+void NullDevice::waitFrameComplete(uint32_t frameIndex)
+{
+	// GetCompletedValue, the fence has always completed
+	++apiCalls;
+	checkFrameIndex(frameIndex);
+}
+
+uint64_t NullDevice::getFenceValue(uint32_t frameIndex)
+{
+	checkFrameIndex(frameIndex);
+	return fenceValues[frameIndex];
+}
+
+Fence& NullDevice::getFence(uint32_t frameIndex)
+{
+	checkFrameIndex(frameIndex);
+	return *fences[frameIndex];
+}
+
+uint64_t NullDevice::getTimestampFrequency()
+{
+	++apiCalls;
+	return 1000000000;
+}
+
+void NullDevice::getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuNs)
+{
+	++apiCalls;
+	cpuNs = Tracer::now();
+	gpuTimestamp = cpuNs;
+}
+
+void NullDevice::readTimestamps(uint32_t frameIndex, uint64_t* values, uint32_t count)
+{
+	// Map + Unmap of the readback buffer
+	apiCalls += 2;
+	checkFrameIndex(frameIndex);
+	if (count > maxTimestampQueries)
+	{
+		throw(runtime_error{ "Timestamp query out of range." });
+	}
+	memcpy(values, &timestamps[frameIndex * maxTimestampQueries], count * sizeof(uint64_t));
+}
+
+void NullDevice::reset(uint32_t frameIndex)
+{
+	++apiCalls;
+	checkFrameIndex(frameIndex);
+	if (recording)
+	{
+		throw(runtime_error{ "Resetting an open command list." });
+	}
+	recording = true;
+	recordingFrame = frameIndex;
+	recordedCost = 0;
+	recordedQueries = 0;
+}
+
+void NullDevice::setPipelineState(PipelineId)
+{
+	++apiCalls;
+	checkRecording();
+}
+
+void NullDevice::setGraphicsRootSignature()
+{
+	++apiCalls;
+	checkRecording();
+}
+
+void NullDevice::setViewport(const Viewport& viewport)
+{
+	++apiCalls;
+	checkRecording();
+	viewportPixels = static_cast<uint64_t>(max(viewport.width, 0.0f)) * static_cast<uint64_t>(max(viewport.height, 0.0f));
+}
+
+void NullDevice::setScissorRect(const ScissorRect&)
+{
+	++apiCalls;
+	checkRecording();
+}
+
+void NullDevice::transitionBackBuffer(uint32_t frameIndex, ResourceState, ResourceState)
+{
+	++apiCalls;
+	checkRecording();
+	checkFrameIndex(frameIndex);
+}
+
+void NullDevice::setRenderTarget(uint32_t frameIndex)
+{
+	++apiCalls;
+	checkRecording();
+	checkFrameIndex(frameIndex);
+}
+
+void NullDevice::clearRenderTarget(uint32_t frameIndex, const float*)
+{
+	++apiCalls;
+	checkRecording();
+	checkFrameIndex(frameIndex);
+}
+
+void NullDevice::clearDepth(float)
+{
+	++apiCalls;
+	checkRecording();
+}
+
+void NullDevice::setPrimitiveTopology(PrimitiveTopology topology)
+{
+	++apiCalls;
+	checkRecording();
+	this->topology = topology;
+}
+
+void NullDevice::setVertexBuffer(BufferId)
+{
+	++apiCalls;
+	checkRecording();
+}
+
+void NullDevice::setIndexBuffer(BufferId)
+{
+	++apiCalls;
+	checkRecording();
+}
+
+void NullDevice::setGraphicsRoot32BitConstants(uint32_t, uint32_t, const void*)
+{
+	++apiCalls;
+	checkRecording();
+}
+
+void NullDevice::setGraphicsRootDescriptorTable(uint32_t)
+{
+	// SetDescriptorHeaps + SetGraphicsRootDescriptorTable
+	apiCalls += 2;
+	checkRecording();
+}
+
+void NullDevice::setGraphicsRootConstantBufferView(uint32_t, uint32_t frameIndex)
+{
+	++apiCalls;
+	checkRecording();
+	checkFrameIndex(frameIndex);
+}
+
+void NullDevice::drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t, uint32_t)
+{
+	++apiCalls;
+	++draws;
+	checkRecording();
+	uint64_t primitiveCost{ topology == PrimitiveTopology::PatchList16 ? vertexCount / 16 * patchCost : vertexCount / 3 * triangleCost };
+	recordedCost += (primitiveCost + viewportPixels * pixelCost / 1000) * instanceCount;
+}
+
+void NullDevice::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t, int32_t, uint32_t)
+{
+	++apiCalls;
+	++draws;
+	checkRecording();
+	uint64_t primitiveCost{ topology == PrimitiveTopology::PatchList16 ? indexCount / 16 * patchCost : indexCount / 3 * triangleCost };
+	recordedCost += (primitiveCost + viewportPixels * pixelCost / 1000) * instanceCount;
+}
+
+void NullDevice::writeTimestamp(uint32_t frameIndex, uint32_t queryIndex)
+{
+	++apiCalls;
+	checkRecording();
+	checkFrameIndex(frameIndex);
+	if (queryIndex >= maxTimestampQueries)
+	{
+		throw(runtime_error{ "Timestamp query out of range." });
+	}
+	for (; recordedQueries <= queryIndex; ++recordedQueries)
+	{
+		queryOffsets[recordedQueries] = UINT64_MAX;
+	}
+	queryOffsets[queryIndex] = recordedCost;
+}
+
+void NullDevice::resolveTimestamps(uint32_t frameIndex, uint32_t queryCount)
+{
+	++apiCalls;
+	checkRecording();
+	checkFrameIndex(frameIndex);
+	if (queryCount > maxTimestampQueries)
+	{
+		throw(runtime_error{ "Timestamp query out of range." });
+	}
+}
+
+void NullDevice::transitionSceneTarget(ResourceState, ResourceState)
+{
+	++apiCalls;
+	checkRecording();
+}
+
+void NullDevice::setSceneRenderTarget()
+{
+	++apiCalls;
+	checkRecording();
+}
+
+void NullDevice::clearSceneRenderTarget(const float*)
+{
+	++apiCalls;
+	checkRecording();
+}
+
+void NullDevice::upscaleScene(const ScissorRect& source)
+{
+	// SetPipelineState, SetGraphicsRootSignature, SetDescriptorHeaps, SetGraphicsRootDescriptorTable,
+	// SetGraphicsRoot32BitConstants, IASetPrimitiveTopology and DrawInstanced
+	apiCalls += 7;
+	++draws;
+	checkRecording();
+	topology = PrimitiveTopology::TriangleList;
+	if (source.right <= source.left || source.bottom <= source.top)
+	{
+		throw(runtime_error{ "Empty upscale source." });
+	}
+}
+
+void NullDevice::setSimulatedPatchCost(uint64_t ns)
+{
+	patchCost = ns;
+}
+
+void NullDevice::setSimulatedPixelCost(uint64_t ps)
+{
+	pixelCost = ps;
+}
+
+void NullDevice::close()
+{
+	++apiCalls;
+	checkRecording();
+	recording = false;
+}
+
+uint64_t NullDevice::getApiCallCount() const
+{
+	return apiCalls;
+}
+
+uint64_t NullDevice::getDrawCount() const
+{
+	return draws;
+}
+
+uint64_t NullDevice::getFrameCount() const
+{
+	return frames;
+}
+
+void NullDevice::resetCounters()
+{
+	apiCalls = 0;
+	draws = 0;
+	frames = 0;
+}
+
+void NullDevice::checkFrameIndex(uint32_t frameIndex) const
+{
+	if (frameIndex >= bufferCount)
+	{
+		throw(runtime_error{ "Frame index out of range." });
+	}
+}
+
+void NullDevice::checkRecording() const
+{
+	if (!recording)
+	{
+		throw(runtime_error{ "Command list is not recording." });
+	}
+}
\ No newline at end of file
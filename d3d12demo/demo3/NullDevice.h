@@ -0,0 +1,97 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "RenderDevice.h"
+
+// RenderDevice that records nothing: every call is validated and counted, fences complete immediately and
+// present advances the back buffer index the way a flip model swap chain does. Timestamps come from a
+// simulated GPU clock in Tracer::now() nanoseconds: a command list starts when it is executed (or when the
+// previous one finishes) and each draw advances the clock by a fixed cost per patch, or per triangle of a
+// triangle list, and per viewport pixel.
+class NullDevice : public RenderDevice, public CommandList
+{
+public:
+	NullDevice(uint32_t bufferCount);
+
+	uint32_t getBufferCount() override;
+	uint32_t getCurrentBackBufferIndex() override;
+	CommandList& getCommandList() override;
+	void resetCommandAllocator(uint32_t frameIndex) override;
+	void updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size) override;
+	void executeCommandList() override;
+	void present(uint32_t syncInterval) override;
+	bool isOccluded() override;
+	bool testOcclusion() override;
+	void signal(uint32_t frameIndex) override;
+	void waitFrameComplete(uint32_t frameIndex) override;
+	uint64_t getFenceValue(uint32_t frameIndex) override;
+	Fence& getFence(uint32_t frameIndex) override;
+	uint64_t getTimestampFrequency() override;
+	void getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuNs) override;
+	void readTimestamps(uint32_t frameIndex, uint64_t* timestamps, uint32_t count) override;
+
+	void reset(uint32_t frameIndex) override;
+	void setPipelineState(PipelineId pipeline) override;
+	void setGraphicsRootSignature() override;
+	void setViewport(const Viewport& viewport) override;
+	void setScissorRect(const ScissorRect& rect) override;
+	void transitionBackBuffer(uint32_t frameIndex, ResourceState before, ResourceState after) override;
+	void setRenderTarget(uint32_t frameIndex) override;
+	void clearRenderTarget(uint32_t frameIndex, const float color[4]) override;
+	void clearDepth(float depth) override;
+	void setPrimitiveTopology(PrimitiveTopology topology) override;
+	void setVertexBuffer(BufferId buffer) override;
+	void setIndexBuffer(BufferId buffer) override;
+	void setGraphicsRoot32BitConstants(uint32_t rootIndex, uint32_t count, const void* data) override;
+	void setGraphicsRootDescriptorTable(uint32_t rootIndex) override;
+	void setGraphicsRootConstantBufferView(uint32_t rootIndex, uint32_t frameIndex) override;
+	void drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance) override;
+	void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+	void writeTimestamp(uint32_t frameIndex, uint32_t queryIndex) override;
+	void resolveTimestamps(uint32_t frameIndex, uint32_t queryCount) override;
+	void close() override;
+	void transitionSceneTarget(ResourceState before, ResourceState after) override;
+	void setSceneRenderTarget() override;
+	void clearSceneRenderTarget(const float color[4]) override;
+	void upscaleScene(const ScissorRect& source) override;
+
+	// simulated GPU cost of one patch in a draw, in nanoseconds
+	void setSimulatedPatchCost(uint64_t ns);
+	// simulated GPU cost of shading one viewport pixel in a draw, in picoseconds; the upscale pass is free
+	void setSimulatedPixelCost(uint64_t ps);
+
+	uint64_t getApiCallCount() const;
+	uint64_t getDrawCount() const;
+	uint64_t getFrameCount() const;
+	void resetCounters();
+
+private:
+	void checkFrameIndex(uint32_t frameIndex) const;
+	void checkRecording() const;
+
+private:
+	uint32_t bufferCount;
+	uint32_t backBufferIndex{ 0 };
+	bool recording{ false };
+	std::vector<uint64_t> fenceValues;
+	std::vector<std::unique_ptr<SimulatedFence>> fences;
+	std::vector<uint8_t> constantBuffer;
+
+	uint32_t recordingFrame{ 0 };
+	uint64_t recordedCost{ 0 };
+	uint64_t patchCost{ 2000 };
+	// pre-tessellated triangles skip the tessellation stages, a patch at factor 8 is 128 of them
+	uint64_t triangleCost{ 10 };
+	PrimitiveTopology topology{ PrimitiveTopology::TriangleList };
+	uint64_t pixelCost{ 0 };
+	uint64_t viewportPixels{ 0 };
+	uint64_t gpuBusyUntil{ 0 };
+	uint32_t recordedQueries{ 0 };
+	uint64_t queryOffsets[maxTimestampQueries];
+	std::vector<uint64_t> timestamps;
+
+	uint64_t apiCalls{ 0 };
+	uint64_t draws{ 0 };
+	uint64_t frames{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "ParallelTessellator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include "BezierPatch.h"
+#include "JobSystem.h"
+
+using namespace std;
+
+namespace
+{
+	// expected cost of a patch besides its triangles, for gathering and transforming its control points; measured
+	// at about as much as 50 triangles
+	const uint64_t patchCost{ 48 };
+	// so workers that finish early have items left to steal
+	const size_t itemsPerThread{ 8 };
+	// expected cost below which a work item isn't worth a job
+	const uint64_t minItemCost{ 1 << 13 };
+	// patches tessellated per measurement, so small inputs run long enough to time
+	const size_t benchmarkPatches{ 1 << 21 };
+
+	// per instance prefix sums, with one more entry for the totals
+	struct InstanceLayout
+	{
+		size_t patchCount;
+		vector<uint64_t> patchCosts;
+		vector<uint64_t> costOffsets;
+		vector<uint64_t> vertexOffsets;
+		vector<uint64_t> indexOffsets;
+	};
+
+	void layOutInstances(const vector<TessellationInstance>& instances, size_t patchCount, InstanceLayout& layout)
+	{
+		layout.patchCount = patchCount;
+		layout.patchCosts.resize(instances.size());
+		layout.costOffsets.assign(instances.size() + 1, 0);
+		layout.vertexOffsets.assign(instances.size() + 1, 0);
+		layout.indexOffsets.assign(instances.size() + 1, 0);
+		for (size_t instance = 0; instance < instances.size(); ++instance)
+		{
+			int factor{ instances[instance].factor };
+			layout.patchCosts[instance] = teapot_tutorial::getGridIndexCount(factor) / 3 + patchCost;
+			layout.costOffsets[instance + 1] = layout.costOffsets[instance] + patchCount * layout.patchCosts[instance];
+			layout.vertexOffsets[instance + 1] = layout.vertexOffsets[instance] + patchCount * teapot_tutorial::getGridVertexCount(factor);
+			layout.indexOffsets[instance + 1] = layout.indexOffsets[instance] + patchCount * teapot_tutorial::getGridIndexCount(factor);
+		}
+	}
+
+	// the first patch, counting through all instances, whose patches before it cost at least cost
+	uint64_t findPatch(const InstanceLayout& layout, uint64_t cost)
+	{
+		size_t instance{ static_cast<size_t>(upper_bound(layout.costOffsets.begin(), layout.costOffsets.end(), cost) - layout.costOffsets.begin()) - 1 };
+		if (instance >= layout.patchCosts.size())
+		{
+			return layout.patchCosts.size() * layout.patchCount;
+		}
+		uint64_t perPatch{ layout.patchCosts[instance] };
+		return instance * layout.patchCount + (cost - layout.costOffsets[instance] + perPatch - 1) / perPatch;
+	}
+
+	uint64_t getCostBefore(const InstanceLayout& layout, uint64_t patch)
+	{
+		size_t instance{ static_cast<size_t>(patch / layout.patchCount) };
+		if (instance >= layout.patchCosts.size())
+		{
+			return layout.costOffsets.back();
+		}
+		return layout.costOffsets[instance] + (patch % layout.patchCount) * layout.patchCosts[instance];
+	}
+
+	// heaviest item over the mean
+	double getImbalance(const InstanceLayout& layout, const vector<uint64_t>& boundaries)
+	{
+		uint64_t heaviest{ 0 };
+		for (size_t item = 0; item + 1 < boundaries.size(); ++item)
+		{
+			heaviest = max(heaviest, getCostBefore(layout, boundaries[item + 1]) - getCostBefore(layout, boundaries[item]));
+		}
+		double mean{ static_cast<double>(layout.costOffsets.back()) / max<size_t>(boundaries.size() - 1, 1) };
+		return mean > 0.0 ? heaviest / mean : 1.0;
+	}
+
+	// Work item item covers patches boundaries[item] to boundaries[item + 1], counting through all instances;
+	// items of equal expected cost, except that one patch is never split.
+	void splitWork(const InstanceLayout& layout, size_t itemCount, vector<uint64_t>& boundaries)
+	{
+		uint64_t total{ layout.costOffsets.back() };
+		boundaries.assign(1, 0);
+		for (size_t item = 1; item < itemCount; ++item)
+		{
+			uint64_t patch{ findPatch(layout, total * item / itemCount) };
+			if (patch > boundaries.back())
+			{
+				boundaries.push_back(patch);
+			}
+		}
+		uint64_t end{ layout.patchCosts.size() * layout.patchCount };
+		if (end > boundaries.back() || boundaries.size() == 1)
+		{
+			boundaries.push_back(end);
+		}
+	}
+
+	void evaluateGrid(const Float3* controlPoints, int factor, PatchEvaluator evaluator, Float3* positions)
+	{
+		if (evaluator == PatchEvaluator::Bernstein)
+		{
+			teapot_tutorial::evaluateGridBernstein(controlPoints, factor, positions);
+		}
+		else if (evaluator == PatchEvaluator::ForwardDifference)
+		{
+			teapot_tutorial::evaluateGridForwardDifference(controlPoints, factor, teapot_tutorial::defaultAnchorSteps, positions);
+		}
+		else
+		{
+			teapot_tutorial::evaluateGridKernel(controlPoints, factor, positions);
+		}
+	}
+
+	bool isSameMesh(const TessellatedMesh& a, const TessellatedMesh& b)
+	{
+		return a.positions.size() == b.positions.size() && a.colors.size() == b.colors.size() && a.indices == b.indices &&
+			memcmp(a.positions.data(), b.positions.data(), a.positions.size() * sizeof(Float3)) == 0 &&
+			memcmp(a.colors.data(), b.colors.data(), a.colors.size() * sizeof(Float3)) == 0;
+	}
+
+	// instances in rows of 64, nearest first with the factor falling off like a projected size would
+	void makeBenchmarkInstances(size_t count, vector<TessellationInstance>& instances)
+	{
+		instances.resize(count);
+		for (size_t instance = 0; instance < count; ++instance)
+		{
+			float distance{ (static_cast<float>(instance) + 0.5f) / static_cast<float>(count) };
+			instances[instance].transform = math::translation(static_cast<float>(instance % 64) * 8.0f, 0.0f, static_cast<float>(instance / 64) * 8.0f);
+			instances[instance].factor = teapot_tutorial::clampTessFactor(static_cast<int>(ceil(1.0f / sqrt(distance))));
+		}
+	}
+}
+
+namespace teapot_tutorial
+{
+	ParallelTessellationResult tessellateParallel(const PatchModel& model, const vector<TessellationInstance>& instances, TessellatedMesh& mesh, JobSystem* jobs, PatchEvaluator evaluator)
+	{
+		size_t patchCount{ model.getPatchCount() };
+		if (patchCount == 0 || instances.empty())
+		{
+			mesh.positions.clear();
+			mesh.colors.clear();
+			mesh.indices.clear();
+			return{ 0, 0, 1.0 };
+		}
+		for (size_t i = 0; i < patchCount * PatchModel::controlPointsPerPatch; ++i)
+		{
+			// checked here as gatherControlPoints would throw on a worker
+			if (model.patches[i] >= model.points.size())
+			{
+				throw(runtime_error{ "Patch index out of range." });
+			}
+		}
+
+		InstanceLayout layout;
+		layOutInstances(instances, patchCount, layout);
+		if (layout.vertexOffsets.back() > numeric_limits<uint32_t>::max())
+		{
+			throw(runtime_error{ "Too many vertices for 32 bit indices." });
+		}
+		mesh.positions.resize(static_cast<size_t>(layout.vertexOffsets.back()));
+		mesh.colors.resize(mesh.positions.size());
+		mesh.indices.resize(static_cast<size_t>(layout.indexOffsets.back()));
+
+		size_t itemCount{ jobs != nullptr ? jobs->getThreadCount() * itemsPerThread : 1 };
+		itemCount = max<size_t>(min<size_t>(itemCount, layout.costOffsets.back() / minItemCost), 1);
+		vector<uint64_t> boundaries;
+		splitWork(layout, itemCount, boundaries);
+
+		auto tessellateItems = [&](uint32_t begin, uint32_t end)
+		{
+			Float3 controlPoints[PatchModel::controlPointsPerPatch];
+			for (uint64_t current = boundaries[begin]; current < boundaries[end]; ++current)
+			{
+				size_t instance{ static_cast<size_t>(current / patchCount) };
+				size_t patch{ static_cast<size_t>(current % patchCount) };
+				int factor{ clampTessFactor(instances[instance].factor) };
+				size_t vertexCount{ getGridVertexCount(factor) };
+				size_t firstVertex{ static_cast<size_t>(layout.vertexOffsets[instance]) + patch * vertexCount };
+				size_t firstIndex{ static_cast<size_t>(layout.indexOffsets[instance]) + patch * getGridIndexCount(factor) };
+
+				gatherControlPoints(model, patch, controlPoints);
+				const Float4x4& patchTransform{ patch < model.patchesTransforms.size() ? model.patchesTransforms[patch] : math::identity() };
+				Float4x4 transform{ math::multiply(patchTransform, instances[instance].transform) };
+				for (Float3& p : controlPoints)
+				{
+					p = bezier::transformPosition(p, transform);
+				}
+				evaluateGrid(controlPoints, factor, evaluator, mesh.positions.data() + firstVertex);
+				writeGridIndices(factor, static_cast<uint32_t>(firstVertex), mesh.indices.data() + firstIndex);
+
+				Float3 color{ patch < model.patchesColors.size() ? model.patchesColors[patch] : Float3{ 1.0f, 1.0f, 1.0f } };
+				fill(mesh.colors.begin() + firstVertex, mesh.colors.begin() + firstVertex + vertexCount, color);
+			}
+		};
+
+		uint32_t items{ static_cast<uint32_t>(boundaries.size() - 1) };
+		if (jobs != nullptr)
+		{
+			jobs->parallelFor(0, items, 1, tessellateItems);
+		}
+		else
+		{
+			tessellateItems(0, items);
+		}
+
+		ParallelTessellationResult result;
+		result.workItems = items;
+		result.triangles = mesh.getTriangleCount();
+		result.imbalance = getImbalance(layout, boundaries);
+		return result;
+	}
+
+	vector<ParallelTessellationBenchmarkResult> runParallelTessellationBenchmark(const PatchModel& model, uint32_t maxThreads)
+	{
+		size_t patchCount{ model.getPatchCount() };
+		if (patchCount == 0)
+		{
+			return{};
+		}
+
+		// one identity instance is tessellate() with the same evaluator
+		const int factor{ 12 };
+		TessellatedMesh reference;
+		TessellatedMesh mesh;
+		tessellate(model, factor, reference, PatchEvaluator::WeightTable);
+		tessellateParallel(model, { { math::identity(), factor } }, mesh);
+		if (!isSameMesh(mesh, reference))
+		{
+			throw(runtime_error{ "Parallel tessellation of one instance differs from tessellate()." });
+		}
+
+		uint32_t threadLimit{ min(max(maxThreads, 1u), max(thread::hardware_concurrency(), 4u)) };
+		vector<ParallelTessellationBenchmarkResult> results;
+		vector<TessellationInstance> instances;
+		for (size_t wantedPatches : { 1000u, 10000u, 100000u, 1000000u })
+		{
+			makeBenchmarkInstances((wantedPatches + patchCount - 1) / patchCount, instances);
+			tessellateParallel(model, instances, reference);
+			InstanceLayout layout;
+			layOutInstances(instances, patchCount, layout);
+
+			double singleSeconds{ 0.0 };
+			for (uint32_t threads = 1; threads <= threadLimit; threads *= 2)
+			{
+				JobSystem jobs{ threads };
+				ParallelTessellationResult tessellation{ tessellateParallel(model, instances, mesh, &jobs) };
+				if (!isSameMesh(mesh, reference))
+				{
+					throw(runtime_error{ "Parallel tessellation on " + to_string(threads) + " threads differs from one thread." });
+				}
+
+				size_t repeats{ max<size_t>(benchmarkPatches / (instances.size() * patchCount), 1) };
+				auto begin = chrono::steady_clock::now();
+				for (size_t repeat = 0; repeat < repeats; ++repeat)
+				{
+					tessellateParallel(model, instances, mesh, &jobs);
+				}
+				double seconds{ chrono::duration<double>(chrono::steady_clock::now() - begin).count() / repeats };
+				singleSeconds = threads == 1 ? seconds : singleSeconds;
+
+				vector<uint64_t> boundaries;
+				for (size_t item = 0; item <= tessellation.workItems; ++item)
+				{
+					boundaries.push_back(instances.size() * patchCount * item / tessellation.workItems);
+				}
+
+				ParallelTessellationBenchmarkResult result;
+				result.patches = instances.size() * patchCount;
+				result.instances = instances.size();
+				result.threads = jobs.getThreadCount();
+				result.workItems = tessellation.workItems;
+				result.triangles = tessellation.triangles;
+				result.ms = seconds * 1000.0;
+				result.trianglesPerSecond = seconds > 0.0 ? tessellation.triangles / seconds : 0.0;
+				result.speedup = seconds > 0.0 ? singleSeconds / seconds : 0.0;
+				result.imbalance = tessellation.imbalance;
+				result.patchCountImbalance = getImbalance(layout, boundaries);
+				results.push_back(result);
+			}
+		}
+		return results;
+	}
+
+	string formatParallelTessellationBenchmarkResults(const vector<ParallelTessellationBenchmarkResult>& results)
+	{
+		string text;
+		for (const ParallelTessellationBenchmarkResult& result : results)
+		{
+			char line[256];
+			snprintf(line, sizeof(line), "parallel tess %7zu patches %5zu instances %2u threads: %9.2f ms, %.1f Mtris/s, %.2fx one thread, %3zu items, imbalance %.2f (%.2f by patch count)\n",
+				result.patches, result.instances, result.threads, result.ms, result.trianglesPerSecond / 1e6, result.speedup, result.workItems,
+				result.imbalance, result.patchCountImbalance);
+			text += line;
+		}
+		return text;
+	}
+}
\ No newline at end of file
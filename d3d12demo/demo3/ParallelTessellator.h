@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MathTypes.h"
+#include "PatchModel.h"
+#include "PatchTessellator.h"
+
+class JobSystem;
+
+// One copy of the model, drawn with a transform applied after the patch transforms and its own factor, e.g. from
+// LodChain::getWantedFactor
+struct TessellationInstance
+{
+	Float4x4 transform;
+	int factor;
+};
+
+struct ParallelTessellationResult
+{
+	size_t workItems;
+	uint64_t triangles;
+	// expected cost of the heaviest work item over the mean
+	double imbalance;
+};
+
+struct ParallelTessellationBenchmarkResult
+{
+	size_t patches;
+	size_t instances;
+	uint32_t threads;
+	size_t workItems;
+	uint64_t triangles;
+	double ms;
+	double trianglesPerSecond;
+	// over one thread at the same patch count
+	double speedup;
+	double imbalance;
+	// the same work items split by patch count instead
+	double patchCountImbalance;
+};
+
+// CPU tessellation of every patch of every instance, laid out like tessellate() does one instance after another.
+// Prefix sums over the instances give each patch its exact vertex and index range up front, so the output is
+// sized once and workers write disjoint ranges without locks. Patches x instances is split into work items of
+// equal expected cost, by triangles plus a fixed cost per patch, for JobSystem::parallelFor.
+namespace teapot_tutorial
+{
+	// jobs null tessellates on the calling thread; the output does not depend on the thread count. Throws when
+	// the vertices don't fit 32 bit indices.
+	ParallelTessellationResult tessellateParallel(const PatchModel& model, const std::vector<TessellationInstance>& instances, TessellatedMesh& mesh,
+		JobSystem* jobs = nullptr, PatchEvaluator evaluator = PatchEvaluator::WeightTable);
+
+	// About 1k, 10k, 100k and 1M patches of instances whose factors fall off with distance, on powers of two
+	// threads up to maxThreads or the hardware's threads, but at least 4. Throws when one instance differs from
+	// tessellate() or an output depends on the thread count.
+	std::vector<ParallelTessellationBenchmarkResult> runParallelTessellationBenchmark(const PatchModel& model, uint32_t maxThreads);
+
+	// one line per result
+	std::string formatParallelTessellationBenchmarkResults(const std::vector<ParallelTessellationBenchmarkResult>& results);
+}
\ No newline at end of file
@@ -0,0 +1,713 @@
+#include "PatchEvaluator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include "BernsteinTableCache.h"
+#include "BezierPatch.h"
+#include "PatchKernels.h"
+#include "PatchTessellator.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PATCH_EVALUATOR_SSE2 1
+#endif
+
+using namespace std;
+
+namespace
+{
+	// points each evaluator produces per measurement, so small factors run long enough to time
+	const size_t benchmarkPoints{ 1 << 21 };
+
+	struct Double3
+	{
+		double x;
+		double y;
+		double z;
+	};
+
+	Double3 evaluateDouble(const Float3* controlPoints, double u, double v)
+	{
+		const double bu[4]{ (1.0 - u) * (1.0 - u) * (1.0 - u), 3.0 * u * (1.0 - u) * (1.0 - u), 3.0 * u * u * (1.0 - u), u * u * u };
+		const double bv[4]{ (1.0 - v) * (1.0 - v) * (1.0 - v), 3.0 * v * (1.0 - v) * (1.0 - v), 3.0 * v * v * (1.0 - v), v * v * v };
+		Double3 value{ 0.0, 0.0, 0.0 };
+		for (size_t row = 0; row < 4; ++row)
+		{
+			for (size_t column = 0; column < 4; ++column)
+			{
+				const Float3& p{ controlPoints[row * 4 + column] };
+				double weight{ bu[column] * bv[row] };
+				value.x += p.x * weight;
+				value.y += p.y * weight;
+				value.z += p.z * weight;
+			}
+		}
+		return value;
+	}
+
+	// every patch's control points with its transform applied
+	void gatherTransformedControlPoints(const PatchModel& model, vector<Float3>& controlPoints)
+	{
+		size_t patchCount{ model.getPatchCount() };
+		controlPoints.resize(patchCount * PatchModel::controlPointsPerPatch);
+		for (size_t patch = 0; patch < patchCount; ++patch)
+		{
+			Float3* points{ &controlPoints[patch * PatchModel::controlPointsPerPatch] };
+			teapot_tutorial::gatherControlPoints(model, patch, points);
+			const Float4x4& transform{ patch < model.patchesTransforms.size() ? model.patchesTransforms[patch] : math::identity() };
+			for (size_t i = 0; i < PatchModel::controlPointsPerPatch; ++i)
+			{
+				points[i] = bezier::transformPosition(points[i], transform);
+			}
+		}
+	}
+
+	// half the diagonal of the bounds
+	float getRadius(const vector<Float3>& points)
+	{
+		Float3 low{ numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::max() };
+		Float3 high{ -low.x, -low.y, -low.z };
+		for (const Float3& p : points)
+		{
+			low = { min(low.x, p.x), min(low.y, p.y), min(low.z, p.z) };
+			high = { max(high.x, p.x), max(high.y, p.y), max(high.z, p.z) };
+		}
+		return max(math::length(high - low) * 0.5f, 1e-6f);
+	}
+
+	// dP/du and dP/dv by central differences of the double precision evaluation, one sided at the borders
+	void getDifferenceTangents(const Float3* controlPoints, double u, double v, Double3& dPdu, Double3& dPdv)
+	{
+		const double h{ 1e-4 };
+		double u0{ max(u - h, 0.0) };
+		double u1{ min(u + h, 1.0) };
+		double v0{ max(v - h, 0.0) };
+		double v1{ min(v + h, 1.0) };
+		Double3 pu0{ evaluateDouble(controlPoints, u0, v) };
+		Double3 pu1{ evaluateDouble(controlPoints, u1, v) };
+		Double3 pv0{ evaluateDouble(controlPoints, u, v0) };
+		Double3 pv1{ evaluateDouble(controlPoints, u, v1) };
+		dPdu = { (pu1.x - pu0.x) / (u1 - u0), (pu1.y - pu0.y) / (u1 - u0), (pu1.z - pu0.z) / (u1 - u0) };
+		dPdv = { (pv1.x - pv0.x) / (v1 - v0), (pv1.y - pv0.y) / (v1 - v0), (pv1.z - pv0.z) / (v1 - v0) };
+	}
+
+	Double3 getDoubleNormal(const Double3& a, const Double3& b)
+	{
+		Double3 n{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		double length{ sqrt(n.x * n.x + n.y * n.y + n.z * n.z) };
+		return length > 0.0 ? Double3{ n.x / length, n.y / length, n.z / length } : n;
+	}
+
+	double getDistance(const Float3& a, const Double3& b)
+	{
+		double dx{ a.x - b.x };
+		double dy{ a.y - b.y };
+		double dz{ a.z - b.z };
+		return sqrt(dx * dx + dy * dy + dz * dz);
+	}
+
+	double getAngleDegrees(const Float3& a, const Double3& b)
+	{
+		double cosine{ a.x * b.x + a.y * b.y + a.z * b.z };
+		return acos(min(max(cosine, -1.0), 1.0)) * 180.0 / 3.14159265358979323846;
+	}
+
+#if defined(PATCH_EVALUATOR_SSE2)
+	__m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+#endif
+}
+
+namespace teapot_tutorial
+{
+	void evaluateGridBernstein(const Float3* controlPoints, int factor, Float3* positions)
+	{
+		const BernsteinWeights& weights{ BernsteinTableCache::getShared().get(factor) };
+		int n{ weights.factor };
+		for (int j{ 0 }; j <= n; ++j)
+		{
+			for (int i{ 0 }; i <= n; ++i)
+			{
+				*positions++ = bezier::evaluate(controlPoints, weights.basis[i], weights.basis[j]);
+			}
+		}
+	}
+
+	void evaluateGridForwardDifference(const Float3* controlPoints, int factor, uint32_t anchorSteps, Float3* positions)
+	{
+		const BernsteinWeights& weights{ BernsteinTableCache::getShared().get(factor) };
+		int n{ weights.factor };
+		size_t rowLength{ static_cast<size_t>(n) + 1 };
+		float h{ 1.0f / static_cast<float>(n) };
+		for (int firstRow{ 0 }; firstRow <= n; firstRow += 4)
+		{
+			int rows{ min(4, n + 1 - firstRow) };
+			// power basis a + b u + c u^2 + d u^3 of each row, by coordinate, one row per lane
+			alignas(16) float coefficients[3][4][4];
+			for (int lane{ 0 }; lane < 4; ++lane)
+			{
+				const Float4& basisV{ weights.basis[firstRow + min(lane, rows - 1)] };
+				Float3 q[4];
+				for (size_t column = 0; column < 4; ++column)
+				{
+					q[column] = controlPoints[column] * basisV.x + controlPoints[4 + column] * basisV.y +
+						controlPoints[8 + column] * basisV.z + controlPoints[12 + column] * basisV.w;
+				}
+				Float3 a{ q[0] };
+				Float3 b{ (q[1] - q[0]) * 3.0f };
+				Float3 c{ (q[0] - q[1] * 2.0f + q[2]) * 3.0f };
+				Float3 d{ q[3] - q[0] + (q[1] - q[2]) * 3.0f };
+				const Float3* powers[4]{ &a, &b, &c, &d };
+				for (size_t power = 0; power < 4; ++power)
+				{
+					coefficients[0][power][lane] = powers[power]->x;
+					coefficients[1][power][lane] = powers[power]->y;
+					coefficients[2][power][lane] = powers[power]->z;
+				}
+			}
+
+			Float3* rowPositions{ positions + static_cast<size_t>(firstRow) * rowLength };
+#if defined(PATCH_EVALUATOR_SSE2)
+			__m128 f[3];
+			__m128 d1[3];
+			__m128 d2[3];
+			__m128 d3[3];
+			const __m128 vh{ _mm_set1_ps(h) };
+			// the value and differences at u from the power basis
+			auto anchor = [&](float u)
+			{
+				const __m128 vu{ _mm_set1_ps(u) };
+				const __m128 three{ _mm_set1_ps(3.0f) };
+				for (size_t c = 0; c < 3; ++c)
+				{
+					__m128 a{ _mm_load_ps(coefficients[c][0]) };
+					__m128 b{ _mm_load_ps(coefficients[c][1]) };
+					__m128 cc{ _mm_load_ps(coefficients[c][2]) };
+					__m128 d{ _mm_load_ps(coefficients[c][3]) };
+					f[c] = _mm_add_ps(a, _mm_mul_ps(vu, _mm_add_ps(b, _mm_mul_ps(vu, _mm_add_ps(cc, _mm_mul_ps(vu, d))))));
+					// h (b + c (2u + h) + d (3u^2 + 3uh + h^2))
+					__m128 twoUPlusH{ _mm_add_ps(_mm_add_ps(vu, vu), vh) };
+					__m128 cubic{ _mm_add_ps(_mm_mul_ps(three, _mm_mul_ps(vu, _mm_add_ps(vu, vh))), _mm_mul_ps(vh, vh)) };
+					d1[c] = _mm_mul_ps(vh, _mm_add_ps(b, _mm_add_ps(_mm_mul_ps(cc, twoUPlusH), _mm_mul_ps(d, cubic))));
+					// 2h^2 (c + 3d (u + h))
+					__m128 h2{ _mm_mul_ps(vh, vh) };
+					d2[c] = _mm_mul_ps(_mm_add_ps(h2, h2), _mm_add_ps(cc, _mm_mul_ps(_mm_mul_ps(three, d), _mm_add_ps(vu, vh))));
+					// 6d h^3
+					d3[c] = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(6.0f), d), _mm_mul_ps(h2, vh));
+				}
+			};
+
+			anchor(0.0f);
+			for (int i{ 0 }; i <= n; ++i)
+			{
+				if (anchorSteps > 0 && i > 0 && i % anchorSteps == 0)
+				{
+					anchor(static_cast<float>(i) * h);
+				}
+				alignas(16) float values[3][4];
+				for (size_t c = 0; c < 3; ++c)
+				{
+					_mm_store_ps(values[c], f[c]);
+					f[c] = _mm_add_ps(f[c], d1[c]);
+					d1[c] = _mm_add_ps(d1[c], d2[c]);
+					d2[c] = _mm_add_ps(d2[c], d3[c]);
+				}
+				for (int lane{ 0 }; lane < rows; ++lane)
+				{
+					rowPositions[lane * rowLength + i] = { values[0][lane], values[1][lane], values[2][lane] };
+				}
+			}
+#else
+			float f[3][4];
+			float d1[3][4];
+			float d2[3][4];
+			float d3[3][4];
+			auto anchor = [&](float u)
+			{
+				for (size_t c = 0; c < 3; ++c)
+				{
+					for (size_t lane = 0; lane < 4; ++lane)
+					{
+						float a{ coefficients[c][0][lane] };
+						float b{ coefficients[c][1][lane] };
+						float cc{ coefficients[c][2][lane] };
+						float d{ coefficients[c][3][lane] };
+						f[c][lane] = a + u * (b + u * (cc + u * d));
+						d1[c][lane] = h * (b + cc * (u + u + h) + d * (3.0f * (u * (u + h)) + h * h));
+						d2[c][lane] = (h * h + h * h) * (cc + 3.0f * d * (u + h));
+						d3[c][lane] = 6.0f * d * (h * h * h);
+					}
+				}
+			};
+
+			anchor(0.0f);
+			for (int i{ 0 }; i <= n; ++i)
+			{
+				if (anchorSteps > 0 && i > 0 && i % anchorSteps == 0)
+				{
+					anchor(static_cast<float>(i) * h);
+				}
+				for (int lane{ 0 }; lane < rows; ++lane)
+				{
+					rowPositions[lane * rowLength + i] = { f[0][lane], f[1][lane], f[2][lane] };
+				}
+				for (size_t c = 0; c < 3; ++c)
+				{
+					for (size_t lane = 0; lane < 4; ++lane)
+					{
+						f[c][lane] += d1[c][lane];
+						d1[c][lane] += d2[c][lane];
+						d2[c][lane] += d3[c][lane];
+					}
+				}
+			}
+#endif
+		}
+	}
+
+	bool hasFixedKernel(int factor)
+	{
+		return factor == 1 || factor == 2 || factor == 4 || factor == 8 || factor == 16 || factor == 32 || factor == 64;
+	}
+
+	void evaluateGridKernel(const Float3* controlPoints, int factor, Float3* positions)
+	{
+		switch (factor)
+		{
+		case 1:
+			evaluateGridFixed<1>(controlPoints, positions);
+			break;
+		case 2:
+			evaluateGridFixed<2>(controlPoints, positions);
+			break;
+		case 4:
+			evaluateGridFixed<4>(controlPoints, positions);
+			break;
+		case 8:
+			evaluateGridFixed<8>(controlPoints, positions);
+			break;
+		case 16:
+			evaluateGridFixed<16>(controlPoints, positions);
+			break;
+		case 32:
+			evaluateGridFixed<32>(controlPoints, positions);
+			break;
+		case 64:
+			evaluateGridFixed<64>(controlPoints, positions);
+			break;
+		default:
+			evaluateGridKernelGeneric(controlPoints, factor, positions);
+			break;
+		}
+	}
+
+	void evaluateGridKernelGeneric(const Float3* controlPoints, int factor, Float3* positions)
+	{
+		// Float4 rows are the (factor + 1) rows of four that evaluateGridWeights takes
+		const BernsteinWeights& weights{ BernsteinTableCache::getShared().get(factor) };
+		evaluateGridWeights<0>(controlPoints, weights.factor, reinterpret_cast<const float*>(weights.basis), positions);
+	}
+
+	void evaluateGridFrames(const Float3* controlPoints, int factor, Float3* positions, Float3* tangentsU, Float3* tangentsV, Float3* normals)
+	{
+		const BernsteinWeights& weights{ BernsteinTableCache::getShared().get(factor) };
+		int n{ weights.factor };
+		size_t rowLength{ static_cast<size_t>(n) + 1 };
+		float step{ 1.0f / static_cast<float>(n) };
+		for (int j{ 0 }; j <= n; ++j)
+		{
+			float v{ static_cast<float>(j) * step };
+			const Float4& basisV{ weights.basis[j] };
+			const Float4& derivativeV{ weights.derivatives[j] };
+			size_t row{ static_cast<size_t>(j) * rowLength };
+#if defined(PATCH_EVALUATOR_SSE2)
+			// the row's curve along u and its derivative in v, by coordinate
+			float q[3][4];
+			float r[3][4];
+			for (size_t column = 0; column < 4; ++column)
+			{
+				const Float3* p{ controlPoints + column };
+				Float3 curve{ p[0] * basisV.x + p[4] * basisV.y + p[8] * basisV.z + p[12] * basisV.w };
+				Float3 derivative{ p[0] * derivativeV.x + p[4] * derivativeV.y + p[8] * derivativeV.z + p[12] * derivativeV.w };
+				q[0][column] = curve.x;
+				q[1][column] = curve.y;
+				q[2][column] = curve.z;
+				r[0][column] = derivative.x;
+				r[1][column] = derivative.y;
+				r[2][column] = derivative.z;
+			}
+
+			const __m128 one{ _mm_set1_ps(1.0f) };
+			const __m128 three{ _mm_set1_ps(3.0f) };
+			const __m128 ratio{ _mm_set1_ps(bezier::collapsedTangentRatio) };
+			const __m128 signV{ _mm_set1_ps(v < 0.5f ? 1.0f : -1.0f) };
+			for (int firstColumn{ 0 }; firstColumn <= n; firstColumn += 4)
+			{
+				// four u values, and their Bernstein basis and its derivative
+				__m128 t{ _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(firstColumn)), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)), _mm_set1_ps(step)) };
+				__m128 invT{ _mm_sub_ps(one, t) };
+				__m128 t2{ _mm_mul_ps(t, t) };
+				__m128 invT2{ _mm_mul_ps(invT, invT) };
+				__m128 tInvT{ _mm_mul_ps(t, invT) };
+				const __m128 basis[4]{ _mm_mul_ps(invT2, invT), _mm_mul_ps(three, _mm_mul_ps(tInvT, invT)),
+					_mm_mul_ps(three, _mm_mul_ps(tInvT, t)), _mm_mul_ps(t2, t) };
+				const __m128 derivative[4]{ _mm_mul_ps(_mm_set1_ps(-3.0f), invT2),
+					_mm_sub_ps(_mm_mul_ps(three, invT2), _mm_mul_ps(_mm_set1_ps(6.0f), tInvT)),
+					_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(6.0f), tInvT), _mm_mul_ps(three, t2)), _mm_mul_ps(three, t2) };
+
+				__m128 p[3];
+				__m128 du[3];
+				__m128 dv[3];
+				__m128 duv[3];
+				for (size_t c = 0; c < 3; ++c)
+				{
+					p[c] = _mm_setzero_ps();
+					du[c] = _mm_setzero_ps();
+					dv[c] = _mm_setzero_ps();
+					duv[c] = _mm_setzero_ps();
+					for (size_t k = 0; k < 4; ++k)
+					{
+						__m128 qk{ _mm_set1_ps(q[c][k]) };
+						__m128 rk{ _mm_set1_ps(r[c][k]) };
+						p[c] = _mm_add_ps(p[c], _mm_mul_ps(basis[k], qk));
+						du[c] = _mm_add_ps(du[c], _mm_mul_ps(derivative[k], qk));
+						dv[c] = _mm_add_ps(dv[c], _mm_mul_ps(basis[k], rk));
+						duv[c] = _mm_add_ps(duv[c], _mm_mul_ps(derivative[k], rk));
+					}
+				}
+
+				// bezier::getNormal on four points
+				__m128 duSquared{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(du[0], du[0]), _mm_mul_ps(du[1], du[1])), _mm_mul_ps(du[2], du[2])) };
+				__m128 dvSquared{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(dv[0], dv[0]), _mm_mul_ps(dv[1], dv[1])), _mm_mul_ps(dv[2], dv[2])) };
+				__m128 duCollapsed{ _mm_cmplt_ps(duSquared, _mm_mul_ps(ratio, dvSquared)) };
+				__m128 dvCollapsed{ _mm_cmplt_ps(dvSquared, _mm_mul_ps(ratio, duSquared)) };
+				__m128 signU{ select(_mm_cmplt_ps(t, _mm_set1_ps(0.5f)), one, _mm_set1_ps(-1.0f)) };
+				__m128 a[3];
+				__m128 b[3];
+				for (size_t c = 0; c < 3; ++c)
+				{
+					a[c] = select(duCollapsed, _mm_mul_ps(duv[c], signV), du[c]);
+					b[c] = select(dvCollapsed, _mm_mul_ps(duv[c], signU), dv[c]);
+				}
+				__m128 normal[3]{ _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1])),
+					_mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2])),
+					_mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0])) };
+				__m128 length{ _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normal[0], normal[0]), _mm_mul_ps(normal[1], normal[1])), _mm_mul_ps(normal[2], normal[2]))) };
+				__m128 scale{ select(_mm_cmpgt_ps(length, _mm_setzero_ps()), _mm_div_ps(one, length), one) };
+
+				alignas(16) float values[4][3][4];
+				for (size_t c = 0; c < 3; ++c)
+				{
+					_mm_store_ps(values[0][c], p[c]);
+					_mm_store_ps(values[1][c], du[c]);
+					_mm_store_ps(values[2][c], dv[c]);
+					_mm_store_ps(values[3][c], _mm_mul_ps(normal[c], scale));
+				}
+				Float3* outputs[4]{ positions + row + firstColumn, tangentsU + row + firstColumn, tangentsV + row + firstColumn, normals + row + firstColumn };
+				int lanes{ min(4, n + 1 - firstColumn) };
+				for (size_t output = 0; output < 4; ++output)
+				{
+					for (int lane{ 0 }; lane < lanes; ++lane)
+					{
+						outputs[output][lane] = { values[output][0][lane], values[output][1][lane], values[output][2][lane] };
+					}
+				}
+			}
+#else
+			for (int i{ 0 }; i <= n; ++i)
+			{
+				float u{ static_cast<float>(i) * step };
+				const Float4& basisU{ weights.basis[i] };
+				const Float4& derivativeU{ weights.derivatives[i] };
+				positions[row + i] = bezier::evaluate(controlPoints, basisU, basisV);
+				tangentsU[row + i] = bezier::evaluate(controlPoints, derivativeU, basisV);
+				tangentsV[row + i] = bezier::evaluate(controlPoints, basisU, derivativeV);
+				normals[row + i] = bezier::getNormal(tangentsU[row + i], tangentsV[row + i], bezier::evaluate(controlPoints, derivativeU, derivativeV), u, v);
+			}
+#endif
+		}
+	}
+
+	vector<EvaluatorBenchmarkResult> runEvaluatorBenchmark(const PatchModel& model)
+	{
+		size_t patchCount{ model.getPatchCount() };
+		vector<Float3> controlPoints;
+		gatherTransformedControlPoints(model, controlPoints);
+		float radius{ getRadius(controlPoints) };
+
+		struct Evaluator
+		{
+			const char* name;
+			bool forwardDifference;
+			uint32_t anchorSteps;
+		};
+		const Evaluator evaluators[]{ { "bernstein", false, 0 }, { "fd anchor 16", true, defaultAnchorSteps }, { "fd no anchor", true, 0 } };
+
+		vector<EvaluatorBenchmarkResult> results;
+		vector<Float3> positions;
+		for (int factor : { 4, 16, 64 })
+		{
+			size_t gridVertices{ getGridVertexCount(factor) };
+			positions.resize(patchCount * gridVertices);
+			size_t repeats{ max<size_t>(benchmarkPoints / max<size_t>(positions.size(), 1), 1) };
+			double bernsteinSeconds{ 0.0 };
+			for (const Evaluator& evaluator : evaluators)
+			{
+				auto evaluateAll = [&]()
+				{
+					for (size_t patch = 0; patch < patchCount; ++patch)
+					{
+						const Float3* points{ &controlPoints[patch * PatchModel::controlPointsPerPatch] };
+						if (evaluator.forwardDifference)
+						{
+							evaluateGridForwardDifference(points, factor, evaluator.anchorSteps, &positions[patch * gridVertices]);
+						}
+						else
+						{
+							evaluateGridBernstein(points, factor, &positions[patch * gridVertices]);
+						}
+					}
+				};
+
+				evaluateAll();
+				auto begin = chrono::steady_clock::now();
+				for (size_t repeat = 0; repeat < repeats; ++repeat)
+				{
+					evaluateAll();
+				}
+				double seconds{ chrono::duration<double>(chrono::steady_clock::now() - begin).count() };
+				bernsteinSeconds = evaluator.forwardDifference ? bernsteinSeconds : seconds;
+
+				double maxError{ 0.0 };
+				double step{ 1.0 / factor };
+				for (size_t patch = 0; patch < patchCount; ++patch)
+				{
+					for (int j = 0; j <= factor; ++j)
+					{
+						for (int i = 0; i <= factor; ++i)
+						{
+							Double3 exact{ evaluateDouble(&controlPoints[patch * PatchModel::controlPointsPerPatch], i * step, j * step) };
+							const Float3& p{ positions[patch * gridVertices + static_cast<size_t>(j) * (factor + 1) + i] };
+							maxError = max(maxError, getDistance(p, exact));
+						}
+					}
+				}
+
+				EvaluatorBenchmarkResult result;
+				result.name = evaluator.name;
+				result.factor = factor;
+				result.pointsPerSecond = seconds > 0.0 ? repeats * positions.size() / seconds : 0.0;
+				result.speedup = seconds > 0.0 ? bernsteinSeconds / seconds : 0.0;
+				result.maxError = maxError / radius;
+				results.push_back(result);
+			}
+		}
+		return results;
+	}
+
+	vector<KernelBenchmarkResult> runKernelBenchmark(const PatchModel& model)
+	{
+		size_t patchCount{ model.getPatchCount() };
+		vector<Float3> controlPoints;
+		gatherTransformedControlPoints(model, controlPoints);
+
+		vector<KernelBenchmarkResult> results;
+		vector<Float3> positions;
+		vector<Float3> genericPositions;
+		for (int factor : { 1, 2, 3, 4, 8, 12, 16, 32, 48, 64 })
+		{
+			size_t gridVertices{ getGridVertexCount(factor) };
+			positions.resize(patchCount * gridVertices);
+			genericPositions.resize(positions.size());
+			size_t repeats{ max<size_t>(benchmarkPoints / max<size_t>(positions.size(), 1), 1) };
+			auto measure = [&](void(*evaluate)(const Float3*, int, Float3*), vector<Float3>& output)
+			{
+				auto begin = chrono::steady_clock::now();
+				for (size_t repeat = 0; repeat < repeats; ++repeat)
+				{
+					for (size_t patch = 0; patch < patchCount; ++patch)
+					{
+						evaluate(&controlPoints[patch * PatchModel::controlPointsPerPatch], factor, &output[patch * gridVertices]);
+					}
+				}
+				double seconds{ chrono::duration<double>(chrono::steady_clock::now() - begin).count() };
+				return seconds > 0.0 ? repeats * output.size() / seconds : 0.0;
+			};
+
+			KernelBenchmarkResult result;
+			result.factor = factor;
+			result.fixed = hasFixedKernel(factor);
+			result.kernelPointsPerSecond = measure(evaluateGridKernel, positions);
+			result.genericPointsPerSecond = measure(evaluateGridKernelGeneric, genericPositions);
+			if (memcmp(positions.data(), genericPositions.data(), positions.size() * sizeof(Float3)) != 0)
+			{
+				throw(runtime_error{ "The factor " + to_string(factor) + " kernel differs from the generic one." });
+			}
+			result.bernsteinPointsPerSecond = measure(evaluateGridBernstein, genericPositions);
+			results.push_back(result);
+		}
+		return results;
+	}
+
+	string formatKernelBenchmarkResults(const vector<KernelBenchmarkResult>& results)
+	{
+		string text;
+		for (const KernelBenchmarkResult& result : results)
+		{
+			char line[256];
+			snprintf(line, sizeof(line), "kernel f%-2d %-7s %.1f Mpoints/s, %.2fx generic %.1f, %.2fx bernstein %.1f\n",
+				result.factor, result.fixed ? "fixed" : "generic", result.kernelPointsPerSecond / 1e6,
+				result.genericPointsPerSecond > 0.0 ? result.kernelPointsPerSecond / result.genericPointsPerSecond : 0.0, result.genericPointsPerSecond / 1e6,
+				result.bernsteinPointsPerSecond > 0.0 ? result.kernelPointsPerSecond / result.bernsteinPointsPerSecond : 0.0, result.bernsteinPointsPerSecond / 1e6);
+			text += line;
+		}
+		return text;
+	}
+
+	NormalCheckResult runNormalCheck(const PatchModel& model)
+	{
+		const int factor{ 16 };
+		size_t patchCount{ model.getPatchCount() };
+		vector<Float3> controlPoints;
+		gatherTransformedControlPoints(model, controlPoints);
+		float radius{ getRadius(controlPoints) };
+		size_t gridVertices{ getGridVertexCount(factor) };
+		vector<Float3> positions(patchCount * gridVertices);
+		vector<Float3> tangentsU(positions.size());
+		vector<Float3> tangentsV(positions.size());
+		vector<Float3> normals(positions.size());
+		for (size_t patch = 0; patch < patchCount; ++patch)
+		{
+			size_t first{ patch * gridVertices };
+			evaluateGridFrames(&controlPoints[patch * PatchModel::controlPointsPerPatch], factor, &positions[first], &tangentsU[first], &tangentsV[first], &normals[first]);
+		}
+
+		NormalCheckResult result;
+		result.points = positions.size();
+		result.collapsedPoints = 0;
+		result.maxTangentError = 0.0;
+		result.maxNormalDegrees = 0.0;
+		result.maxCollapsedNormalDegrees = 0.0;
+		const double inset{ 1e-3 };
+		for (size_t patch = 0; patch < patchCount; ++patch)
+		{
+			const Float3* points{ &controlPoints[patch * PatchModel::controlPointsPerPatch] };
+			for (int j = 0; j <= factor; ++j)
+			{
+				for (int i = 0; i <= factor; ++i)
+				{
+					size_t index{ patch * gridVertices + static_cast<size_t>(j) * (factor + 1) + i };
+					double u{ static_cast<double>(i) / factor };
+					double v{ static_cast<double>(j) / factor };
+					Double3 dPdu;
+					Double3 dPdv;
+					getDifferenceTangents(points, u, v, dPdu, dPdv);
+					result.maxTangentError = max(result.maxTangentError, max(getDistance(tangentsU[index], dPdu), getDistance(tangentsV[index], dPdv)) / radius);
+
+					double duSquared{ dPdu.x * dPdu.x + dPdu.y * dPdu.y + dPdu.z * dPdu.z };
+					double dvSquared{ dPdv.x * dPdv.x + dPdv.y * dPdv.y + dPdv.z * dPdv.z };
+					if (duSquared < bezier::collapsedTangentRatio * dvSquared || dvSquared < bezier::collapsedTangentRatio * duSquared)
+					{
+						// the difference normal vanishes on the border, so it comes from just inside
+						getDifferenceTangents(points, min(max(u, inset), 1.0 - inset), min(max(v, inset), 1.0 - inset), dPdu, dPdv);
+						++result.collapsedPoints;
+						result.maxCollapsedNormalDegrees = max(result.maxCollapsedNormalDegrees, getAngleDegrees(normals[index], getDoubleNormal(dPdu, dPdv)));
+					}
+					else
+					{
+						result.maxNormalDegrees = max(result.maxNormalDegrees, getAngleDegrees(normals[index], getDoubleNormal(dPdu, dPdv)));
+					}
+				}
+			}
+		}
+		if (result.maxTangentError > 1e-3 || result.maxNormalDegrees > 0.1 || result.maxCollapsedNormalDegrees > 1.0)
+		{
+			throw(runtime_error{ "Analytic patch derivatives differ from finite differences." });
+		}
+
+		// throughput at factor 64, against the same per point with the scalar helpers and positions alone
+		const int benchmarkFactor{ maxTessFactor };
+		gridVertices = getGridVertexCount(benchmarkFactor);
+		positions.resize(patchCount * gridVertices);
+		tangentsU.resize(positions.size());
+		tangentsV.resize(positions.size());
+		normals.resize(positions.size());
+		size_t repeats{ max<size_t>(benchmarkPoints / max<size_t>(positions.size(), 1), 1) };
+		auto measure = [&](int kind)
+		{
+			auto begin = chrono::steady_clock::now();
+			for (size_t repeat = 0; repeat < repeats; ++repeat)
+			{
+				for (size_t patch = 0; patch < patchCount; ++patch)
+				{
+					const Float3* points{ &controlPoints[patch * PatchModel::controlPointsPerPatch] };
+					size_t first{ patch * gridVertices };
+					if (kind == 0)
+					{
+						evaluateGridFrames(points, benchmarkFactor, &positions[first], &tangentsU[first], &tangentsV[first], &normals[first]);
+					}
+					else if (kind == 1)
+					{
+						float step{ 1.0f / benchmarkFactor };
+						for (int j = 0; j <= benchmarkFactor; ++j)
+						{
+							float v{ static_cast<float>(j) * step };
+							Float4 basisV{ bezier::bernsteinBasis(v) };
+							Float4 derivativeV{ bezier::bernsteinDerivative(v) };
+							for (int i = 0; i <= benchmarkFactor; ++i)
+							{
+								size_t index{ first + static_cast<size_t>(j) * (benchmarkFactor + 1) + i };
+								float u{ static_cast<float>(i) * step };
+								Float4 basisU{ bezier::bernsteinBasis(u) };
+								Float4 derivativeU{ bezier::bernsteinDerivative(u) };
+								positions[index] = bezier::evaluate(points, basisU, basisV);
+								tangentsU[index] = bezier::evaluate(points, derivativeU, basisV);
+								tangentsV[index] = bezier::evaluate(points, basisU, derivativeV);
+								normals[index] = bezier::getNormal(tangentsU[index], tangentsV[index], bezier::evaluate(points, derivativeU, derivativeV), u, v);
+							}
+						}
+					}
+					else
+					{
+						evaluateGridBernstein(points, benchmarkFactor, &positions[first]);
+					}
+				}
+			}
+			double seconds{ chrono::duration<double>(chrono::steady_clock::now() - begin).count() };
+			return seconds > 0.0 ? repeats * positions.size() / seconds : 0.0;
+		};
+		result.framePointsPerSecond = measure(0);
+		result.scalarFramePointsPerSecond = measure(1);
+		result.positionPointsPerSecond = measure(2);
+		return result;
+	}
+
+	string formatNormalCheckResult(const NormalCheckResult& result)
+	{
+		char text[384];
+		snprintf(text, sizeof(text), "normals %zu points, %zu on collapsed borders: tangent error max %.2e, normal error max %.4f deg, %.4f deg on collapsed borders\n"
+			"normals f64 %.1f Mpoints/s simd, %.1f scalar, %.1f positions only\n",
+			result.points, result.collapsedPoints, result.maxTangentError, result.maxNormalDegrees, result.maxCollapsedNormalDegrees,
+			result.framePointsPerSecond / 1e6, result.scalarFramePointsPerSecond / 1e6, result.positionPointsPerSecond / 1e6);
+		return text;
+	}
+
+	string formatEvaluatorBenchmarkResults(const vector<EvaluatorBenchmarkResult>& results)
+	{
+		string text;
+		for (const EvaluatorBenchmarkResult& result : results)
+		{
+			char line[256];
+			snprintf(line, sizeof(line), "evaluator %-12s f%-2d %.1f Mpoints/s, %.2fx bernstein, max error %.3g\n",
+				result.name.c_str(), result.factor, result.pointsPerSecond / 1e6, result.speedup, result.maxError);
+			text += line;
+		}
+		return text;
+	}
+}
\ No newline at end of file
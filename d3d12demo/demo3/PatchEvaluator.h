@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MathTypes.h"
+#include "PatchModel.h"
+
+enum class PatchEvaluator
+{
+	// BernsteinTableCache weights and the 16 term sum per point, like DomainShader.hlsl
+	Bernstein,
+	// forward differences along the grid rows, four rows at a time
+	ForwardDifference,
+	// a weight table per factor and one curve per grid row, compile time kernels for the common factors
+	WeightTable
+};
+
+struct EvaluatorBenchmarkResult
+{
+	std::string name;
+	int factor;
+	double pointsPerSecond;
+	// over the Bernstein evaluator at the same factor
+	double speedup;
+	// largest distance from a double precision evaluation, relative to the bounding radius
+	double maxError;
+};
+
+struct NormalCheckResult
+{
+	size_t points;
+	// on a border collapsed to a point, checked against differences just inside it
+	size_t collapsedPoints;
+	// largest distance of dP/du or dP/dv from central differences, relative to the bounding radius
+	double maxTangentError;
+	double maxNormalDegrees;
+	double maxCollapsedNormalDegrees;
+	double framePointsPerSecond;
+	double scalarFramePointsPerSecond;
+	double positionPointsPerSecond;
+};
+
+struct KernelBenchmarkResult
+{
+	int factor;
+	bool fixed;
+	double kernelPointsPerSecond;
+	// the same kernel with the factor and weights at run time
+	double genericPointsPerSecond;
+	double bernsteinPointsPerSecond;
+};
+
+// Grid evaluators behind tessellatePatch. Both write the (factor + 1)^2 points of a patch row by row, u along a
+// row and v across rows, from 16 control points that already have the patch transform applied.
+namespace teapot_tutorial
+{
+	// steps along a row between recomputing the differences from the row's power basis
+	const uint32_t defaultAnchorSteps{ 16 };
+
+	void evaluateGridBernstein(const Float3* controlPoints, int factor, Float3* positions);
+
+	// Each row is a cubic in u whose power basis comes from the Bernstein basis in v; after that a point costs
+	// three adds per coordinate. anchorSteps 0 never re-anchors, so rounding error grows along the row.
+	void evaluateGridForwardDifference(const Float3* controlPoints, int factor, uint32_t anchorSteps, Float3* positions);
+
+	// factors evaluateGridKernel has a compile time kernel for: 1, 2, 4, 8, 16, 32 and 64
+	bool hasFixedKernel(int factor);
+	// evaluateGridFixed of PatchKernels.h for those factors, evaluateGridKernelGeneric for the rest
+	void evaluateGridKernel(const Float3* controlPoints, int factor, Float3* positions);
+	void evaluateGridKernelGeneric(const Float3* controlPoints, int factor, Float3* positions);
+
+	// Positions, dP/du, dP/dv and unit normals from one Bernstein evaluation, four points of a row at a time.
+	// Normals on a border collapsed to a point follow bezier::getNormal.
+	void evaluateGridFrames(const Float3* controlPoints, int factor, Float3* positions, Float3* tangentsU, Float3* tangentsV, Float3* normals);
+
+	// Throughput and error of both evaluators, forward differencing with and without re-anchoring, at factors 4,
+	// 16 and 64 over the model's patches.
+	std::vector<EvaluatorBenchmarkResult> runEvaluatorBenchmark(const PatchModel& model);
+
+	// Each fixed factor kernel and a few others through the dispatcher, against the generic kernel and the
+	// Bernstein evaluator. Throws when a kernel's output differs from the generic one's.
+	std::vector<KernelBenchmarkResult> runKernelBenchmark(const PatchModel& model);
+
+	// one line per result
+	std::string formatKernelBenchmarkResults(const std::vector<KernelBenchmarkResult>& results);
+
+	// Checks evaluateGridFrames at factor 16 against double precision differences and throws when it is off, then
+	// measures it at factor 64 against the scalar helpers and against positions alone.
+	NormalCheckResult runNormalCheck(const PatchModel& model);
+
+	std::string formatNormalCheckResult(const NormalCheckResult& result);
+
+	// one line per result
+	std::string formatEvaluatorBenchmarkResults(const std::vector<EvaluatorBenchmarkResult>& results);
+}
\ No newline at end of file
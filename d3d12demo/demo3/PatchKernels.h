@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include "MathTypes.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PATCH_KERNELS_SSE2 1
+#endif
+
+// Grid evaluation from a table of Bernstein weights, (factor + 1) rows of four. Each grid row first sums the
+// control point rows into one curve along u, after which a point is a four term sum. FixedBernsteinTable builds
+// the table at compile time, along with a transposed copy that evaluateGridFixed reads four points of a row at a
+// time from.
+namespace teapot_tutorial
+{
+	// bezier::bernsteinBasis as one expression, so it can run at compile time and round the same way
+	constexpr float getBernsteinWeight(size_t k, float t)
+	{
+		return k == 0 ? (1.0f - t) * (1.0f - t) * (1.0f - t) :
+			k == 1 ? 3.0f * t * (1.0f - t) * (1.0f - t) :
+			k == 2 ? 3.0f * t * t * (1.0f - t) :
+			t * t * t;
+	}
+
+	template <size_t Size>
+	struct BernsteinTable
+	{
+		float weights[Size];
+	};
+
+	// the four weights of each parameter i / Factor in turn
+	template <int Factor, size_t... Indices>
+	constexpr BernsteinTable<sizeof...(Indices)> makeBernsteinTable(std::index_sequence<Indices...>)
+	{
+		return{ { getBernsteinWeight(Indices % 4, static_cast<float>(Indices / 4) / static_cast<float>(Factor))... } };
+	}
+
+	// weight k of every parameter i / Factor for i below Columns, then the next k
+	template <int Factor, size_t Columns, size_t... Indices>
+	constexpr BernsteinTable<sizeof...(Indices)> makeTransposedBernsteinTable(std::index_sequence<Indices...>)
+	{
+		return{ { getBernsteinWeight(Indices / Columns, static_cast<float>(Indices % Columns) / static_cast<float>(Factor))... } };
+	}
+
+	template <int Factor>
+	struct FixedBernsteinTable
+	{
+		// the u columns of a row rounded up to groups of four; the weights past the last column are of t > 1
+		static constexpr size_t columns{ (Factor + 4) / 4 * 4 };
+
+		static constexpr BernsteinTable<(Factor + 1) * 4> table{ makeBernsteinTable<Factor>(std::make_index_sequence<(Factor + 1) * 4>{}) };
+		// weight k of column i at [k * columns + i]
+		static constexpr BernsteinTable<columns * 4> transposed{ makeTransposedBernsteinTable<Factor, columns>(std::make_index_sequence<columns * 4>{}) };
+	};
+
+	template <int Factor>
+	constexpr size_t FixedBernsteinTable<Factor>::columns;
+	template <int Factor>
+	constexpr BernsteinTable<(Factor + 1) * 4> FixedBernsteinTable<Factor>::table;
+	template <int Factor>
+	constexpr BernsteinTable<FixedBernsteinTable<Factor>::columns * 4> FixedBernsteinTable<Factor>::transposed;
+
+	// Factor 0 takes the factor at run time
+	template <int Factor>
+	inline void evaluateGridWeights(const Float3* controlPoints, int factor, const float* weights, Float3* positions)
+	{
+		const int n{ Factor > 0 ? Factor : factor };
+		const Float3* p{ controlPoints };
+		for (int j = 0; j <= n; ++j)
+		{
+			const float* bv{ weights + j * 4 };
+			const Float3 curve[4]{
+				p[0] * bv[0] + p[4] * bv[1] + p[8] * bv[2] + p[12] * bv[3],
+				p[1] * bv[0] + p[5] * bv[1] + p[9] * bv[2] + p[13] * bv[3],
+				p[2] * bv[0] + p[6] * bv[1] + p[10] * bv[2] + p[14] * bv[3],
+				p[3] * bv[0] + p[7] * bv[1] + p[11] * bv[2] + p[15] * bv[3] };
+			for (int i = 0; i <= n; ++i)
+			{
+				const float* bu{ weights + i * 4 };
+				*positions++ = curve[0] * bu[0] + curve[1] * bu[1] + curve[2] * bu[2] + curve[3] * bu[3];
+			}
+		}
+	}
+
+	// Sums in the same order as evaluateGridWeights, so the output is bitwise equal to it. Four columns at a time
+	// are stored as x0 y0 z0 x1, y1 z1 x2 y2, z2 x3 y3 z3; a row's last group spills into the next row, which
+	// overwrites it, and only the last row's is cut short.
+	template <int Factor>
+	void evaluateGridFixed(const Float3* controlPoints, Float3* positions)
+	{
+#if defined(PATCH_KERNELS_SSE2)
+		typedef FixedBernsteinTable<Factor> Table;
+		const float* weights{ Table::table.weights };
+		const float* transposed{ Table::transposed.weights };
+		// control point row r as x, y and z lanes of its four points
+		__m128 px[4];
+		__m128 py[4];
+		__m128 pz[4];
+		for (int r = 0; r < 4; ++r)
+		{
+			const float* in{ reinterpret_cast<const float*>(controlPoints + r * 4) };
+			__m128 a{ _mm_loadu_ps(in) };
+			__m128 b{ _mm_loadu_ps(in + 4) };
+			__m128 c{ _mm_loadu_ps(in + 8) };
+			__m128 x0x1{ _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 0)) };
+			__m128 x2x3{ _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)) };
+			px[r] = _mm_shuffle_ps(x0x1, x2x3, _MM_SHUFFLE(2, 0, 3, 0));
+			__m128 y0y1{ _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)) };
+			__m128 y2y3{ _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)) };
+			py[r] = _mm_shuffle_ps(y0y1, y2y3, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 z0z1{ _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)) };
+			pz[r] = _mm_shuffle_ps(z0z1, c, _MM_SHUFFLE(3, 0, 2, 0));
+		}
+
+		for (int j = 0; j <= Factor; ++j)
+		{
+			const float* bv{ weights + j * 4 };
+			const __m128 v[4]{ _mm_set1_ps(bv[0]), _mm_set1_ps(bv[1]), _mm_set1_ps(bv[2]), _mm_set1_ps(bv[3]) };
+			__m128 curveX{ _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px[0], v[0]), _mm_mul_ps(px[1], v[1])), _mm_mul_ps(px[2], v[2])), _mm_mul_ps(px[3], v[3])) };
+			__m128 curveY{ _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(py[0], v[0]), _mm_mul_ps(py[1], v[1])), _mm_mul_ps(py[2], v[2])), _mm_mul_ps(py[3], v[3])) };
+			__m128 curveZ{ _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(pz[0], v[0]), _mm_mul_ps(pz[1], v[1])), _mm_mul_ps(pz[2], v[2])), _mm_mul_ps(pz[3], v[3])) };
+			const __m128 cx[4]{ _mm_shuffle_ps(curveX, curveX, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(curveX, curveX, _MM_SHUFFLE(1, 1, 1, 1)),
+				_mm_shuffle_ps(curveX, curveX, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(curveX, curveX, _MM_SHUFFLE(3, 3, 3, 3)) };
+			const __m128 cy[4]{ _mm_shuffle_ps(curveY, curveY, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(curveY, curveY, _MM_SHUFFLE(1, 1, 1, 1)),
+				_mm_shuffle_ps(curveY, curveY, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(curveY, curveY, _MM_SHUFFLE(3, 3, 3, 3)) };
+			const __m128 cz[4]{ _mm_shuffle_ps(curveZ, curveZ, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(curveZ, curveZ, _MM_SHUFFLE(1, 1, 1, 1)),
+				_mm_shuffle_ps(curveZ, curveZ, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(curveZ, curveZ, _MM_SHUFFLE(3, 3, 3, 3)) };
+			for (size_t i = 0; i < Table::columns; i += 4)
+			{
+				const __m128 bu[4]{ _mm_loadu_ps(transposed + i), _mm_loadu_ps(transposed + Table::columns + i),
+					_mm_loadu_ps(transposed + Table::columns * 2 + i), _mm_loadu_ps(transposed + Table::columns * 3 + i) };
+				__m128 x{ _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx[0], bu[0]), _mm_mul_ps(cx[1], bu[1])), _mm_mul_ps(cx[2], bu[2])), _mm_mul_ps(cx[3], bu[3])) };
+				__m128 y{ _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cy[0], bu[0]), _mm_mul_ps(cy[1], bu[1])), _mm_mul_ps(cy[2], bu[2])), _mm_mul_ps(cy[3], bu[3])) };
+				__m128 z{ _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cz[0], bu[0]), _mm_mul_ps(cz[1], bu[1])), _mm_mul_ps(cz[2], bu[2])), _mm_mul_ps(cz[3], bu[3])) };
+
+				__m128 xyLow{ _mm_unpacklo_ps(x, y) };
+				__m128 xyHigh{ _mm_unpackhi_ps(x, y) };
+				__m128 z0x1{ _mm_shuffle_ps(z, xyLow, _MM_SHUFFLE(2, 2, 0, 0)) };
+				__m128 y1z1{ _mm_shuffle_ps(xyLow, z, _MM_SHUFFLE(1, 1, 3, 3)) };
+				__m128 z2x3{ _mm_shuffle_ps(z, xyHigh, _MM_SHUFFLE(3, 2, 3, 2)) };
+				const __m128 packed[3]{ _mm_shuffle_ps(xyLow, z0x1, _MM_SHUFFLE(2, 0, 1, 0)), _mm_shuffle_ps(y1z1, xyHigh, _MM_SHUFFLE(1, 0, 2, 0)),
+					_mm_shuffle_ps(z2x3, z2x3, _MM_SHUFFLE(1, 3, 2, 0)) };
+				float* out{ reinterpret_cast<float*>(positions + i) };
+				if (j < Factor || i + 4 <= static_cast<size_t>(Factor) + 1)
+				{
+					_mm_storeu_ps(out, packed[0]);
+					_mm_storeu_ps(out + 4, packed[1]);
+					_mm_storeu_ps(out + 8, packed[2]);
+				}
+				else
+				{
+					float values[12];
+					_mm_storeu_ps(values, packed[0]);
+					_mm_storeu_ps(values + 4, packed[1]);
+					_mm_storeu_ps(values + 8, packed[2]);
+					for (size_t c = 0; c < (static_cast<size_t>(Factor) + 1 - i) * 3; ++c)
+					{
+						out[c] = values[c];
+					}
+				}
+			}
+			positions += Factor + 1;
+		}
+#else
+		evaluateGridWeights<Factor>(controlPoints, Factor, FixedBernsteinTable<Factor>::table.weights, positions);
+#endif
+	}
+}
\ No newline at end of file
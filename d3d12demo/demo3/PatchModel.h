@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+
+// Bicubic Bezier patch set in the layout Demo uploads: a shared control point buffer, 16 indices per patch
+// and one transform and color per patch (indexed by SV_PrimitiveID in the domain shader).
+struct PatchModel
+{
+	static const size_t controlPointsPerPatch{ 16 };
+
+	std::vector<Float3> points;
+	std::vector<uint32_t> patches;
+	std::vector<Float4x4> patchesTransforms;
+	std::vector<Float3> patchesColors;
+
+	size_t getPatchCount() const
+	{
+		return patches.size() / controlPointsPerPatch;
+	}
+
+	void clear()
+	{
+		points.clear();
+		patches.clear();
+		patchesTransforms.clear();
+		patchesColors.clear();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,647 @@
+#include "PatchModelLoader.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "AssetStream.h"
+#include "MappedFile.h"
+#include "TeapotData.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PATCH_LOADER_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+	const double exactPowersOfTen[]{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	bool isSeparator(char c)
+	{
+		return c == ' ' || c == ',' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	bool isDigit(char c)
+	{
+		return static_cast<unsigned>(c - '0') < 10u;
+	}
+
+#if defined(PATCH_LOADER_SSE2)
+	unsigned countTrailingZeros(unsigned mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+	}
+#endif
+
+	// Tokenizer over a memory mapped buffer. Separators are skipped 16 bytes at a time and digit runs are
+	// converted 8 at a time with SWAR arithmetic; nothing here allocates.
+	class Scanner
+	{
+	public:
+		Scanner(const char* begin, const char* end) : p{ begin }, end{ end }
+		{
+		}
+
+		bool atEnd()
+		{
+			skipSeparators();
+			return p == end;
+		}
+
+		void skipSeparators()
+		{
+#if defined(PATCH_LOADER_SSE2)
+			const __m128i space{ _mm_set1_epi8(' ') };
+			const __m128i comma{ _mm_set1_epi8(',') };
+			const __m128i newline{ _mm_set1_epi8('\n') };
+			const __m128i carriageReturn{ _mm_set1_epi8('\r') };
+			const __m128i tab{ _mm_set1_epi8('\t') };
+
+			while (end - p >= 16)
+			{
+				__m128i chars{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) };
+				__m128i separators{ _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(chars, space), _mm_cmpeq_epi8(chars, comma)),
+					_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, newline), _mm_cmpeq_epi8(chars, carriageReturn)), _mm_cmpeq_epi8(chars, tab))) };
+
+				unsigned mask{ ~static_cast<unsigned>(_mm_movemask_epi8(separators)) & 0xffffu };
+				if (mask != 0)
+				{
+					p += countTrailingZeros(mask);
+					return;
+				}
+				p += 16;
+			}
+#endif
+			while (p < end && isSeparator(*p))
+			{
+				++p;
+			}
+		}
+
+		// counts the numbers left on the current line without consuming them
+		int countTokensOnLine() const
+		{
+			int count{ 0 };
+			bool inToken{ false };
+			for (const char* q{ p }; q < end && *q != '\n'; ++q)
+			{
+				bool separator{ isSeparator(*q) };
+				if (!separator && !inToken)
+				{
+					++count;
+				}
+				inToken = !separator;
+			}
+			return count;
+		}
+
+		void skipLine()
+		{
+			const void* newline{ memchr(p, '\n', static_cast<size_t>(end - p)) };
+			p = newline != nullptr ? static_cast<const char*>(newline) + 1 : end;
+		}
+
+		uint32_t parseUInt()
+		{
+			skipSeparators();
+
+			uint64_t value{ 0 };
+			int digits{ parseDigits(value, 10) };
+			if (digits == 0 || value > UINT32_MAX)
+			{
+				throw(runtime_error{ "Invalid integer in patch file." });
+			}
+			return static_cast<uint32_t>(value);
+		}
+
+		float parseFloat()
+		{
+			skipSeparators();
+
+			bool negative{ false };
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				++p;
+			}
+
+			uint64_t mantissa{ 0 };
+			int exponent{ 0 };
+			int significant{ parseDigits(mantissa, 19) };
+			int digits{ significant };
+
+			// integer digits beyond what fits the mantissa only scale it
+			while (p < end && isDigit(*p))
+			{
+				++p;
+				++exponent;
+				++digits;
+			}
+
+			if (p < end && *p == '.')
+			{
+				++p;
+				int fraction{ parseDigits(mantissa, 19 - significant) };
+				exponent -= fraction;
+				digits += fraction;
+				while (p < end && isDigit(*p))
+				{
+					++p;
+					++digits;
+				}
+			}
+
+			if (digits == 0)
+			{
+				throw(runtime_error{ "Invalid number in patch file." });
+			}
+
+			if (p < end && (*p == 'e' || *p == 'E'))
+			{
+				++p;
+				bool negativeExponent{ false };
+				if (p < end && (*p == '-' || *p == '+'))
+				{
+					negativeExponent = *p == '-';
+					++p;
+				}
+
+				uint64_t e{ 0 };
+				if (parseDigits(e, 4) == 0)
+				{
+					throw(runtime_error{ "Invalid exponent in patch file." });
+				}
+				while (p < end && isDigit(*p))
+				{
+					++p;
+				}
+				exponent += negativeExponent ? -static_cast<int>(e) : static_cast<int>(e);
+			}
+
+			double value{ static_cast<double>(mantissa) };
+			if (exponent >= 0 && exponent <= 22)
+			{
+				value *= exactPowersOfTen[exponent];
+			}
+			else if (exponent < 0 && exponent >= -22)
+			{
+				value /= exactPowersOfTen[-exponent];
+			}
+			else if (mantissa != 0)
+			{
+				value *= std::pow(10.0, exponent);
+			}
+
+			return static_cast<float>(negative ? -value : value);
+		}
+
+	private:
+		// Appends up to maxDigits digits to value; returns the number of digits consumed.
+		int parseDigits(uint64_t& value, int maxDigits)
+		{
+			int count{ 0 };
+
+			while (maxDigits - count >= 8 && end - p >= 8)
+			{
+				uint64_t chunk;
+				memcpy(&chunk, p, sizeof(chunk));
+				if (!isEightDigits(chunk))
+				{
+					break;
+				}
+
+				value = value * 100000000ull + parseEightDigits(chunk);
+				p += 8;
+				count += 8;
+			}
+
+			while (count < maxDigits && p < end && isDigit(*p))
+			{
+				value = value * 10 + static_cast<uint64_t>(*p - '0');
+				++p;
+				++count;
+			}
+
+			return count;
+		}
+
+		static bool isEightDigits(uint64_t chunk)
+		{
+			return (((chunk & 0xF0F0F0F0F0F0F0F0ull) | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull);
+		}
+
+		// little endian SWAR conversion of "dddddddd" to its value
+		static uint64_t parseEightDigits(uint64_t chunk)
+		{
+			const uint64_t mask{ 0x000000FF000000FFull };
+			const uint64_t mul1{ 0x000F424000000064ull }; // 100 + (1000000 << 32)
+			const uint64_t mul2{ 0x0000271000000001ull }; // 1 + (10000 << 32)
+			chunk -= 0x3030303030303030ull;
+			chunk = (chunk * 10) + (chunk >> 8);
+			return (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+		}
+
+	private:
+		const char* p;
+		const char* end;
+	};
+
+	// the tokens of a Scanner read with std::istream, what the benchmark measures the Scanner against
+	class StreamScanner
+	{
+	public:
+		StreamScanner(istream& stream) : stream(stream)
+		{
+		}
+
+		uint32_t parseUInt()
+		{
+			uint32_t value;
+			if (!(stream >> value))
+			{
+				throw(runtime_error{ "Invalid integer in patch file." });
+			}
+			return value;
+		}
+
+		float parseFloat()
+		{
+			float value;
+			if (!(stream >> value))
+			{
+				throw(runtime_error{ "Invalid number in patch file." });
+			}
+			return value;
+		}
+
+	private:
+		istream& stream;
+	};
+
+	template<typename T>
+	bool isSameVector(const vector<T>& a, const vector<T>& b)
+	{
+		return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+	}
+
+	Float3 getPatchColor(size_t patchIndex)
+	{
+		uint32_t h{ static_cast<uint32_t>(patchIndex) * 2654435761u };
+		h ^= h >> 15;
+		h *= 2246822519u;
+		h ^= h >> 13;
+		return{
+			static_cast<float>(h & 0xff) / 255.0f,
+			static_cast<float>((h >> 8) & 0xff) / 255.0f,
+			static_cast<float>((h >> 16) & 0xff) / 255.0f
+		};
+	}
+
+	void addPatchAttributes(PatchModel& model)
+	{
+		model.patchesTransforms.push_back(math::identity());
+		model.patchesColors.push_back(getPatchColor(model.patchesColors.size()));
+	}
+
+	// raises a Bezier curve of the given degree by one, in place, for each of count curves spaced stride apart
+	void elevateDegree(Float3* points, int degree, int count, int pointStride, int curveStride)
+	{
+		for (int c{ 0 }; c < count; ++c)
+		{
+			Float3* curve{ points + c * curveStride };
+			Float3 previous{ curve[0] };
+			for (int i{ 1 }; i <= degree; ++i)
+			{
+				Float3 current{ curve[i * pointStride] };
+				float t{ static_cast<float>(i) / static_cast<float>(degree + 1) };
+				curve[i * pointStride] = previous * t + current * (1.0f - t);
+				previous = current;
+			}
+			curve[(degree + 1) * pointStride] = previous;
+		}
+	}
+
+	template<typename Tokens>
+	void parseBpt(Tokens& scanner, PatchModel& model)
+	{
+		uint32_t patchCount{ scanner.parseUInt() };
+
+		model.points.reserve(static_cast<size_t>(patchCount) * PatchModel::controlPointsPerPatch);
+		model.patches.reserve(static_cast<size_t>(patchCount) * PatchModel::controlPointsPerPatch);
+		model.patchesTransforms.reserve(patchCount);
+		model.patchesColors.reserve(patchCount);
+
+		for (uint32_t patch{ 0 }; patch < patchCount; ++patch)
+		{
+			uint32_t degreeU{ scanner.parseUInt() };
+			uint32_t degreeV{ scanner.parseUInt() };
+
+			if (degreeU < 1 || degreeU > 3 || degreeV < 1 || degreeV > 3)
+			{
+				throw(runtime_error{ "Only patches up to bicubic are supported." });
+			}
+
+			uint32_t base{ static_cast<uint32_t>(model.points.size()) };
+
+			if (degreeU == 3 && degreeV == 3)
+			{
+				for (int i{ 0 }; i < 16; ++i)
+				{
+					float x{ scanner.parseFloat() };
+					float y{ scanner.parseFloat() };
+					float z{ scanner.parseFloat() };
+					model.points.push_back({ x, y, z });
+				}
+			}
+			else
+			{
+				// rows along v, columns along u, stored in a 4x4 grid and elevated in place
+				Float3 grid[4][4];
+				for (uint32_t i{ 0 }; i <= degreeU; ++i)
+				{
+					for (uint32_t j{ 0 }; j <= degreeV; ++j)
+					{
+						float x{ scanner.parseFloat() };
+						float y{ scanner.parseFloat() };
+						float z{ scanner.parseFloat() };
+						grid[i][j] = { x, y, z };
+					}
+				}
+
+				for (uint32_t d{ degreeV }; d < 3; ++d)
+				{
+					elevateDegree(&grid[0][0], static_cast<int>(d), static_cast<int>(degreeU) + 1, 1, 4);
+				}
+
+				for (uint32_t d{ degreeU }; d < 3; ++d)
+				{
+					elevateDegree(&grid[0][0], static_cast<int>(d), 4, 4, 1);
+				}
+
+				for (int i{ 0 }; i < 4; ++i)
+				{
+					for (int j{ 0 }; j < 4; ++j)
+					{
+						model.points.push_back(grid[i][j]);
+					}
+				}
+			}
+
+			for (uint32_t i{ 0 }; i < 16; ++i)
+			{
+				model.patches.push_back(base + i);
+			}
+
+			addPatchAttributes(model);
+		}
+	}
+
+	void parseNewell(Scanner& scanner, PatchModel& model)
+	{
+		uint32_t patchCount{ scanner.parseUInt() };
+
+		model.patches.reserve(static_cast<size_t>(patchCount) * PatchModel::controlPointsPerPatch);
+		model.patchesTransforms.reserve(patchCount);
+		model.patchesColors.reserve(patchCount);
+
+		for (uint32_t patch{ 0 }; patch < patchCount; ++patch)
+		{
+			for (int i{ 0 }; i < 16; ++i)
+			{
+				uint32_t index{ scanner.parseUInt() };
+				if (index == 0)
+				{
+					throw(runtime_error{ "Patch indices are one-based." });
+				}
+				model.patches.push_back(index - 1);
+			}
+
+			addPatchAttributes(model);
+		}
+
+		uint32_t pointCount{ scanner.parseUInt() };
+		model.points.reserve(pointCount);
+
+		for (uint32_t i{ 0 }; i < pointCount; ++i)
+		{
+			float x{ scanner.parseFloat() };
+			float y{ scanner.parseFloat() };
+			float z{ scanner.parseFloat() };
+			model.points.push_back({ x, y, z });
+		}
+
+		for (uint32_t index : model.patches)
+		{
+			if (index >= pointCount)
+			{
+				throw(runtime_error{ "Patch index out of range." });
+			}
+		}
+	}
+}
+
+namespace teapot_tutorial
+{
+	void loadPatchModel(string path, PatchModel& model, PatchFileFormat format)
+	{
+		MappedFile file{ path };
+		const char* begin{ reinterpret_cast<const char*>(file.getData()) };
+		parsePatchModel(begin, begin + file.getSize(), model, format);
+	}
+
+	PatchModel loadPatchModel(string path, PatchFileFormat format)
+	{
+		PatchModel model;
+		loadPatchModel(path, model, format);
+		return model;
+	}
+
+	void parsePatchModel(const char* begin, const char* end, PatchModel& model, PatchFileFormat format)
+	{
+		model.clear();
+
+		Scanner scanner{ begin, end };
+		if (scanner.atEnd())
+		{
+			throw(runtime_error{ "Empty patch file." });
+		}
+
+		if (format == PatchFileFormat::Auto)
+		{
+			// the line after the patch count holds either "n m" or the first patch's 16 indices
+			Scanner probe{ scanner };
+			probe.skipLine();
+			format = probe.countTokensOnLine() == 2 ? PatchFileFormat::Bpt : PatchFileFormat::Newell;
+		}
+
+		if (format == PatchFileFormat::Bpt)
+		{
+			parseBpt(scanner, model);
+		}
+		else
+		{
+			parseNewell(scanner, model);
+		}
+	}
+
+	void writePatchModel(AssetStreamWriter& stream, const PatchModel& model)
+	{
+		stream.addSection(AssetSectionId::Points, model.points);
+		stream.addSection(AssetSectionId::Patches, model.patches);
+		stream.addSection(AssetSectionId::PatchesTransforms, model.patchesTransforms);
+		stream.addSection(AssetSectionId::PatchesColors, model.patchesColors);
+	}
+
+	PatchModel readPatchModel(AssetStreamReader& stream)
+	{
+		PatchModel model;
+		model.points = stream.readSection<Float3>(AssetSectionId::Points);
+		model.patches = stream.readSection<uint32_t>(AssetSectionId::Patches);
+		model.patchesTransforms = stream.readSection<Float4x4>(AssetSectionId::PatchesTransforms);
+		model.patchesColors = stream.readSection<Float3>(AssetSectionId::PatchesColors);
+		return model;
+	}
+
+	bool isAssetStreamPath(const string& path)
+	{
+		return path.size() > 5 && path.compare(path.size() - 5, 5, ".astm") == 0;
+	}
+
+	PatchModel openPatchModel(string path)
+	{
+		if (path.empty())
+		{
+			return TeapotData::getModel();
+		}
+
+		if (isAssetStreamPath(path))
+		{
+			AssetStreamReader stream{ path };
+			return readPatchModel(stream);
+		}
+
+		return loadPatchModel(path);
+	}
+
+	void writeSyntheticBpt(const string& path, uint64_t megabytes)
+	{
+		ofstream file{ path, ios::binary | ios::trunc };
+		if (!file)
+		{
+			throw(runtime_error{ "Error creating " + path + "." });
+		}
+
+		// about 28 bytes per point, and the patch count is the first line
+		uint64_t patchCount{ max<uint64_t>(megabytes * (1 << 20) / (16 * 28), 1) };
+		string text{ to_string(patchCount) + "\n" };
+		uint32_t state{ 1 };
+		for (uint64_t patch = 0; patch < patchCount; ++patch)
+		{
+			uint32_t degreeU{ patch % 5 == 4 ? static_cast<uint32_t>(patch / 5 % 3) + 1 : 3 };
+			uint32_t degreeV{ patch % 5 == 4 ? static_cast<uint32_t>(patch / 15 % 3) + 1 : 3 };
+			char line[96];
+			snprintf(line, sizeof(line), "%u %u\n", degreeU, degreeV);
+			text += line;
+			for (uint32_t i = 0; i < (degreeU + 1) * (degreeV + 1); ++i)
+			{
+				float coordinates[3];
+				for (float& coordinate : coordinates)
+				{
+					state = state * 1664525u + 1013904223u;
+					coordinate = static_cast<float>(static_cast<int32_t>(state >> 8) - (1 << 23)) / (1 << 20);
+				}
+				snprintf(line, sizeof(line), "%.6f %.6f %.6f\n", coordinates[0], coordinates[1], coordinates[2]);
+				text += line;
+			}
+
+			if (text.size() >= 1 << 20)
+			{
+				file.write(text.data(), text.size());
+				text.clear();
+			}
+		}
+		file.write(text.data(), text.size());
+
+		if (!file)
+		{
+			throw(runtime_error{ "Error writing " + path + "." });
+		}
+	}
+
+	ParseBenchmarkResult runParseBenchmark(const string& path, uint64_t megabytes)
+	{
+		writeSyntheticBpt(path, megabytes);
+
+		try
+		{
+			ParseBenchmarkResult result;
+			{
+				ifstream file{ path, ios::binary | ios::ate };
+				result.bytes = static_cast<uint64_t>(file.tellg());
+			}
+
+			// the best of three, reusing the model's capacity like a reload does
+			PatchModel model;
+			double seconds{ 0.0 };
+			for (int repeat{ 0 }; repeat < 3; ++repeat)
+			{
+				auto begin = chrono::steady_clock::now();
+				loadPatchModel(path, model, PatchFileFormat::Bpt);
+				double elapsed{ chrono::duration<double>(chrono::steady_clock::now() - begin).count() };
+				seconds = repeat == 0 ? elapsed : min(seconds, elapsed);
+			}
+
+			PatchModel streamModel;
+			auto begin = chrono::steady_clock::now();
+			{
+				ifstream file{ path, ios::binary };
+				StreamScanner scanner{ file };
+				parseBpt(scanner, streamModel);
+			}
+			double streamSeconds{ chrono::duration<double>(chrono::steady_clock::now() - begin).count() };
+
+			if (!isSameVector(model.points, streamModel.points) || !isSameVector(model.patches, streamModel.patches) ||
+				!isSameVector(model.patchesTransforms, streamModel.patchesTransforms) || !isSameVector(model.patchesColors, streamModel.patchesColors))
+			{
+				throw(runtime_error{ "loadPatchModel and std::istream parse " + path + " differently." });
+			}
+
+			result.patches = model.getPatchCount();
+			result.megabytesPerSecond = seconds > 0.0 ? result.bytes / seconds / 1e6 : 0.0;
+			result.streamMegabytesPerSecond = streamSeconds > 0.0 ? result.bytes / streamSeconds / 1e6 : 0.0;
+			remove(path.c_str());
+			return result;
+		}
+		catch (...)
+		{
+			remove(path.c_str());
+			throw;
+		}
+	}
+
+	string formatParseBenchmarkResult(const ParseBenchmarkResult& result)
+	{
+		char text[160];
+		snprintf(text, sizeof(text), "parse %.1f MB %zu patches: %.1f MB/s, istream %.1f MB/s, %.2fx\n", result.bytes / 1e6, result.patches,
+			result.megabytesPerSecond, result.streamMegabytesPerSecond, result.streamMegabytesPerSecond > 0.0 ? result.megabytesPerSecond / result.streamMegabytesPerSecond : 0.0);
+		return text;
+	}
+}
\ No newline at end of file
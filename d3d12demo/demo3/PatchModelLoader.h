@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "PatchModel.h"
+
+class AssetStreamReader;
+class AssetStreamWriter;
+
+enum class PatchFileFormat
+{
+	Auto,
+	// "teapot.bpt" style: patch count, then per patch "n m" followed by (n+1)*(m+1) points
+	Bpt,
+	// Newell's original layout: patch count, 16 one-based indices per patch, point count, points
+	Newell
+};
+
+struct ParseBenchmarkResult
+{
+	uint64_t bytes;
+	size_t patches;
+	double megabytesPerSecond;
+	// the same file read with std::istream >> float
+	double streamMegabytesPerSecond;
+};
+
+namespace teapot_tutorial
+{
+	// Parses a Bezier patch text file through a memory mapping. Lower degree patches are degree elevated to
+	// bicubic. The model's vectors are cleared but keep their capacity, so reloading into the same model
+	// does not allocate once it has grown large enough.
+	void loadPatchModel(std::string path, PatchModel& model, PatchFileFormat format = PatchFileFormat::Auto);
+	PatchModel loadPatchModel(std::string path, PatchFileFormat format = PatchFileFormat::Auto);
+
+	void parsePatchModel(const char* begin, const char* end, PatchModel& model, PatchFileFormat format = PatchFileFormat::Auto);
+
+	void writePatchModel(AssetStreamWriter& stream, const PatchModel& model);
+	PatchModel readPatchModel(AssetStreamReader& stream);
+
+	// by the ".astm" extension
+	bool isAssetStreamPath(const std::string& path);
+
+	// the model named on a demo command line: the built-in teapot for an empty path, an asset stream for
+	// ".astm" and a .bpt/Newell text file otherwise
+	PatchModel openPatchModel(std::string path);
+
+	// Writes about megabytes of .bpt text: bicubic patches with every fifth one of a lower degree, coordinates
+	// printed to six decimals.
+	void writeSyntheticBpt(const std::string& path, uint64_t megabytes);
+
+	// Writes a synthetic .bpt file of megabytes to path, times loadPatchModel on it against a parser reading
+	// the same tokens with std::istream and removes it. Throws unless both give the same model.
+	ParseBenchmarkResult runParseBenchmark(const std::string& path, uint64_t megabytes);
+
+	std::string formatParseBenchmarkResult(const ParseBenchmarkResult& result);
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "PatchTessellator.h"
+#include <algorithm>
+#include <stdexcept>
+#include "BernsteinTableCache.h"
+#include "BezierPatch.h"
+
+using namespace std;
+
+namespace teapot_tutorial
+{
+	int clampTessFactor(int factor)
+	{
+		return max(minTessFactor, min(maxTessFactor, factor));
+	}
+
+	size_t getGridVertexCount(int factor)
+	{
+		size_t n{ static_cast<size_t>(clampTessFactor(factor)) };
+		return (n + 1) * (n + 1);
+	}
+
+	size_t getGridIndexCount(int factor)
+	{
+		size_t n{ static_cast<size_t>(clampTessFactor(factor)) };
+		return n * n * 6;
+	}
+
+	void gatherControlPoints(const PatchModel& model, size_t patch, Float3* controlPoints)
+	{
+		const uint32_t* indices{ model.patches.data() + patch * PatchModel::controlPointsPerPatch };
+		for (size_t i{ 0 }; i < PatchModel::controlPointsPerPatch; ++i)
+		{
+			if (indices[i] >= model.points.size())
+			{
+				throw(runtime_error{ "Patch index out of range." });
+			}
+			controlPoints[i] = model.points[indices[i]];
+		}
+	}
+
+	void tessellatePatch(const PatchModel& model, size_t patch, int factor, Float3* positions, PatchEvaluator evaluator)
+	{
+		Float3 controlPoints[16];
+		gatherControlPoints(model, patch, controlPoints);
+
+		const Float4x4& transform{ patch < model.patchesTransforms.size() ? model.patchesTransforms[patch] : math::identity() };
+		if (evaluator != PatchEvaluator::Bernstein)
+		{
+			// the transforms are affine, so transforming the control points transforms the surface
+			for (Float3& p : controlPoints)
+			{
+				p = bezier::transformPosition(p, transform);
+			}
+			if (evaluator == PatchEvaluator::ForwardDifference)
+			{
+				evaluateGridForwardDifference(controlPoints, factor, defaultAnchorSteps, positions);
+			}
+			else
+			{
+				evaluateGridKernel(controlPoints, clampTessFactor(factor), positions);
+			}
+			return;
+		}
+
+		const BernsteinWeights& weights{ BernsteinTableCache::getShared().get(factor) };
+		for (int j{ 0 }; j <= weights.factor; ++j)
+		{
+			for (int i{ 0 }; i <= weights.factor; ++i)
+			{
+				*positions++ = bezier::transformPosition(bezier::evaluate(controlPoints, weights.basis[i], weights.basis[j]), transform);
+			}
+		}
+	}
+
+	void tessellatePatchFrames(const PatchModel& model, size_t patch, int factor, Float3* positions, Float3* tangentsU, Float3* tangentsV, Float3* normals)
+	{
+		Float3 controlPoints[16];
+		gatherControlPoints(model, patch, controlPoints);
+
+		const Float4x4& transform{ patch < model.patchesTransforms.size() ? model.patchesTransforms[patch] : math::identity() };
+		for (Float3& p : controlPoints)
+		{
+			p = bezier::transformPosition(p, transform);
+		}
+		evaluateGridFrames(controlPoints, factor, positions, tangentsU, tangentsV, normals);
+	}
+
+	void writeGridIndices(int factor, uint32_t baseVertex, uint32_t* indices)
+	{
+		uint32_t n{ static_cast<uint32_t>(clampTessFactor(factor)) };
+		uint32_t rowLength{ n + 1 };
+		for (uint32_t j{ 0 }; j < n; ++j)
+		{
+			for (uint32_t i{ 0 }; i < n; ++i)
+			{
+				uint32_t v00{ baseVertex + j * rowLength + i };
+				uint32_t v10{ v00 + 1 };
+				uint32_t v01{ v00 + rowLength };
+				uint32_t v11{ v01 + 1 };
+
+				*indices++ = v00;
+				*indices++ = v01;
+				*indices++ = v10;
+				*indices++ = v10;
+				*indices++ = v01;
+				*indices++ = v11;
+			}
+		}
+	}
+
+	void tessellate(const PatchModel& model, int factor, TessellatedMesh& mesh, PatchEvaluator evaluator)
+	{
+		size_t patchCount{ model.getPatchCount() };
+		size_t vertexCount{ getGridVertexCount(factor) };
+		size_t indexCount{ getGridIndexCount(factor) };
+
+		mesh.positions.resize(patchCount * vertexCount);
+		mesh.colors.resize(patchCount * vertexCount);
+		mesh.indices.resize(patchCount * indexCount);
+
+		for (size_t patch{ 0 }; patch < patchCount; ++patch)
+		{
+			tessellatePatch(model, patch, factor, mesh.positions.data() + patch * vertexCount, evaluator);
+			writeGridIndices(factor, static_cast<uint32_t>(patch * vertexCount), mesh.indices.data() + patch * indexCount);
+
+			Float3 color{ patch < model.patchesColors.size() ? model.patchesColors[patch] : Float3{ 1.0f, 1.0f, 1.0f } };
+			fill(mesh.colors.begin() + patch * vertexCount, mesh.colors.begin() + (patch + 1) * vertexCount, color);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "PatchEvaluator.h"
+#include "PatchModel.h"
+
+struct TessellatedMesh
+{
+	std::vector<Float3> positions;
+	std::vector<Float3> colors;
+	std::vector<uint32_t> indices;
+
+	size_t getTriangleCount() const
+	{
+		return indices.size() / 3;
+	}
+};
+
+// Reference CPU tessellation of the demo3 pipeline: quad domain, integer partitioning and the same factor on
+// every edge and inside, as set up by HullShader.hlsl. Each patch becomes a (factor + 1)^2 vertex grid that
+// DomainShader.hlsl would produce, already multiplied by the patch transform.
+namespace teapot_tutorial
+{
+	const int minTessFactor{ 1 };
+	const int maxTessFactor{ 64 };
+
+	int clampTessFactor(int factor);
+
+	size_t getGridVertexCount(int factor);
+	size_t getGridIndexCount(int factor);
+
+	void gatherControlPoints(const PatchModel& model, size_t patch, Float3* controlPoints);
+	void tessellatePatch(const PatchModel& model, size_t patch, int factor, Float3* positions, PatchEvaluator evaluator = PatchEvaluator::Bernstein);
+	// the grid of tessellatePatch with the partial derivatives and unit normals, all with the patch transform applied
+	void tessellatePatchFrames(const PatchModel& model, size_t patch, int factor, Float3* positions, Float3* tangentsU, Float3* tangentsV, Float3* normals);
+	void writeGridIndices(int factor, uint32_t baseVertex, uint32_t* indices);
+
+	void tessellate(const PatchModel& model, int factor, TessellatedMesh& mesh, PatchEvaluator evaluator = PatchEvaluator::Bernstein);
+}
\ No newline at end of file
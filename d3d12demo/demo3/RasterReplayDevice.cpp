@@ -0,0 +1,322 @@
+#include "RasterReplayDevice.h"
+#include "PatchTessellator.h"
+#include "Trace.h"
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+RasterReplayDevice::RasterReplayDevice(const PatchModel& model, uint32_t bufferCount, uint32_t width, uint32_t height, unsigned threadCount) :
+	model(model), bufferCount{ bufferCount }, rasterizer{ threadCount }, images(bufferCount, RenderImage{ width, height }), sceneImage{ width, height }, constantBuffers(bufferCount, math::identity()),
+	timestamps(bufferCount * maxTimestampQueries, 0)
+{
+	if (bufferCount == 0)
+	{
+		throw(runtime_error{ "Replay device needs at least one buffer." });
+	}
+	worldViewProj = math::identity();
+}
+
+uint32_t RasterReplayDevice::getBufferCount()
+{
+	return bufferCount;
+}
+
+uint32_t RasterReplayDevice::getCurrentBackBufferIndex()
+{
+	return backBufferIndex;
+}
+
+CommandList& RasterReplayDevice::getCommandList()
+{
+	return recordedCommands;
+}
+
+void RasterReplayDevice::resetCommandAllocator(uint32_t)
+{
+}
+
+void RasterReplayDevice::updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size)
+{
+	if (frameIndex >= bufferCount || size > sizeof(Float4x4))
+	{
+		throw(runtime_error{ "Invalid constant buffer update." });
+	}
+	memcpy(&constantBuffers[frameIndex], data, size);
+}
+
+void RasterReplayDevice::executeCommandList()
+{
+	recordedCommands.replay(*this, *this);
+	recordedCommands.clear();
+}
+
+void RasterReplayDevice::present(uint32_t)
+{
+	backBufferIndex = (backBufferIndex + 1) % bufferCount;
+}
+
+bool RasterReplayDevice::isOccluded()
+{
+	return false;
+}
+
+bool RasterReplayDevice::testOcclusion()
+{
+	return false;
+}
+
+void RasterReplayDevice::signal(uint32_t)
+{
+}
+
+void RasterReplayDevice::waitFrameComplete(uint32_t)
+{
+}
+
+uint64_t RasterReplayDevice::getFenceValue(uint32_t)
+{
+	return 0;
+}
+
+Fence& RasterReplayDevice::getFence(uint32_t)
+{
+	return fence;
+}
+
+uint64_t RasterReplayDevice::getTimestampFrequency()
+{
+	return 1000000000;
+}
+
+void RasterReplayDevice::getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuNs)
+{
+	cpuNs = Tracer::now();
+	gpuTimestamp = cpuNs;
+}
+
+void RasterReplayDevice::readTimestamps(uint32_t frameIndex, uint64_t* values, uint32_t count)
+{
+	if (frameIndex >= bufferCount || count > maxTimestampQueries)
+	{
+		throw(runtime_error{ "Timestamp query out of range." });
+	}
+	memcpy(values, &timestamps[frameIndex * maxTimestampQueries], count * sizeof(uint64_t));
+}
+
+void RasterReplayDevice::reset(uint32_t)
+{
+	renderTarget = nullptr;
+}
+
+void RasterReplayDevice::setPipelineState(PipelineId pipeline)
+{
+	bool solid{ pipeline == PipelineId::Solid || pipeline == PipelineId::SolidMesh };
+	rasterizer.setPipelineState(solid ? RasterFillMode::Solid : RasterFillMode::Wireframe, RasterCullMode::None);
+}
+
+void RasterReplayDevice::setGraphicsRootSignature()
+{
+}
+
+void RasterReplayDevice::setViewport(const Viewport& viewport)
+{
+	rasterizer.setViewport(viewport.topLeftX, viewport.topLeftY, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth);
+}
+
+void RasterReplayDevice::setScissorRect(const ScissorRect& rect)
+{
+	rasterizer.setScissorRect(rect.left, rect.top, rect.right, rect.bottom);
+}
+
+void RasterReplayDevice::transitionBackBuffer(uint32_t, ResourceState, ResourceState)
+{
+}
+
+void RasterReplayDevice::setRenderTarget(uint32_t frameIndex)
+{
+	if (frameIndex >= bufferCount)
+	{
+		throw(runtime_error{ "Frame index out of range." });
+	}
+	renderTarget = &images[frameIndex];
+	lastRenderTarget = renderTarget;
+}
+
+void RasterReplayDevice::clearRenderTarget(uint32_t frameIndex, const float color[4])
+{
+	if (frameIndex >= bufferCount)
+	{
+		throw(runtime_error{ "Frame index out of range." });
+	}
+	rasterizer.clearRenderTarget(images[frameIndex], color);
+}
+
+void RasterReplayDevice::clearDepth(float depth)
+{
+	if (renderTarget == nullptr)
+	{
+		throw(runtime_error{ "No render target bound." });
+	}
+	rasterizer.clearDepth(*renderTarget, depth);
+}
+
+void RasterReplayDevice::setPrimitiveTopology(PrimitiveTopology topology)
+{
+	this->topology = topology;
+}
+
+void RasterReplayDevice::setVertexBuffer(BufferId)
+{
+}
+
+void RasterReplayDevice::setIndexBuffer(BufferId)
+{
+}
+
+void RasterReplayDevice::setGraphicsRoot32BitConstants(uint32_t rootIndex, uint32_t count, const void* data)
+{
+	if (rootIndex == 1 && count > 0)
+	{
+		int32_t edgeFactor;
+		memcpy(&edgeFactor, data, sizeof(edgeFactor));
+		tessFactor = teapot_tutorial::clampTessFactor(edgeFactor);
+	}
+}
+
+void RasterReplayDevice::setGraphicsRootDescriptorTable(uint32_t)
+{
+}
+
+void RasterReplayDevice::setGraphicsRootConstantBufferView(uint32_t rootIndex, uint32_t frameIndex)
+{
+	if (frameIndex >= bufferCount)
+	{
+		throw(runtime_error{ "Frame index out of range." });
+	}
+	if (rootIndex == 0)
+	{
+		worldViewProj = constantBuffers[frameIndex];
+	}
+}
+
+void RasterReplayDevice::drawInstanced(uint32_t, uint32_t, uint32_t, uint32_t)
+{
+	throw(runtime_error{ "Replay only supports indexed patch draws." });
+}
+
+void RasterReplayDevice::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t)
+{
+	if (renderTarget == nullptr)
+	{
+		throw(runtime_error{ "No render target bound." });
+	}
+	if (topology == PrimitiveTopology::TriangleList)
+	{
+		drawLodMesh(indexCount, instanceCount, startIndex, baseVertex);
+		return;
+	}
+	if (baseVertex != 0)
+	{
+		throw(runtime_error{ "Replay only supports indexed patch draws from the first control point." });
+	}
+	if (static_cast<size_t>(startIndex) + indexCount > model.patches.size())
+	{
+		throw(runtime_error{ "Draw out of index buffer range." });
+	}
+
+	const PatchModel* drawn{ &model };
+	if (startIndex != 0 || indexCount != model.patches.size())
+	{
+		// SV_PrimitiveID restarts at zero for every draw, so only the index range moves
+		drawModel.points = model.points;
+		drawModel.patches.assign(model.patches.begin() + startIndex, model.patches.begin() + startIndex + indexCount);
+		drawModel.patchesTransforms = model.patchesTransforms;
+		drawModel.patchesColors = model.patchesColors;
+		drawn = &drawModel;
+	}
+
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		rasterizer.drawPatches(*renderTarget, *drawn, worldViewProj, tessFactor);
+	}
+}
+
+void RasterReplayDevice::drawLodMesh(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex)
+{
+	if (lodChain == nullptr)
+	{
+		lodChain = make_unique<LodChain>(model);
+	}
+	const vector<LodVertex>& vertices{ lodChain->getVertices() };
+	const vector<uint32_t>& indices{ lodChain->getIndices() };
+	if (static_cast<size_t>(startIndex) + indexCount > indices.size() || baseVertex < 0 || static_cast<size_t>(baseVertex) >= vertices.size())
+	{
+		throw(runtime_error{ "Draw out of LOD buffer range." });
+	}
+
+	// the vertex shader stage, over the level starting at baseVertex or every vertex after it; the rasterizer
+	// checks the indices against them
+	size_t vertexCount{ vertices.size() - baseVertex };
+	for (const LodLevel& level : lodChain->getLevels())
+	{
+		vertexCount = level.baseVertex == baseVertex ? level.vertexCount : vertexCount;
+	}
+	meshVertices.resize(vertexCount);
+	for (size_t i = 0; i < meshVertices.size(); ++i)
+	{
+		meshVertices[i].position = math::transformPoint(vertices[baseVertex + i].position, worldViewProj);
+		meshVertices[i].color = vertices[baseVertex + i].color;
+	}
+
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		rasterizer.drawTriangles(*renderTarget, meshVertices.data(), meshVertices.size(), indices.data() + startIndex, indexCount);
+	}
+}
+
+void RasterReplayDevice::writeTimestamp(uint32_t frameIndex, uint32_t queryIndex)
+{
+	if (frameIndex >= bufferCount || queryIndex >= maxTimestampQueries)
+	{
+		throw(runtime_error{ "Timestamp query out of range." });
+	}
+	timestamps[frameIndex * maxTimestampQueries + queryIndex] = Tracer::now();
+}
+
+void RasterReplayDevice::resolveTimestamps(uint32_t, uint32_t)
+{
+}
+
+void RasterReplayDevice::close()
+{
+}
+
+void RasterReplayDevice::transitionSceneTarget(ResourceState, ResourceState)
+{
+}
+
+void RasterReplayDevice::setSceneRenderTarget()
+{
+	renderTarget = &sceneImage;
+	lastRenderTarget = renderTarget;
+}
+
+void RasterReplayDevice::clearSceneRenderTarget(const float color[4])
+{
+	rasterizer.clearRenderTarget(sceneImage, color);
+}
+
+void RasterReplayDevice::upscaleScene(const ScissorRect& source)
+{
+	if (renderTarget == nullptr || renderTarget == &sceneImage)
+	{
+		throw(runtime_error{ "Upscale needs a back buffer bound." });
+	}
+	rasterizer.upscale(*renderTarget, sceneImage, source.left, source.top, source.right, source.bottom);
+}
+
+const RenderImage& RasterReplayDevice::getImage() const
+{
+	return lastRenderTarget != nullptr ? *lastRenderTarget : images[0];
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "CommandStream.h"
+#include "LodChain.h"
+#include "PatchModel.h"
+#include "RenderDevice.h"
+#include "SoftwareRasterizer.h"
+
+// RenderDevice executing the demo3 command subset on the SoftwareRasterizer, so a captured CommandStream can
+// be replayed to an image without a GPU. The buffer ids resolve to the model's control points and patches, or to
+// a default LodChain of the model built on the first triangle list draw, root constants at root index 1 are
+// the hull shader tessellation factors and the constant buffer view at root index 0 is the world view
+// projection matrix. Like on a GPU queue, the command list is recorded and only
+// runs on executeCommandList, so constant buffer updates made after recording are seen by its draws; timestamps
+// are the CPU time at which the rasterizer reached them.
+class RasterReplayDevice : public RenderDevice, public CommandList
+{
+public:
+	RasterReplayDevice(const PatchModel& model, uint32_t bufferCount, uint32_t width, uint32_t height, unsigned threadCount = 0);
+
+	uint32_t getBufferCount() override;
+	uint32_t getCurrentBackBufferIndex() override;
+	CommandList& getCommandList() override;
+	void resetCommandAllocator(uint32_t frameIndex) override;
+	void updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size) override;
+	void executeCommandList() override;
+	void present(uint32_t syncInterval) override;
+	bool isOccluded() override;
+	bool testOcclusion() override;
+	void signal(uint32_t frameIndex) override;
+	void waitFrameComplete(uint32_t frameIndex) override;
+	uint64_t getFenceValue(uint32_t frameIndex) override;
+	Fence& getFence(uint32_t frameIndex) override;
+	uint64_t getTimestampFrequency() override;
+	void getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuNs) override;
+	void readTimestamps(uint32_t frameIndex, uint64_t* timestamps, uint32_t count) override;
+
+	void reset(uint32_t frameIndex) override;
+	void setPipelineState(PipelineId pipeline) override;
+	void setGraphicsRootSignature() override;
+	void setViewport(const Viewport& viewport) override;
+	void setScissorRect(const ScissorRect& rect) override;
+	void transitionBackBuffer(uint32_t frameIndex, ResourceState before, ResourceState after) override;
+	void setRenderTarget(uint32_t frameIndex) override;
+	void clearRenderTarget(uint32_t frameIndex, const float color[4]) override;
+	void clearDepth(float depth) override;
+	void setPrimitiveTopology(PrimitiveTopology topology) override;
+	void setVertexBuffer(BufferId buffer) override;
+	void setIndexBuffer(BufferId buffer) override;
+	void setGraphicsRoot32BitConstants(uint32_t rootIndex, uint32_t count, const void* data) override;
+	void setGraphicsRootDescriptorTable(uint32_t rootIndex) override;
+	void setGraphicsRootConstantBufferView(uint32_t rootIndex, uint32_t frameIndex) override;
+	void drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance) override;
+	void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+	void writeTimestamp(uint32_t frameIndex, uint32_t queryIndex) override;
+	void resolveTimestamps(uint32_t frameIndex, uint32_t queryCount) override;
+	void close() override;
+	void transitionSceneTarget(ResourceState before, ResourceState after) override;
+	void setSceneRenderTarget() override;
+	void clearSceneRenderTarget(const float color[4]) override;
+	void upscaleScene(const ScissorRect& source) override;
+
+	// the image of the last render target bound
+	const RenderImage& getImage() const;
+
+private:
+	void drawLodMesh(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex);
+
+private:
+	// the CommandList calls above run immediately, the recorded list is replayed into them
+	CommandStream recordedCommands;
+	const PatchModel& model;
+	uint32_t bufferCount;
+	uint32_t backBufferIndex{ 0 };
+	SoftwareRasterizer rasterizer;
+	// never signaled, commands have completed when they return
+	SimulatedFence fence;
+	std::vector<RenderImage> images;
+	// with its own depth buffer, which the back buffers then leave unused
+	RenderImage sceneImage;
+	std::vector<Float4x4> constantBuffers;
+	std::vector<uint64_t> timestamps;
+
+	RenderImage* renderTarget{ nullptr };
+	const RenderImage* lastRenderTarget{ nullptr };
+	PrimitiveTopology topology{ PrimitiveTopology::TriangleList };
+	Float4x4 worldViewProj;
+	int tessFactor{ 1 };
+	PatchModel drawModel;
+	std::unique_ptr<LodChain> lodChain;
+	std::vector<RasterVertex> meshVertices;
+};
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "RecordingDevice.h"
+#include "Trace.h"
+
+using namespace std;
+
+RecordingDevice::RecordingDevice(RenderDevice& target) : target(target)
+{
+}
+
+uint32_t RecordingDevice::getBufferCount()
+{
+	return target.getBufferCount();
+}
+
+uint32_t RecordingDevice::getCurrentBackBufferIndex()
+{
+	return target.getCurrentBackBufferIndex();
+}
+
+CommandList& RecordingDevice::getCommandList()
+{
+	return stream;
+}
+
+void RecordingDevice::resetCommandAllocator(uint32_t frameIndex)
+{
+	target.resetCommandAllocator(frameIndex);
+}
+
+void RecordingDevice::updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size)
+{
+	stream.updateConstantBuffer(frameIndex, data, size);
+}
+
+void RecordingDevice::executeCommandList()
+{
+	stream.replay(target);
+	target.executeCommandList();
+	lastCommandCount = stream.getCommandCount();
+
+	if (!capturePath.empty())
+	{
+		stream.save(capturePath);
+		capturePath.clear();
+	}
+
+	// swap instead of copy so both streams keep their capacity from frame to frame
+	swap(stream, lastStream);
+	stream.clear();
+}
+
+void RecordingDevice::present(uint32_t syncInterval)
+{
+	target.present(syncInterval);
+}
+
+bool RecordingDevice::isOccluded()
+{
+	return target.isOccluded();
+}
+
+bool RecordingDevice::testOcclusion()
+{
+	return target.testOcclusion();
+}
+
+void RecordingDevice::signal(uint32_t frameIndex)
+{
+	target.signal(frameIndex);
+
+	++frameNumber;
+	if (flightRecorder != nullptr)
+	{
+		flightRecorder->recordFrame(frameNumber, frameIndex, target.getFenceValue(frameIndex), lastWaitNs, lastCommandCount);
+	}
+}
+
+void RecordingDevice::waitFrameComplete(uint32_t frameIndex)
+{
+	if (flightRecorder == nullptr)
+	{
+		target.waitFrameComplete(frameIndex);
+		return;
+	}
+
+	uint64_t waitBeginNs{ Tracer::now() };
+	target.waitFrameComplete(frameIndex);
+	lastWaitNs = Tracer::now() - waitBeginNs;
+}
+
+uint64_t RecordingDevice::getFenceValue(uint32_t frameIndex)
+{
+	return target.getFenceValue(frameIndex);
+}
+
+Fence& RecordingDevice::getFence(uint32_t frameIndex)
+{
+	return target.getFence(frameIndex);
+}
+
+uint64_t RecordingDevice::getTimestampFrequency()
+{
+	return target.getTimestampFrequency();
+}
+
+void RecordingDevice::getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuNs)
+{
+	target.getClockCalibration(gpuTimestamp, cpuNs);
+}
+
+void RecordingDevice::readTimestamps(uint32_t frameIndex, uint64_t* timestamps, uint32_t count)
+{
+	target.readTimestamps(frameIndex, timestamps, count);
+}
+
+void RecordingDevice::captureNextFrame(string path)
+{
+	capturePath = path;
+}
+
+const CommandStream& RecordingDevice::getLastStream() const
+{
+	return lastStream;
+}
+
+void RecordingDevice::setFlightRecorder(FlightRecorder* recorder)
+{
+	flightRecorder = recorder;
+}
\ No newline at end of file
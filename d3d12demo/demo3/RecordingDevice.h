@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include "CommandStream.h"
+#include "FlightRecorder.h"
+
+// Records a frame's commands and constant buffer updates into a CommandStream and replays it into the
+// target device on executeCommandList. A frame can be captured to a file on request.
+class RecordingDevice : public RenderDevice
+{
+public:
+	RecordingDevice(RenderDevice& target);
+
+	uint32_t getBufferCount() override;
+	uint32_t getCurrentBackBufferIndex() override;
+	CommandList& getCommandList() override;
+	void resetCommandAllocator(uint32_t frameIndex) override;
+	void updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size) override;
+	void executeCommandList() override;
+	void present(uint32_t syncInterval) override;
+	bool isOccluded() override;
+	bool testOcclusion() override;
+	void signal(uint32_t frameIndex) override;
+	void waitFrameComplete(uint32_t frameIndex) override;
+	uint64_t getFenceValue(uint32_t frameIndex) override;
+	Fence& getFence(uint32_t frameIndex) override;
+	uint64_t getTimestampFrequency() override;
+	void getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuNs) override;
+	void readTimestamps(uint32_t frameIndex, uint64_t* timestamps, uint32_t count) override;
+
+	// saves the stream of the next executed command list
+	void captureNextFrame(std::string path);
+
+	const CommandStream& getLastStream() const;
+
+	// records every signaled frame with its fence value, command count and the preceding fence wait; null
+	// stops recording
+	void setFlightRecorder(FlightRecorder* recorder);
+
+private:
+	RenderDevice& target;
+	CommandStream stream;
+	CommandStream lastStream;
+	std::string capturePath;
+	FlightRecorder* flightRecorder{ nullptr };
+	uint64_t frameNumber{ 0 };
+	uint32_t lastCommandCount{ 0 };
+	uint64_t lastWaitNs{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Fence.h"
+
+// Platform neutral view of the D3D12 calls the demo render loop makes. D3D12Backend translates these to
+// ID3D12GraphicsCommandList/ID3D12CommandQueue/IDXGISwapChain calls; NullDevice only counts them so the
+// frame loop can run without a window or GPU.
+
+// the Mesh pipelines draw pre-tessellated triangle lists, skipping the hull and domain shaders
+enum class PipelineId : uint32_t
+{
+	Wireframe,
+	Solid,
+	WireframeMesh,
+	SolidMesh
+};
+
+// the Lod buffers hold every level of the model's LodChain
+enum class BufferId : uint32_t
+{
+	ControlPoints,
+	PatchIndices,
+	LodVertices,
+	LodIndices
+};
+
+enum class ResourceState : uint32_t
+{
+	Present,
+	RenderTarget,
+	ShaderResource
+};
+
+enum class PrimitiveTopology : uint32_t
+{
+	TriangleList,
+	PatchList16
+};
+
+struct Viewport
+{
+	float topLeftX;
+	float topLeftY;
+	float width;
+	float height;
+	float minDepth;
+	float maxDepth;
+};
+
+// timestamp queries available to each back buffer's command list
+const uint32_t maxTimestampQueries{ 64 };
+
+struct ScissorRect
+{
+	int32_t left;
+	int32_t top;
+	int32_t right;
+	int32_t bottom;
+};
+
+class CommandList
+{
+public:
+	virtual ~CommandList() = default;
+
+	virtual void reset(uint32_t frameIndex) = 0;
+	virtual void setPipelineState(PipelineId pipeline) = 0;
+	virtual void setGraphicsRootSignature() = 0;
+	virtual void setViewport(const Viewport& viewport) = 0;
+	virtual void setScissorRect(const ScissorRect& rect) = 0;
+	virtual void transitionBackBuffer(uint32_t frameIndex, ResourceState before, ResourceState after) = 0;
+	virtual void setRenderTarget(uint32_t frameIndex) = 0;
+	virtual void clearRenderTarget(uint32_t frameIndex, const float color[4]) = 0;
+	virtual void clearDepth(float depth) = 0;
+	virtual void setPrimitiveTopology(PrimitiveTopology topology) = 0;
+	virtual void setVertexBuffer(BufferId buffer) = 0;
+	virtual void setIndexBuffer(BufferId buffer) = 0;
+	virtual void setGraphicsRoot32BitConstants(uint32_t rootIndex, uint32_t count, const void* data) = 0;
+	virtual void setGraphicsRootDescriptorTable(uint32_t rootIndex) = 0;
+	virtual void setGraphicsRootConstantBufferView(uint32_t rootIndex, uint32_t frameIndex) = 0;
+	virtual void drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance) = 0;
+	virtual void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) = 0;
+	// EndQuery on the frame's slice of the timestamp query heap
+	virtual void writeTimestamp(uint32_t frameIndex, uint32_t queryIndex) = 0;
+	// ResolveQueryData of the frame's first queryCount timestamps into its readback slice
+	virtual void resolveTimestamps(uint32_t frameIndex, uint32_t queryCount) = 0;
+	virtual void close() = 0;
+
+	// The scene target is an offscreen color target of the back buffer size that dynamic resolution renders a
+	// smaller region of, sharing the depth buffer; it rests in ShaderResource between frames.
+	virtual void transitionSceneTarget(ResourceState before, ResourceState after) = 0;
+	virtual void setSceneRenderTarget() = 0;
+	virtual void clearSceneRenderTarget(const float color[4]) = 0;
+	// draws the source region of the scene target, bilinearly filtered, over the viewport of the bound target;
+	// leaves the upscale pipeline and root signature set
+	virtual void upscaleScene(const ScissorRect& source) = 0;
+};
+
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() = default;
+
+	virtual uint32_t getBufferCount() = 0;
+	virtual uint32_t getCurrentBackBufferIndex() = 0;
+	virtual CommandList& getCommandList() = 0;
+	virtual void resetCommandAllocator(uint32_t frameIndex) = 0;
+	// writes the per frame slice of the upload heap constant buffer
+	virtual void updateConstantBuffer(uint32_t frameIndex, const void* data, size_t size) = 0;
+	virtual void executeCommandList() = 0;
+	virtual void present(uint32_t syncInterval) = 0;
+	// whether the last present found the output hidden, e.g. behind another window or on a locked screen
+	virtual bool isOccluded() = 0;
+	// checks again without presenting anything
+	virtual bool testOcclusion() = 0;
+	virtual void signal(uint32_t frameIndex) = 0;
+	virtual void waitFrameComplete(uint32_t frameIndex) = 0;
+	// value of the frame's last signal, the one waitFrameComplete waits for
+	virtual uint64_t getFenceValue(uint32_t frameIndex) = 0;
+	// the fence signal() advances for the frame, for FenceWaiter dependencies instead of waitFrameComplete
+	virtual Fence& getFence(uint32_t frameIndex) = 0;
+
+	virtual uint64_t getTimestampFrequency() = 0;
+	// a GPU timestamp and the Tracer::now() time sampled at the same moment
+	virtual void getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuNs) = 0;
+	// reads resolved timestamps; only valid once the frame's fence has completed
+	virtual void readTimestamps(uint32_t frameIndex, uint64_t* timestamps, uint32_t count) = 0;
+};
\ No newline at end of file
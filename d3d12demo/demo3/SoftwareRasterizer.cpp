@@ -0,0 +1,796 @@
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include "PatchTessellator.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARE_RASTERIZER_SSE2 1
+#endif
+
+using namespace std;
+using namespace details;
+
+namespace
+{
+	const uint32_t tileSize{ 64 };
+	const int maxClipVertices{ 9 };
+
+	// D3D clip volume: -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	const float clipPlanes[6][4]{
+		{ 1.0f, 0.0f, 0.0f, 1.0f },
+		{ -1.0f, 0.0f, 0.0f, 1.0f },
+		{ 0.0f, 1.0f, 0.0f, 1.0f },
+		{ 0.0f, -1.0f, 0.0f, 1.0f },
+		{ 0.0f, 0.0f, 1.0f, 0.0f },
+		{ 0.0f, 0.0f, -1.0f, 1.0f }
+	};
+
+	float planeDistance(const RasterVertex& v, const float* plane)
+	{
+		return v.position.x * plane[0] + v.position.y * plane[1] + v.position.z * plane[2] + v.position.w * plane[3];
+	}
+
+	RasterVertex lerp(const RasterVertex& a, const RasterVertex& b, float t)
+	{
+		return{
+			{ a.position.x + (b.position.x - a.position.x) * t, a.position.y + (b.position.y - a.position.y) * t,
+			a.position.z + (b.position.z - a.position.z) * t, a.position.w + (b.position.w - a.position.w) * t },
+			a.color + (b.color - a.color) * t
+		};
+	}
+
+	// Sutherland-Hodgman against the planes the polygon is not already inside of; returns the vertex count. edges[i]
+	// tells whether the edge from vertex i to the next lies on an edge of the input; edges along a clip plane don't.
+	int clipPolygon(RasterVertex* polygon, bool* edges, int count, unsigned outsideMask)
+	{
+		RasterVertex scratch[maxClipVertices];
+		bool scratchEdges[maxClipVertices];
+		for (int p{ 0 }; p < 6 && count > 0; ++p)
+		{
+			if ((outsideMask & (1u << p)) == 0)
+			{
+				continue;
+			}
+
+			int outCount{ 0 };
+			for (int i{ 0 }; i < count; ++i)
+			{
+				const RasterVertex& current{ polygon[i] };
+				const RasterVertex& next{ polygon[(i + 1) % count] };
+				float dc{ planeDistance(current, clipPlanes[p]) };
+				float dn{ planeDistance(next, clipPlanes[p]) };
+
+				if (dc >= 0.0f)
+				{
+					scratchEdges[outCount] = edges[i];
+					scratch[outCount++] = current;
+				}
+
+				if ((dc >= 0.0f) != (dn >= 0.0f) && outCount < maxClipVertices)
+				{
+					// leaving, the edge to where the polygon comes back in runs along the plane
+					scratchEdges[outCount] = dc < 0.0f && edges[i];
+					scratch[outCount++] = lerp(current, next, dc / (dc - dn));
+				}
+			}
+
+			count = outCount;
+			copy(scratch, scratch + count, polygon);
+			copy(scratchEdges, scratchEdges + count, edges);
+		}
+		return count;
+	}
+
+	uint32_t packColor(float r, float g, float b)
+	{
+		auto toByte = [](float v) { return static_cast<uint32_t>(min(max(v, 0.0f), 1.0f) * 255.0f + 0.5f); };
+		return toByte(r) | (toByte(g) << 8) | (toByte(b) << 16) | 0xff000000u;
+	}
+
+	bool isInside(float e, bool topLeft)
+	{
+		return e > 0.0f || (e == 0.0f && topLeft);
+	}
+
+	void shadePixel(const RasterTriangle& t, int32_t x, int32_t y, uint32_t* color, float* depth)
+	{
+		float px{ static_cast<float>(x) + 0.5f };
+		float py{ static_cast<float>(y) + 0.5f };
+
+		// a * x + (b * y + c), summed in the same order as the SSE2 rows so both paths round alike
+		float e[3];
+		for (int k{ 0 }; k < 3; ++k)
+		{
+			float rowC{ t.b[k] * py + t.c[k] };
+			e[k] = t.a[k] * px + rowC;
+			if (!isInside(e[k], t.topLeft[k]))
+			{
+				return;
+			}
+		}
+
+		float l0{ e[0] * t.invArea };
+		float l1{ e[1] * t.invArea };
+		float l2{ e[2] * t.invArea };
+		float z{ l0 * t.z[0] + l1 * t.z[1] + l2 * t.z[2] };
+		if (!(z < *depth))
+		{
+			return;
+		}
+
+		float w{ 1.0f / (l0 * t.invW[0] + l1 * t.invW[1] + l2 * t.invW[2]) };
+		Float3 c{ (t.colorOverW[0] * l0 + t.colorOverW[1] * l1 + t.colorOverW[2] * l2) * w };
+		*depth = z;
+		*color = packColor(c.x, c.y, c.z);
+	}
+
+	void rasterizeSolid(const RasterTriangle& t, RenderImage& target, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+	{
+		uint32_t pitch{ target.getWidth() };
+		uint32_t* colorRows{ target.getColorData() };
+		float* depthRows{ target.getDepthData() };
+
+		for (int32_t y{ y0 }; y <= y1; ++y)
+		{
+			uint32_t* color{ colorRows + static_cast<size_t>(y) * pitch };
+			float* depth{ depthRows + static_cast<size_t>(y) * pitch };
+			int32_t x{ x0 };
+
+#if defined(SOFTWARE_RASTERIZER_SSE2)
+			const __m128 py{ _mm_set1_ps(static_cast<float>(y) + 0.5f) };
+			const __m128 zero{ _mm_setzero_ps() };
+			const __m128 laneOffsets{ _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f) };
+			const __m128 invArea{ _mm_set1_ps(t.invArea) };
+			const __m128 one{ _mm_set1_ps(1.0f) };
+			const __m128 scale{ _mm_set1_ps(255.0f) };
+			const __m128 half{ _mm_set1_ps(0.5f) };
+
+			__m128 rowC[3];
+			for (int k{ 0 }; k < 3; ++k)
+			{
+				rowC[k] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.b[k]), py), _mm_set1_ps(t.c[k]));
+			}
+
+			for (; x + 3 <= x1; x += 4)
+			{
+				__m128 px{ _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets) };
+
+				__m128 e[3];
+				__m128 inside{ _mm_castsi128_ps(_mm_set1_epi32(-1)) };
+				for (int k{ 0 }; k < 3; ++k)
+				{
+					e[k] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.a[k]), px), rowC[k]);
+					inside = _mm_and_ps(inside, t.topLeft[k] ? _mm_cmpge_ps(e[k], zero) : _mm_cmpgt_ps(e[k], zero));
+				}
+
+				if (_mm_movemask_ps(inside) == 0)
+				{
+					continue;
+				}
+
+				__m128 l0{ _mm_mul_ps(e[0], invArea) };
+				__m128 l1{ _mm_mul_ps(e[1], invArea) };
+				__m128 l2{ _mm_mul_ps(e[2], invArea) };
+				__m128 z{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(l0, _mm_set1_ps(t.z[0])), _mm_mul_ps(l1, _mm_set1_ps(t.z[1]))), _mm_mul_ps(l2, _mm_set1_ps(t.z[2]))) };
+
+				__m128 oldDepth{ _mm_loadu_ps(depth + x) };
+				__m128 pass{ _mm_and_ps(inside, _mm_cmplt_ps(z, oldDepth)) };
+				if (_mm_movemask_ps(pass) == 0)
+				{
+					continue;
+				}
+
+				_mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, oldDepth)));
+
+				__m128 invW{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(l0, _mm_set1_ps(t.invW[0])), _mm_mul_ps(l1, _mm_set1_ps(t.invW[1]))), _mm_mul_ps(l2, _mm_set1_ps(t.invW[2]))) };
+				__m128 w{ _mm_div_ps(one, invW) };
+
+				__m128i packed{ _mm_set1_epi32(static_cast<int>(0xff000000u)) };
+				const float Float3::* channels[3]{ &Float3::x, &Float3::y, &Float3::z };
+				for (int ch{ 0 }; ch < 3; ++ch)
+				{
+					__m128 value{ _mm_add_ps(_mm_add_ps(
+						_mm_mul_ps(l0, _mm_set1_ps(t.colorOverW[0].*channels[ch])),
+						_mm_mul_ps(l1, _mm_set1_ps(t.colorOverW[1].*channels[ch]))),
+						_mm_mul_ps(l2, _mm_set1_ps(t.colorOverW[2].*channels[ch]))) };
+					value = _mm_min_ps(_mm_max_ps(_mm_mul_ps(value, w), zero), one);
+					__m128i bytes{ _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half)) };
+					packed = _mm_or_si128(packed, _mm_slli_epi32(bytes, ch * 8));
+				}
+
+				__m128i passMask{ _mm_castps_si128(pass) };
+				__m128i oldColor{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(color + x)) };
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(color + x), _mm_or_si128(_mm_and_si128(passMask, packed), _mm_andnot_si128(passMask, oldColor)));
+			}
+#endif
+			for (; x <= x1; ++x)
+			{
+				shadePixel(t, x, y, color + x, depth + x);
+			}
+		}
+	}
+
+	void rasterizeLine(const RasterTriangle& t, int i, int j, RenderImage& target, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+	{
+		float dx{ t.x[j] - t.x[i] };
+		float dy{ t.y[j] - t.y[i] };
+		int steps{ static_cast<int>(ceil(max(fabs(dx), fabs(dy)))) };
+		if (steps == 0)
+		{
+			steps = 1;
+		}
+
+		uint32_t pitch{ target.getWidth() };
+		for (int s{ 0 }; s <= steps; ++s)
+		{
+			float f{ static_cast<float>(s) / static_cast<float>(steps) };
+			int32_t x{ static_cast<int32_t>(floor(t.x[i] + dx * f)) };
+			int32_t y{ static_cast<int32_t>(floor(t.y[i] + dy * f)) };
+			if (x < x0 || x > x1 || y < y0 || y > y1)
+			{
+				continue;
+			}
+
+			float z{ t.z[i] + (t.z[j] - t.z[i]) * f };
+			float* depth{ target.getDepthData() + static_cast<size_t>(y) * pitch + x };
+			if (!(z < *depth))
+			{
+				continue;
+			}
+
+			float invW{ t.invW[i] + (t.invW[j] - t.invW[i]) * f };
+			Float3 c{ (t.colorOverW[i] + (t.colorOverW[j] - t.colorOverW[i]) * f) * (1.0f / invW) };
+			*depth = z;
+			target.getColorData()[static_cast<size_t>(y) * pitch + x] = packColor(c.x, c.y, c.z);
+		}
+	}
+
+	uint32_t lerpColor(uint32_t a, uint32_t b, float t)
+	{
+		uint32_t result{ 0 };
+		for (uint32_t shift = 0; shift < 32; shift += 8)
+		{
+			float ca{ static_cast<float>((a >> shift) & 0xff) };
+			float cb{ static_cast<float>((b >> shift) & 0xff) };
+			result |= static_cast<uint32_t>(ca + (cb - ca) * t + 0.5f) << shift;
+		}
+		return result;
+	}
+}
+
+RenderImage::RenderImage(uint32_t width, uint32_t height) : width{ width }, height{ height }, color(static_cast<size_t>(width) * height, 0xff000000u), depth(static_cast<size_t>(width) * height, 1.0f)
+{
+}
+
+uint32_t RenderImage::getWidth() const
+{
+	return width;
+}
+
+uint32_t RenderImage::getHeight() const
+{
+	return height;
+}
+
+uint32_t* RenderImage::getColorData()
+{
+	return color.data();
+}
+
+const uint32_t* RenderImage::getColorData() const
+{
+	return color.data();
+}
+
+float* RenderImage::getDepthData()
+{
+	return depth.data();
+}
+
+const float* RenderImage::getDepthData() const
+{
+	return depth.data();
+}
+
+uint32_t RenderImage::getPixel(uint32_t x, uint32_t y) const
+{
+	return color[static_cast<size_t>(y) * width + x];
+}
+
+float RenderImage::getDepth(uint32_t x, uint32_t y) const
+{
+	return depth[static_cast<size_t>(y) * width + x];
+}
+
+void RenderImage::savePpm(string path) const
+{
+	ofstream file{ path, ios::binary };
+	if (!file)
+	{
+		throw(runtime_error{ "Error creating image file." });
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for (uint32_t pixel : color)
+	{
+		char rgb[3]{ static_cast<char>(pixel & 0xff), static_cast<char>((pixel >> 8) & 0xff), static_cast<char>((pixel >> 16) & 0xff) };
+		file.write(rgb, sizeof(rgb));
+	}
+}
+
+RenderImage RenderImage::loadPpm(string path)
+{
+	ifstream file{ path, ios::binary };
+	if (!file)
+	{
+		throw(runtime_error{ "Error opening image file." });
+	}
+
+	string magic;
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	uint32_t maxValue{ 0 };
+	file >> magic >> width >> height >> maxValue;
+	if (!file || magic != "P6" || maxValue != 255 || width == 0 || height == 0 || width > 16384 || height > 16384)
+	{
+		throw(runtime_error{ "Unsupported image file." });
+	}
+	// a single whitespace character separates the header from the pixels
+	file.get();
+
+	RenderImage image{ width, height };
+	vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+	if (!file.read(reinterpret_cast<char*>(rgb.data()), rgb.size()))
+	{
+		throw(runtime_error{ "Truncated image file." });
+	}
+
+	for (size_t i = 0; i < image.color.size(); ++i)
+	{
+		image.color[i] = rgb[i * 3] | (rgb[i * 3 + 1] << 8) | (rgb[i * 3 + 2] << 16) | 0xff000000u;
+	}
+	return image;
+}
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned threadCount) : threadCount{ threadCount != 0 ? threadCount : max(thread::hardware_concurrency(), 1u) }
+{
+	setupTriangles.resize(this->threadCount);
+	bins.resize(this->threadCount);
+	workerStatistics.resize(this->threadCount);
+
+	for (unsigned i{ 1 }; i < this->threadCount; ++i)
+	{
+		workers.emplace_back(&SoftwareRasterizer::workerLoop, this, i);
+	}
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	{
+		lock_guard<std::mutex> lock{ mutex };
+		stopping = true;
+	}
+	startCondition.notify_all();
+
+	for (thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void SoftwareRasterizer::setPipelineState(RasterFillMode fillMode, RasterCullMode cullMode)
+{
+	this->fillMode = fillMode;
+	this->cullMode = cullMode;
+}
+
+void SoftwareRasterizer::setViewport(float x, float y, float width, float height, float minDepth, float maxDepth)
+{
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+	viewport[4] = minDepth;
+	viewport[5] = maxDepth;
+	hasViewport = true;
+}
+
+void SoftwareRasterizer::setScissorRect(int32_t left, int32_t top, int32_t right, int32_t bottom)
+{
+	scissor[0] = left;
+	scissor[1] = top;
+	scissor[2] = right;
+	scissor[3] = bottom;
+	hasScissor = true;
+}
+
+void SoftwareRasterizer::clearRenderTarget(RenderImage& target, const float color[4])
+{
+	uint32_t value{ packColor(color[0], color[1], color[2]) };
+	value = (value & 0x00ffffffu) | (static_cast<uint32_t>(min(max(color[3], 0.0f), 1.0f) * 255.0f + 0.5f) << 24);
+	fill(target.getColorData(), target.getColorData() + static_cast<size_t>(target.getWidth()) * target.getHeight(), value);
+}
+
+void SoftwareRasterizer::clearDepth(RenderImage& target, float depth)
+{
+	fill(target.getDepthData(), target.getDepthData() + static_cast<size_t>(target.getWidth()) * target.getHeight(), depth);
+}
+
+void SoftwareRasterizer::drawTriangles(RenderImage& target, const RasterVertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+{
+	size_t triangleCount{ (indices != nullptr ? indexCount : vertexCount) / 3 };
+
+	tilesX = (target.getWidth() + tileSize - 1) / tileSize;
+	tilesY = (target.getHeight() + tileSize - 1) / tileSize;
+	size_t tileCount{ static_cast<size_t>(tilesX) * tilesY };
+
+	// setup and binning: each worker takes a contiguous triangle range so tiles see triangles in order
+	runParallel([&](unsigned worker)
+	{
+		vector<RasterTriangle>& triangles{ setupTriangles[worker] };
+		vector<vector<uint32_t>>& workerBins{ bins[worker] };
+		triangles.clear();
+		workerBins.resize(tileCount);
+		for (vector<uint32_t>& bin : workerBins)
+		{
+			bin.clear();
+		}
+
+		size_t begin{ triangleCount * worker / threadCount };
+		size_t end{ triangleCount * (worker + 1) / threadCount };
+		for (size_t i{ begin }; i < end; ++i)
+		{
+			RasterVertex v[3];
+			for (int k{ 0 }; k < 3; ++k)
+			{
+				size_t index{ indices != nullptr ? indices[i * 3 + k] : i * 3 + k };
+				if (index >= vertexCount)
+				{
+					index = 0;
+				}
+				v[k] = vertices[index];
+			}
+
+			++workerStatistics[worker].trianglesSubmitted;
+			setupTriangle(v, worker, target.getWidth(), target.getHeight());
+		}
+	});
+
+	// rasterization: workers pull tiles
+	atomic<uint32_t> nextTile{ 0 };
+	runParallel([&](unsigned)
+	{
+		for (uint32_t tile{ nextTile++ }; tile < tileCount; tile = nextTile++)
+		{
+			rasterizeTile(target, tile % tilesX, tile / tilesX, tile);
+		}
+	});
+
+	for (RasterStatistics& s : workerStatistics)
+	{
+		statistics.trianglesSubmitted += s.trianglesSubmitted;
+		statistics.trianglesCulled += s.trianglesCulled;
+		statistics.trianglesClipped += s.trianglesClipped;
+		statistics.trianglesRasterized += s.trianglesRasterized;
+		s = RasterStatistics{};
+	}
+}
+
+void SoftwareRasterizer::drawPatches(RenderImage& target, const PatchModel& model, const Float4x4& worldViewProj, int tessFactor)
+{
+	size_t patchCount{ model.getPatchCount() };
+	size_t vertexCount{ teapot_tutorial::getGridVertexCount(tessFactor) };
+	size_t indexCount{ teapot_tutorial::getGridIndexCount(tessFactor) };
+
+	patchVertices.resize(patchCount * vertexCount);
+	patchIndices.resize(patchCount * indexCount);
+
+	// hull + domain stage: every worker evaluates a range of patches into its slice of the output
+	runParallel([&](unsigned worker)
+	{
+		vector<Float3> positions(vertexCount);
+
+		size_t begin{ patchCount * worker / threadCount };
+		size_t end{ patchCount * (worker + 1) / threadCount };
+		for (size_t patch{ begin }; patch < end; ++patch)
+		{
+			teapot_tutorial::tessellatePatch(model, patch, tessFactor, positions.data());
+			teapot_tutorial::writeGridIndices(tessFactor, static_cast<uint32_t>(patch * vertexCount), patchIndices.data() + patch * indexCount);
+
+			Float3 color{ patch < model.patchesColors.size() ? model.patchesColors[patch] : Float3{ 1.0f, 1.0f, 1.0f } };
+			RasterVertex* out{ patchVertices.data() + patch * vertexCount };
+			for (size_t i{ 0 }; i < vertexCount; ++i)
+			{
+				out[i].position = math::transformPoint(positions[i], worldViewProj);
+				out[i].color = color;
+			}
+		}
+	});
+
+	drawTriangles(target, patchVertices.data(), patchVertices.size(), patchIndices.data(), patchIndices.size());
+}
+
+void SoftwareRasterizer::upscale(RenderImage& target, const RenderImage& source, int32_t left, int32_t top, int32_t right, int32_t bottom)
+{
+	left = max(left, 0);
+	top = max(top, 0);
+	right = min(right, static_cast<int32_t>(source.getWidth()));
+	bottom = min(bottom, static_cast<int32_t>(source.getHeight()));
+	if (right <= left || bottom <= top)
+	{
+		throw(runtime_error{ "Empty upscale source." });
+	}
+
+	float vx{ hasViewport ? viewport[0] : 0.0f };
+	float vy{ hasViewport ? viewport[1] : 0.0f };
+	float vw{ hasViewport ? viewport[2] : static_cast<float>(target.getWidth()) };
+	float vh{ hasViewport ? viewport[3] : static_cast<float>(target.getHeight()) };
+	int32_t clipLeft{ max(static_cast<int32_t>(floor(vx)), 0) };
+	int32_t clipTop{ max(static_cast<int32_t>(floor(vy)), 0) };
+	int32_t clipRight{ min(static_cast<int32_t>(ceil(vx + vw)), static_cast<int32_t>(target.getWidth())) };
+	int32_t clipBottom{ min(static_cast<int32_t>(ceil(vy + vh)), static_cast<int32_t>(target.getHeight())) };
+	if (hasScissor)
+	{
+		clipLeft = max(clipLeft, scissor[0]);
+		clipTop = max(clipTop, scissor[1]);
+		clipRight = min(clipRight, scissor[2]);
+		clipBottom = min(clipBottom, scissor[3]);
+	}
+
+	const uint32_t* sourceColor{ source.getColorData() };
+	size_t sourcePitch{ source.getWidth() };
+	size_t targetPitch{ target.getWidth() };
+	float scaleX{ (right - left) / vw };
+	float scaleY{ (bottom - top) / vh };
+	for (int32_t y = clipTop; y < clipBottom; ++y)
+	{
+		// texel centers of the region, clamped so no texel outside it is filtered in
+		float sy{ min(max(top + (y + 0.5f - vy) * scaleY - 0.5f, static_cast<float>(top)), static_cast<float>(bottom - 1)) };
+		int32_t y0{ static_cast<int32_t>(sy) };
+		int32_t y1{ min(y0 + 1, bottom - 1) };
+		float fy{ sy - y0 };
+		for (int32_t x = clipLeft; x < clipRight; ++x)
+		{
+			float sx{ min(max(left + (x + 0.5f - vx) * scaleX - 0.5f, static_cast<float>(left)), static_cast<float>(right - 1)) };
+			int32_t x0{ static_cast<int32_t>(sx) };
+			int32_t x1{ min(x0 + 1, right - 1) };
+			float fx{ sx - x0 };
+			uint32_t upper{ lerpColor(sourceColor[y0 * sourcePitch + x0], sourceColor[y0 * sourcePitch + x1], fx) };
+			uint32_t lower{ lerpColor(sourceColor[y1 * sourcePitch + x0], sourceColor[y1 * sourcePitch + x1], fx) };
+			target.getColorData()[y * targetPitch + x] = lerpColor(upper, lower, fy);
+		}
+	}
+}
+
+unsigned SoftwareRasterizer::getThreadCount() const
+{
+	return threadCount;
+}
+
+const RasterStatistics& SoftwareRasterizer::getStatistics() const
+{
+	return statistics;
+}
+
+void SoftwareRasterizer::resetStatistics()
+{
+	statistics = RasterStatistics{};
+}
+
+void SoftwareRasterizer::runParallel(const function<void(unsigned)>& task)
+{
+	if (threadCount > 1)
+	{
+		lock_guard<std::mutex> lock{ mutex };
+		currentTask = &task;
+		pending = threadCount - 1;
+		++generation;
+	}
+	startCondition.notify_all();
+
+	task(0);
+
+	if (threadCount > 1)
+	{
+		unique_lock<std::mutex> lock{ mutex };
+		doneCondition.wait(lock, [this]() { return pending == 0; });
+		currentTask = nullptr;
+	}
+}
+
+void SoftwareRasterizer::workerLoop(unsigned index)
+{
+	uint64_t seen{ 0 };
+	for (;;)
+	{
+		const function<void(unsigned)>* task;
+		{
+			unique_lock<std::mutex> lock{ mutex };
+			startCondition.wait(lock, [&]() { return stopping || generation != seen; });
+			if (stopping)
+			{
+				return;
+			}
+			seen = generation;
+			task = currentTask;
+		}
+
+		(*task)(index);
+
+		{
+			lock_guard<std::mutex> lock{ mutex };
+			--pending;
+		}
+		doneCondition.notify_one();
+	}
+}
+
+void SoftwareRasterizer::setupTriangle(const RasterVertex* input, unsigned worker, uint32_t targetWidth, uint32_t targetHeight)
+{
+	RasterStatistics& stats{ workerStatistics[worker] };
+
+	unsigned outsideMask{ 0 };
+	for (int p{ 0 }; p < 6; ++p)
+	{
+		unsigned outsideCount{ 0 };
+		for (int k{ 0 }; k < 3; ++k)
+		{
+			if (planeDistance(input[k], clipPlanes[p]) < 0.0f)
+			{
+				++outsideCount;
+			}
+		}
+
+		if (outsideCount == 3)
+		{
+			++stats.trianglesCulled;
+			return;
+		}
+
+		if (outsideCount > 0)
+		{
+			outsideMask |= 1u << p;
+		}
+	}
+
+	RasterVertex polygon[maxClipVertices]{ input[0], input[1], input[2] };
+	bool edges[maxClipVertices]{ true, true, true };
+	int count{ 3 };
+	if (outsideMask != 0)
+	{
+		++stats.trianglesClipped;
+		count = clipPolygon(polygon, edges, count, outsideMask);
+	}
+
+	float vx{ hasViewport ? viewport[0] : 0.0f };
+	float vy{ hasViewport ? viewport[1] : 0.0f };
+	float vw{ hasViewport ? viewport[2] : static_cast<float>(targetWidth) };
+	float vh{ hasViewport ? viewport[3] : static_cast<float>(targetHeight) };
+	float minDepth{ hasViewport ? viewport[4] : 0.0f };
+	float maxDepth{ hasViewport ? viewport[5] : 1.0f };
+
+	int32_t clipLeft{ max(static_cast<int32_t>(floor(vx)), 0) };
+	int32_t clipTop{ max(static_cast<int32_t>(floor(vy)), 0) };
+	int32_t clipRight{ min(static_cast<int32_t>(ceil(vx + vw)), static_cast<int32_t>(targetWidth)) - 1 };
+	int32_t clipBottom{ min(static_cast<int32_t>(ceil(vy + vh)), static_cast<int32_t>(targetHeight)) - 1 };
+	if (hasScissor)
+	{
+		clipLeft = max(clipLeft, scissor[0]);
+		clipTop = max(clipTop, scissor[1]);
+		clipRight = min(clipRight, scissor[2] - 1);
+		clipBottom = min(clipBottom, scissor[3] - 1);
+	}
+
+	// screen space polygon, fanned into triangles
+	float sx[maxClipVertices];
+	float sy[maxClipVertices];
+	float sz[maxClipVertices];
+	float invW[maxClipVertices];
+	for (int i{ 0 }; i < count; ++i)
+	{
+		invW[i] = 1.0f / polygon[i].position.w;
+		sx[i] = vx + (polygon[i].position.x * invW[i] * 0.5f + 0.5f) * vw;
+		sy[i] = vy + (0.5f - polygon[i].position.y * invW[i] * 0.5f) * vh;
+		sz[i] = minDepth + polygon[i].position.z * invW[i] * (maxDepth - minDepth);
+	}
+
+	for (int f{ 1 }; f + 1 < count; ++f)
+	{
+		const int ids[3]{ 0, f, f + 1 };
+
+		RasterTriangle t;
+		for (int k{ 0 }; k < 3; ++k)
+		{
+			t.x[k] = sx[ids[k]];
+			t.y[k] = sy[ids[k]];
+			t.z[k] = sz[ids[k]];
+			t.invW[k] = invW[ids[k]];
+			t.colorOverW[k] = polygon[ids[k]].color * invW[ids[k]];
+		}
+		// the fan's own diagonals are not edges of the triangle being drawn
+		t.drawEdge[0] = f == 1 && edges[0];
+		t.drawEdge[1] = edges[f];
+		t.drawEdge[2] = f + 2 == count && edges[count - 1];
+
+		// positive area is clockwise on screen, the front face for FrontCounterClockwise = FALSE
+		float area{ (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]) };
+		if (area == 0.0f || (cullMode == RasterCullMode::Back && area < 0.0f) || (cullMode == RasterCullMode::Front && area > 0.0f))
+		{
+			++stats.trianglesCulled;
+			continue;
+		}
+
+		float sign{ area > 0.0f ? 1.0f : -1.0f };
+		for (int k{ 0 }; k < 3; ++k)
+		{
+			int i{ (k + 1) % 3 };
+			int j{ (k + 2) % 3 };
+			t.a[k] = sign * (t.y[i] - t.y[j]);
+			t.b[k] = sign * (t.x[j] - t.x[i]);
+			t.c[k] = sign * ((t.y[j] - t.y[i]) * t.x[i] - (t.x[j] - t.x[i]) * t.y[i]);
+			t.topLeft[k] = t.a[k] > 0.0f || (t.a[k] == 0.0f && t.b[k] > 0.0f);
+		}
+		t.invArea = 1.0f / fabs(area);
+
+		t.minX = max(static_cast<int32_t>(floor(min(min(t.x[0], t.x[1]), t.x[2]))), clipLeft);
+		t.minY = max(static_cast<int32_t>(floor(min(min(t.y[0], t.y[1]), t.y[2]))), clipTop);
+		t.maxX = min(static_cast<int32_t>(ceil(max(max(t.x[0], t.x[1]), t.x[2]))), clipRight);
+		t.maxY = min(static_cast<int32_t>(ceil(max(max(t.y[0], t.y[1]), t.y[2]))), clipBottom);
+		if (t.minX > t.maxX || t.minY > t.maxY)
+		{
+			++stats.trianglesCulled;
+			continue;
+		}
+
+		uint32_t index{ static_cast<uint32_t>(setupTriangles[worker].size()) };
+		setupTriangles[worker].push_back(t);
+		++stats.trianglesRasterized;
+
+		for (uint32_t ty{ static_cast<uint32_t>(t.minY) / tileSize }; ty <= static_cast<uint32_t>(t.maxY) / tileSize; ++ty)
+		{
+			for (uint32_t tx{ static_cast<uint32_t>(t.minX) / tileSize }; tx <= static_cast<uint32_t>(t.maxX) / tileSize; ++tx)
+			{
+				bins[worker][ty * tilesX + tx].push_back(index);
+			}
+		}
+	}
+}
+
+void SoftwareRasterizer::rasterizeTile(RenderImage& target, uint32_t tileX, uint32_t tileY, uint32_t tileIndex)
+{
+	int32_t tileLeft{ static_cast<int32_t>(tileX * tileSize) };
+	int32_t tileTop{ static_cast<int32_t>(tileY * tileSize) };
+	int32_t tileRight{ min(tileLeft + static_cast<int32_t>(tileSize), static_cast<int32_t>(target.getWidth())) - 1 };
+	int32_t tileBottom{ min(tileTop + static_cast<int32_t>(tileSize), static_cast<int32_t>(target.getHeight())) - 1 };
+
+	for (unsigned worker{ 0 }; worker < threadCount; ++worker)
+	{
+		const vector<RasterTriangle>& triangles{ setupTriangles[worker] };
+		for (uint32_t index : bins[worker][tileIndex])
+		{
+			const RasterTriangle& t{ triangles[index] };
+			int32_t x0{ max(t.minX, tileLeft) };
+			int32_t y0{ max(t.minY, tileTop) };
+			int32_t x1{ min(t.maxX, tileRight) };
+			int32_t y1{ min(t.maxY, tileBottom) };
+
+			if (fillMode == RasterFillMode::Solid)
+			{
+				rasterizeSolid(t, target, x0, y0, x1, y1);
+			}
+			else
+			{
+				for (int k{ 0 }; k < 3; ++k)
+				{
+					if (t.drawEdge[k])
+					{
+						rasterizeLine(t, k, (k + 1) % 3, target, x0, y0, x1, y1);
+					}
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MathTypes.h"
+#include "PatchModel.h"
+
+enum class RasterFillMode
+{
+	Solid,
+	Wireframe
+};
+
+enum class RasterCullMode
+{
+	None,
+	Front,
+	Back
+};
+
+// clip space position plus the COLOR the demo pixel shaders output
+struct RasterVertex
+{
+	Float4 position;
+	Float3 color;
+};
+
+namespace details
+{
+	// screen space triangle with edge equations a * x + b * y + c, edge k lying opposite vertex k
+	struct RasterTriangle
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+		float invW[3];
+		Float3 colorOverW[3];
+		float a[3];
+		float b[3];
+		float c[3];
+		bool topLeft[3];
+		// wireframe draws the edge from vertex k to vertex k + 1; clipping fans out triangles whose inner edges it skips
+		bool drawEdge[3];
+		float invArea;
+		int32_t minX;
+		int32_t minY;
+		int32_t maxX;
+		int32_t maxY;
+	};
+}
+
+// R8G8B8A8_UNORM color target with a D32_FLOAT depth buffer of the same size
+class RenderImage
+{
+public:
+	RenderImage(uint32_t width, uint32_t height);
+
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+	uint32_t* getColorData();
+	const uint32_t* getColorData() const;
+	float* getDepthData();
+	const float* getDepthData() const;
+	uint32_t getPixel(uint32_t x, uint32_t y) const;
+	float getDepth(uint32_t x, uint32_t y) const;
+
+	void savePpm(std::string path) const;
+	// binary PPM with a maximum value of 255, as savePpm writes it; alpha is opaque
+	static RenderImage loadPpm(std::string path);
+
+private:
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint32_t> color;
+	std::vector<float> depth;
+};
+
+struct RasterStatistics
+{
+	uint64_t trianglesSubmitted{ 0 };
+	uint64_t trianglesCulled{ 0 };
+	uint64_t trianglesClipped{ 0 };
+	uint64_t trianglesRasterized{ 0 };
+};
+
+// CPU implementation of the fixed function subset used by the demos: triangle lists (demo2), 16 control point
+// patch lists run through the hull/domain shader logic (demo3), LESS depth testing on D32 and solid or wireframe
+// fill. Triangles are set up and binned into 64x64 tiles in parallel, then tiles are rasterized in parallel with
+// SSE2 edge functions, preserving submission order inside each tile.
+class SoftwareRasterizer
+{
+public:
+	// threadCount 0 uses std::thread::hardware_concurrency()
+	SoftwareRasterizer(unsigned threadCount = 0);
+	~SoftwareRasterizer();
+
+	SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+	SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+	void setPipelineState(RasterFillMode fillMode, RasterCullMode cullMode);
+	void setViewport(float x, float y, float width, float height, float minDepth, float maxDepth);
+	void setScissorRect(int32_t left, int32_t top, int32_t right, int32_t bottom);
+
+	void clearRenderTarget(RenderImage& target, const float color[4]);
+	void clearDepth(RenderImage& target, float depth);
+
+	// indices may be null for a non indexed draw of vertexCount vertices
+	void drawTriangles(RenderImage& target, const RasterVertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+	void drawPatches(RenderImage& target, const PatchModel& model, const Float4x4& worldViewProj, int tessFactor);
+	// bilinear stretch of source's [left, right) x [top, bottom) region over the viewport, within the scissor
+	void upscale(RenderImage& target, const RenderImage& source, int32_t left, int32_t top, int32_t right, int32_t bottom);
+
+	unsigned getThreadCount() const;
+	const RasterStatistics& getStatistics() const;
+	void resetStatistics();
+
+private:
+	void runParallel(const std::function<void(unsigned)>& task);
+	void workerLoop(unsigned index);
+	void setupTriangle(const RasterVertex* v, unsigned worker, uint32_t targetWidth, uint32_t targetHeight);
+	void rasterizeTile(RenderImage& target, uint32_t tileX, uint32_t tileY, uint32_t tileIndex);
+
+private:
+	unsigned threadCount;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable startCondition;
+	std::condition_variable doneCondition;
+	const std::function<void(unsigned)>* currentTask{ nullptr };
+	uint64_t generation{ 0 };
+	unsigned pending{ 0 };
+	bool stopping{ false };
+
+	RasterFillMode fillMode{ RasterFillMode::Solid };
+	RasterCullMode cullMode{ RasterCullMode::None };
+	float viewport[6]{ 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	int32_t scissor[4]{ 0, 0, 0, 0 };
+	bool hasViewport{ false };
+	bool hasScissor{ false };
+
+	uint32_t tilesX{ 0 };
+	uint32_t tilesY{ 0 };
+	std::vector<std::vector<details::RasterTriangle>> setupTriangles;
+	std::vector<std::vector<std::vector<uint32_t>>> bins;
+	std::vector<RasterStatistics> workerStatistics;
+	std::vector<RasterVertex> patchVertices;
+	std::vector<uint32_t> patchIndices;
+	RasterStatistics statistics;
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+// Bounded single producer / single consumer ring. push and pop take no lock and never allocate. Each side keeps
+// a copy of the other side's index and only reads the shared one when the ring looks full or empty, so the two
+// threads share a cache line only when they have to.
+template <typename T, uint32_t Capacity>
+class SpscQueue
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two.");
+	static_assert(std::is_trivially_copyable<T>::value, "SpscQueue items are copied with plain stores.");
+
+public:
+	static const uint32_t capacity{ Capacity };
+
+	SpscQueue() = default;
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// producer only; false when full
+	bool push(const T& item)
+	{
+		uint64_t t{ tail.load(std::memory_order_relaxed) };
+		if (t - cachedHead == Capacity)
+		{
+			cachedHead = head.load(std::memory_order_acquire);
+			if (t - cachedHead == Capacity)
+			{
+				return false;
+			}
+		}
+		items[t & (Capacity - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only; false when empty
+	bool pop(T& item)
+	{
+		uint64_t h{ head.load(std::memory_order_relaxed) };
+		if (h == cachedTail)
+		{
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (h == cachedTail)
+			{
+				return false;
+			}
+		}
+		item = items[h & (Capacity - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// a snapshot, exact only from a side that is not running concurrently with the other
+	uint32_t getSize() const
+	{
+		return static_cast<uint32_t>(tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire));
+	}
+
+private:
+	// producer's line
+	std::atomic<uint64_t> tail{ 0 };
+	uint64_t cachedHead{ 0 };
+	char tailPadding[64 - sizeof(std::atomic<uint64_t>) - sizeof(uint64_t)];
+	// consumer's line
+	std::atomic<uint64_t> head{ 0 };
+	uint64_t cachedTail{ 0 };
+	char headPadding[64 - sizeof(std::atomic<uint64_t>) - sizeof(uint64_t)];
+	T items[Capacity];
+};
\ No newline at end of file
@@ -4,7 +4,7 @@
 // https://www.sjbaker.org/wiki/index.php?title=The_History_of_The_Teapot
 // http://www.gamasutra.com/view/feature/131755/curved_surfaces_using_bzier_.php?print=1
 
-std::vector<DirectX::XMFLOAT3> TeapotData::points
+std::vector<Float3> TeapotData::points
 {
 	{0.2000f, 0.0000f, 2.70000f},
 	{0.2000f, -0.1120f, 2.70000f},
@@ -167,32 +167,32 @@ std::vector<uint32_t> TeapotData::patches
 	80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95
 };
 
-std::vector<DirectX::XMFLOAT4X4> TeapotData::patchesTransforms
+std::vector<Float4x4> TeapotData::patchesTransforms
 {
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(0.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(90.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(180.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(270.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(0.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(90.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(180.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(270.0f), 0.0f),
 
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(0.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(90.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(180.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(270.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(0.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(90.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(180.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(270.0f), 0.0f),
 
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(0.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(90.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(180.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(270.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(0.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(90.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(180.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(270.0f), 0.0f),
 
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(0.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(90.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(180.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(270.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(0.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(90.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(180.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(270.0f), 0.0f),
 
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(0.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(90.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(180.0f), 0.0f),
-	getRotationMatrix(0.0f, DirectX::XMConvertToRadians(270.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(0.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(90.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(180.0f), 0.0f),
+	getRotationMatrix(0.0f, math::toRadians(270.0f), 0.0f),
 
 	getScalingMatrix(1.0f, 1.0f, 1.0f),
 	getScalingMatrix(1.0f, -1.0f, 1.0f),
@@ -207,7 +207,7 @@ std::vector<DirectX::XMFLOAT4X4> TeapotData::patchesTransforms
 	getScalingMatrix(1.0f, -1.0f, 1.0f)
 };
 
-std::vector<DirectX::XMFLOAT3> TeapotData::patchesColors
+std::vector<Float3> TeapotData::patchesColors
 {
 	{ static_cast<float>(std::rand()) / RAND_MAX, static_cast<float>(std::rand()) / RAND_MAX, static_cast<float>(std::rand()) / RAND_MAX },
 	{ static_cast<float>(std::rand()) / RAND_MAX, static_cast<float>(std::rand()) / RAND_MAX, static_cast<float>(std::rand()) / RAND_MAX },
@@ -1,27 +1,28 @@
 #pragma once
 
 #include <vector>
-#include <DirectXMath.h>
+#include "PatchModel.h"
 
 struct TeapotData
 {
-	static std::vector<DirectX::XMFLOAT3> points;
+	static std::vector<Float3> points;
 	static std::vector<uint32_t> patches;
-	static std::vector<DirectX::XMFLOAT4X4> patchesTransforms;
-	static std::vector<DirectX::XMFLOAT3> patchesColors;
+	static std::vector<Float4x4> patchesTransforms;
+	static std::vector<Float3> patchesColors;
+
+	static PatchModel getModel()
+	{
+		return{ points, patches, patchesTransforms, patchesColors };
+	}
 
 private:
-	static DirectX::XMFLOAT4X4 getRotationMatrix(float x, float y, float z)
+	static Float4x4 getRotationMatrix(float x, float y, float z)
 	{
-		DirectX::XMFLOAT4X4 tmp;
-		DirectX::XMStoreFloat4x4(&tmp, DirectX::XMMatrixRotationRollPitchYaw(x, z, y));
-		return tmp;
+		return math::rotationRollPitchYaw(x, z, y);
 	}
 
-	static DirectX::XMFLOAT4X4 getScalingMatrix(float x, float y, float z)
+	static Float4x4 getScalingMatrix(float x, float y, float z)
 	{
-		DirectX::XMFLOAT4X4 tmp;
-		DirectX::XMStoreFloat4x4(&tmp, DirectX::XMMatrixScaling(x, y, z));
-		return tmp;
+		return math::scaling(x, y, z);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,350 @@
+#include "TeapotRenderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#include "DynamicResolution.h"
+#include "FramePacer.h"
+#include "InputSystem.h"
+#include "TessellationBudget.h"
+#include "Trace.h"
+
+using namespace std;
+
+namespace
+{
+	PipelineId getMeshPipeline(PipelineId pipeline)
+	{
+		return pipeline == PipelineId::Solid ? PipelineId::SolidMesh : PipelineId::WireframeMesh;
+	}
+}
+
+TeapotRenderer::TeapotRenderer(uint32_t indexCount, int32_t width, int32_t height) : indexCount{ indexCount }, frameArena{ frameArenaSize },
+	frameTime(MetricsRegistry::getGlobal().getHistogram("teapot_frame_time_ns", "Time between the starts of consecutive frames.")),
+	recordTime(MetricsRegistry::getGlobal().getHistogram("teapot_cpu_record_ns", "CPU time spent recording the frame's command list.")),
+	fenceWaitTime(MetricsRegistry::getGlobal().getHistogram("teapot_fence_wait_ns", "Time blocked in waitFrameComplete.")),
+	inputToSubmitTime(MetricsRegistry::getGlobal().getHistogram("teapot_input_to_submit_ns", "Age of the newest latched input event when its frame was submitted.")),
+	renderScale(MetricsRegistry::getGlobal().getHistogram("teapot_render_scale_permille", "Dynamic resolution render size over output size, per axis.")),
+	tessellatedTriangles(MetricsRegistry::getGlobal().getHistogram("teapot_tessellated_triangles", "Triangles the tessellator produces for the frame."))
+{
+	viewport.topLeftX = 0.0f;
+	viewport.topLeftY = 0.0f;
+	viewport.width = static_cast<float>(width);
+	viewport.height = static_cast<float>(height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	scissorRect.left = 0;
+	scissorRect.top = 0;
+	scissorRect.right = width;
+	scissorRect.bottom = height;
+}
+
+void TeapotRenderer::render(RenderDevice& device, const FrameInput& input)
+{
+	TRACE_SCOPE("TeapotRenderer::render");
+
+	if (framePacer != nullptr)
+	{
+		pace(device);
+	}
+
+	uint64_t frameBeginNs{ Tracer::now() };
+	if (lastFrameBeginNs != 0)
+	{
+		frameTime.record(frameBeginNs - lastFrameBeginNs);
+	}
+	lastFrameBeginNs = frameBeginNs;
+
+	// the previous frame's commands were executed by the end of its render, so its scratch memory is free
+	frameArena.reset();
+
+	uint32_t frameIndex{ device.getCurrentBackBufferIndex() };
+
+	device.resetCommandAllocator(frameIndex);
+	gpuProfiler.beginFrame(device, frameIndex);
+	uint64_t gpuFrameNs{ gpuProfiler.getResolvedFrameNs() };
+	if (framePacer != nullptr && gpuFrameNs != 0)
+	{
+		framePacer->onGpuFrameMeasured(gpuFrameNs);
+	}
+
+	ScissorRect sceneRect{ scissorRect };
+	if (dynamicResolution != nullptr)
+	{
+		if (gpuFrameNs != 0)
+		{
+			dynamicResolution->update(gpuFrameNs);
+		}
+		dynamicResolution->getRenderSize(scissorRect.right, scissorRect.bottom, sceneRect.right, sceneRect.bottom);
+		renderScale.record(static_cast<uint64_t>(dynamicResolution->getScale() * 1000.0f + 0.5f));
+	}
+	Viewport sceneViewport{ viewport };
+	sceneViewport.width = static_cast<float>(sceneRect.right);
+	sceneViewport.height = static_cast<float>(sceneRect.bottom);
+
+	uint64_t patchCount{ indexCount / PatchModel::controlPointsPerPatch };
+	appliedTessFactor = teapot_tutorial::chooseTessFactor(tessFactor, triangleBudget, patchCount, 1);
+	const LodLevel* mesh{ nullptr };
+	if (lodChain != nullptr)
+	{
+		// from the input the frame is recorded with; the late latched MVP is too late to pick the draw, and
+		// the hysteresis covers the difference
+		float wantedFactor{ lodChain->getWantedFactor(computeWorldViewProj(input), sceneViewport.height, lodSettings) };
+		lodLevel = lodChain->selectLevel(wantedFactor, lodLevel, appliedTessFactor, lodSettings);
+		if (lodLevel != LodChain::tessellateLevel)
+		{
+			mesh = &lodChain->getLevels()[lodLevel];
+			appliedTessFactor = mesh->factor;
+		}
+	}
+	tessellatedTriangles.record(teapot_tutorial::getTessellationCounts(appliedTessFactor, patchCount, 1).triangles);
+
+	CommandList& commandList{ device.getCommandList() };
+	{
+		TRACE_SCOPE("record");
+		uint64_t recordBeginNs{ Tracer::now() };
+
+		commandList.reset(frameIndex);
+		uint32_t frameScope{ gpuProfiler.beginScope(commandList, "frame") };
+
+		commandList.setPipelineState(mesh != nullptr ? getMeshPipeline(pipeline) : pipeline);
+		commandList.setGraphicsRootSignature();
+		commandList.setViewport(sceneViewport);
+		commandList.setScissorRect(sceneRect);
+
+		static float clearColor[]{ 0.1f, 0.1f, 0.1f, 1.0f };
+		if (dynamicResolution != nullptr)
+		{
+			commandList.transitionSceneTarget(ResourceState::ShaderResource, ResourceState::RenderTarget);
+			commandList.setSceneRenderTarget();
+			commandList.clearSceneRenderTarget(clearColor);
+		}
+		else
+		{
+			commandList.transitionBackBuffer(frameIndex, ResourceState::Present, ResourceState::RenderTarget);
+			commandList.setRenderTarget(frameIndex);
+			commandList.clearRenderTarget(frameIndex, clearColor);
+		}
+		commandList.clearDepth(1.0f);
+
+		if (mesh != nullptr)
+		{
+			// the vertices are already tessellated, transformed by their patch and colored
+			commandList.setPrimitiveTopology(PrimitiveTopology::TriangleList);
+			commandList.setVertexBuffer(BufferId::LodVertices);
+			commandList.setGraphicsRootConstantBufferView(0, frameIndex);
+			commandList.setIndexBuffer(BufferId::LodIndices);
+
+			uint32_t drawScope{ gpuProfiler.beginScope(commandList, "draw teapot lod") };
+			commandList.drawIndexedInstanced(mesh->indexCount, 1, mesh->startIndex, mesh->baseVertex, 0);
+			gpuProfiler.endScope(commandList, drawScope);
+		}
+		else
+		{
+			commandList.setPrimitiveTopology(PrimitiveTopology::PatchList16);
+			commandList.setVertexBuffer(BufferId::ControlPoints);
+
+			int* rootConstants{ frameArena.allocate<int>(2) };
+			rootConstants[0] = appliedTessFactor;
+			rootConstants[1] = appliedTessFactor;
+			commandList.setGraphicsRoot32BitConstants(1, 2, rootConstants);
+
+			commandList.setGraphicsRootDescriptorTable(2);
+			commandList.setGraphicsRootConstantBufferView(0, frameIndex);
+
+			commandList.setIndexBuffer(BufferId::PatchIndices);
+
+			uint32_t drawScope{ gpuProfiler.beginScope(commandList, "draw teapot") };
+			commandList.drawIndexedInstanced(indexCount, 1, 0, 0, 0);
+			gpuProfiler.endScope(commandList, drawScope);
+		}
+
+		if (dynamicResolution != nullptr)
+		{
+			uint32_t upscaleScope{ gpuProfiler.beginScope(commandList, "upscale") };
+			commandList.transitionSceneTarget(ResourceState::RenderTarget, ResourceState::ShaderResource);
+			commandList.transitionBackBuffer(frameIndex, ResourceState::Present, ResourceState::RenderTarget);
+			commandList.setRenderTarget(frameIndex);
+			commandList.setViewport(viewport);
+			commandList.setScissorRect(scissorRect);
+			commandList.upscaleScene(sceneRect);
+			gpuProfiler.endScope(commandList, upscaleScope);
+		}
+
+		commandList.transitionBackBuffer(frameIndex, ResourceState::RenderTarget, ResourceState::Present);
+		gpuProfiler.endScope(commandList, frameScope);
+		gpuProfiler.endFrame(commandList);
+		commandList.close();
+		recordTime.record(Tracer::now() - recordBeginNs);
+	}
+
+	{
+		TRACE_SCOPE("submit");
+
+		// Late latch: the GPU reads the constant buffer when it executes the list, so the MVP is written after
+		// recording, from the newest input.
+		FrameInput latchedInput{ input };
+		uint32_t latchedEvents{ 0 };
+		uint64_t inputTimeNs{ 0 };
+		if (inputSystem != nullptr)
+		{
+			const InputState& state{ inputSystem->latch(latchedEvents) };
+			// a minimized window resizes to 0 x 0; keep the size the frame was recorded with
+			latchedInput = FrameInput{ state.width > 0 ? state.width : input.width, state.height > 0 ? state.height : input.height,
+				state.mouseX, state.mouseY, input.zoom };
+			inputTimeNs = state.timeNs;
+		}
+		Float4x4 mvpMatrix{ computeWorldViewProj(latchedInput) };
+		device.updateConstantBuffer(frameIndex, &mvpMatrix, sizeof(mvpMatrix));
+
+		uint64_t submitNs{ Tracer::now() };
+		device.executeCommandList();
+		// only frames that picked up new input, an idle mouse has no latency to report
+		if (latchedEvents > 0)
+		{
+			inputToSubmitTime.record(Tracer::now() - inputTimeNs);
+		}
+		device.present(1);
+		device.signal(frameIndex);
+
+		if (framePacer != nullptr)
+		{
+			framePacer->onFrameSubmitted(frameBeginNs, submitNs);
+			pacedFrameIndices[framePacer->getSubmittedFrames() % maxPacedBuffers] = frameIndex;
+			return;
+		}
+	}
+
+	{
+		TRACE_SCOPE("waitFrameComplete");
+		uint64_t waitBeginNs{ Tracer::now() };
+		device.waitFrameComplete(device.getCurrentBackBufferIndex());
+		fenceWaitTime.record(Tracer::now() - waitBeginNs);
+	}
+}
+
+void TeapotRenderer::pace(RenderDevice& device)
+{
+	TRACE_SCOPE("pace");
+
+	uint32_t bufferCount{ device.getBufferCount() };
+	if (bufferCount > maxPacedBuffers)
+	{
+		throw(runtime_error{ "Frame pacing supports at most 16 back buffers." });
+	}
+
+	// whatever the pacer allows, the next back buffer is only free once the frame that last used it completed
+	uint64_t submittedFrames{ framePacer->getSubmittedFrames() };
+	uint64_t bufferFrame{ submittedFrames + 1 > bufferCount ? submittedFrames + 1 - bufferCount : 0 };
+	uint64_t waitFrame{ max(framePacer->getFrameToWait(), bufferFrame) };
+	if (waitFrame != 0)
+	{
+		// its back buffer has not been used since, so the buffer's last signal is the frame's
+		uint32_t waitIndex{ pacedFrameIndices[waitFrame % maxPacedBuffers] };
+		bool blocked{ device.getFence(waitIndex).getCompletedValue() < device.getFenceValue(waitIndex) };
+		uint64_t waitBeginNs{ Tracer::now() };
+		device.waitFrameComplete(waitIndex);
+		uint64_t waitEndNs{ Tracer::now() };
+		fenceWaitTime.record(waitEndNs - waitBeginNs);
+		framePacer->onWaitReturned(waitFrame, waitEndNs, blocked);
+	}
+
+	uint64_t nowNs{ Tracer::now() };
+	uint64_t startNs{ framePacer->getStartTime(nowNs) };
+	if (startNs > nowNs)
+	{
+		this_thread::sleep_for(chrono::nanoseconds{ startNs - nowNs });
+	}
+}
+
+Float4x4 TeapotRenderer::computeWorldViewProj(const FrameInput& input)
+{
+	// at least one pixel, so an empty size gives a usable matrix instead of NaNs
+	float width{ static_cast<float>(max(input.width, 1)) };
+	float height{ static_cast<float>(max(input.height, 1)) };
+
+	float ratio{ width / height };
+	Float4x4 projMatrix{ math::perspectiveFovLH(math::toRadians(45), ratio, 1.0f, 100.0f) };
+
+	Float3 camPosition{ 0.0f, 0.0f, -10.0f * pow(2.0f, input.zoom / 4.0f) };
+	Float3 camLookAt{ 0.0f, 0.0f, 0.0f };
+	Float3 camUp{ 0.0f, 1.0f, 0.0f };
+	Float4x4 viewMatrix{ math::lookAtLH(camPosition, camLookAt, camUp) };
+
+	Float4x4 viewProjMatrix{ math::multiply(viewMatrix, projMatrix) };
+
+	float pitch{ -math::toRadians((input.mouseX - (width / 2.0f)) / (width / 2.0f) * 180.0f) };
+	float roll{ math::toRadians((input.mouseY - (height / 2.0f)) / (height / 2.0f) * 180.0f) };
+
+	Float4x4 modelMatrixRotation{ math::rotationRollPitchYaw(roll, pitch, 0.0f) };
+	Float4x4 modelMatrixTranslation{ math::translation(0.0f, -1.0f, 0.0f) };
+	Float4x4 modelMatrix{ math::multiply(modelMatrixRotation, modelMatrixTranslation) };
+
+	return math::multiply(modelMatrix, viewProjMatrix);
+}
+
+void TeapotRenderer::setInputSystem(InputSystem* inputSystem)
+{
+	this->inputSystem = inputSystem;
+}
+
+void TeapotRenderer::setFramePacer(FramePacer* framePacer)
+{
+	this->framePacer = framePacer;
+	gpuProfiler.setFrameTimingEnabled(framePacer != nullptr || dynamicResolution != nullptr);
+}
+
+void TeapotRenderer::setDynamicResolution(DynamicResolution* dynamicResolution)
+{
+	this->dynamicResolution = dynamicResolution;
+	gpuProfiler.setFrameTimingEnabled(framePacer != nullptr || dynamicResolution != nullptr);
+}
+
+void TeapotRenderer::setTessFactor(int tessFactor)
+{
+	this->tessFactor = tessFactor;
+}
+
+void TeapotRenderer::setTriangleBudget(uint64_t triangleBudget)
+{
+	this->triangleBudget = triangleBudget;
+}
+
+void TeapotRenderer::setLodChain(const LodChain* lodChain, const LodSettings& settings)
+{
+	this->lodChain = lodChain;
+	lodSettings = settings;
+	lodLevel = LodChain::tessellateLevel;
+}
+
+void TeapotRenderer::setPipeline(PipelineId pipeline)
+{
+	this->pipeline = pipeline;
+}
+
+int TeapotRenderer::getTessFactor() const
+{
+	return tessFactor;
+}
+
+int TeapotRenderer::getAppliedTessFactor() const
+{
+	return appliedTessFactor;
+}
+
+bool TeapotRenderer::isLodMeshApplied() const
+{
+	return lodChain != nullptr && lodLevel != LodChain::tessellateLevel;
+}
+
+PipelineId TeapotRenderer::getPipeline() const
+{
+	return pipeline;
+}
+
+FrameArena& TeapotRenderer::getFrameArena()
+{
+	return frameArena;
+}
\ No newline at end of file
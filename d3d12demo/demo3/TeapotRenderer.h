@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include "FrameArena.h"
+#include "MathTypes.h"
+#include "GpuProfiler.h"
+#include "LodChain.h"
+#include "Metrics.h"
+#include "RenderDevice.h"
+
+class DynamicResolution;
+class FramePacer;
+class InputSystem;
+
+// window state sampled for one frame
+struct FrameInput
+{
+	int32_t width;
+	int32_t height;
+	int32_t mouseX;
+	int32_t mouseY;
+	// camera distance in steps of 2^(1/4) away from the default, closer when negative
+	int32_t zoom;
+};
+
+// The demo3 frame: camera and the command sequence recorded every frame, independent of the device it is
+// recorded against. Key handling lives in TeapotSimulation, which sets the tessellation factor and pipeline.
+class TeapotRenderer
+{
+public:
+	TeapotRenderer(uint32_t indexCount, int32_t width, int32_t height);
+
+	void render(RenderDevice& device, const FrameInput& input);
+
+	static Float4x4 computeWorldViewProj(const FrameInput& input);
+
+	// Set, the mouse position and window size come from inputSystem, latched right before the frame is
+	// submitted, instead of from the FrameInput passed to render. Null goes back to FrameInput.
+	void setInputSystem(InputSystem* inputSystem);
+	// Set, frames start when the pacer says instead of each frame waiting for the next back buffer at its end.
+	// Enables GPU frame timing, which the pacer's estimates come from.
+	void setFramePacer(FramePacer* framePacer);
+	// Set, the scene is rendered into the device's scene target at the size dynamicResolution picks from GPU
+	// frame times, then upscaled to the back buffer. Enables GPU frame timing.
+	void setDynamicResolution(DynamicResolution* dynamicResolution);
+	void setTessFactor(int tessFactor);
+	// Triangles the tessellator may produce per frame across all instances drawn, 0 for no limit. The factor set
+	// with setTessFactor becomes the most that is drawn with, lowered to the largest that fits the budget.
+	void setTriangleBudget(uint64_t triangleBudget);
+	// Set, the factor lodChain's levels are selected by from the model's projected size, and a level at or below
+	// the tessellation factor is drawn as a triangle list without tessellating. lodChain's levels have to be in
+	// the device's Lod buffers. Null always tessellates.
+	void setLodChain(const LodChain* lodChain, const LodSettings& settings = LodSettings{});
+	void setPipeline(PipelineId pipeline);
+	int getTessFactor() const;
+	// the factor the last frame was drawn with
+	int getAppliedTessFactor() const;
+	// whether the last frame drew a LodChain level instead of tessellating
+	bool isLodMeshApplied() const;
+	PipelineId getPipeline() const;
+
+	// scratch memory for the frame being recorded, reset at the start of every render
+	FrameArena& getFrameArena();
+
+private:
+	static const size_t frameArenaSize{ 64 * 1024 };
+	static const uint32_t maxPacedBuffers{ 16 };
+
+	void pace(RenderDevice& device);
+
+private:
+	uint32_t indexCount;
+	Viewport viewport;
+	ScissorRect scissorRect;
+	PipelineId pipeline{ PipelineId::Wireframe };
+	int tessFactor{ 8 };
+	int appliedTessFactor{ 8 };
+	uint64_t triangleBudget{ 0 };
+	const LodChain* lodChain{ nullptr };
+	LodSettings lodSettings;
+	uint32_t lodLevel{ LodChain::tessellateLevel };
+	InputSystem* inputSystem{ nullptr };
+	FramePacer* framePacer{ nullptr };
+	DynamicResolution* dynamicResolution{ nullptr };
+	// back buffer index of the paced frames, by frame number
+	uint32_t pacedFrameIndices[maxPacedBuffers];
+	GpuProfiler gpuProfiler;
+	FrameArena frameArena;
+
+	Histogram& frameTime;
+	Histogram& recordTime;
+	Histogram& fenceWaitTime;
+	Histogram& inputToSubmitTime;
+	Histogram& renderScale;
+	Histogram& tessellatedTriangles;
+	uint64_t lastFrameBeginNs{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "TeapotSimulation.h"
+
+using namespace std;
+
+TeapotSimulation::TeapotSimulation(int32_t width, int32_t height)
+{
+	snapshot.input = FrameInput{ width, height, 0, 0, 0 };
+	snapshot.tessFactor = 8;
+	snapshot.pipeline = PipelineId::Wireframe;
+	snapshot.captureCount = 0;
+	snapshot.sequence = 0;
+	snapshot.inputTimeNs = 0;
+}
+
+void TeapotSimulation::apply(const InputEvent& event)
+{
+	switch (event.type)
+	{
+	case InputEventType::KeyDown:
+		onKeyPress(event.key);
+		break;
+	case InputEventType::MouseMove:
+		snapshot.input.mouseX = event.x;
+		snapshot.input.mouseY = event.y;
+		break;
+	case InputEventType::Resize:
+		snapshot.input.width = event.x;
+		snapshot.input.height = event.y;
+		break;
+	}
+	snapshot.inputTimeNs = event.timeNs;
+	++snapshot.sequence;
+}
+
+uint32_t TeapotSimulation::update(InputQueue& queue)
+{
+	uint32_t count{ 0 };
+	InputEvent event;
+	while (queue.pop(event))
+	{
+		apply(event);
+		++count;
+	}
+	return count;
+}
+
+const FrameSnapshot& TeapotSimulation::getSnapshot() const
+{
+	return snapshot;
+}
+
+void TeapotSimulation::onKeyPress(uint32_t key)
+{
+	switch (key)
+	{
+	case 49:
+		--snapshot.tessFactor;
+		if (snapshot.tessFactor < 1) snapshot.tessFactor = 1;
+		break;
+	case 50:
+		++snapshot.tessFactor;
+		if (snapshot.tessFactor > 64) snapshot.tessFactor = 64;
+		break;
+	case 51:
+		snapshot.pipeline = PipelineId::Wireframe;
+		break;
+	case 52:
+		snapshot.pipeline = PipelineId::Solid;
+		break;
+	// '5' saves the next frame's command stream for offline replay
+	case 53:
+		++snapshot.captureCount;
+		break;
+	// '6' moves the camera away, '7' back towards the teapot
+	case 54:
+		++snapshot.input.zoom;
+		if (snapshot.input.zoom > 12) snapshot.input.zoom = 12;
+		break;
+	case 55:
+		--snapshot.input.zoom;
+		if (snapshot.input.zoom < -2) snapshot.input.zoom = -2;
+		break;
+	}
+}
\ No newline at end of file
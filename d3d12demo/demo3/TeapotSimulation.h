@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include "InputEvent.h"
+#include "TeapotRenderer.h"
+
+// everything the render thread needs from the simulation for one frame
+struct FrameSnapshot
+{
+	FrameInput input;
+	int tessFactor;
+	PipelineId pipeline;
+	// bumped by '5'; the render thread saves the command stream of a frame whenever it changes
+	uint32_t captureCount;
+	// one per published change
+	uint64_t sequence;
+	// Tracer::now() of the newest input event applied, 0 before the first
+	uint64_t inputTimeNs;
+};
+
+// Window state and key handling of demo3, advanced by the window's input events instead of querying the window
+// from the render thread.
+class TeapotSimulation
+{
+public:
+	TeapotSimulation(int32_t width, int32_t height);
+
+	void apply(const InputEvent& event);
+	// applies every queued event, returning how many
+	uint32_t update(InputQueue& queue);
+
+	const FrameSnapshot& getSnapshot() const;
+
+private:
+	void onKeyPress(uint32_t key);
+
+private:
+	FrameSnapshot snapshot;
+};
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "TessellationBudget.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include "PatchTessellator.h"
+
+using namespace std;
+
+namespace teapot_tutorial
+{
+	int getIntegerTessFactor(float factor)
+	{
+		if (!(factor > static_cast<float>(minTessFactor)))
+		{
+			return minTessFactor;
+		}
+		return clampTessFactor(static_cast<int>(min(ceil(factor), static_cast<float>(maxTessFactor))));
+	}
+
+	TessellationCounts getPatchTessellationCounts(int factor)
+	{
+		uint64_t n{ static_cast<uint64_t>(clampTessFactor(factor)) };
+		return{ (n + 1) * (n + 1), 2 * n * n };
+	}
+
+	TessellationCounts getTessellationCounts(int factor, uint64_t patchCount, uint32_t instanceCount)
+	{
+		TessellationCounts patch{ getPatchTessellationCounts(factor) };
+		uint64_t patches{ patchCount * instanceCount };
+		return{ patch.vertices * patches, patch.triangles * patches };
+	}
+
+	int chooseTessFactor(int requestedFactor, uint64_t triangleBudget, uint64_t patchCount, uint32_t instanceCount)
+	{
+		int requested{ clampTessFactor(requestedFactor) };
+		uint64_t patches{ patchCount * instanceCount };
+		if (triangleBudget == 0 || patches == 0)
+		{
+			return requested;
+		}
+
+		// 2n^2 * patches <= budget; the square root is only a guess, the counts decide
+		int factor{ clampTessFactor(static_cast<int>(sqrt(static_cast<double>(triangleBudget / patches) / 2.0))) };
+		while (factor < requested && getTessellationCounts(factor + 1, patchCount, instanceCount).triangles <= triangleBudget)
+		{
+			++factor;
+		}
+		while (factor > minTessFactor && getTessellationCounts(factor, patchCount, instanceCount).triangles > triangleBudget)
+		{
+			--factor;
+		}
+		return min(factor, requested);
+	}
+
+	TessellationBudgetResult runTessellationBudgetCheck(const PatchModel& model)
+	{
+		TessellationBudgetResult result;
+		result.patches = model.getPatchCount();
+		result.factorsChecked = 0;
+		result.budgetsChecked = 0;
+
+		// reference triangles per instance, by factor
+		vector<uint64_t> referenceTriangles(maxTessFactor + 1, 0);
+		TessellatedMesh mesh;
+		for (int factor = minTessFactor; factor <= maxTessFactor; ++factor)
+		{
+			tessellate(model, factor, mesh);
+			uint64_t triangles{ 0 };
+			for (size_t i = 0; i < mesh.indices.size(); i += 3)
+			{
+				const uint32_t* triangle{ &mesh.indices[i] };
+				if (triangle[0] >= mesh.positions.size() || triangle[1] >= mesh.positions.size() || triangle[2] >= mesh.positions.size())
+				{
+					throw(runtime_error{ "Reference tessellation index out of range." });
+				}
+				triangles += triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[0] != triangle[2] ? 1 : 0;
+			}
+
+			TessellationCounts counts{ getTessellationCounts(factor, result.patches, 1) };
+			if (counts.vertices != mesh.positions.size() || counts.triangles != triangles || triangles != mesh.getTriangleCount())
+			{
+				throw(runtime_error{ "Tessellation count model does not match the reference at factor " + to_string(factor) + "." });
+			}
+			referenceTriangles[factor] = triangles;
+			++result.factorsChecked;
+		}
+
+		for (float factor : { 0.0f, 0.5f, 1.0f, 1.01f, 7.5f, 8.0f, 63.2f, 100.0f })
+		{
+			int expected{ factor <= 1.0f ? 1 : factor > 64.0f ? 64 : static_cast<int>(factor) + (factor != static_cast<int>(factor) ? 1 : 0) };
+			if (getIntegerTessFactor(factor) != expected)
+			{
+				throw(runtime_error{ "Integer partitioning rounded " + to_string(factor) + " wrong." });
+			}
+		}
+
+		for (uint32_t instances = 1; instances <= 4; ++instances)
+		{
+			for (int step = minTessFactor; step <= maxTessFactor; ++step)
+			{
+				uint64_t stepTriangles{ referenceTriangles[step] * instances };
+				for (uint64_t budget : { stepTriangles - 1, stepTriangles, stepTriangles + 1 })
+				{
+					for (int requested : { maxTessFactor, 8 })
+					{
+						int factor{ chooseTessFactor(requested, budget, result.patches, instances) };
+						bool fits{ referenceTriangles[factor] * instances <= budget || factor == minTessFactor };
+						bool largest{ factor == requested || referenceTriangles[factor + 1] * instances > budget };
+						if (!fits || !largest || factor > requested)
+						{
+							throw(runtime_error{ "Tessellation factor " + to_string(factor) + " is not the largest within a budget of " +
+								to_string(budget) + " triangles." });
+						}
+						++result.budgetsChecked;
+					}
+				}
+			}
+		}
+
+		for (uint64_t budget : { 1000ull, 100000ull, 1000000ull, 10000000ull })
+		{
+			int factor{ chooseTessFactor(maxTessFactor, budget, result.patches, 1) };
+			result.sampleBudgets.push_back(budget);
+			result.sampleFactors.push_back(factor);
+			result.sampleTriangles.push_back(referenceTriangles[factor]);
+		}
+		return result;
+	}
+
+	string formatTessellationBudgetResult(const TessellationBudgetResult& result)
+	{
+		char text[256];
+		snprintf(text, sizeof(text), "tess model: exact for factors 1-%u on %llu patches, %u budgets checked\n",
+			result.factorsChecked, static_cast<unsigned long long>(result.patches), result.budgetsChecked);
+		string report{ text };
+		for (size_t i = 0; i < result.sampleBudgets.size(); ++i)
+		{
+			snprintf(text, sizeof(text), "tess budget %llu triangles: factor %d, %llu triangles\n",
+				static_cast<unsigned long long>(result.sampleBudgets[i]), result.sampleFactors[i],
+				static_cast<unsigned long long>(result.sampleTriangles[i]));
+			report += text;
+		}
+		return report;
+	}
+}
\ No newline at end of file
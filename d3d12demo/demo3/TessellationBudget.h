@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PatchModel.h"
+
+struct TessellationCounts
+{
+	uint64_t vertices;
+	uint64_t triangles;
+};
+
+// What HullShader.hlsl makes the tessellator produce: quad domain and integer partitioning, where a fractional
+// factor is rounded up, with the same factor n on every edge and inside. That is an n x n grid of quads split
+// in two, (n + 1)^2 vertices and 2n^2 triangles per patch, for every patch of every instance drawn.
+namespace teapot_tutorial
+{
+	// integer partitioning of a fractional factor: rounded up, then clamped to 1..64
+	int getIntegerTessFactor(float factor);
+
+	TessellationCounts getPatchTessellationCounts(int factor);
+	TessellationCounts getTessellationCounts(int factor, uint64_t patchCount, uint32_t instanceCount);
+
+	// The largest factor up to requestedFactor that keeps the triangles of patchCount patches in each of
+	// instanceCount instances within triangleBudget, or minTessFactor when even that does not fit. A budget of
+	// 0 is no budget.
+	int chooseTessFactor(int requestedFactor, uint64_t triangleBudget, uint64_t patchCount, uint32_t instanceCount);
+}
+
+struct TessellationBudgetResult
+{
+	uint64_t patches;
+	// factors whose model counts matched the reference tessellation
+	uint32_t factorsChecked;
+	// budget and instance count pairs whose chosen factor was the largest to fit by the reference counts
+	uint32_t budgetsChecked;
+	// a few of them, to show
+	std::vector<uint64_t> sampleBudgets;
+	std::vector<int> sampleFactors;
+	std::vector<uint64_t> sampleTriangles;
+};
+
+namespace teapot_tutorial
+{
+	// Checks the counts against tessellate() for every factor and chooseTessFactor against them for budgets
+	// around every step; throws on the first mismatch.
+	TessellationBudgetResult runTessellationBudgetCheck(const PatchModel& model);
+
+	std::string formatTessellationBudgetResult(const TessellationBudgetResult& result);
+}
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+using namespace std;
+using namespace details;
+
+namespace
+{
+	struct TraceRegistry
+	{
+		mutex lock;
+		vector<unique_ptr<TraceBuffer>> buffers;
+		vector<string> trackNames;
+	};
+
+	TraceRegistry& getRegistry()
+	{
+		static TraceRegistry registry;
+		return registry;
+	}
+
+	thread_local TraceBuffer* threadBuffer{ nullptr };
+
+	void appendEscaped(string& out, const char* text)
+	{
+		for (const char* c{ text }; *c != '\0'; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				out += '\\';
+			}
+			out += static_cast<unsigned char>(*c) < 0x20 ? ' ' : *c;
+		}
+	}
+}
+
+atomic<bool> Tracer::enabled{ false };
+
+TraceBuffer::TraceBuffer(uint32_t trackId) : trackId{ trackId }
+{
+}
+
+void TraceBuffer::push(const TraceEvent& event)
+{
+	uint64_t h{ head.load(memory_order_relaxed) };
+	if (h - tail.load(memory_order_acquire) >= capacity)
+	{
+		dropped.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+	events[h & (capacity - 1)] = event;
+	head.store(h + 1, memory_order_release);
+}
+
+void TraceBuffer::drain(vector<TraceEvent>& out)
+{
+	uint64_t t{ tail.load(memory_order_relaxed) };
+	uint64_t h{ head.load(memory_order_acquire) };
+	for (; t < h; ++t)
+	{
+		out.push_back(events[t & (capacity - 1)]);
+	}
+	tail.store(t, memory_order_release);
+}
+
+uint32_t TraceBuffer::getTrackId() const
+{
+	return trackId;
+}
+
+uint64_t TraceBuffer::getDroppedCount() const
+{
+	return dropped.load(memory_order_relaxed);
+}
+
+void Tracer::setEnabled(bool enable)
+{
+	enabled.store(enable, memory_order_relaxed);
+}
+
+bool Tracer::isEnabled()
+{
+	return enabled.load(memory_order_relaxed);
+}
+
+uint64_t Tracer::now()
+{
+	return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Tracer::setThreadName(const char* name)
+{
+	TraceBuffer& buffer{ getThreadBuffer() };
+	TraceRegistry& registry{ getRegistry() };
+	lock_guard<mutex> guard{ registry.lock };
+	registry.trackNames[buffer.getTrackId()] = name;
+}
+
+uint32_t Tracer::createTrack(const char* name)
+{
+	TraceRegistry& registry{ getRegistry() };
+	lock_guard<mutex> guard{ registry.lock };
+	registry.trackNames.push_back(name);
+	return static_cast<uint32_t>(registry.trackNames.size() - 1);
+}
+
+void Tracer::record(const char* name, uint64_t beginNs, uint64_t endNs, uint32_t trackId, uint32_t depth)
+{
+	if (isEnabled())
+	{
+		getThreadBuffer().push({ name, beginNs, endNs, trackId, depth });
+	}
+}
+
+void Tracer::collect(vector<TraceEvent>& out)
+{
+	TraceRegistry& registry{ getRegistry() };
+	lock_guard<mutex> guard{ registry.lock };
+	for (auto& buffer : registry.buffers)
+	{
+		buffer->drain(out);
+	}
+}
+
+uint64_t Tracer::getDroppedCount()
+{
+	TraceRegistry& registry{ getRegistry() };
+	lock_guard<mutex> guard{ registry.lock };
+	uint64_t dropped{ 0 };
+	for (auto& buffer : registry.buffers)
+	{
+		dropped += buffer->getDroppedCount();
+	}
+	return dropped;
+}
+
+string Tracer::toChromeJson(const vector<TraceEvent>& events)
+{
+	uint64_t origin{ UINT64_MAX };
+	for (const TraceEvent& event : events)
+	{
+		origin = min(origin, event.beginNs);
+	}
+
+	string json{ "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" };
+	bool first{ true };
+	char number[96];
+
+	{
+		TraceRegistry& registry{ getRegistry() };
+		lock_guard<mutex> guard{ registry.lock };
+		for (size_t track{ 0 }; track < registry.trackNames.size(); ++track)
+		{
+			json += first ? "\n" : ",\n";
+			first = false;
+			snprintf(number, sizeof(number), "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"", static_cast<unsigned>(track));
+			json += number;
+			appendEscaped(json, registry.trackNames[track].c_str());
+			json += "\"}}";
+		}
+	}
+
+	for (const TraceEvent& event : events)
+	{
+		json += first ? "\n" : ",\n";
+		first = false;
+		json += "{\"ph\":\"X\",\"name\":\"";
+		appendEscaped(json, event.name);
+		// timestamps are in microseconds, keep the nanoseconds as decimals
+		snprintf(number, sizeof(number), "\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			static_cast<unsigned>(event.trackId),
+			(event.beginNs - origin) / 1000.0,
+			(event.endNs - event.beginNs) / 1000.0);
+		json += number;
+	}
+
+	json += "\n]}\n";
+	return json;
+}
+
+void Tracer::writeChromeTrace(string path, const vector<TraceEvent>& events)
+{
+	ofstream file{ path, ios::binary | ios::trunc };
+	if (!file)
+	{
+		throw(runtime_error{ "Error creating trace file." });
+	}
+
+	string json{ toChromeJson(events) };
+	if (!file.write(json.data(), json.size()))
+	{
+		throw(runtime_error{ "Error writing trace file." });
+	}
+}
+
+TraceBuffer& Tracer::getThreadBuffer()
+{
+	if (threadBuffer == nullptr)
+	{
+		TraceRegistry& registry{ getRegistry() };
+		lock_guard<mutex> guard{ registry.lock };
+		uint32_t trackId{ static_cast<uint32_t>(registry.trackNames.size()) };
+		registry.trackNames.push_back("thread " + to_string(trackId));
+		registry.buffers.push_back(make_unique<TraceBuffer>(trackId));
+		threadBuffer = registry.buffers.back().get();
+	}
+	return *threadBuffer;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// one complete ("ph":"X") event; names must be string literals or otherwise outlive the trace
+struct TraceEvent
+{
+	const char* name;
+	uint64_t beginNs;
+	uint64_t endNs;
+	uint32_t trackId;
+	uint32_t depth;
+};
+
+namespace details
+{
+	// Single producer / single consumer ring owned by one thread. The owner appends without locking and drops
+	// events while the ring is full; Tracer::collect drains it from any thread.
+	class TraceBuffer
+	{
+	public:
+		static const uint32_t capacity{ 1 << 14 };
+
+		TraceBuffer(uint32_t trackId);
+
+		void push(const TraceEvent& event);
+		void drain(std::vector<TraceEvent>& out);
+
+		uint32_t getTrackId() const;
+		uint64_t getDroppedCount() const;
+
+		uint32_t depth{ 0 };
+
+	private:
+		uint32_t trackId;
+		std::atomic<uint64_t> head{ 0 };
+		std::atomic<uint64_t> tail{ 0 };
+		std::atomic<uint64_t> dropped{ 0 };
+		TraceEvent events[capacity];
+	};
+}
+
+// Process wide CPU tracer. Every thread that records gets its own TraceBuffer on first use; recording is a
+// clock read and a ring append, and does nothing but test a flag while tracing is disabled.
+class Tracer
+{
+public:
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+
+	static uint64_t now();
+
+	// names the calling thread's track in exported traces
+	static void setThreadName(const char* name);
+	// a track not bound to a thread, e.g. a GPU queue; events are added to it with record()
+	static uint32_t createTrack(const char* name);
+
+	static void record(const char* name, uint64_t beginNs, uint64_t endNs, uint32_t trackId, uint32_t depth = 0);
+
+	// moves the recorded events of all threads into out
+	static void collect(std::vector<TraceEvent>& out);
+	static uint64_t getDroppedCount();
+
+	// Chrome trace event format, also loaded by Perfetto and about://tracing
+	static std::string toChromeJson(const std::vector<TraceEvent>& events);
+	static void writeChromeTrace(std::string path, const std::vector<TraceEvent>& events);
+
+	static details::TraceBuffer& getThreadBuffer();
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+class TraceScope
+{
+public:
+	TraceScope(const char* name) : name{ name }
+	{
+		if (Tracer::isEnabled())
+		{
+			buffer = &Tracer::getThreadBuffer();
+			depth = buffer->depth++;
+			beginNs = Tracer::now();
+		}
+	}
+
+	~TraceScope()
+	{
+		if (buffer != nullptr)
+		{
+			buffer->push({ name, beginNs, Tracer::now(), buffer->getTrackId(), depth });
+			--buffer->depth;
+		}
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char* name;
+	details::TraceBuffer* buffer{ nullptr };
+	uint64_t beginNs{ 0 };
+	uint32_t depth{ 0 };
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__){ name }
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the newest value from one writer thread to one reader thread without either ever waiting. The writer
+// fills its back buffer and publishes it by swapping it with the middle one; the reader swaps its front buffer
+// with the middle one when that holds something newer. The middle index and a "newer" bit share one atomic, so
+// each side does a single exchange and never touches the buffer the other side owns.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+
+	explicit TripleBuffer(const T& initial) : buffers{ initial, initial, initial }
+	{
+	}
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	// writer only
+	T& getWriteBuffer()
+	{
+		return buffers[backIndex];
+	}
+
+	// writer only; the write buffer afterwards is a stale one, rewrite it whole before the next publish
+	void publish()
+	{
+		backIndex = middle.exchange(backIndex | newerBit, std::memory_order_acq_rel) & indexMask;
+	}
+
+	// reader only; true when it took a buffer newer than the previous read buffer
+	bool update()
+	{
+		// only the writer changes middle meanwhile, and never clears the bit
+		if ((middle.load(std::memory_order_relaxed) & newerBit) == 0)
+		{
+			return false;
+		}
+		frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+		return true;
+	}
+
+	// reader only
+	const T& getReadBuffer() const
+	{
+		return buffers[frontIndex];
+	}
+
+private:
+	static const uint32_t indexMask{ 3 };
+	static const uint32_t newerBit{ 4 };
+
+	T buffers[3];
+	// writer's line
+	uint32_t backIndex{ 0 };
+	char backPadding[64 - sizeof(uint32_t)];
+	std::atomic<uint32_t> middle{ 1 };
+	char middlePadding[64 - sizeof(std::atomic<uint32_t>)];
+	// reader's line
+	uint32_t frontIndex{ 2 };
+};
\ No newline at end of file
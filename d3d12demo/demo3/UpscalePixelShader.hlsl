@@ -0,0 +1,24 @@
+cbuffer SourceRect : register(b0)
+{
+	float4 sourceRect;
+};
+
+Texture2D scene : register(t0);
+SamplerState linearClamp : register(s0);
+
+struct UpscaleToPixel
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD;
+};
+
+float4 main(UpscaleToPixel input) : SV_TARGET
+{
+	// keep the bilinear footprint inside the region, the rest of the target holds older frames
+	float2 size;
+	scene.GetDimensions(size.x, size.y);
+	float2 halfTexel = 0.5f / size;
+	float2 uv = clamp(input.uv, sourceRect.xy + halfTexel, sourceRect.zw - halfTexel);
+
+	return scene.Sample(linearClamp, uv);
+}
\ No newline at end of file
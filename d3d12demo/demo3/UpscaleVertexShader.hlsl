@@ -0,0 +1,23 @@
+// left, top, right, bottom of the rendered region of the scene target, in texture coordinates
+cbuffer SourceRect : register(b0)
+{
+	float4 sourceRect;
+};
+
+struct UpscaleToPixel
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD;
+};
+
+// one triangle covering the viewport, the region mapped onto it
+UpscaleToPixel main(uint vertexId : SV_VertexID)
+{
+	float2 corner = float2((vertexId << 1) & 2, vertexId & 2);
+
+	UpscaleToPixel output;
+	output.pos = float4(corner.x * 2.0f - 1.0f, 1.0f - corner.y * 2.0f, 0.0f, 1.0f);
+	output.uv = lerp(sourceRect.xy, sourceRect.zw, corner);
+
+	return output;
+}
\ No newline at end of file
@@ -4,14 +4,23 @@
 #include <d3d12.h>
 #include <vector>
 #include <string>
+#include <functional>
+#include <stdexcept>
+#include "AssetStream.h"
+#include "Metrics.h"
+#include "Trace.h"
 
 namespace details
 {
-	template<typename T>
-	Microsoft::WRL::ComPtr<ID3D12Resource> createDefaultBuffer(ID3D12Device* device, const std::vector<T>& data, D3D12_RESOURCE_STATES finalState, std::wstring name = L"")
+	// fill writes bufferSize bytes into the mapped upload heap before the copy is recorded
+	inline Microsoft::WRL::ComPtr<ID3D12Resource> createDefaultBuffer(ID3D12Device* device, UINT64 bufferSize, const std::function<void(void*)>& fill, D3D12_RESOURCE_STATES finalState, std::wstring name = L"")
 	{
-		UINT elementSize{ static_cast<UINT>(sizeof(T)) };
-		UINT bufferSize{ static_cast<UINT>(data.size() * elementSize) };
+		TRACE_SCOPE("details::createDefaultBuffer");
+
+		static Histogram& uploadSize(MetricsRegistry::getGlobal().getHistogram("teapot_upload_size_bytes", "Bytes per upload heap copy."));
+		static Counter& uploadTotal(MetricsRegistry::getGlobal().getCounter("teapot_upload_bytes_total", "Bytes copied through upload heaps."));
+		uploadSize.record(bufferSize);
+		uploadTotal.add(bufferSize);
 
 		D3D12_HEAP_PROPERTIES heapProps;
 		ZeroMemory(&heapProps, sizeof(heapProps));
@@ -46,7 +55,7 @@ namespace details
 
 		if (FAILED(hr))
 		{
-			throw(runtime_error{ "Error creating a default buffer." });
+			throw(std::runtime_error{ "Error creating a default buffer." });
 		}
 
 		defaultBuffer->SetName(name.c_str());
@@ -64,19 +73,19 @@ namespace details
 
 		if (FAILED(hr))
 		{
-			throw(runtime_error{ "Error creating an upload buffer." });
+			throw(std::runtime_error{ "Error creating an upload buffer." });
 		}
 
-		ComPtr<ID3D12CommandAllocator> commandAllocator;
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
 		if (FAILED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(commandAllocator.ReleaseAndGetAddressOf()))))
 		{
-			throw(runtime_error{ "Error creating a command allocator." });
+			throw(std::runtime_error{ "Error creating a command allocator." });
 		}
 
 		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList;
 		if (FAILED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator.Get(), nullptr, IID_PPV_ARGS(commandList.ReleaseAndGetAddressOf()))))
 		{
-			throw(runtime_error{ "Error creating a command list." });
+			throw(std::runtime_error{ "Error creating a command list." });
 		}
 
 		D3D12_COMMAND_QUEUE_DESC queueDesc;
@@ -89,16 +98,16 @@ namespace details
 		Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue;
 		if (FAILED(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(commandQueue.ReleaseAndGetAddressOf()))))
 		{
-			throw(runtime_error{ "Error creating a command queue." });
+			throw(std::runtime_error{ "Error creating a command queue." });
 		}
 
 		void* pData;
 		if (FAILED(uploadBuffer->Map(0, NULL, &pData)))
 		{
-			throw(runtime_error{ "Failed map intermediate resource." });
+			throw(std::runtime_error{ "Failed map intermediate resource." });
 		}
 
-		memcpy(pData, data.data(), bufferSize);
+		fill(pData);
 		uploadBuffer->Unmap(0, NULL);
 
 		commandList->CopyBufferRegion(defaultBuffer.Get(), 0, uploadBuffer.Get(), 0, bufferSize);
@@ -122,33 +131,53 @@ namespace details
 		Microsoft::WRL::ComPtr<ID3D12Fence> fence;
 		if (FAILED(device->CreateFence(initialValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(fence.ReleaseAndGetAddressOf()))))
 		{
-			throw(runtime_error{ "Error creating a fence." });
+			throw(std::runtime_error{ "Error creating a fence." });
 		}
 
 		HANDLE fenceEventHandle{ CreateEvent(nullptr, FALSE, FALSE, nullptr) };
 		if (fenceEventHandle == NULL)
 		{
-			throw(runtime_error{ "Error creating a fence event." });
+			throw(std::runtime_error{ "Error creating a fence event." });
 		}
 
 		if (FAILED(commandQueue->Signal(fence.Get(), 1)))
 		{
-			throw(runtime_error{ "Error siganalling buffer uploaded." });
+			throw(std::runtime_error{ "Error siganalling buffer uploaded." });
 		}
 
 		if (FAILED(fence->SetEventOnCompletion(1, fenceEventHandle)))
 		{
-			throw(runtime_error{ "Failed set event on completion." });
+			throw(std::runtime_error{ "Failed set event on completion." });
 		}
 
 		DWORD wait{ WaitForSingleObject(fenceEventHandle, 10000) };
 		if (wait != WAIT_OBJECT_0)
 		{
-			throw(runtime_error{ "Failed WaitForSingleObject()." });
+			throw(std::runtime_error{ "Failed WaitForSingleObject()." });
 		}
 
 		return defaultBuffer;
 	}
+
+	template<typename T>
+	Microsoft::WRL::ComPtr<ID3D12Resource> createDefaultBuffer(ID3D12Device* device, const std::vector<T>& data, D3D12_RESOURCE_STATES finalState, std::wstring name = L"")
+	{
+		UINT64 bufferSize{ data.size() * sizeof(T) };
+		return createDefaultBuffer(device, bufferSize, [&data, bufferSize](void* pData) { memcpy(pData, data.data(), static_cast<size_t>(bufferSize)); }, finalState, name);
+	}
+
+	// decompresses the section straight into the mapped upload heap, throws unless its elements are Ts
+	template<typename T>
+	Microsoft::WRL::ComPtr<ID3D12Resource> createDefaultBuffer(ID3D12Device* device, AssetStreamReader& stream, AssetSectionId section, D3D12_RESOURCE_STATES finalState, std::wstring name = L"")
+	{
+		if (stream.getSectionStride(section) != sizeof(T))
+		{
+			throw(std::runtime_error{ "Asset stream section stride does not match the buffer's element size." });
+		}
+
+		UINT64 bufferSize{ stream.getSectionSize(section) };
+		return createDefaultBuffer(device, bufferSize, [&stream, section, bufferSize](void* pData) { stream.readSection(section, pData, bufferSize); }, finalState, name);
+	}
 }
 
 namespace teapot_tutorial
@@ -171,6 +200,24 @@ namespace teapot_tutorial
 		return details::createDefaultBuffer(device, data, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, name);
 	}
 
+	template<typename T>
+	Microsoft::WRL::ComPtr<ID3D12Resource> createVertexBuffer(ID3D12Device* device, AssetStreamReader& stream, AssetSectionId section, std::wstring name = L"")
+	{
+		return details::createDefaultBuffer<T>(device, stream, section, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, name);
+	}
+
+	template<typename T>
+	Microsoft::WRL::ComPtr<ID3D12Resource> createIndexBuffer(ID3D12Device* device, AssetStreamReader& stream, AssetSectionId section, std::wstring name = L"")
+	{
+		return details::createDefaultBuffer<T>(device, stream, section, D3D12_RESOURCE_STATE_INDEX_BUFFER, name);
+	}
+
+	template<typename T>
+	Microsoft::WRL::ComPtr<ID3D12Resource> createStructuredBuffer(ID3D12Device* device, AssetStreamReader& stream, AssetSectionId section, std::wstring name = L"")
+	{
+		return details::createDefaultBuffer<T>(device, stream, section, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, name);
+	}
+
 	template<typename T>
 	void createSrv(ID3D12Device* device, ID3D12DescriptorHeap* descHeap, int offset, ID3D12Resource* resource, size_t numElements)
 	{
@@ -1,5 +1,8 @@
 #include "Window.h"
+#include <windowsx.h>
 #include <stdexcept>
+#include "InputSystem.h"
+#include "Trace.h"
 
 using namespace std;
 
@@ -61,9 +64,28 @@ POINT Window::getSize()
 	return{ rect.right - rect.left, rect.bottom - rect.top };
 }
 
-void Window::addKeyPressCallback(shared_ptr<function<void(WPARAM)>> onKeyPress)
+void Window::setInputQueue(InputQueue* queue)
 {
-	this->onKeyPress = onKeyPress;
+	inputQueue = queue;
+}
+
+void Window::setInputSystem(InputSystem* inputSystem)
+{
+	this->inputSystem = inputSystem;
+}
+
+void Window::pushInput(InputEventType type, uint32_t key, int32_t x, int32_t y)
+{
+	InputEvent event{ type, key, x, y, Tracer::now() };
+	// drops the event while the simulation is a whole queue behind, which only a long modal move or size loop gets near
+	if (inputQueue != nullptr)
+	{
+		inputQueue->push(event);
+	}
+	if (inputSystem != nullptr)
+	{
+		inputSystem->push(event);
+	}
 }
 
 LRESULT CALLBACK Window::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
@@ -78,16 +100,22 @@ LRESULT CALLBACK Window::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 		SetWindowLongPtr(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(pCreateStruct->lpCreateParams));
 	}
 		break;
+	case WM_CLOSE:
+		// the window then lives until the process exits, after the render thread has stopped presenting to it
+		PostQuitMessage(0);
+		break;
 	case WM_DESTROY:
 		PostQuitMessage(0);
 		break;
 	case WM_KEYDOWN:
-		if (window->onKeyPress != nullptr)
-		{
-			(*window->onKeyPress)(wParam);
-		}
-		
+		window->pushInput(InputEventType::KeyDown, static_cast<uint32_t>(wParam), 0, 0);
+		break;
+	case WM_MOUSEMOVE:
+		window->pushInput(InputEventType::MouseMove, 0, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 		break;
+	case WM_SIZE:
+		window->pushInput(InputEventType::Resize, 0, LOWORD(lParam), HIWORD(lParam));
+		return DefWindowProc(hWnd, message, wParam, lParam);
 	default:
 		return DefWindowProc(hWnd, message, wParam, lParam);
 	}
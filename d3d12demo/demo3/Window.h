@@ -1,8 +1,9 @@
 #pragma once
 
 #include <Windows.h>
-#include <functional>
-#include <memory>
+#include "InputEvent.h"
+
+class InputSystem;
 
 class Window
 {
@@ -11,12 +12,18 @@ public:
 	HWND getHandle();
 	POINT getMousePosition();
 	POINT getSize();
-	void addKeyPressCallback(std::shared_ptr<std::function<void(WPARAM)>> onKeyPress);
+	// key, mouse and size messages are pushed to queue from the thread pumping the window's messages
+	void setInputQueue(InputQueue* queue);
+	// the same messages, timestamped for late latching on the render thread
+	void setInputSystem(InputSystem* inputSystem);
 
 private:
 	static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
+	void pushInput(InputEventType type, uint32_t key, int32_t x, int32_t y);
+
 private:
 	HWND hWnd;
-	std::shared_ptr<std::function<void(WPARAM)>> onKeyPress;
+	InputQueue* inputQueue{ nullptr };
+	InputSystem* inputSystem{ nullptr };
 };
\ No newline at end of file